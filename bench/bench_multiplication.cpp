@@ -0,0 +1,228 @@
+#include "matrix_multiplication.h"
+#include <algorithm>
+#include <cstdint>
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+// Benchmarks of the matrix_multiplication engines over several operand shapes.
+// Each benchmark takes {size, engine} arguments and reports:
+// - GOPS: billions of multiply-adds times two per second,
+// - BytesPerFlop: bytes of A, B and C over the operations of one product,
+//   i.e. the arithmetic intensity the engine has to turn into speed.
+// Run with --benchmark_out=results.json --benchmark_out_format=json to keep
+// the results for comparisons between releases.
+
+// Fills the matrix with reproducible values of the interval [-10, 9]
+void fillMatrixRandomly(Matrix<int>& A, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> dis(-10, 9);
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            A(i, j) = dis(gen);
+        }
+    }
+}
+
+// Fills the matrix with reproducible values of the interval [-1, 1]
+template <typename T>
+void fillMatrixRandomly(Matrix<T>& A, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<T> dis(-1, 1);
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            A(i, j) = dis(gen);
+        }
+    }
+}
+
+// Sets the counters of `count` products of an (m x k) by a (k x n) matrix
+// whose operands take `operandBytes` per element (the result takes 4 or more)
+void setCounters(benchmark::State& state, long m, long k, long n, long count = 1, int operandBytes = 4, int resultBytes = 4) {
+    double ops = 2.0 * m * k * n * count;
+    double bytes = (operandBytes * (m * k + k * n) + resultBytes * m * n) * static_cast<double>(count);
+    state.counters["GOPS"] = benchmark::Counter(ops / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["BytesPerFlop"] = bytes / ops;
+    state.SetLabel(simdIsaName(simdIsa()));
+}
+
+// Calibrates the tile sizes and starts the thread pool outside the timed loops
+void warmUp() {
+    tileSizes();
+    threadPool();
+}
+
+// Multiplies an (m x k) by a (k x n) matrix with the engine of state.range(1)
+void runProduct(benchmark::State& state, int m, int k, int n) {
+    Engine engine = static_cast<Engine>(state.range(1));
+    warmUp();
+    Matrix<int> A(m, k), B(k, n), C(m, n);
+    fillMatrixRandomly(A, 1);
+    fillMatrixRandomly(B, 2);
+
+    for (auto _ : state) {
+        multiply(A, B, C, engine);
+        benchmark::DoNotOptimize(C.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, m, k, n);
+}
+
+void BM_Square(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    runProduct(state, size, size, size);
+}
+
+// Tall-skinny result: (size x size) by (size x 16)
+void BM_TallSkinny(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    runProduct(state, size, size, 16);
+}
+
+// Short-fat result: (16 x size) by (size x size)
+void BM_ShortFat(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    runProduct(state, 16, size, size);
+}
+
+// Matrix-vector: (size x size) by (size x 1)
+void BM_MatrixVector(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    runProduct(state, size, size, 1);
+}
+
+// 1024 independent products of (size x size) matrices
+void BM_Batched(benchmark::State& state) {
+    const int count = 1024;
+    int size = static_cast<int>(state.range(0));
+    Engine engine = static_cast<Engine>(state.range(1));
+    warmUp();
+    std::vector<Matrix<int>> A(count, Matrix<int>(size, size));
+    std::vector<Matrix<int>> B(count, Matrix<int>(size, size));
+    std::vector<Matrix<int>> C(count, Matrix<int>(size, size));
+    for (int b = 0; b < count; ++b) {
+        fillMatrixRandomly(A[b], 2 * b + 1);
+        fillMatrixRandomly(B[b], 2 * b + 2);
+    }
+
+    for (auto _ : state) {
+        for (int b = 0; b < count; ++b) {
+            multiply(A[b], B[b], C[b], engine);
+        }
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, size, size, size, count);
+}
+
+// The same 1024 products through one strided multiplyBatched call
+void BM_BatchedApi(benchmark::State& state) {
+    const int count = 1024;
+    int size = static_cast<int>(state.range(0));
+    warmUp();
+    Matrix<int> A(count * size, size), B(count * size, size), C(count * size, size);
+    fillMatrixRandomly(A, 1);
+    fillMatrixRandomly(B, 2);
+    long stride = static_cast<long>(size) * size;
+
+    for (auto _ : state) {
+        multiplyBatched(count, size, size, size, A.data(), size, stride, B.data(), size, stride, C.data(), size, stride);
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, size, size, size, count);
+}
+
+// Square float and double products with the engine of state.range(1)
+template <typename T>
+void BM_SquareFloating(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    Engine engine = static_cast<Engine>(state.range(1));
+    warmUp();
+    Matrix<T> A(size, size), B(size, size), C(size, size);
+    fillMatrixRandomly(A, 1);
+    fillMatrixRandomly(B, 2);
+
+    for (auto _ : state) {
+        multiply(A, B, C, engine);
+        benchmark::DoNotOptimize(C.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, size, size, size, 1, sizeof(T), sizeof(T));
+}
+
+// Square quantized products with int32 results
+template <typename T>
+void BM_SquareQuantized(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    warmUp();
+    Matrix<T> A(size, size), B(size, size);
+    Matrix<std::int32_t> C(size, size);
+    std::mt19937 gen(1);
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            A(i, j) = static_cast<T>(gen());
+            B(i, j) = static_cast<T>(gen());
+        }
+    }
+    Quantization quant;
+    quant.zeroPoint = {3};
+
+    for (auto _ : state) {
+        multiplyQuantized(A, quant, B, quant, C);
+        benchmark::DoNotOptimize(C.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, size, size, size, 1, sizeof(T), 4);
+}
+
+// Square products of a CSR matrix with state.range(1) percent of non-zeros
+// by a dense one. GOPS counts the dense operations, to compare with BM_Square.
+void BM_SparseTimesDense(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    int percent = static_cast<int>(state.range(1));
+    warmUp();
+    Matrix<int> A(size, size), B(size, size), C(size, size);
+    std::mt19937 gen(1);
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            A(i, j) = static_cast<int>(gen() % 100) < percent ? static_cast<int>(gen() % 9) + 1 : 0;
+        }
+    }
+    fillMatrixRandomly(B, 2);
+    CsrMatrix<int> sparse(A);
+
+    for (auto _ : state) {
+        multiply(sparse, B, C);
+        benchmark::DoNotOptimize(C.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, size, size, size);
+}
+
+// Registers sizes from 8 to maxSize for every engine, skipping the sizes at
+// which the slower engines would take minutes per iteration.
+void sizesAndEngines(benchmark::internal::Benchmark* bench, int maxSize) {
+    const Engine engines[] = {Engine::Reference, Engine::Tiled, Engine::Simd, Engine::Parallel, Engine::Auto};
+    for (Engine engine : engines) {
+        int limit = maxSize;
+        if (engine == Engine::Reference) limit = std::min(limit, 512);
+        if (engine == Engine::Tiled) limit = std::min(limit, 2048);
+        for (int size = 8; size <= limit; size *= 2) {
+            bench->Args({size, static_cast<int>(engine)});
+        }
+    }
+    bench->ArgNames({"size", "engine"});
+}
+
+BENCHMARK(BM_Square)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 4096); })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TallSkinny)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 4096); })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ShortFat)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 4096); })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MatrixVector)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 4096); })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Batched)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 64); })->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SquareFloating, float)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 4096); })->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SquareFloating, double)->Apply([](benchmark::internal::Benchmark* b) { sizesAndEngines(b, 4096); })->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SquareQuantized, std::int8_t)->RangeMultiplier(2)->Range(8, 4096)->ArgName("size")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SquareQuantized, std::int16_t)->RangeMultiplier(2)->Range(8, 4096)->ArgName("size")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SparseTimesDense)->ArgsProduct({{256, 1024, 4096}, {1, 5, 10, 20}})->ArgNames({"size", "percent"})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BatchedApi)->DenseRange(2, 16, 2)->Arg(32)->Arg(64)->ArgName("size")->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,30 @@
+#ifndef ACCUMULATION_H
+#define ACCUMULATION_H
+
+#include <cstdint>
+
+#include "matrix.h"
+
+// Overflow-safe products. The SIMD kernels widen every product to 64 bits and
+// accumulate in int64, which is exact as long as each sum fits in 64 bits
+// (for instance for any int K when the operands are below 2^15 in magnitude).
+// Narrowing to int is fused with the write-back of each cache tile, so no
+// separate pass over C is needed. All functions throw std::invalid_argument
+// if the dimensions do not match.
+
+// How the int64 sums are stored into an int result.
+// - Wrap: modulo 2^32, computed by the int engines of multiply().
+// - Checked: throws std::overflow_error, after computing all of C, if any
+//   element does not fit in an int.
+// - Saturate: clamps every element to [INT_MIN, INT_MAX].
+enum class Accumulation { Wrap, Checked, Saturate };
+
+// Computes C = A * B with int64 accumulation and the given narrowing.
+void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C,
+              Accumulation accumulation);
+
+// Computes C = A * B with int64 accumulation and int64 results.
+void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B,
+              MatrixView<std::int64_t> C);
+
+#endif // ACCUMULATION_H
@@ -0,0 +1,49 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <exception>
+#include <functional>
+#include <future>
+
+#include "engine.h"
+#include "matrix.h"
+
+// Asynchronous products. multiplyAsync() only queues the product and returns;
+// a dispatcher thread runs the queued products one at a time, in submission
+// order, with the engines and thread pool of multiply(). The queue is
+// pipelined: while one product computes, a second thread prepares the next
+// one (checks its dimensions, picks its engine and packs B for the SIMD
+// engines), so packing no longer sits between consecutive products.
+//
+// A, B and C are not copied: they must stay valid, A and B unchanged, and C
+// untouched until the product completes.
+
+// Completes the future with the product, or with its exception (such as the
+// std::invalid_argument of a dimension mismatch).
+std::future<void> multiplyAsync(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                                MatrixView<int> C,
+                                Engine engine = Engine::Auto);
+std::future<void> multiplyAsync(ConstMatrixView<float> A,
+                                ConstMatrixView<float> B, MatrixView<float> C,
+                                Engine engine = Engine::Auto);
+std::future<void> multiplyAsync(ConstMatrixView<double> A,
+                                ConstMatrixView<double> B,
+                                MatrixView<double> C,
+                                Engine engine = Engine::Auto);
+
+// Calls done(nullptr) once the product completes, or done(error) with its
+// exception, on the dispatcher thread. Callbacks run in submission order;
+// they may submit more products but must neither throw nor wait for a
+// product submitted after their own.
+using MultiplyCallback = std::function<void(std::exception_ptr error)>;
+void multiplyAsync(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                   MatrixView<int> C, MultiplyCallback done,
+                   Engine engine = Engine::Auto);
+void multiplyAsync(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                   MatrixView<float> C, MultiplyCallback done,
+                   Engine engine = Engine::Auto);
+void multiplyAsync(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                   MatrixView<double> C, MultiplyCallback done,
+                   Engine engine = Engine::Auto);
+
+#endif // ASYNC_H
@@ -0,0 +1,30 @@
+#ifndef BATCHED_H
+#define BATCHED_H
+
+#include <vector>
+
+#include "matrix.h"
+
+// Batched products C[b] = A[b] * B[b] for b in [0, batch), computed in one
+// call. Products up to 10 x 10 x 10 are interleaved across SIMD lanes (one
+// product per lane); larger ones run the SIMD engine each. The batch is
+// spread over the shared thread pool. All variants throw
+// std::invalid_argument on invalid dimensions or leading dimensions.
+
+// Strided variant: A[b] is the m x k row-major matrix at A + b * strideA with
+// leading dimension lda, and likewise for B (k x n) and C (m x n).
+void multiplyBatched(int batch, int m, int k, int n, const int *A, int lda,
+                     long strideA, const int *B, int ldb, long strideB, int *C,
+                     int ldc, long strideC);
+
+// Pointer-array variant: A[b], B[b] and C[b] point to the matrices directly.
+void multiplyBatched(int batch, int m, int k, int n, const int *const *A,
+                     int lda, const int *const *B, int ldb, int *const *C,
+                     int ldc);
+
+// View variant: the products may have different shapes.
+void multiplyBatched(const std::vector<ConstMatrixView<int>> &A,
+                     const std::vector<ConstMatrixView<int>> &B,
+                     const std::vector<MatrixView<int>> &C);
+
+#endif // BATCHED_H
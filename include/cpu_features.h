@@ -0,0 +1,22 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Instruction sets with a dedicated micro-kernel, from least to most capable.
+// Avx512Vnni is AVX-512 with the BW and VNNI extensions, used by the int8 and
+// int16 dot-product kernels; the other kernels are those of Avx512.
+enum class SimdIsa { Scalar, Sse41, Avx2, Avx512, Avx512Vnni };
+
+// Most capable instruction set supported by this CPU (queried with cpuid) and
+// compiled into the library.
+SimdIsa detectSimdIsa();
+
+// Instruction set used by Engine::Simd; detectSimdIsa() unless overridden.
+SimdIsa simdIsa();
+
+// Forces the micro-kernels of a given instruction set, e.g. to compare them.
+// Throws std::invalid_argument if this CPU does not support it.
+void setSimdIsa(SimdIsa isa);
+
+const char *simdIsaName(SimdIsa isa);
+
+#endif // CPU_FEATURES_H
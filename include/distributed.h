@@ -0,0 +1,101 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <mpi.h>
+
+#include "matrix.h"
+
+// Distributed products over MPI, in the separate matrix_multiplication_mpi
+// library. Matrices are split in 2D blocks over a grid of processes, and
+// every process multiplies its blocks with multiply() (Engine::Auto), so the
+// local work runs on the same kernels and thread pool as a single process.
+
+// Processes of a communicator arranged in a rows x cols grid, row by row.
+// Collective over `comm`: every process must construct it with the same
+// arguments. Rows and cols of 0 pick a grid as square as possible; other
+// shapes throw std::invalid_argument unless rows * cols is the size of comm.
+class ProcessGrid {
+public:
+  explicit ProcessGrid(MPI_Comm comm, int rows = 0, int cols = 0);
+  ~ProcessGrid();
+  ProcessGrid(const ProcessGrid &) = delete;
+  ProcessGrid &operator=(const ProcessGrid &) = delete;
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  // Position of the calling process.
+  int row() const { return row_; }
+  int col() const { return col_; }
+
+  // The whole grid (periodic in both directions), the processes of the
+  // calling one's row, and those of its column, ranked by position.
+  MPI_Comm comm() const { return grid_; }
+  MPI_Comm rowComm() const { return rowComm_; }
+  MPI_Comm colComm() const { return colComm_; }
+
+private:
+  int rows_ = 0, cols_ = 0, row_ = 0, col_ = 0;
+  MPI_Comm grid_ = MPI_COMM_NULL;
+  MPI_Comm rowComm_ = MPI_COMM_NULL;
+  MPI_Comm colComm_ = MPI_COMM_NULL;
+};
+
+// Part `index` of `extent` indices split into `parts` near-equal ranges, the
+// first extent % parts of them one longer.
+struct BlockRange {
+  int begin;
+  int size;
+};
+BlockRange blockRange(int extent, int parts, int index);
+
+// - Summa: the owners of each panel of k broadcast it along their grid row
+//   (A) and column (B), and every process accumulates the panel product.
+//   Works on any grid; the next panels travel while one is multiplied.
+// - Cannon: after an initial skew, blocks of A shift left and blocks of B up
+//   by one process per step. Needs a square grid, and sends each block to a
+//   single neighbour instead of broadcasting it.
+enum class DistributedAlgorithm { Summa, Cannon };
+
+// C = A * B on block-distributed matrices, for an m x k A and a k x n B.
+// The process at (r, c) passes rows blockRange(m, grid.rows(), r) and
+// columns blockRange(k, grid.cols(), c) of A, rows blockRange(k,
+// grid.rows(), r) and columns blockRange(n, grid.cols(), c) of B, and the
+// same blocks of C as of A x B. Collective over the grid; throws
+// std::invalid_argument if a local block has the wrong size or Cannon runs
+// on a grid that is not square.
+void multiplyDistributed(const ProcessGrid &grid, int m, int k, int n,
+                         ConstMatrixView<int> A, ConstMatrixView<int> B,
+                         MatrixView<int> C,
+                         DistributedAlgorithm algorithm =
+                             DistributedAlgorithm::Summa);
+void multiplyDistributed(const ProcessGrid &grid, int m, int k, int n,
+                         ConstMatrixView<float> A, ConstMatrixView<float> B,
+                         MatrixView<float> C,
+                         DistributedAlgorithm algorithm =
+                             DistributedAlgorithm::Summa);
+void multiplyDistributed(const ProcessGrid &grid, int m, int k, int n,
+                         ConstMatrixView<double> A, ConstMatrixView<double> B,
+                         MatrixView<double> C,
+                         DistributedAlgorithm algorithm =
+                             DistributedAlgorithm::Summa);
+
+// The same for whole matrices held by the process of rank `root` in
+// grid.comm(): its A and B are scattered in blocks and C is gathered back
+// into its C. The matrices of the other processes are not used.
+void multiplyFromRoot(const ProcessGrid &grid, ConstMatrixView<int> A,
+                      ConstMatrixView<int> B, MatrixView<int> C,
+                      DistributedAlgorithm algorithm =
+                          DistributedAlgorithm::Summa,
+                      int root = 0);
+void multiplyFromRoot(const ProcessGrid &grid, ConstMatrixView<float> A,
+                      ConstMatrixView<float> B, MatrixView<float> C,
+                      DistributedAlgorithm algorithm =
+                          DistributedAlgorithm::Summa,
+                      int root = 0);
+void multiplyFromRoot(const ProcessGrid &grid, ConstMatrixView<double> A,
+                      ConstMatrixView<double> B, MatrixView<double> C,
+                      DistributedAlgorithm algorithm =
+                          DistributedAlgorithm::Summa,
+                      int root = 0);
+
+#endif // DISTRIBUTED_H
@@ -0,0 +1,23 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+// Engines that multiply() can run. Auto picks one from the operand shapes,
+// after routing small fixed sizes to unrolled kernels (fixed_matrix.h),
+// int operands of a special structure, when detection is on, to copies,
+// gathers, scalings or popcounts (structure.h), products with a dimension
+// of 1 (dot, matrix-vector, vector-matrix and outer products) to
+// vectorized, multithreaded streaming kernels, and mostly-zero operands to
+// Sparse.
+// - Reference: the plain triple loop.
+// - Tiled: cache-blocked loops with the tile sizes of tileSizes() (tiling.h).
+// - Simd: the same blocking around register-blocked micro-kernels for the
+//   instruction set picked at runtime (cpu_features.h).
+// - Parallel: Simd on 2D tiles of C spread over the shared thread pool
+//   (thread_pool.h).
+// - Strassen: Strassen-Winograd recursion down to strassenCrossover()
+//   (strassen.h), then the best classical engine for the remaining size.
+// - Sparse: compresses the sparser operand to CSR or CSC and skips its zeros
+//   (sparse.h).
+enum class Engine { Auto, Reference, Tiled, Simd, Parallel, Strassen, Sparse };
+
+#endif // ENGINE_H
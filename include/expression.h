@@ -0,0 +1,206 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+
+// Lazy matrix expressions. operator* on matrices, views and scalars only
+// records the factors of a product, and operator+ / operator- the matrix
+// added to it; nothing is computed until the expression is converted to a
+// Matrix or passed to evaluate(). Then
+// - a chain of three or more factors is multiplied in the order needing the
+//   fewest multiply-adds (see optimalChainOrder()), and
+// - the last product of alpha * A * B + beta * C runs in one pass, the
+//   kernels scaling A while they pack it and starting each tile of the
+//   result from beta * C, with no temporary for A * B.
+// The products use the Reference, Simd or Parallel engine by size, as Auto
+// does, but never Strassen.
+//
+// Expressions refer to their operands, which must outlive them: evaluate
+// them in the statement that builds them rather than keeping them in `auto`
+// variables, and do not build them from temporary matrices.
+//
+//   Matrix<float> D = 2.0f * A * B + 0.5f * C;
+//   evaluate(A * B + C, C.view());       // C += A * B, in place
+//   Matrix<double> E = A * B * C * D;    // cheapest parenthesization
+
+// Cheapest way to multiply a chain whose factor i is dims[i] x dims[i + 1]:
+// its number of multiply-adds and the parenthesization by factor index, such
+// as "((0 1) 2)". Throws std::invalid_argument for fewer than one factor or
+// negative dimensions.
+struct ChainOrder {
+  long long cost = 0;
+  std::string parenthesization;
+};
+ChainOrder optimalChainOrder(const std::vector<int> &dims);
+
+// scale * factors[0] * factors[1] * ...
+template <typename T> class ProductExpression {
+public:
+  explicit ProductExpression(ConstMatrixView<T> factor, T scale = T(1))
+      : factors_{factor}, scale_(scale) {}
+
+  // Throws std::invalid_argument if the inner dimensions do not match.
+  ProductExpression(const ProductExpression &left,
+                    const ProductExpression &right)
+      : factors_(left.factors_), scale_(left.scale_ * right.scale_) {
+    if (left.cols() != right.rows())
+      throw std::invalid_argument("expression: dimension mismatch");
+    factors_.insert(factors_.end(), right.factors_.begin(),
+                    right.factors_.end());
+  }
+
+  const std::vector<ConstMatrixView<T>> &factors() const { return factors_; }
+  T scale() const { return scale_; }
+  int rows() const { return factors_.front().rows(); }
+  int cols() const { return factors_.back().cols(); }
+
+  ProductExpression scaled(T scale) const {
+    ProductExpression result = *this;
+    result.scale_ = scale * scale_;
+    return result;
+  }
+
+  operator Matrix<T>() const;
+
+private:
+  std::vector<ConstMatrixView<T>> factors_;
+  T scale_;
+};
+
+// product + beta * addend
+template <typename T> class SumExpression {
+public:
+  // Throws std::invalid_argument if the shapes differ.
+  SumExpression(ProductExpression<T> product, T beta,
+                ConstMatrixView<T> addend)
+      : product_(std::move(product)), beta_(beta), addend_(addend) {
+    if (product_.rows() != addend.rows() || product_.cols() != addend.cols())
+      throw std::invalid_argument("expression: dimension mismatch");
+  }
+
+  // The addend is an evaluated product, owned by the expression.
+  SumExpression(ProductExpression<T> product, T beta,
+                std::shared_ptr<const Matrix<T>> addend)
+      : SumExpression(std::move(product), beta, addend->view()) {
+    owned_ = std::move(addend);
+  }
+
+  const ProductExpression<T> &product() const { return product_; }
+  T beta() const { return beta_; }
+  ConstMatrixView<T> addend() const { return addend_; }
+
+  operator Matrix<T>() const;
+
+private:
+  ProductExpression<T> product_;
+  T beta_;
+  ConstMatrixView<T> addend_;
+  std::shared_ptr<const Matrix<T>> owned_;
+};
+
+// Evaluates the expression into a new matrix, or into C, which must have its
+// shape. C may be the addend itself (C = A * B + C) but must not otherwise
+// overlap an operand of the last product.
+template <typename T> Matrix<T> evaluate(const ProductExpression<T> &product);
+template <typename T> Matrix<T> evaluate(const SumExpression<T> &sum);
+template <typename T>
+void evaluate(const ProductExpression<T> &product, MatrixView<T> C);
+template <typename T>
+void evaluate(const SumExpression<T> &sum, MatrixView<T> C);
+
+template <typename T> ProductExpression<T>::operator Matrix<T>() const {
+  return evaluate(*this);
+}
+
+template <typename T> SumExpression<T>::operator Matrix<T>() const {
+  return evaluate(*this);
+}
+
+namespace expression {
+
+// Matrices, views and products can be operands of the operators below.
+template <typename X> struct Operand {};
+template <typename T> struct Operand<Matrix<T>> {
+  using Type = T;
+};
+template <typename T> struct Operand<MatrixView<T>> {
+  using Type = std::remove_const_t<T>;
+};
+template <typename T> struct Operand<ProductExpression<T>> {
+  using Type = T;
+};
+template <typename X> using OperandType = typename Operand<X>::Type;
+
+template <typename T> ProductExpression<T> lift(const Matrix<T> &matrix) {
+  return ProductExpression<T>(matrix.view());
+}
+template <typename T> ProductExpression<T> lift(MatrixView<T> view) {
+  return ProductExpression<T>(ConstMatrixView<T>(view));
+}
+template <typename T> ProductExpression<T> lift(MatrixView<const T> view) {
+  return ProductExpression<T>(view);
+}
+template <typename T>
+const ProductExpression<T> &lift(const ProductExpression<T> &product) {
+  return product;
+}
+
+// The sum of two products evaluates the one with more factors and adds the
+// other to it.
+template <typename T>
+SumExpression<T> sum(const ProductExpression<T> &left, T beta,
+                     const ProductExpression<T> &right) {
+  if (right.factors().size() > 1 && left.factors().size() == 1)
+    return sum(right.scaled(beta), T(1), left);
+  if (right.factors().size() == 1)
+    return SumExpression<T>(left, beta * right.scale(), right.factors()[0]);
+  auto addend = std::make_shared<const Matrix<T>>(evaluate(right));
+  return SumExpression<T>(left, beta, std::move(addend));
+}
+
+} // namespace expression
+
+template <typename L, typename R, typename T = expression::OperandType<L>,
+          typename = std::enable_if_t<
+              std::is_same_v<T, expression::OperandType<R>>>>
+ProductExpression<T> operator*(const L &left, const R &right) {
+  return ProductExpression<T>(expression::lift(left),
+                              expression::lift(right));
+}
+
+template <typename X, typename T = expression::OperandType<X>>
+ProductExpression<T> operator*(expression::OperandType<X> scale,
+                               const X &operand) {
+  return expression::lift(operand).scaled(scale);
+}
+
+template <typename X, typename T = expression::OperandType<X>>
+ProductExpression<T> operator*(const X &operand,
+                               expression::OperandType<X> scale) {
+  return expression::lift(operand).scaled(scale);
+}
+
+template <typename L, typename R, typename T = expression::OperandType<L>,
+          typename = std::enable_if_t<
+              std::is_same_v<T, expression::OperandType<R>>>>
+SumExpression<T> operator+(const L &left, const R &right) {
+  return expression::sum(expression::lift(left), T(1),
+                         expression::lift(right));
+}
+
+template <typename L, typename R, typename T = expression::OperandType<L>,
+          typename = std::enable_if_t<
+              std::is_same_v<T, expression::OperandType<R>>>>
+SumExpression<T> operator-(const L &left, const R &right) {
+  return expression::sum(expression::lift(left), T(-1),
+                         expression::lift(right));
+}
+
+#endif // EXPRESSION_H
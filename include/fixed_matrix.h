@@ -0,0 +1,92 @@
+#ifndef FIXED_MATRIX_H
+#define FIXED_MATRIX_H
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "matrix.h"
+
+// Row-major matrix whose dimensions are known at compile time, stored inline
+// in a std::array. Usable in constant expressions.
+template <typename T, int Rows, int Cols> struct FixedMatrix {
+  static_assert(Rows > 0 && Cols > 0, "FixedMatrix dimensions must be positive");
+
+  std::array<T, static_cast<std::size_t>(Rows) * Cols> elements{};
+
+  static constexpr int rows() { return Rows; }
+  static constexpr int cols() { return Cols; }
+
+  constexpr T &operator()(int i, int j) { return elements[i * Cols + j]; }
+  constexpr const T &operator()(int i, int j) const {
+    return elements[i * Cols + j];
+  }
+
+  MatrixView<T> view() { return MatrixView<T>(elements.data(), Rows, Cols); }
+  MatrixView<const T> view() const {
+    return MatrixView<const T>(elements.data(), Rows, Cols);
+  }
+
+  constexpr bool operator==(const FixedMatrix &other) const {
+    for (std::size_t e = 0; e < elements.size(); ++e)
+      if (!(elements[e] == other.elements[e]))
+        return false;
+    return true;
+  }
+  constexpr bool operator!=(const FixedMatrix &other) const {
+    return !(*this == other);
+  }
+};
+
+// Integer products are accumulated in the matching unsigned type, so that
+// they wrap modulo 2^bits like the runtime engines instead of overflowing.
+template <typename T>
+using FixedAccumulator =
+    std::conditional_t<std::is_integral<T>::value,
+                       std::make_unsigned_t<std::common_type_t<T, unsigned>>,
+                       T>;
+
+// Calls f(std::integral_constant<int, 0>{}) ... f(<Count - 1>{}), unrolled.
+template <typename F, int... I>
+constexpr void unrollIndices(F &&f, std::integer_sequence<int, I...>) {
+  (f(std::integral_constant<int, I>{}), ...);
+}
+template <int Count, typename F> constexpr void unroll(F &&f) {
+  unrollIndices(f, std::make_integer_sequence<int, Count>{});
+}
+
+// Fully unrolled C = A * B for an M x K by K x N product on row-major data
+// with leading dimensions lda, ldb and ldc.
+template <int M, int K, int N, typename T>
+constexpr void fixedProduct(const T *A, int lda, const T *B, int ldb, T *C,
+                            int ldc) {
+  using Acc = FixedAccumulator<T>;
+  unroll<M>([&](auto i) {
+    unroll<N>([&](auto j) {
+      Acc sum = Acc();
+      unroll<K>([&](auto k) {
+        sum += static_cast<Acc>(A[i * lda + k]) *
+               static_cast<Acc>(B[k * ldb + j]);
+      });
+      C[i * ldc + j] = static_cast<T>(sum);
+    });
+  });
+}
+
+template <int M, int K, int N, typename T>
+constexpr FixedMatrix<T, M, N> multiply(const FixedMatrix<T, M, K> &A,
+                                        const FixedMatrix<T, K, N> &B) {
+  FixedMatrix<T, M, N> C;
+  fixedProduct<M, K, N>(A.elements.data(), K, B.elements.data(), N,
+                        C.elements.data(), N);
+  return C;
+}
+
+// Whether multiply() with Engine::Auto routes an m x k by k x n int product
+// to a compile-time specialized kernel: square 2, 3, 4 and 8, and the
+// vector-matrix (1 x n by n x n) and matrix-vector (n x n by n x 1) products
+// of those sizes.
+bool hasFixedSizeKernel(int m, int k, int n);
+
+#endif // FIXED_MATRIX_H
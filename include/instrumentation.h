@@ -0,0 +1,74 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <string>
+#include <vector>
+
+#include "engine.h"
+
+// Per-call profiles of the dense products (multiply() on views, including
+// its int64 and narrowing overloads, and multiplyAsync()). Recording is
+// compiled in only when the library is built with -DMATMUL_INSTRUMENTATION=ON;
+// otherwise the probes expand to nothing and the functions below report no
+// calls. The most recent callProfileCapacity calls are kept.
+
+constexpr int callProfileCapacity = 1024;
+
+// Hardware counters of all the threads that worked on a call, read through
+// perf_event_open (user space only). Not available when the kernel refuses
+// to open them, e.g. under a strict perf_event_paranoid or in a container.
+struct HardwareCounters {
+  bool available = false;
+  long long cycles = 0;
+  long long instructions = 0;
+  long long cacheReferences = 0;
+  long long cacheMisses = 0;
+
+  double instructionsPerCycle() const {
+    return cycles > 0 ? static_cast<double>(instructions) / cycles : 0.0;
+  }
+};
+
+struct CallProfile {
+  // Engine that ran the product (Auto when it took the fixed-size kernels)
+  // and element type: "int", "float", "double" or "int64".
+  Engine engine = Engine::Auto;
+  const char *type = "";
+  int m = 0;
+  int k = 0;
+  int n = 0;
+
+  // Start, in seconds since the first profiled call, and wall time.
+  double start = 0;
+  double seconds = 0;
+  // Thread time spent packing operands, running kernels and writing tiles of
+  // C back, summed over the threads of the call; a thread's time outside of
+  // these and of waiting for the pool counts as compute.
+  double packSeconds = 0;
+  double computeSeconds = 0;
+  double writebackSeconds = 0;
+  double gops = 0;
+
+  // Micro-kernel calls, tasks handed to the thread pool, threads of the pool
+  // (1 for serial engines), and the busy share of threads x wall time.
+  long microTiles = 0;
+  long tasks = 0;
+  int threads = 1;
+  double utilization = 0;
+
+  HardwareCounters counters;
+};
+
+// Whether the library was built with instrumentation.
+bool instrumentationEnabled();
+
+// Profiles of the most recent calls, oldest first, and their removal.
+std::vector<CallProfile> callProfiles();
+void clearCallProfiles();
+
+// Writes the recorded calls as a Chrome trace (chrome://tracing, Perfetto):
+// one event per call on the calling thread and one per pool task on the
+// thread that ran it. Throws std::system_error if the file cannot be written.
+void writeChromeTrace(const std::string &path);
+
+#endif // INSTRUMENTATION_H
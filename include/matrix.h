@@ -0,0 +1,175 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Allocator returning 64-byte aligned storage, so that rows of a Matrix start
+// on a cache line and can be loaded with aligned SIMD instructions.
+template <typename T, std::size_t Alignment = 64> struct AlignedAllocator {
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+  }
+  void deallocate(T *p, std::size_t) noexcept {
+    ::operator delete(p, std::align_val_t(Alignment));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept {
+    return false;
+  }
+};
+
+// Non-owning view over a row-major matrix. Consecutive rows are `ld` (leading
+// dimension) elements apart, so a view can describe a sub-block of a larger
+// matrix without copying it. MatrixView<const T> is the read-only flavour.
+template <typename T> class MatrixView {
+public:
+  MatrixView() = default;
+  MatrixView(T *data, int rows, int cols)
+      : data_(data), rows_(rows), cols_(cols), ld_(cols) {}
+  MatrixView(T *data, int rows, int cols, int ld)
+      : data_(data), rows_(rows), cols_(cols), ld_(ld) {
+    if (rows < 0 || cols < 0 || ld < cols)
+      throw std::invalid_argument("MatrixView: invalid dimensions");
+  }
+
+  // A mutable view converts implicitly to a read-only one.
+  template <typename U, typename = std::enable_if_t<
+                            std::is_same<const U, T>::value &&
+                            !std::is_same<U, T>::value>>
+  MatrixView(const MatrixView<U> &other)
+      : data_(other.data()), rows_(other.rows()), cols_(other.cols()),
+        ld_(other.ld()) {}
+
+  T *data() const { return data_; }
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int ld() const { return ld_; }
+  bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+  T *row(int i) const { return data_ + static_cast<std::size_t>(i) * ld_; }
+  T &operator()(int i, int j) const { return row(i)[j]; }
+
+  // Sub-block starting at (i, j) with the given size, sharing this storage.
+  MatrixView block(int i, int j, int rows, int cols) const {
+    return MatrixView(row(i) + j, rows, cols, ld_);
+  }
+
+private:
+  T *data_ = nullptr;
+  int rows_ = 0;
+  int cols_ = 0;
+  int ld_ = 0;
+};
+
+template <typename T> using ConstMatrixView = MatrixView<const T>;
+
+// Dense row-major matrix stored in a single contiguous, aligned buffer.
+// The leading dimension may be larger than the number of columns to pad rows.
+template <typename T> class Matrix {
+public:
+  Matrix() = default;
+  Matrix(int rows, int cols, T value = T())
+      : Matrix(rows, cols, cols, value) {}
+  Matrix(int rows, int cols, int ld, T value)
+      : rows_(rows), cols_(cols), ld_(ld) {
+    if (rows < 0 || cols < 0 || ld < cols)
+      throw std::invalid_argument("Matrix: invalid dimensions");
+    storage_.assign(static_cast<std::size_t>(rows) * ld, value);
+  }
+
+  // Copies a nested-vector matrix into contiguous storage.
+  explicit Matrix(const std::vector<std::vector<T>> &nested)
+      : Matrix(static_cast<int>(nested.size()),
+               nested.empty() ? 0 : static_cast<int>(nested[0].size())) {
+    for (int i = 0; i < rows_; ++i) {
+      if (static_cast<int>(nested[i].size()) != cols_)
+        throw std::invalid_argument("Matrix: ragged nested vector");
+      std::copy(nested[i].begin(), nested[i].end(), row(i));
+    }
+  }
+
+  // Copies the contents of a view (dropping any row padding).
+  explicit Matrix(MatrixView<const T> view) : Matrix(view.rows(), view.cols()) {
+    for (int i = 0; i < rows_; ++i)
+      std::copy(view.row(i), view.row(i) + cols_, row(i));
+  }
+
+  // Reinterprets the elements, in storage order, as an unpadded rows x cols
+  // matrix; rows * cols must equal rows() * ld().
+  void reshape(int rows, int cols) {
+    if (rows < 0 || cols < 0 ||
+        static_cast<std::size_t>(rows) * cols != storage_.size())
+      throw std::invalid_argument("Matrix: invalid dimensions");
+    rows_ = rows;
+    cols_ = cols;
+    ld_ = cols;
+  }
+
+  std::vector<std::vector<T>> toNested() const {
+    std::vector<std::vector<T>> nested(rows_);
+    for (int i = 0; i < rows_; ++i)
+      nested[i].assign(row(i), row(i) + cols_);
+    return nested;
+  }
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int ld() const { return ld_; }
+  bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+  T *data() { return storage_.data(); }
+  const T *data() const { return storage_.data(); }
+  T *row(int i) { return data() + static_cast<std::size_t>(i) * ld_; }
+  const T *row(int i) const {
+    return data() + static_cast<std::size_t>(i) * ld_;
+  }
+  T &operator()(int i, int j) { return row(i)[j]; }
+  const T &operator()(int i, int j) const { return row(i)[j]; }
+
+  MatrixView<T> view() { return MatrixView<T>(data(), rows_, cols_, ld_); }
+  MatrixView<const T> view() const {
+    return MatrixView<const T>(data(), rows_, cols_, ld_);
+  }
+  operator MatrixView<T>() { return view(); }
+  operator MatrixView<const T>() const { return view(); }
+
+  // Element-wise comparison, ignoring row padding.
+  bool operator==(const Matrix &other) const {
+    if (rows_ != other.rows_ || cols_ != other.cols_)
+      return false;
+    for (int i = 0; i < rows_; ++i)
+      if (!std::equal(row(i), row(i) + cols_, other.row(i)))
+        return false;
+    return true;
+  }
+  bool operator!=(const Matrix &other) const { return !(*this == other); }
+
+private:
+  std::vector<T, AlignedAllocator<T>> storage_;
+  int rows_ = 0;
+  int cols_ = 0;
+  int ld_ = 0;
+};
+
+#endif // MATRIX_H
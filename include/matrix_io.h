@@ -0,0 +1,32 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <string>
+
+#include "matrix.h"
+
+// Text formats of matrices. Files are mapped into memory and split into
+// chunks of whole lines that are parsed in parallel over the shared thread
+// pool; writers format chunks of the matrix in parallel as well. Errors of
+// the system calls throw std::system_error and malformed files throw
+// std::runtime_error naming the offending row or entry. Readers are
+// instantiated for int, float and double.
+
+// CSV: one row per line, fields separated by commas, with spaces and tabs
+// around them ignored. Blank lines are skipped; every row must have the same
+// number of fields.
+template <typename T> Matrix<T> readCsv(const std::string &path);
+void writeCsv(const std::string &path, MatrixView<const int> A);
+void writeCsv(const std::string &path, MatrixView<const float> A);
+void writeCsv(const std::string &path, MatrixView<const double> A);
+
+// Matrix Market exchange format: "array" files (dense, column by column) and
+// "coordinate" files (one 1-based "row col value" entry per line) with
+// integer, real or pattern fields, general or (coordinate only) symmetric.
+// The writers produce general array files.
+template <typename T> Matrix<T> readMatrixMarket(const std::string &path);
+void writeMatrixMarket(const std::string &path, MatrixView<const int> A);
+void writeMatrixMarket(const std::string &path, MatrixView<const float> A);
+void writeMatrixMarket(const std::string &path, MatrixView<const double> A);
+
+#endif // MATRIX_IO_H
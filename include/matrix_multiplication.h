@@ -3,6 +3,54 @@
 
 #include <vector>
 
+#include "accumulation.h"
+#include "async.h"
+#include "batched.h"
+#include "cpu_features.h"
+#include "engine.h"
+#include "expression.h"
+#include "fixed_matrix.h"
+#include "instrumentation.h"
+#include "matrix.h"
+#include "matrix_io.h"
+#include "numa_policy.h"
+#include "out_of_core.h"
+#include "product_cache.h"
+#include "quantized.h"
+#include "random_matrix.h"
+#include "sparse.h"
+#include "strassen.h"
+#include "structure.h"
+#include "thread_pool.h"
+#include "tiling.h"
+#include "transpose.h"
+#include "verification.h"
+
 void multiplyMatrices(const std::vector<std::vector<int>>& A, const std::vector<std::vector<int>>& B, std::vector<std::vector<int>>& C, int rowsA, int colsA, int colsB);
 
-#endif // MATRIX_MULTIPLICATION_H
\ No newline at end of file
+// Computes C = A * B on contiguous row-major matrices.
+// Integer products wrap modulo 2^32 on overflow, identically for every engine.
+// float and double use FMA micro-kernels where available; their results
+// depend on the engine up to rounding, and Auto never picks Strassen for them.
+// Throws std::invalid_argument if the dimensions do not match.
+void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C,
+              Engine engine = Engine::Auto);
+void multiply(ConstMatrixView<float> A, ConstMatrixView<float> B,
+              MatrixView<float> C, Engine engine = Engine::Auto);
+void multiply(ConstMatrixView<double> A, ConstMatrixView<double> B,
+              MatrixView<double> C, Engine engine = Engine::Auto);
+Matrix<int> multiply(const Matrix<int> &A, const Matrix<int> &B,
+                     Engine engine = Engine::Auto);
+Matrix<float> multiply(const Matrix<float> &A, const Matrix<float> &B,
+                       Engine engine = Engine::Auto);
+Matrix<double> multiply(const Matrix<double> &A, const Matrix<double> &B,
+                        Engine engine = Engine::Auto);
+
+// Adapter with the nested-vector signature of multiplyMatrices: copies the
+// operands into contiguous storage, multiplies, and copies the result back.
+void multiply(const std::vector<std::vector<int>> &A,
+              const std::vector<std::vector<int>> &B,
+              std::vector<std::vector<int>> &C, int rowsA, int colsA, int colsB,
+              Engine engine = Engine::Auto);
+
+#endif // MATRIX_MULTIPLICATION_H
@@ -0,0 +1,60 @@
+#ifndef NUMA_POLICY_H
+#define NUMA_POLICY_H
+
+#include <vector>
+
+// NUMA placement for the Parallel engine. With a policy set and more than one
+// node, the workers of the shared pool are split into contiguous groups, one
+// per node, each bound to the CPUs of its node; tiles of C are handed out in
+// bands of rows, so a node computes the same rows call after call, and idle
+// workers steal from their own node before crossing to another.
+//
+// - FirstTouch keeps the data a node works on in its own memory: every node
+//   packs its own replica of B (written, hence first touched, by one of its
+//   workers), packed panels of A live in per-thread buffers, and the pages
+//   of each band of C are migrated to the node that computes it.
+// - Interleave spreads C and the packed B, shared by all nodes, page by page
+//   over the nodes, which evens out the bandwidth when the bands are not
+//   stable.
+//
+// Memory is only placed when the library is built with libnuma and the
+// topology is the machine's; on a single node, or with a synthetic topology,
+// the policy only shapes the scheduling. Pages of C are migrated, not bound:
+// no memory policy is left on them once the call returns.
+
+enum class NumaPolicy { None, FirstTouch, Interleave };
+
+struct NumaNode {
+  int id = 0;
+  std::vector<int> cpus;
+};
+
+struct NumaTopology {
+  std::vector<NumaNode> nodes;
+  // Nodes that only partition the CPUs, with no memory of their own.
+  bool synthetic = false;
+
+  // The nodes with CPUs in the affinity mask of the process, from libnuma;
+  // one node holding every allowed CPU without libnuma or NUMA support.
+  static NumaTopology detect();
+
+  // `count` nodes splitting the allowed CPUs into contiguous groups, reusing
+  // CPUs round robin when there are fewer CPUs than nodes. Throws
+  // std::invalid_argument if count is not positive.
+  static NumaTopology makeSynthetic(int count);
+};
+
+// Whether the library was built with libnuma and the kernel supports it.
+bool numaAvailable();
+
+// Policy of the shared pool (None by default). Changing it rebuilds the pool.
+void setNumaPolicy(NumaPolicy policy);
+NumaPolicy numaPolicy();
+
+// Topology the shared pool follows under a policy: detect() unless set, e.g.
+// to a synthetic one for testing. Throws std::invalid_argument if it has no
+// nodes or a node without CPUs.
+void setNumaTopology(const NumaTopology &topology);
+NumaTopology numaTopology();
+
+#endif // NUMA_POLICY_H
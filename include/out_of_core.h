@@ -0,0 +1,102 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "matrix.h"
+
+// Element types of matrix files.
+enum class ElementType : std::uint32_t { Int32 = 1, Float32 = 2, Float64 = 3 };
+
+// Matrix stored in a binary file and accessed through a shared memory
+// mapping, so it can be larger than RAM. The file starts with a 4096-byte
+// header (magic "MATMUL01", format version, element type, rows, cols, tile
+// rows and tile cols, little-endian), followed by the tiles in row-major
+// order of tiles. Each tile is tileRows x tileCols elements, row-major, with
+// the tiles of the last row and column zero-padded to full size, so every
+// tile sits at a fixed offset and, when its size is a multiple of the page
+// size, on its own pages.
+//
+// Files are created with create() and opened with open(); errors of the
+// system calls throw std::system_error, files that are not matrix files of
+// element type T throw std::runtime_error and invalid arguments throw
+// std::invalid_argument. Instantiated for int, float and double.
+template <typename T> class MappedMatrix {
+public:
+  // Creates (or truncates) `path` for a rows x cols matrix of zeros and maps
+  // it for reading and writing.
+  static MappedMatrix create(const std::string &path, int rows, int cols,
+                             int tileRows, int tileCols);
+  // Maps an existing file, read-only unless `writable`.
+  static MappedMatrix open(const std::string &path, bool writable = false);
+
+  MappedMatrix() = default;
+  ~MappedMatrix();
+  MappedMatrix(MappedMatrix &&other) noexcept;
+  MappedMatrix &operator=(MappedMatrix &&other) noexcept;
+  MappedMatrix(const MappedMatrix &) = delete;
+  MappedMatrix &operator=(const MappedMatrix &) = delete;
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int tileRows() const { return tileRows_; }
+  int tileCols() const { return tileCols_; }
+  int tileRowCount() const { return (rows_ + tileRows_ - 1) / tileRows_; }
+  int tileColCount() const { return (cols_ + tileCols_ - 1) / tileCols_; }
+  bool writable() const { return writable_; }
+
+  // Tile (i, j) in place, trimmed to the matrix at the last row and column.
+  // writableTile() throws std::invalid_argument on read-only mappings.
+  MatrixView<const T> tile(int i, int j) const;
+  MatrixView<T> writableTile(int i, int j);
+
+  // Copies the block at (row, col) with the size of `block` out of the file
+  // or into it, across tiles.
+  void read(int row, int col, MatrixView<T> block) const;
+  void write(int row, int col, MatrixView<const T> block);
+
+  // Paging hints for the tiles overlapping a block: prefetch() starts
+  // reading them ahead, release() drops them from the memory of the process
+  // (written data stays in the file).
+  void prefetch(int row, int col, int rows, int cols) const;
+  void release(int row, int col, int rows, int cols) const;
+
+  // Writes the modified pages back to the file and waits for completion.
+  void flush();
+
+private:
+  static MappedMatrix map(const std::string &path, int fd, bool writable);
+  T *tileData(int i, int j) const;
+  template <typename Part>
+  void forEachTilePart(int row, int col, int rows, int cols, Part part) const;
+  template <typename Advice>
+  void adviseTiles(int row, int col, int rows, int cols, Advice advice) const;
+  void unmap() noexcept;
+
+  int fd_ = -1;
+  unsigned char *map_ = nullptr;
+  std::size_t size_ = 0;
+  int rows_ = 0;
+  int cols_ = 0;
+  int tileRows_ = 1;
+  int tileCols_ = 1;
+  bool writable_ = false;
+};
+
+// Element type of the matrix file at `path`, to pick the MappedMatrix to
+// open it with. Throws like MappedMatrix::open().
+ElementType matrixFileElementType(const std::string &path);
+
+// Computes C = A * B for matrices in files, streaming blocks of A and B
+// through at most about `memoryBudget` bytes of buffers while a background
+// thread reads the next blocks, and writing C block by block. The blocks are
+// multiplied in memory by multiply() with Engine::Auto. C must be writable;
+// throws std::invalid_argument if the dimensions do not match or the budget
+// cannot hold blocks of 16 x 16 elements.
+template <typename T>
+void multiplyOutOfCore(const MappedMatrix<T> &A, const MappedMatrix<T> &B,
+                       MappedMatrix<T> &C, std::size_t memoryBudget);
+
+#endif // OUT_OF_CORE_H
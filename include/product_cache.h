@@ -0,0 +1,113 @@
+#ifndef PRODUCT_CACHE_H
+#define PRODUCT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "engine.h"
+#include "matrix.h"
+
+// Memory of earlier products for workloads that multiply the same operands
+// again, such as one weight matrix B against many A.
+//
+// Operands are identified by their contents, through fingerprint(), so a
+// matrix modified in place is a new operand. The cache keeps
+// - B packed into the panels of the Simd and Parallel engines, so a B seen
+//   before is not packed again, within a byte budget for packed panels;
+// - optionally whole results, so an A * B seen before is copied instead of
+//   computed, within a byte budget for results (0, the default, disables
+//   them).
+// Both are evicted least recently used first. A cache may be shared between
+// threads.
+//
+// When B is known not to change, a PackedMatrix packs it once and spares
+// the fingerprint of B, which reads all of it, on every product.
+
+// 64-bit hash of the shape and elements of M, row by row (padding between
+// rows is ignored). Eight 64-bit lanes each add the product of the two
+// 32-bit halves of their data xor a key, with the SIMD multiplies of the
+// instruction set returned by simdIsa() (the same value for all of them),
+// and are scrambled after every row; it runs at about the speed of a copy.
+// Not cryptographic: two different matrices collide with a probability of
+// about 2^-64.
+std::uint64_t fingerprint(ConstMatrixView<int> M);
+std::uint64_t fingerprint(ConstMatrixView<float> M);
+std::uint64_t fingerprint(ConstMatrixView<double> M);
+
+struct ProductCacheStats {
+  // Products that found B packed, and products that had to pack it.
+  long packHits = 0;
+  long packMisses = 0;
+  // Products copied from a stored result, and products computed.
+  long resultHits = 0;
+  long resultMisses = 0;
+  // Entries of either kind dropped to stay within a budget.
+  long evictions = 0;
+  std::size_t packedBytes = 0;
+  std::size_t resultBytes = 0;
+};
+
+class ProductCache {
+public:
+  explicit ProductCache(std::size_t resultBudget = 0,
+                        std::size_t packedBudget = std::size_t(256) << 20);
+  ~ProductCache();
+  ProductCache(const ProductCache &) = delete;
+  ProductCache &operator=(const ProductCache &) = delete;
+
+  // C = A * B like multiply(), with the same results: stored results are
+  // kept per engine. Throws std::invalid_argument if the dimensions do not
+  // match.
+  void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                MatrixView<int> C, Engine engine = Engine::Auto);
+  void multiply(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                MatrixView<float> C, Engine engine = Engine::Auto);
+  void multiply(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                MatrixView<double> C, Engine engine = Engine::Auto);
+
+  ProductCacheStats stats() const;
+  // Drops every entry and resets the counters.
+  void clear();
+
+private:
+  struct Impl;
+  template <typename T>
+  void multiplyCached(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C, Engine engine);
+
+  std::unique_ptr<Impl> impl_;
+};
+
+// B packed into the panels of the Simd and Parallel engines. It refers to
+// B, which must outlive it and not change, for the engines that do not use
+// the panels; after setTileSizes() the panels no longer fit and every
+// product packs B again.
+template <typename T> class PackedMatrix {
+public:
+  explicit PackedMatrix(ConstMatrixView<T> B);
+
+  ConstMatrixView<T> view() const { return B_; }
+  int rows() const { return B_.rows(); }
+  int cols() const { return B_.cols(); }
+  // Size of the panels.
+  std::size_t bytes() const { return bytes_; }
+  // The panels, in the layout of the engines.
+  const std::shared_ptr<const void> &panels() const { return panels_; }
+
+private:
+  ConstMatrixView<T> B_;
+  std::shared_ptr<const void> panels_;
+  std::size_t bytes_ = 0;
+};
+
+// C = A * B with the panels of B packed ahead. Throws std::invalid_argument
+// if the dimensions do not match.
+void multiply(ConstMatrixView<int> A, const PackedMatrix<int> &B,
+              MatrixView<int> C, Engine engine = Engine::Auto);
+void multiply(ConstMatrixView<float> A, const PackedMatrix<float> &B,
+              MatrixView<float> C, Engine engine = Engine::Auto);
+void multiply(ConstMatrixView<double> A, const PackedMatrix<double> &B,
+              MatrixView<double> C, Engine engine = Engine::Auto);
+
+#endif // PRODUCT_CACHE_H
@@ -0,0 +1,42 @@
+#ifndef QUANTIZED_H
+#define QUANTIZED_H
+
+#include <cstdint>
+#include <vector>
+
+#include "matrix.h"
+
+// Affine quantization of the rows of A or the columns of B: the quantized
+// value q stands for scale * (q - zeroPoint). Each vector holds one entry per
+// row (for A) or per column (for B), or a single entry shared by all.
+struct Quantization {
+  std::vector<float> scale{1.0f};
+  std::vector<std::int32_t> zeroPoint{0};
+};
+
+// Quantized products of int8 or int16 matrices with int32 accumulation, on
+// dot-product kernels (pmaddwd, or vpdpbusd/vpdpwssd with AVX-512 VNNI) and
+// the same cache blocking and thread pool as the int engines. Zero points are
+// applied with row and column sums while each tile is written back:
+//   int32 result: C(i, j) = sum_k (A(i, k) - zA[i]) * (B(k, j) - zB[j])
+//   float result: the same sum times scaleA[i] * scaleB[j]
+// The int32 sums wrap modulo 2^32. Throws std::invalid_argument if the
+// dimensions do not match or a quantization vector has the wrong size.
+void multiplyQuantized(ConstMatrixView<std::int8_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int8_t> B,
+                       const Quantization &quantB, MatrixView<std::int32_t> C);
+void multiplyQuantized(ConstMatrixView<std::int8_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int8_t> B,
+                       const Quantization &quantB, MatrixView<float> C);
+void multiplyQuantized(ConstMatrixView<std::int16_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int16_t> B,
+                       const Quantization &quantB, MatrixView<std::int32_t> C);
+void multiplyQuantized(ConstMatrixView<std::int16_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int16_t> B,
+                       const Quantization &quantB, MatrixView<float> C);
+
+#endif // QUANTIZED_H
@@ -0,0 +1,62 @@
+#ifndef RANDOM_MATRIX_H
+#define RANDOM_MATRIX_H
+
+#include <array>
+#include <cstdint>
+
+#include "matrix.h"
+
+// Reproducible random matrices from the counter-based Philox4x32-10
+// generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+// Each value is a pure function of the seed and of the position of the
+// element in the matrix, element (i, j) being number i * cols + j, so rows
+// are generated in parallel and with the Philox kernel of the selected
+// instruction set, and the result does not depend on the thread count, the
+// instruction set or the leading dimension of the view.
+//
+// Element e takes word e of the output stream for int and float, words 2e
+// and 2e + 1 for double, where word w is word w % 4 of
+// philox4x32({w / 4 mod 2^32, w / 2^34, 0, 0}, {seed mod 2^32, seed / 2^32}).
+// - int: low + floor(word * (high - low + 1) / 2^32), in [low, high];
+// - float: low + (high - low) * u, u the top 24 bits of the word over 2^24;
+// - double: the same with the top 53 bits of the two words over 2^53.
+// Floating-point values are in [low, high], high only through rounding.
+
+// Philox4x32-10 of one counter.
+std::array<std::uint32_t, 4> philox4x32(std::array<std::uint32_t, 4> counter,
+                                        std::array<std::uint32_t, 2> key);
+
+// Every element uniform in [low, high]. Throws std::invalid_argument if low
+// is greater than high.
+void fillUniform(MatrixView<int> M, int low, int high, std::uint64_t seed);
+void fillUniform(MatrixView<float> M, float low, float high,
+                 std::uint64_t seed);
+void fillUniform(MatrixView<double> M, double low, double high,
+                 std::uint64_t seed);
+
+// Ones on the diagonal and zeros elsewhere, for any shape.
+template <typename T> void fillIdentity(MatrixView<T> M);
+
+// The elements of the band -lower <= j - i <= upper take the values
+// fillUniform() gives them with the same seed, the others are zero. Throws
+// std::invalid_argument if lower or upper is negative or low is greater than
+// high.
+void fillBanded(MatrixView<int> M, int lower, int upper, int low, int high,
+                std::uint64_t seed);
+void fillBanded(MatrixView<float> M, int lower, int upper, float low,
+                float high, std::uint64_t seed);
+void fillBanded(MatrixView<double> M, int lower, int upper, double low,
+                double high, std::uint64_t seed);
+
+// Each element keeps the value fillUniform() gives it with probability
+// `density` and is zero otherwise, the choice drawn from a second stream
+// (counter word 2 set to 1) of the same seed. Throws std::invalid_argument
+// if density is outside [0, 1] or low is greater than high.
+void fillSparse(MatrixView<int> M, double density, int low, int high,
+                std::uint64_t seed);
+void fillSparse(MatrixView<float> M, double density, float low, float high,
+                std::uint64_t seed);
+void fillSparse(MatrixView<double> M, double density, double low,
+                double high, std::uint64_t seed);
+
+#endif // RANDOM_MATRIX_H
@@ -0,0 +1,174 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <stdexcept>
+#include <vector>
+
+#include "matrix.h"
+
+// Compressed sparse matrices. CsrMatrix stores the non-zeros row by row: those
+// of row i are values[rowStart[i] .. rowStart[i + 1]), at the column indices
+// of the same range of `indices`, sorted. CscMatrix is the same by columns:
+// the non-zeros of column j are at colStart[j] .. colStart[j + 1], with their
+// row indices. Both validate their arrays and throw std::invalid_argument if
+// they are inconsistent.
+template <typename T> class CsrMatrix {
+public:
+  CsrMatrix() : rowStart_(1, 0) {}
+  CsrMatrix(int rows, int cols, std::vector<int> rowStart,
+            std::vector<int> indices, std::vector<T> values)
+      : rows_(rows), cols_(cols), rowStart_(std::move(rowStart)),
+        indices_(std::move(indices)), values_(std::move(values)) {
+    validate();
+  }
+
+  // Compresses the non-zero elements of a dense matrix.
+  explicit CsrMatrix(MatrixView<const T> dense)
+      : rows_(dense.rows()), cols_(dense.cols()), rowStart_(1, 0) {
+    for (int i = 0; i < rows_; ++i) {
+      const T *row = dense.row(i);
+      for (int j = 0; j < cols_; ++j)
+        if (row[j] != T()) {
+          indices_.push_back(j);
+          values_.push_back(row[j]);
+        }
+      rowStart_.push_back(static_cast<int>(indices_.size()));
+    }
+  }
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int nonZeros() const { return static_cast<int>(values_.size()); }
+  const std::vector<int> &rowStart() const { return rowStart_; }
+  const std::vector<int> &indices() const { return indices_; }
+  const std::vector<T> &values() const { return values_; }
+
+  Matrix<T> toDense() const {
+    Matrix<T> dense(rows_, cols_);
+    for (int i = 0; i < rows_; ++i)
+      for (int p = rowStart_[i]; p < rowStart_[i + 1]; ++p)
+        dense(i, indices_[p]) = values_[p];
+    return dense;
+  }
+
+private:
+  void validate() const {
+    if (rows_ < 0 || cols_ < 0 ||
+        rowStart_.size() != static_cast<std::size_t>(rows_) + 1 ||
+        rowStart_.front() != 0 ||
+        rowStart_.back() != static_cast<int>(indices_.size()) ||
+        indices_.size() != values_.size())
+      throw std::invalid_argument("CsrMatrix: inconsistent arrays");
+    for (int i = 0; i < rows_; ++i)
+      for (int p = rowStart_[i]; p < rowStart_[i + 1]; ++p)
+        if (indices_[p] < 0 || indices_[p] >= cols_ ||
+            (p > rowStart_[i] && indices_[p] <= indices_[p - 1]))
+          throw std::invalid_argument("CsrMatrix: invalid column index");
+  }
+
+  int rows_ = 0;
+  int cols_ = 0;
+  std::vector<int> rowStart_;
+  std::vector<int> indices_;
+  std::vector<T> values_;
+};
+
+template <typename T> class CscMatrix {
+public:
+  CscMatrix() : colStart_(1, 0) {}
+  CscMatrix(int rows, int cols, std::vector<int> colStart,
+            std::vector<int> indices, std::vector<T> values)
+      : rows_(rows), cols_(cols), colStart_(std::move(colStart)),
+        indices_(std::move(indices)), values_(std::move(values)) {
+    validate();
+  }
+
+  // Compresses the non-zero elements of a dense matrix.
+  explicit CscMatrix(MatrixView<const T> dense)
+      : rows_(dense.rows()), cols_(dense.cols()), colStart_(1, 0) {
+    for (int j = 0; j < cols_; ++j) {
+      for (int i = 0; i < rows_; ++i)
+        if (dense(i, j) != T()) {
+          indices_.push_back(i);
+          values_.push_back(dense(i, j));
+        }
+      colStart_.push_back(static_cast<int>(indices_.size()));
+    }
+  }
+
+  int rows() const { return rows_; }
+  int cols() const { return cols_; }
+  int nonZeros() const { return static_cast<int>(values_.size()); }
+  const std::vector<int> &colStart() const { return colStart_; }
+  const std::vector<int> &indices() const { return indices_; }
+  const std::vector<T> &values() const { return values_; }
+
+  Matrix<T> toDense() const {
+    Matrix<T> dense(rows_, cols_);
+    for (int j = 0; j < cols_; ++j)
+      for (int p = colStart_[j]; p < colStart_[j + 1]; ++p)
+        dense(indices_[p], j) = values_[p];
+    return dense;
+  }
+
+private:
+  void validate() const {
+    if (rows_ < 0 || cols_ < 0 ||
+        colStart_.size() != static_cast<std::size_t>(cols_) + 1 ||
+        colStart_.front() != 0 ||
+        colStart_.back() != static_cast<int>(indices_.size()) ||
+        indices_.size() != values_.size())
+      throw std::invalid_argument("CscMatrix: inconsistent arrays");
+    for (int j = 0; j < cols_; ++j)
+      for (int p = colStart_[j]; p < colStart_[j + 1]; ++p)
+        if (indices_[p] < 0 || indices_[p] >= rows_ ||
+            (p > colStart_[j] && indices_[p] <= indices_[p - 1]))
+          throw std::invalid_argument("CscMatrix: invalid row index");
+  }
+
+  int rows_ = 0;
+  int cols_ = 0;
+  std::vector<int> colStart_;
+  std::vector<int> indices_;
+  std::vector<T> values_;
+};
+
+// Sparse products, for int (wrapping modulo 2^32 like the dense engines),
+// float and double. They run over the shared thread pool and throw
+// std::invalid_argument if the dimensions do not match. The element type is
+// taken from the sparse operand, so dense ones may be matrices or views.
+template <typename T> struct SparseElement { using Type = T; };
+template <typename T>
+using DenseOperand = MatrixView<const typename SparseElement<T>::Type>;
+template <typename T>
+using DenseResult = MatrixView<typename SparseElement<T>::Type>;
+
+// SpMM: C = A * B with A sparse, as a sum of rows of B scaled by the
+// non-zeros of each row of A.
+template <typename T>
+void multiply(const CsrMatrix<T> &A, DenseOperand<T> B, DenseResult<T> C);
+
+// C = A * B with B sparse: each element of C is a dot product of a row of A
+// with the non-zeros of a column of B.
+template <typename T>
+void multiply(DenseOperand<T> A, const CscMatrix<T> &B, DenseResult<T> C);
+
+// SpGEMM: C = A * B with both operands and the result sparse (Gustavson's
+// row-by-row algorithm). Products that cancel out stay as explicit zeros.
+template <typename T>
+CsrMatrix<T> multiply(const CsrMatrix<T> &A, const CsrMatrix<T> &B);
+
+// Fraction of non-zero elements of A, counted exactly for small matrices and
+// estimated from a fixed sample of 256 positions otherwise.
+double estimateDensity(MatrixView<const int> A);
+double estimateDensity(MatrixView<const float> A);
+double estimateDensity(MatrixView<const double> A);
+
+// Engine::Auto converts an operand to a sparse format and runs the sparse
+// products above when its estimated density is at most this fraction
+// (default 0.1). Engine::Sparse always does. Throws std::invalid_argument
+// if the threshold is outside [0, 1].
+void setSparseDensityThreshold(double threshold);
+double sparseDensityThreshold();
+
+#endif // SPARSE_H
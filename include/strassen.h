@@ -0,0 +1,10 @@
+#ifndef STRASSEN_H
+#define STRASSEN_H
+
+// Engine::Strassen halves every dimension and recurses while all of them are
+// at least this large (default 512); smaller products go to the classical
+// engines. Throws std::invalid_argument if crossover is smaller than 2.
+void setStrassenCrossover(int crossover);
+int strassenCrossover();
+
+#endif // STRASSEN_H
@@ -0,0 +1,47 @@
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include "matrix.h"
+
+// Fast paths for int operands with a special structure. When enabled,
+// Engine::Auto first analyses A and B, in one pass over each that stops at
+// the first element ruling out every structure, and then
+// - fills C with zeros if A or B is zero;
+// - copies the other operand if A or B is the identity;
+// - gathers the rows of B (A a permutation) or scatters the columns of A
+//   (B a permutation);
+// - scales the rows of B (A diagonal) or the columns of A (B diagonal);
+// - multiplies two matrices of zeros and ones with multiplyBinary().
+// Every path gives the result of the engines, wrapping modulo 2^32.
+
+enum class Structure {
+  General,
+  // All elements zero.
+  Zero,
+  // Square, with ones on the diagonal and zeros elsewhere.
+  Identity,
+  // Square, with a single one in each row and column and zeros elsewhere.
+  Permutation,
+  // Square, with zeros off the diagonal.
+  Diagonal,
+  // Every element 0 or 1.
+  Binary
+};
+
+// The first structure of the list above that M has, General if none.
+Structure detectStructure(ConstMatrixView<int> M);
+const char *structureName(Structure structure);
+
+// Whether Engine::Auto analyses int operands (off by default).
+void setStructureDetection(bool enabled);
+bool structureDetection();
+
+// C = A * B for matrices of zeros and ones. Rows of A and columns of B are
+// packed 64 elements to a 64-bit word, and each element of C is a sum of
+// popcounts of the AND of two words, over the thread pool for large
+// products. Throws std::invalid_argument if the dimensions do not match or
+// an element of A or B is neither 0 nor 1.
+void multiplyBinary(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                    MatrixView<int> C);
+
+#endif // STRUCTURE_H
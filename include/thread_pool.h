@@ -0,0 +1,103 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "numa_policy.h"
+
+// Persistent pool of worker threads with one task deque per worker.
+// parallelFor() spreads its tasks over the deques in contiguous chunks; a
+// worker pops from the back of its own deque and, once it runs dry, steals
+// from the front of the others. Threads live as long as the pool, so a
+// parallel multiply does not create or destroy any.
+class ThreadPool {
+public:
+  // `threads` is the total parallelism: threads - 1 workers are started and
+  // the thread calling parallelFor() runs tasks as well. With `pin` each
+  // worker is bound to its own CPU of the process affinity mask.
+  //
+  // With a topology of several nodes the queues are split into contiguous
+  // groups, one per node (at most one node per queue), whose workers are
+  // bound to the CPUs of their node, or with `pin` to one of them each. The
+  // calling thread counts as part of the last node.
+  explicit ThreadPool(int threads, bool pin = false,
+                      const NumaTopology &topology = {});
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  int size() const { return static_cast<int>(queues_.size()); }
+
+  // Runs task(0) ... task(count - 1) and returns once all of them finished.
+  // The caller helps with queued tasks while it waits, so parallelFor() may
+  // be nested inside a task. The first exception thrown by a task is
+  // rethrown here.
+  void parallelFor(int count, const std::function<void(int)> &task);
+
+  // Number of nodes the queues are split into, and the node of the calling
+  // thread: its worker's, or the last one for any other thread.
+  int nodes() const { return nodes_; }
+  int currentNode() const;
+  // Topology the pool was built with; node i of the pool is its nodes[i].
+  const NumaTopology &topology() const { return topology_; }
+  // Node whose queues parallelFor(count, ...) first hands task `index` to.
+  int taskNode(int count, int index) const;
+
+  // Runs task(node) once per node, on a thread of that node, and returns
+  // once all of them finished, like parallelFor().
+  void forEachNode(const std::function<void(int)> &task);
+
+private:
+  struct Job;
+  // Tasks bound to a node (node >= 0) are only stolen by its threads.
+  struct Task {
+    Job *job;
+    int index;
+    int node;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popOwn(int queue, Task &task);
+  bool steal(int thief, Task &task);
+  void run(const Task &task);
+  void wait(Job &job);
+  void workerLoop(int queue);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  NumaTopology topology_;
+  std::vector<int> queueNode_;
+  int nodes_ = 1;
+  std::vector<std::thread> workers_;
+  std::mutex wakeMutex_;
+  std::condition_variable wake_;
+  // Queued tasks not started yet: unbound ones, and bound ones per node.
+  std::atomic<int> pending_{0};
+  std::vector<std::atomic<int>> boundPending_;
+  bool stopping_ = false;
+};
+
+// Shared pool used by the parallel engines. It is created on first use with
+// threadCount() threads and rebuilt when the settings below change.
+std::shared_ptr<ThreadPool> threadPool();
+
+// Number of threads of the shared pool; defaults to the hardware concurrency.
+// Throws std::invalid_argument if threads is not positive.
+void setThreadCount(int threads);
+int threadCount();
+
+// Whether the workers of the shared pool are pinned to CPUs (off by default).
+void setThreadPinning(bool pin);
+bool threadPinning();
+
+#endif // THREAD_POOL_H
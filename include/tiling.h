@@ -0,0 +1,24 @@
+#ifndef TILING_H
+#define TILING_H
+
+// Tile sizes of the cache-blocked engines, in elements.
+// The kc x nc panel of B is meant to stay in L2, a row of an mc x kc block of
+// A together with nc elements of C in L1, and the whole mc x kc block in L3.
+struct TileSizes {
+  int mc;
+  int nc;
+  int kc;
+};
+
+// Tile sizes used by Engine::Tiled. Unless setTileSizes() was called before,
+// the first call runs calibrateTileSizes() and caches its result.
+TileSizes tileSizes();
+
+// Overrides the tile sizes. Throws std::invalid_argument if any is not positive.
+void setTileSizes(TileSizes sizes);
+
+// Derives candidate tile sizes from the cache sizes reported by the system,
+// times each of them on a small product and returns the fastest one.
+TileSizes calibrateTileSizes();
+
+#endif // TILING_H
@@ -0,0 +1,46 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include "engine.h"
+#include "matrix.h"
+
+// Products of transposed operands and explicit transposes.
+//
+// multiply() with transpose flags computes C = op(A) * op(B), op(X) being X
+// or X^T, without forming the transposes: the SIMD engines pack the panels
+// of op(A) and op(B) straight from the stored operands, and the reference
+// loops read A * B^T as dot products of rows. Auto picks among the
+// Reference, Simd and Parallel engines by size; Tiled, Strassen and Sparse
+// take transposed copies of the flagged operands.
+
+enum class Transpose { No, Yes };
+
+// Throws std::invalid_argument if the dimensions of op(A), op(B) and C do
+// not match.
+void multiply(ConstMatrixView<int> A, Transpose transA, ConstMatrixView<int> B,
+              Transpose transB, MatrixView<int> C,
+              Engine engine = Engine::Auto);
+void multiply(ConstMatrixView<float> A, Transpose transA,
+              ConstMatrixView<float> B, Transpose transB, MatrixView<float> C,
+              Engine engine = Engine::Auto);
+void multiply(ConstMatrixView<double> A, Transpose transA,
+              ConstMatrixView<double> B, Transpose transB,
+              MatrixView<double> C, Engine engine = Engine::Auto);
+
+// At = A^T. Cache-oblivious: the larger side is halved recursively until
+// blocks fit in any cache level, so rows and columns are both read and
+// written in cache-sized runs. At must be A.cols() x A.rows(), or
+// std::invalid_argument is thrown, and must not overlap A.
+template <typename T> void transpose(ConstMatrixView<T> A, MatrixView<T> At);
+template <typename T> Matrix<T> transpose(const Matrix<T> &A);
+
+// A = A^T without a second matrix. Square matrices (the only shape a view
+// accepts, or std::invalid_argument) are transposed by recursively swapping
+// the blocks on either side of the diagonal. A rectangular Matrix is
+// permuted by following the cycles of the transposition, with one bit of
+// bookkeeping per element, and takes the transposed shape; one with padded
+// rows goes through a copy instead.
+template <typename T> void transposeInPlace(MatrixView<T> A);
+template <typename T> void transposeInPlace(Matrix<T> &A);
+
+#endif // TRANSPOSE_H
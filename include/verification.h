@@ -0,0 +1,84 @@
+#ifndef VERIFICATION_H
+#define VERIFICATION_H
+
+#include <cstdint>
+#include <vector>
+
+#include "engine.h"
+#include "matrix.h"
+
+// Checks of a product that cost O(n^2) instead of a second multiply.
+//
+// Freivalds' algorithm compares A (B x) with C x for random vectors x, a few
+// matrix-vector products per round. For int it is exact in the wrapping
+// arithmetic of the engines: a wrong C passes a round with probability at
+// most 1/2, and below 2^-32 unless every wrong element is off by a multiple
+// of a large power of two. For float and double each element of the two
+// vectors must agree within tolerance * (K + 2) * epsilon times the same
+// element computed with |A|, |B| and |x|, which bounds the rounding of any
+// classical engine; Strassen may need a larger tolerance.
+
+struct VerificationOptions {
+  int rounds = 4;
+  // Seed of the random vectors; 0 draws one from std::random_device.
+  std::uint64_t seed = 0;
+  // Factor of the floating-point error bound.
+  double tolerance = 4;
+};
+
+// Whether C passes every round. Throws std::invalid_argument if the
+// dimensions do not match or rounds is not positive.
+bool verifyProduct(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                   ConstMatrixView<int> C,
+                   const VerificationOptions &options = {});
+bool verifyProduct(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                   ConstMatrixView<float> C,
+                   const VerificationOptions &options = {});
+bool verifyProduct(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                   ConstMatrixView<double> C,
+                   const VerificationOptions &options = {});
+
+// multiply() followed by verifyProduct(); throws std::runtime_error if the
+// check fails.
+void multiplyVerified(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                      MatrixView<int> C, Engine engine = Engine::Auto,
+                      const VerificationOptions &options = {});
+void multiplyVerified(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                      MatrixView<float> C, Engine engine = Engine::Auto,
+                      const VerificationOptions &options = {});
+void multiplyVerified(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                      MatrixView<double> C, Engine engine = Engine::Auto,
+                      const VerificationOptions &options = {});
+
+// Algorithm-based fault tolerance (Huang and Abraham). A gets an extra row
+// holding its column sums and B an extra column holding its row sums; the
+// engine multiplies them like any other rows and columns, so the product
+// carries the row and column sums of C, computed by the same kernels. Each
+// row and column of C is then checked against its sum, with the bound above
+// for floating point. A single wrong element shows up as one bad row and one
+// bad column and is corrected from the row sum.
+struct ChecksumReport {
+  // Rows and columns of C whose sums disagree with their checksums.
+  std::vector<int> rows;
+  std::vector<int> columns;
+  // Whether a single wrong element, at (rows[0], columns[0]), was corrected.
+  bool corrected = false;
+
+  // Whether C holds the product.
+  bool valid() const { return corrected || (rows.empty() && columns.empty()); }
+};
+
+// Throws std::invalid_argument if the dimensions do not match.
+ChecksumReport multiplyWithChecksums(ConstMatrixView<int> A,
+                                     ConstMatrixView<int> B, MatrixView<int> C,
+                                     Engine engine = Engine::Auto);
+ChecksumReport multiplyWithChecksums(ConstMatrixView<float> A,
+                                     ConstMatrixView<float> B,
+                                     MatrixView<float> C,
+                                     Engine engine = Engine::Auto);
+ChecksumReport multiplyWithChecksums(ConstMatrixView<double> A,
+                                     ConstMatrixView<double> B,
+                                     MatrixView<double> C,
+                                     Engine engine = Engine::Auto);
+
+#endif // VERIFICATION_H
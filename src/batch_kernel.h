@@ -0,0 +1,32 @@
+#ifndef BATCH_KERNEL_H
+#define BATCH_KERNEL_H
+
+// Generic batch kernel (see BatchKernelFn in microkernel.h). The innermost
+// loop runs across the Lanes interleaved products, so each translation unit
+// that instantiates it turns that loop into one vector multiply-add of its
+// own instruction set. The anonymous namespace gives every such translation
+// unit its own copy, so the linker cannot merge the instantiations compiled
+// for different instruction sets.
+namespace {
+
+template <int Lanes>
+void interleavedProducts(int m, int k, int n, const int *A, const int *B,
+                         int *C) {
+  for (int i = 0; i < m; ++i)
+    for (int j = 0; j < n; ++j) {
+      unsigned sum[Lanes] = {};
+      for (int p = 0; p < k; ++p) {
+        const int *a = A + (i * k + p) * Lanes;
+        const int *b = B + (p * n + j) * Lanes;
+        for (int l = 0; l < Lanes; ++l)
+          sum[l] += static_cast<unsigned>(a[l]) * static_cast<unsigned>(b[l]);
+      }
+      int *c = C + (i * n + j) * Lanes;
+      for (int l = 0; l < Lanes; ++l)
+        c[l] = static_cast<int>(sum[l]);
+    }
+}
+
+} // namespace
+
+#endif // BATCH_KERNEL_H
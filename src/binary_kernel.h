@@ -0,0 +1,53 @@
+#ifndef BINARY_KERNEL_H
+#define BINARY_KERNEL_H
+
+#include <cstdint>
+
+// Generic binary kernel (see BinaryKernelFn in microkernel.h). Translation
+// units whose flags enable POPCNT (the AVX2 and AVX-512 ones) count the bits
+// of a word with one instruction; the others fall back to a branch-free bit
+// count. The anonymous namespace keeps the two apart.
+namespace {
+
+inline unsigned popcount64(std::uint64_t x) {
+#ifdef __POPCNT__
+  return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+  x -= (x >> 1) & 0x5555555555555555ull;
+  x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return static_cast<unsigned>((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// Rows of A sharing each word of a column of B.
+template <int Rows>
+void binaryRows(int n, int words, const std::uint64_t *A,
+                const std::uint64_t *B, int *C, long ldc) {
+  for (int j = 0; j < n; ++j) {
+    const std::uint64_t *b = B + static_cast<long>(j) * words;
+    unsigned sum[Rows] = {};
+    for (int w = 0; w < words; ++w) {
+      const std::uint64_t bits = b[w];
+      for (int r = 0; r < Rows; ++r)
+        sum[r] += popcount64(A[r * words + w] & bits);
+    }
+    for (int r = 0; r < Rows; ++r)
+      C[r * ldc + j] = static_cast<int>(sum[r]);
+  }
+}
+
+void popcountProducts(int m, int n, int words, const std::uint64_t *A,
+                      const std::uint64_t *B, int *C, long ldc) {
+  int i = 0;
+  for (; i + 4 <= m; i += 4)
+    binaryRows<4>(n, words, A + static_cast<long>(i) * words, B, C + i * ldc,
+                  ldc);
+  for (; i < m; ++i)
+    binaryRows<1>(n, words, A + static_cast<long>(i) * words, B, C + i * ldc,
+                  ldc);
+}
+
+} // namespace
+
+#endif // BINARY_KERNEL_H
@@ -0,0 +1,22 @@
+#ifndef CHECKSUMS_H
+#define CHECKSUMS_H
+
+#include "matrix.h"
+#include "verification.h"
+
+// Steps of multiplyWithChecksums() (verification.h), instantiated for int,
+// float and double.
+
+// A with an extra row holding the sums of its columns.
+template <typename T> Matrix<T> appendColumnSums(ConstMatrixView<T> A);
+
+// B with an extra column holding the sums of its rows.
+template <typename T> Matrix<T> appendRowSums(ConstMatrixView<T> B);
+
+// Checks the (m + 1) x (n + 1) product Cf of the two against A and B, and
+// corrects a single wrong element in place.
+template <typename T>
+ChecksumReport checkChecksums(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                              MatrixView<T> Cf);
+
+#endif // CHECKSUMS_H
@@ -0,0 +1,251 @@
+#include "cpu_features.h"
+#include "microkernel.h"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<int> forcedIsa{-1};
+
+} // namespace
+
+SimdIsa detectSimdIsa() {
+#ifdef MATMUL_X86_KERNELS
+  // __builtin_cpu_supports reads cpuid and also checks that the OS saves
+  // the wider register state (xgetbv), so a reported ISA is usable.
+  static const SimdIsa detected = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vnni"))
+      return SimdIsa::Avx512Vnni;
+    if (__builtin_cpu_supports("avx512f"))
+      return SimdIsa::Avx512;
+    // The AVX2 kernels are compiled with -mfma.
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return SimdIsa::Avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+      return SimdIsa::Sse41;
+    return SimdIsa::Scalar;
+  }();
+  return detected;
+#else
+  return SimdIsa::Scalar;
+#endif
+}
+
+SimdIsa simdIsa() {
+  const int forced = forcedIsa.load(std::memory_order_relaxed);
+  return forced < 0 ? detectSimdIsa() : static_cast<SimdIsa>(forced);
+}
+
+void setSimdIsa(SimdIsa isa) {
+  if (static_cast<int>(isa) > static_cast<int>(detectSimdIsa()))
+    throw std::invalid_argument("setSimdIsa: instruction set not supported");
+  forcedIsa.store(static_cast<int>(isa), std::memory_order_relaxed);
+}
+
+const char *simdIsaName(SimdIsa isa) {
+  switch (isa) {
+  case SimdIsa::Scalar:
+    return "scalar";
+  case SimdIsa::Sse41:
+    return "sse4.1";
+  case SimdIsa::Avx2:
+    return "avx2";
+  case SimdIsa::Avx512:
+    return "avx512";
+  case SimdIsa::Avx512Vnni:
+    return "avx512vnni";
+  }
+  return "unknown";
+}
+
+template <> const TypedMicroKernel<int> &microKernel<int>() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512MicroKernel();
+  case SimdIsa::Avx2:
+    return avx2MicroKernel();
+  case SimdIsa::Sse41:
+    return sse41MicroKernel();
+#endif
+  default:
+    return scalarMicroKernel();
+  }
+}
+
+template <> const TypedMicroKernel<float> &microKernel<float>() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512FloatMicroKernel();
+  case SimdIsa::Avx2:
+    return avx2FloatMicroKernel();
+  case SimdIsa::Sse41:
+    return sse41FloatMicroKernel();
+#endif
+  default:
+    return scalarFloatMicroKernel();
+  }
+}
+
+template <> const TypedMicroKernel<double> &microKernel<double>() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512DoubleMicroKernel();
+  case SimdIsa::Avx2:
+    return avx2DoubleMicroKernel();
+  case SimdIsa::Sse41:
+    return sse41DoubleMicroKernel();
+#endif
+  default:
+    return scalarDoubleMicroKernel();
+  }
+}
+
+const WideMicroKernel &wideMicroKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512WideMicroKernel();
+  case SimdIsa::Avx2:
+    return avx2WideMicroKernel();
+  case SimdIsa::Sse41:
+    return sse41WideMicroKernel();
+#endif
+  default:
+    return scalarWideMicroKernel();
+  }
+}
+
+const BatchKernel &batchKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512BatchKernel();
+  case SimdIsa::Avx2:
+    return avx2BatchKernel();
+  case SimdIsa::Sse41:
+    return sse41BatchKernel();
+#endif
+  default:
+    return scalarBatchKernel();
+  }
+}
+
+const SparseRowKernel &sparseRowKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512SparseRowKernel();
+  case SimdIsa::Avx2:
+    return avx2SparseRowKernel();
+  case SimdIsa::Sse41:
+    return sse41SparseRowKernel();
+#endif
+  default:
+    return scalarSparseRowKernel();
+  }
+}
+
+template <typename T> const VectorKernel<T> &vectorKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512VectorKernel<T>();
+  case SimdIsa::Avx2:
+    return avx2VectorKernel<T>();
+  case SimdIsa::Sse41:
+    return sse41VectorKernel<T>();
+#endif
+  default:
+    return scalarVectorKernel<T>();
+  }
+}
+
+template const VectorKernel<int> &vectorKernel();
+template const VectorKernel<float> &vectorKernel();
+template const VectorKernel<double> &vectorKernel();
+
+const BinaryKernel &binaryKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512BinaryKernel();
+  case SimdIsa::Avx2:
+    return avx2BinaryKernel();
+  case SimdIsa::Sse41:
+    return sse41BinaryKernel();
+#endif
+  default:
+    return scalarBinaryKernel();
+  }
+}
+
+const PhiloxKernel &philoxKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512PhiloxKernel();
+  case SimdIsa::Avx2:
+    return avx2PhiloxKernel();
+  case SimdIsa::Sse41:
+    return sse41PhiloxKernel();
+#endif
+  default:
+    return scalarPhiloxKernel();
+  }
+}
+
+const HashRowKernel &hashRowKernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+  case SimdIsa::Avx512:
+    return avx512HashRowKernel();
+  case SimdIsa::Avx2:
+    return avx2HashRowKernel();
+  case SimdIsa::Sse41:
+    return sse41HashRowKernel();
+#endif
+  default:
+    return scalarHashRowKernel();
+  }
+}
+
+const QuantizedKernel &int16Kernel() {
+  switch (simdIsa()) {
+#ifdef MATMUL_X86_KERNELS
+  case SimdIsa::Avx512Vnni:
+    return avx512VnniInt16Kernel();
+  case SimdIsa::Avx512:
+  case SimdIsa::Avx2:
+    return avx2Int16Kernel();
+  case SimdIsa::Sse41:
+    return sse41Int16Kernel();
+#endif
+  default:
+    return scalarInt16Kernel();
+  }
+}
+
+const QuantizedKernel &int8Kernel() {
+#ifdef MATMUL_X86_KERNELS
+  if (simdIsa() == SimdIsa::Avx512Vnni)
+    return avx512VnniInt8Kernel();
+#endif
+  return int16Kernel();
+}
@@ -0,0 +1,160 @@
+#ifndef ENGINES_H
+#define ENGINES_H
+
+#include <functional>
+#include <memory>
+
+#include "engine.h"
+#include "matrix.h"
+#include "packing.h"
+#include "thread_pool.h"
+#include "tiling.h"
+
+// Internal entry points of the engines dispatched by multiply().
+// Dimensions are checked by the caller; C is fully overwritten. The engine
+// templates are instantiated for int, float and double in their sources.
+
+// Type the engines compute in: int is multiplied and added in unsigned
+// arithmetic so that it wraps modulo 2^32 instead of overflowing, the
+// floating-point types use their own arithmetic.
+template <typename T> struct Arithmetic { using Type = T; };
+template <> struct Arithmetic<int> { using Type = unsigned; };
+template <typename T> using ArithmeticType = typename Arithmetic<T>::Type;
+
+template <typename T>
+void multiplyReference(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                       MatrixView<T> C);
+
+// multiplyReference() of op(A) * op(B), where op transposes the operands
+// whose flag is set. The loops are ordered so the innermost one walks rows:
+// A * B^T takes dot products of rows of A and B, and A^T * B adds rows of B.
+template <typename T>
+void multiplyReferenceTransposed(ConstMatrixView<T> A, bool transA,
+                                 ConstMatrixView<T> B, bool transB,
+                                 MatrixView<T> C);
+
+// Runs the compile-time specialized kernel for the shape of A and B, if there
+// is one (fixed_matrix.h), and returns whether it did.
+bool multiplyFixedSize(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                       MatrixView<int> C);
+
+template <typename T>
+void multiplyTiled(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                   TileSizes tiles);
+
+// Optional parts of a Simd product:
+// - packedB: panels of B packed ahead, used from its column packedCol on
+//   instead of packing B;
+// - alpha, beta and addend: C = alpha * A * B + beta * D for D = addend, a
+//   view of the shape of C that may be C itself. alpha scales A as it is
+//   packed and beta * D is loaded into each micro-tile of C before the first
+//   block of k accumulates onto it, so neither needs a pass of its own;
+// - transA and transB: the product uses the transpose of the view passed as
+//   A or B, which the packing routines read in place.
+template <typename T> struct SimdOptions {
+  const PackedB<T> *packedB = nullptr;
+  int packedCol = 0;
+  T alpha = T(1);
+  T beta = T(0);
+  ConstMatrixView<T> addend;
+  bool transA = false;
+  bool transB = false;
+};
+
+template <typename T>
+void multiplySimd(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                  TileSizes tiles, const SimdOptions<T> &options = {});
+
+// Shape of the 2D tiles of an m x n result spread over `threads` threads:
+// the cache tiles, halved until there are at least four tiles per thread.
+struct ParallelTiles {
+  int rows;
+  int cols;
+};
+ParallelTiles parallelTiles(int m, int n, int mr, int nr, TileSizes tiles,
+                            int threads);
+
+// Splits C into 2D tiles and runs multiplySimd on each of them in the pool.
+template <typename T>
+void multiplyParallel(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C, TileSizes tiles, ThreadPool &pool,
+                      const SimdOptions<T> &options = {});
+
+// Below this many multiply-adds a dense product runs on the calling thread,
+// as waking the pool costs more than it saves. Shared by multiply() and the
+// wide and quantized engines.
+constexpr long gemmParallelThreshold = 128L * 128 * 128;
+
+// Classical engine that Engine::Strassen calls below the crossover.
+template <typename T>
+using ClassicalEngine = std::function<void(
+    ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C)>;
+
+// Strassen-Winograd recursion down to strassenCrossover() (strassen.h).
+template <typename T>
+void multiplyStrassen(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C, const ClassicalEngine<T> &leaf);
+
+// Engine::Sparse: compresses the sparser operand (sparse.h) and runs the
+// matching sparse product.
+template <typename T>
+void multiplySparse(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                    MatrixView<T> C);
+
+// Whether the product is large enough to sample and A or B is at most
+// sparseDensityThreshold() dense, which makes Engine::Auto run it sparse.
+template <typename T>
+bool isSparseProduct(ConstMatrixView<T> A, ConstMatrixView<T> B);
+
+// Runs a sparse product if isSparseProduct(), and returns whether it did.
+template <typename T>
+bool multiplyIfSparse(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C);
+
+// Whether a dimension of the product is 1, which makes Engine::Auto run it
+// with the vector kernels (microkernel.h): a dot product, a matrix-vector or
+// vector-matrix product, or a rank-1 outer product.
+bool isVectorProduct(int m, int k, int n);
+
+// Runs the product with the vector kernels if isVectorProduct(), over the
+// pool when it streams enough elements, and returns whether it did.
+template <typename T>
+bool multiplyIfVector(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C);
+
+// Whether structureDetection() is on and the structures of A and B
+// (structure.h) select a path of multiplyIfStructured().
+bool isStructuredProduct(ConstMatrixView<int> A, ConstMatrixView<int> B);
+
+// Runs the copy, gather, scaling or binary path matching the structures of
+// A and B if structureDetection() is on and one applies, and returns whether
+// it did.
+bool multiplyIfStructured(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                          MatrixView<int> C);
+
+// C = alpha * A * B + beta * D, with the scaling and the addition fused into
+// the Simd or Parallel engine (a plain loop for products too small to block).
+// D must have the shape of C and may be C itself; it is not read when beta
+// is zero. Dimensions are checked by the caller.
+template <typename T>
+void multiplyFused(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                   T alpha, T beta, ConstMatrixView<T> D);
+
+// multiply() split in two phases, so that one product can be prepared while
+// another computes. prepareProduct() checks the dimensions, resolves
+// Engine::Auto when it lands on a classical engine and packs B for Simd and
+// Parallel, unless packedB already holds B packed with the current tile sizes
+// (as set by a ProductCache); runProduct() computes C.
+template <typename T> struct PreparedProduct {
+  ConstMatrixView<T> A;
+  ConstMatrixView<T> B;
+  MatrixView<T> C;
+  Engine engine = Engine::Auto;
+  TileSizes tiles{};
+  std::shared_ptr<const PackedB<T>> packedB;
+};
+
+template <typename T> void prepareProduct(PreparedProduct<T> &product);
+template <typename T> void runProduct(const PreparedProduct<T> &product);
+
+#endif // ENGINES_H
@@ -0,0 +1,204 @@
+#include "expression.h"
+#include "engines.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+namespace {
+
+// Table of optimalChainOrder(): cost[i][j] is the cheapest product of the
+// factors i..j and split[i][j] the last factor of its left half.
+struct ChainTable {
+  std::vector<std::vector<long long>> cost;
+  std::vector<std::vector<int>> split;
+};
+
+ChainTable chainTable(const std::vector<int> &dims) {
+  if (dims.size() < 2)
+    throw std::invalid_argument("optimalChainOrder: no factors");
+  for (int d : dims)
+    if (d < 0)
+      throw std::invalid_argument("optimalChainOrder: negative dimension");
+
+  const int n = static_cast<int>(dims.size()) - 1;
+  ChainTable table{std::vector<std::vector<long long>>(
+                       n, std::vector<long long>(n, 0)),
+                   std::vector<std::vector<int>>(n, std::vector<int>(n, 0))};
+  for (int length = 2; length <= n; ++length) {
+    for (int i = 0; i + length <= n; ++i) {
+      const int j = i + length - 1;
+      table.cost[i][j] = std::numeric_limits<long long>::max();
+      for (int s = i; s < j; ++s) {
+        const long long cost = table.cost[i][s] + table.cost[s + 1][j] +
+                               static_cast<long long>(dims[i]) *
+                                   dims[s + 1] * dims[j + 1];
+        if (cost < table.cost[i][j]) {
+          table.cost[i][j] = cost;
+          table.split[i][j] = s;
+        }
+      }
+    }
+  }
+  return table;
+}
+
+std::string parenthesize(const ChainTable &table, int i, int j) {
+  if (i == j)
+    return std::to_string(i);
+  const int s = table.split[i][j];
+  return "(" + parenthesize(table, i, s) + " " +
+         parenthesize(table, s + 1, j) + ")";
+}
+
+template <typename T>
+bool overlaps(ConstMatrixView<T> a, ConstMatrixView<T> b) {
+  if (a.empty() || b.empty())
+    return false;
+  const auto begin = [](ConstMatrixView<T> v) {
+    return reinterpret_cast<std::uintptr_t>(v.data());
+  };
+  const auto end = [](ConstMatrixView<T> v) {
+    return reinterpret_cast<std::uintptr_t>(v.row(v.rows() - 1) + v.cols());
+  };
+  return begin(a) < end(b) && begin(b) < end(a);
+}
+
+template <typename T>
+bool sameView(ConstMatrixView<T> a, ConstMatrixView<T> b) {
+  return a.data() == b.data() && a.rows() == b.rows() &&
+         a.cols() == b.cols() && a.ld() == b.ld();
+}
+
+// C = alpha * F + beta * D, element by element, so any of them may alias.
+template <typename T>
+void scaleAndAdd(ConstMatrixView<T> F, MatrixView<T> C, T alpha, T beta,
+                 ConstMatrixView<T> D) {
+  using U = ArithmeticType<T>;
+  const U a = static_cast<U>(alpha), b = static_cast<U>(beta);
+  for (int i = 0; i < C.rows(); ++i) {
+    for (int j = 0; j < C.cols(); ++j) {
+      U value = a * static_cast<U>(F(i, j));
+      if (b != U(0))
+        value += b * static_cast<U>(D(i, j));
+      C(i, j) = static_cast<T>(value);
+    }
+  }
+}
+
+// C = alpha * (factors[0] * ... * factors[n - 1]) + beta * D. The halves of
+// the cheapest split are evaluated into temporaries, recursively, and the last
+// product is fused with the scaling and the addition.
+template <typename T> class ChainEvaluator {
+public:
+  explicit ChainEvaluator(const std::vector<ConstMatrixView<T>> &factors)
+      : factors_(factors) {
+    std::vector<int> dims;
+    for (const ConstMatrixView<T> &factor : factors)
+      dims.push_back(factor.rows());
+    dims.push_back(factors.back().cols());
+    table_ = chainTable(dims);
+  }
+
+  void run(MatrixView<T> C, T alpha, T beta, ConstMatrixView<T> D) {
+    const int last = static_cast<int>(factors_.size()) - 1;
+    if (last == 0) {
+      scaleAndAdd(factors_[0], C, alpha, beta, D);
+      return;
+    }
+    const int s = table_.split[0][last];
+    Matrix<T> left, right;
+    const ConstMatrixView<T> A = operand(0, s, left);
+    const ConstMatrixView<T> B = operand(s + 1, last, right);
+
+    // The fused kernels read D while writing C, which is only safe when
+    // every element of C is read from its own position in D.
+    const ConstMatrixView<T> out = C;
+    const bool aliased =
+        overlaps(A, out) || overlaps(B, out) ||
+        (beta != T(0) && overlaps(D, out) && !sameView(D, out));
+    if (!aliased) {
+      multiplyFused(A, B, C, alpha, beta, D);
+      return;
+    }
+    Matrix<T> result(C.rows(), C.cols());
+    multiplyFused(A, B, result.view(), alpha, beta, D);
+    for (int i = 0; i < C.rows(); ++i)
+      std::copy(result.row(i), result.row(i) + C.cols(), C.row(i));
+  }
+
+private:
+  // Factor i, or the product of factors i..j evaluated into storage.
+  ConstMatrixView<T> operand(int i, int j, Matrix<T> &storage) {
+    if (i == j)
+      return factors_[i];
+    storage = Matrix<T>(factors_[i].rows(), factors_[j].cols());
+    product(i, j, storage.view());
+    return storage.view();
+  }
+
+  void product(int i, int j, MatrixView<T> C) {
+    const int s = table_.split[i][j];
+    Matrix<T> left, right;
+    const ConstMatrixView<T> A = operand(i, s, left);
+    const ConstMatrixView<T> B = operand(s + 1, j, right);
+    multiplyFused(A, B, C, T(1), T(0), ConstMatrixView<T>());
+  }
+
+  const std::vector<ConstMatrixView<T>> &factors_;
+  ChainTable table_;
+};
+
+template <typename T>
+void checkShape(const ProductExpression<T> &product, MatrixView<T> C) {
+  if (C.rows() != product.rows() || C.cols() != product.cols())
+    throw std::invalid_argument("evaluate: dimension mismatch");
+}
+
+} // namespace
+
+ChainOrder optimalChainOrder(const std::vector<int> &dims) {
+  const ChainTable table = chainTable(dims);
+  const int last = static_cast<int>(dims.size()) - 2;
+  return {table.cost[0][last], parenthesize(table, 0, last)};
+}
+
+template <typename T>
+void evaluate(const ProductExpression<T> &product, MatrixView<T> C) {
+  checkShape(product, C);
+  ChainEvaluator<T>(product.factors())
+      .run(C, product.scale(), T(0), ConstMatrixView<T>());
+}
+
+template <typename T>
+void evaluate(const SumExpression<T> &sum, MatrixView<T> C) {
+  const ProductExpression<T> &product = sum.product();
+  checkShape(product, C);
+  ChainEvaluator<T>(product.factors())
+      .run(C, product.scale(), sum.beta(), sum.addend());
+}
+
+template <typename T> Matrix<T> evaluate(const ProductExpression<T> &product) {
+  Matrix<T> C(product.rows(), product.cols());
+  evaluate(product, C.view());
+  return C;
+}
+
+template <typename T> Matrix<T> evaluate(const SumExpression<T> &sum) {
+  Matrix<T> C(sum.product().rows(), sum.product().cols());
+  evaluate(sum, C.view());
+  return C;
+}
+
+template Matrix<int> evaluate(const ProductExpression<int> &);
+template Matrix<float> evaluate(const ProductExpression<float> &);
+template Matrix<double> evaluate(const ProductExpression<double> &);
+template Matrix<int> evaluate(const SumExpression<int> &);
+template Matrix<float> evaluate(const SumExpression<float> &);
+template Matrix<double> evaluate(const SumExpression<double> &);
+template void evaluate(const ProductExpression<int> &, MatrixView<int>);
+template void evaluate(const ProductExpression<float> &, MatrixView<float>);
+template void evaluate(const ProductExpression<double> &, MatrixView<double>);
+template void evaluate(const SumExpression<int> &, MatrixView<int>);
+template void evaluate(const SumExpression<float> &, MatrixView<float>);
+template void evaluate(const SumExpression<double> &, MatrixView<double>);
@@ -0,0 +1,154 @@
+#include "batched.h"
+#include "engines.h"
+#include "microkernel.h"
+#include "packing.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Products up to this many multiply-adds are interleaved across lanes;
+// beyond it a single product already fills the micro-kernels.
+constexpr long interleaveThreshold = 10L * 10 * 10;
+
+// Below this many multiply-adds in total the batch runs on the calling thread.
+constexpr long parallelThreshold = 64L * 64 * 64;
+
+void checkLeadingDimensions(int batch, int m, int k, int n, int lda, int ldb,
+                            int ldc) {
+  if (batch < 0 || m < 0 || k < 0 || n < 0 || lda < k || ldb < n || ldc < n)
+    throw std::invalid_argument("multiplyBatched: invalid dimensions");
+}
+
+// Runs `batch` products of the same shape; matrixA(b), matrixB(b) and
+// matrixC(b) return the views of product b.
+template <typename GetA, typename GetB, typename GetC>
+void runUniformBatch(int batch, int m, int k, int n, GetA matrixA,
+                     GetB matrixB, GetC matrixC) {
+  if (batch == 0 || m == 0 || n == 0)
+    return;
+  const long work = static_cast<long>(m) * k * n;
+  ThreadPool &pool = *threadPool();
+  const bool parallel = work * batch >= parallelThreshold;
+
+  if (work > interleaveThreshold) {
+    auto product = [&](int b) {
+      multiplySimd(matrixA(b), matrixB(b), matrixC(b), tileSizes());
+    };
+    if (parallel)
+      pool.parallelFor(batch, product);
+    else
+      for (int b = 0; b < batch; ++b)
+        product(b);
+    return;
+  }
+
+  const BatchKernel &kernel = batchKernel();
+  const int lanes = kernel.lanes;
+  const int groups = (batch + lanes - 1) / lanes;
+
+  // Each group of `lanes` products is gathered into interleaved buffers of
+  // the calling thread's arena, multiplied at once and scattered back.
+  // Missing lanes of the last group are zero-filled and ignored.
+  auto group = [&](int g) {
+    PackArena &arena = packArena();
+    int *a = arena.get<int>(PackArena::SlotA,
+                            static_cast<std::size_t>(m) * k * lanes);
+    int *b = arena.get<int>(PackArena::SlotB,
+                            static_cast<std::size_t>(k) * n * lanes);
+    int *c = arena.get<int>(PackArena::SlotC,
+                            static_cast<std::size_t>(m) * n * lanes);
+    const int first = g * lanes;
+    const int count = std::min(lanes, batch - first);
+
+    for (int l = 0; l < lanes; ++l) {
+      if (l >= count) {
+        for (int e = 0; e < m * k; ++e)
+          a[e * lanes + l] = 0;
+        for (int e = 0; e < k * n; ++e)
+          b[e * lanes + l] = 0;
+        continue;
+      }
+      ConstMatrixView<int> A = matrixA(first + l);
+      ConstMatrixView<int> B = matrixB(first + l);
+      for (int i = 0; i < m; ++i)
+        for (int p = 0; p < k; ++p)
+          a[(i * k + p) * lanes + l] = A(i, p);
+      for (int p = 0; p < k; ++p)
+        for (int j = 0; j < n; ++j)
+          b[(p * n + j) * lanes + l] = B(p, j);
+    }
+
+    kernel.fn(m, k, n, a, b, c);
+
+    for (int l = 0; l < count; ++l) {
+      MatrixView<int> C = matrixC(first + l);
+      for (int i = 0; i < m; ++i)
+        for (int j = 0; j < n; ++j)
+          C(i, j) = c[(i * n + j) * lanes + l];
+    }
+  };
+
+  if (parallel)
+    pool.parallelFor(groups, group);
+  else
+    for (int g = 0; g < groups; ++g)
+      group(g);
+}
+
+} // namespace
+
+void multiplyBatched(int batch, int m, int k, int n, const int *A, int lda,
+                     long strideA, const int *B, int ldb, long strideB, int *C,
+                     int ldc, long strideC) {
+  checkLeadingDimensions(batch, m, k, n, lda, ldb, ldc);
+  runUniformBatch(
+      batch, m, k, n,
+      [=](int b) { return ConstMatrixView<int>(A + b * strideA, m, k, lda); },
+      [=](int b) { return ConstMatrixView<int>(B + b * strideB, k, n, ldb); },
+      [=](int b) { return MatrixView<int>(C + b * strideC, m, n, ldc); });
+}
+
+void multiplyBatched(int batch, int m, int k, int n, const int *const *A,
+                     int lda, const int *const *B, int ldb, int *const *C,
+                     int ldc) {
+  checkLeadingDimensions(batch, m, k, n, lda, ldb, ldc);
+  runUniformBatch(
+      batch, m, k, n,
+      [=](int b) { return ConstMatrixView<int>(A[b], m, k, lda); },
+      [=](int b) { return ConstMatrixView<int>(B[b], k, n, ldb); },
+      [=](int b) { return MatrixView<int>(C[b], m, n, ldc); });
+}
+
+void multiplyBatched(const std::vector<ConstMatrixView<int>> &A,
+                     const std::vector<ConstMatrixView<int>> &B,
+                     const std::vector<MatrixView<int>> &C) {
+  if (A.size() != B.size() || A.size() != C.size())
+    throw std::invalid_argument("multiplyBatched: batch sizes differ");
+  const int batch = static_cast<int>(A.size());
+  bool uniform = true;
+  for (int b = 0; b < batch; ++b) {
+    if (A[b].cols() != B[b].rows() || C[b].rows() != A[b].rows() ||
+        C[b].cols() != B[b].cols())
+      throw std::invalid_argument("multiplyBatched: dimension mismatch");
+    uniform = uniform && A[b].rows() == A[0].rows() &&
+              A[b].cols() == A[0].cols() && B[b].cols() == B[0].cols();
+  }
+  if (batch == 0)
+    return;
+
+  if (uniform) {
+    runUniformBatch(
+        batch, A[0].rows(), A[0].cols(), B[0].cols(),
+        [&](int b) { return A[b]; }, [&](int b) { return B[b]; },
+        [&](int b) { return C[b]; });
+    return;
+  }
+
+  // Mixed shapes: one product per task on the SIMD engine.
+  threadPool()->parallelFor(batch, [&](int b) {
+    if (!C[b].empty())
+      multiplySimd(A[b], B[b], C[b], tileSizes());
+  });
+}
@@ -0,0 +1,378 @@
+#include "distributed.h"
+#include "matrix_multiplication.h"
+#include "engines.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Width of the panels of k that SUMMA broadcasts, wide enough for the local
+// products to run at full speed.
+constexpr int summaPanel = 256;
+
+template <typename T> MPI_Datatype datatype();
+template <> MPI_Datatype datatype<int>() { return MPI_INT; }
+template <> MPI_Datatype datatype<float>() { return MPI_FLOAT; }
+template <> MPI_Datatype datatype<double>() { return MPI_DOUBLE; }
+
+// Element count of a message, which MPI takes as an int.
+int messageSize(long rows, long cols) {
+  if (rows * cols > INT_MAX)
+    throw std::invalid_argument("multiplyDistributed: block too large");
+  return static_cast<int>(rows * cols);
+}
+
+// Copies a block into contiguous storage, as sent by MPI.
+template <typename T>
+void pack(ConstMatrixView<T> block, std::vector<T> &buffer) {
+  buffer.resize(static_cast<std::size_t>(block.rows()) * block.cols());
+  for (int i = 0; i < block.rows(); ++i)
+    std::copy(block.row(i), block.row(i) + block.cols(),
+              buffer.data() + static_cast<std::size_t>(i) * block.cols());
+}
+
+template <typename T>
+ConstMatrixView<T> contiguous(const std::vector<T> &buffer, int rows,
+                              int cols) {
+  return ConstMatrixView<T>(buffer.data(), rows, cols);
+}
+
+// C += A * B through a scratch product, or C = A * B on the first panel.
+template <typename T>
+void multiplyAdd(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                 bool first, Matrix<T> &product) {
+  if (first) {
+    multiply(A, B, C);
+    return;
+  }
+  if (product.rows() != C.rows() || product.cols() != C.cols())
+    product = Matrix<T>(C.rows(), C.cols());
+  multiply(A, B, product.view());
+  using U = ArithmeticType<T>;
+  for (int i = 0; i < C.rows(); ++i) {
+    U *c = reinterpret_cast<U *>(C.row(i));
+    const U *p = reinterpret_cast<const U *>(product.row(i));
+    for (int j = 0; j < C.cols(); ++j)
+      c[j] += p[j];
+  }
+}
+
+// Grid part holding index `i` of `extent` split in `parts`.
+int owner(int extent, int parts, int i) {
+  int part = static_cast<int>(static_cast<long>(i) * parts / extent);
+  while (blockRange(extent, parts, part).begin > i)
+    --part;
+  while (part + 1 < parts && blockRange(extent, parts, part + 1).begin <= i)
+    ++part;
+  return part;
+}
+
+template <typename T>
+void summa(const ProcessGrid &grid, int k, ConstMatrixView<T> A,
+           ConstMatrixView<T> B, MatrixView<T> C) {
+  const int rowsA = A.rows(), colsB = B.cols();
+
+  // Panels never straddle two owners of A columns or of B rows.
+  struct Panel {
+    int begin, width, ownerA, ownerB;
+  };
+  std::vector<Panel> panels;
+  for (int p = 0; p < k;) {
+    const int ownerA = owner(k, grid.cols(), p);
+    const int ownerB = owner(k, grid.rows(), p);
+    const BlockRange a = blockRange(k, grid.cols(), ownerA);
+    const BlockRange b = blockRange(k, grid.rows(), ownerB);
+    const int width = std::min({summaPanel, a.begin + a.size - p,
+                                b.begin + b.size - p});
+    panels.push_back({p, width, ownerA, ownerB});
+    p += width;
+  }
+  if (panels.empty()) {
+    for (int i = 0; i < C.rows(); ++i)
+      std::fill(C.row(i), C.row(i) + C.cols(), T());
+    return;
+  }
+
+  // Panel p + 1 is broadcast with non-blocking calls while panel p is
+  // multiplied, in the other of two buffers.
+  std::vector<T> panelA[2], panelB[2];
+  MPI_Request requests[2][2];
+  const auto start = [&](std::size_t p) {
+    const Panel &panel = panels[p];
+    const int slot = static_cast<int>(p % 2);
+    const int offsetA =
+        panel.begin - blockRange(k, grid.cols(), panel.ownerA).begin;
+    const int offsetB =
+        panel.begin - blockRange(k, grid.rows(), panel.ownerB).begin;
+    if (grid.col() == panel.ownerA)
+      pack(A.block(0, offsetA, rowsA, panel.width), panelA[slot]);
+    else
+      panelA[slot].resize(static_cast<std::size_t>(rowsA) * panel.width);
+    if (grid.row() == panel.ownerB)
+      pack(B.block(offsetB, 0, panel.width, colsB), panelB[slot]);
+    else
+      panelB[slot].resize(static_cast<std::size_t>(panel.width) * colsB);
+    MPI_Ibcast(panelA[slot].data(), messageSize(rowsA, panel.width),
+               datatype<T>(), panel.ownerA, grid.rowComm(),
+               &requests[slot][0]);
+    MPI_Ibcast(panelB[slot].data(), messageSize(panel.width, colsB),
+               datatype<T>(), panel.ownerB, grid.colComm(),
+               &requests[slot][1]);
+  };
+
+  Matrix<T> product;
+  start(0);
+  for (std::size_t p = 0; p < panels.size(); ++p) {
+    const int slot = static_cast<int>(p % 2);
+    MPI_Waitall(2, requests[slot], MPI_STATUSES_IGNORE);
+    if (p + 1 < panels.size())
+      start(p + 1);
+    multiplyAdd(contiguous(panelA[slot], rowsA, panels[p].width),
+                contiguous(panelB[slot], panels[p].width, colsB), C, p == 0,
+                product);
+  }
+}
+
+template <typename T>
+void cannon(const ProcessGrid &grid, int k, ConstMatrixView<T> A,
+            ConstMatrixView<T> B, MatrixView<T> C) {
+  const int q = grid.rows(), i = grid.row(), j = grid.col();
+  const int rowsA = A.rows(), colsB = B.cols();
+  const auto depth = [&](int l) { return blockRange(k, q, l % q).size; };
+
+  // Skew: row i of A moves i places left and column j of B j places up, so
+  // that (i, j) holds A(i, l) and B(l, j) with l = i + j.
+  std::vector<T> blockA[2], blockB[2];
+  pack(A, blockA[0]);
+  pack(B, blockB[0]);
+  int l = i + j;
+  blockA[1].resize(static_cast<std::size_t>(rowsA) * depth(l));
+  blockB[1].resize(static_cast<std::size_t>(depth(l)) * colsB);
+  int source, destination;
+  MPI_Cart_shift(grid.comm(), 1, -i, &source, &destination);
+  MPI_Sendrecv(blockA[0].data(), messageSize(rowsA, A.cols()), datatype<T>(),
+               destination, 0, blockA[1].data(), messageSize(rowsA, depth(l)),
+               datatype<T>(), source, 0, grid.comm(), MPI_STATUS_IGNORE);
+  MPI_Cart_shift(grid.comm(), 0, -j, &source, &destination);
+  MPI_Sendrecv(blockB[0].data(), messageSize(B.rows(), colsB), datatype<T>(),
+               destination, 1, blockB[1].data(), messageSize(depth(l), colsB),
+               datatype<T>(), source, 1, grid.comm(), MPI_STATUS_IGNORE);
+  std::swap(blockA[0], blockA[1]);
+  std::swap(blockB[0], blockB[1]);
+
+  int leftSource, left, upSource, up;
+  MPI_Cart_shift(grid.comm(), 1, -1, &leftSource, &left);
+  MPI_Cart_shift(grid.comm(), 0, -1, &upSource, &up);
+  Matrix<T> product;
+  for (int step = 0; step < q; ++step, ++l) {
+    multiplyAdd(contiguous(blockA[0], rowsA, depth(l)),
+                contiguous(blockB[0], depth(l), colsB), C, step == 0, product);
+    if (step + 1 == q)
+      break;
+    blockA[1].resize(static_cast<std::size_t>(rowsA) * depth(l + 1));
+    blockB[1].resize(static_cast<std::size_t>(depth(l + 1)) * colsB);
+    MPI_Sendrecv(blockA[0].data(), messageSize(rowsA, depth(l)), datatype<T>(),
+                 left, 2, blockA[1].data(), messageSize(rowsA, depth(l + 1)),
+                 datatype<T>(), leftSource, 2, grid.comm(), MPI_STATUS_IGNORE);
+    MPI_Sendrecv(blockB[0].data(), messageSize(depth(l), colsB), datatype<T>(),
+                 up, 3, blockB[1].data(), messageSize(depth(l + 1), colsB),
+                 datatype<T>(), upSource, 3, grid.comm(), MPI_STATUS_IGNORE);
+    std::swap(blockA[0], blockA[1]);
+    std::swap(blockB[0], blockB[1]);
+  }
+}
+
+template <typename T>
+void distributed(const ProcessGrid &grid, int m, int k, int n,
+                 ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                 DistributedAlgorithm algorithm) {
+  const BlockRange rows = blockRange(m, grid.rows(), grid.row());
+  const BlockRange cols = blockRange(n, grid.cols(), grid.col());
+  if (A.rows() != rows.size ||
+      A.cols() != blockRange(k, grid.cols(), grid.col()).size ||
+      B.rows() != blockRange(k, grid.rows(), grid.row()).size ||
+      B.cols() != cols.size || C.rows() != rows.size || C.cols() != cols.size)
+    throw std::invalid_argument("multiplyDistributed: wrong local block size");
+
+  if (algorithm == DistributedAlgorithm::Cannon) {
+    if (grid.rows() != grid.cols())
+      throw std::invalid_argument(
+          "multiplyDistributed: Cannon needs a square grid");
+    if (k == 0) {
+      for (int i = 0; i < C.rows(); ++i)
+        std::fill(C.row(i), C.row(i) + C.cols(), T());
+      return;
+    }
+    cannon(grid, k, A, B, C);
+  } else {
+    summa(grid, k, A, B, C);
+  }
+}
+
+// Root sends block (r, c) of its rows x cols matrix to the process at (r, c),
+// with point-to-point messages since the blocks may not fit the int
+// displacements of MPI_Scatterv. gather() is the reverse.
+template <typename T>
+void scatter(const ProcessGrid &grid, ConstMatrixView<T> whole, int rows,
+             int cols, std::vector<T> &local, int root) {
+  int rank;
+  MPI_Comm_rank(grid.comm(), &rank);
+  const BlockRange r = blockRange(rows, grid.rows(), grid.row());
+  const BlockRange c = blockRange(cols, grid.cols(), grid.col());
+  local.resize(static_cast<std::size_t>(r.size) * c.size);
+  if (rank != root) {
+    MPI_Recv(local.data(), messageSize(r.size, c.size), datatype<T>(), root, 4,
+             grid.comm(), MPI_STATUS_IGNORE);
+    return;
+  }
+  std::vector<T> buffer;
+  for (int target = 0; target < grid.rows() * grid.cols(); ++target) {
+    int coords[2];
+    MPI_Cart_coords(grid.comm(), target, 2, coords);
+    const BlockRange br = blockRange(rows, grid.rows(), coords[0]);
+    const BlockRange bc = blockRange(cols, grid.cols(), coords[1]);
+    const ConstMatrixView<T> block =
+        whole.block(br.begin, bc.begin, br.size, bc.size);
+    if (target == rank) {
+      pack(block, local);
+    } else {
+      pack(block, buffer);
+      MPI_Send(buffer.data(), messageSize(br.size, bc.size), datatype<T>(),
+               target, 4, grid.comm());
+    }
+  }
+}
+
+template <typename T>
+void gather(const ProcessGrid &grid, const std::vector<T> &local,
+            MatrixView<T> whole, int rows, int cols, int root) {
+  int rank;
+  MPI_Comm_rank(grid.comm(), &rank);
+  if (rank != root) {
+    MPI_Send(local.data(), static_cast<int>(local.size()), datatype<T>(), root,
+             5, grid.comm());
+    return;
+  }
+  std::vector<T> buffer;
+  for (int source = 0; source < grid.rows() * grid.cols(); ++source) {
+    int coords[2];
+    MPI_Cart_coords(grid.comm(), source, 2, coords);
+    const BlockRange br = blockRange(rows, grid.rows(), coords[0]);
+    const BlockRange bc = blockRange(cols, grid.cols(), coords[1]);
+    if (source == rank) {
+      buffer = local;
+    } else {
+      buffer.resize(static_cast<std::size_t>(br.size) * bc.size);
+      MPI_Recv(buffer.data(), messageSize(br.size, bc.size), datatype<T>(),
+               source, 5, grid.comm(), MPI_STATUS_IGNORE);
+    }
+    for (int i = 0; i < br.size; ++i)
+      std::copy(buffer.data() + static_cast<std::size_t>(i) * bc.size,
+                buffer.data() + static_cast<std::size_t>(i + 1) * bc.size,
+                whole.row(br.begin + i) + bc.begin);
+  }
+}
+
+template <typename T>
+void fromRoot(const ProcessGrid &grid, ConstMatrixView<T> A,
+              ConstMatrixView<T> B, MatrixView<T> C,
+              DistributedAlgorithm algorithm, int root) {
+  int rank;
+  MPI_Comm_rank(grid.comm(), &rank);
+  int dims[3] = {A.rows(), A.cols(), B.cols()};
+  if (rank == root &&
+      (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols()))
+    dims[0] = -1;
+  MPI_Bcast(dims, 3, MPI_INT, root, grid.comm());
+  if (dims[0] < 0)
+    throw std::invalid_argument("multiplyFromRoot: dimension mismatch");
+  const int m = dims[0], k = dims[1], n = dims[2];
+
+  std::vector<T> localA, localB, localC;
+  scatter(grid, A, m, k, localA, root);
+  scatter(grid, B, k, n, localB, root);
+  const BlockRange rows = blockRange(m, grid.rows(), grid.row());
+  const BlockRange cols = blockRange(n, grid.cols(), grid.col());
+  const BlockRange depthA = blockRange(k, grid.cols(), grid.col());
+  const BlockRange depthB = blockRange(k, grid.rows(), grid.row());
+  localC.resize(static_cast<std::size_t>(rows.size) * cols.size);
+  distributed(grid, m, k, n, contiguous(localA, rows.size, depthA.size),
+              contiguous(localB, depthB.size, cols.size),
+              MatrixView<T>(localC.data(), rows.size, cols.size), algorithm);
+  gather(grid, localC, C, m, n, root);
+}
+
+} // namespace
+
+ProcessGrid::ProcessGrid(MPI_Comm comm, int rows, int cols) {
+  int size;
+  MPI_Comm_size(comm, &size);
+  int dims[2] = {rows, cols};
+  if (rows == 0 && cols == 0)
+    MPI_Dims_create(size, 2, dims);
+  else if (rows <= 0 || cols <= 0 || rows * cols != size)
+    throw std::invalid_argument("ProcessGrid: grid does not match the "
+                                "communicator size");
+  rows_ = dims[0];
+  cols_ = dims[1];
+
+  // Periodic in both directions for the shifts of Cannon's algorithm; ranks
+  // keep their order so that positions follow the ranks of comm.
+  const int periods[2] = {1, 1};
+  MPI_Cart_create(comm, 2, dims, periods, 0, &grid_);
+  int rank, coords[2];
+  MPI_Comm_rank(grid_, &rank);
+  MPI_Cart_coords(grid_, rank, 2, coords);
+  row_ = coords[0];
+  col_ = coords[1];
+  const int keepCols[2] = {0, 1}, keepRows[2] = {1, 0};
+  MPI_Cart_sub(grid_, keepCols, &rowComm_);
+  MPI_Cart_sub(grid_, keepRows, &colComm_);
+}
+
+ProcessGrid::~ProcessGrid() {
+  MPI_Comm_free(&rowComm_);
+  MPI_Comm_free(&colComm_);
+  MPI_Comm_free(&grid_);
+}
+
+BlockRange blockRange(int extent, int parts, int index) {
+  const int base = extent / parts, extra = extent % parts;
+  return {index * base + std::min(index, extra), base + (index < extra)};
+}
+
+void multiplyDistributed(const ProcessGrid &grid, int m, int k, int n,
+                         ConstMatrixView<int> A, ConstMatrixView<int> B,
+                         MatrixView<int> C, DistributedAlgorithm algorithm) {
+  distributed(grid, m, k, n, A, B, C, algorithm);
+}
+void multiplyDistributed(const ProcessGrid &grid, int m, int k, int n,
+                         ConstMatrixView<float> A, ConstMatrixView<float> B,
+                         MatrixView<float> C, DistributedAlgorithm algorithm) {
+  distributed(grid, m, k, n, A, B, C, algorithm);
+}
+void multiplyDistributed(const ProcessGrid &grid, int m, int k, int n,
+                         ConstMatrixView<double> A, ConstMatrixView<double> B,
+                         MatrixView<double> C, DistributedAlgorithm algorithm) {
+  distributed(grid, m, k, n, A, B, C, algorithm);
+}
+
+void multiplyFromRoot(const ProcessGrid &grid, ConstMatrixView<int> A,
+                      ConstMatrixView<int> B, MatrixView<int> C,
+                      DistributedAlgorithm algorithm, int root) {
+  fromRoot(grid, A, B, C, algorithm, root);
+}
+void multiplyFromRoot(const ProcessGrid &grid, ConstMatrixView<float> A,
+                      ConstMatrixView<float> B, MatrixView<float> C,
+                      DistributedAlgorithm algorithm, int root) {
+  fromRoot(grid, A, B, C, algorithm, root);
+}
+void multiplyFromRoot(const ProcessGrid &grid, ConstMatrixView<double> A,
+                      ConstMatrixView<double> B, MatrixView<double> C,
+                      DistributedAlgorithm algorithm, int root) {
+  fromRoot(grid, A, B, C, algorithm, root);
+}
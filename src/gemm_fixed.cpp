@@ -0,0 +1,48 @@
+#include "engines.h"
+#include "fixed_matrix.h"
+
+namespace {
+
+using FixedKernelFn = void (*)(const int *A, int lda, const int *B, int ldb,
+                               int *C, int ldc);
+
+struct FixedKernel {
+  int m, k, n;
+  FixedKernelFn fn;
+};
+
+template <int M, int K, int N> constexpr FixedKernel entry() {
+  return {M, K, N, fixedProduct<M, K, N, int>};
+}
+
+// Square, vector-matrix and matrix-vector kernels for each supported size.
+template <int S> constexpr std::array<FixedKernel, 3> kernelsOfSize() {
+  return {entry<S, S, S>(), entry<1, S, S>(), entry<S, S, 1>()};
+}
+
+constexpr std::array<std::array<FixedKernel, 3>, 4> fixedKernels = {
+    kernelsOfSize<2>(), kernelsOfSize<3>(), kernelsOfSize<4>(),
+    kernelsOfSize<8>()};
+
+const FixedKernel *findFixedKernel(int m, int k, int n) {
+  for (const auto &ofSize : fixedKernels)
+    for (const FixedKernel &kernel : ofSize)
+      if (kernel.m == m && kernel.k == k && kernel.n == n)
+        return &kernel;
+  return nullptr;
+}
+
+} // namespace
+
+bool hasFixedSizeKernel(int m, int k, int n) {
+  return findFixedKernel(m, k, n) != nullptr;
+}
+
+bool multiplyFixedSize(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                       MatrixView<int> C) {
+  const FixedKernel *kernel = findFixedKernel(A.rows(), A.cols(), B.cols());
+  if (!kernel)
+    return false;
+  kernel->fn(A.data(), A.ld(), B.data(), B.ld(), C.data(), C.ld());
+  return true;
+}
@@ -0,0 +1,135 @@
+#include "engines.h"
+#include "microkernel.h"
+#include "numa_memory.h"
+#include "packing.h"
+#include "profiling.h"
+
+#include <algorithm>
+
+namespace {
+
+int ceilDiv(int a, int b) { return (a + b - 1) / b; }
+
+int roundUp(int value, int multiple) { return ceilDiv(value, multiple) * multiple; }
+
+// Moves each band of tileRows rows of C to the node that computes it, or
+// spreads C over the nodes with ids `ids`.
+template <typename T>
+void placeResult(MatrixView<T> C, int tileRows, int colTiles,
+                 const ThreadPool &pool, NumaPolicy policy,
+                 const std::vector<int> &ids) {
+  const auto bytes = [&](int rows) {
+    return (static_cast<std::size_t>(rows - 1) * C.ld() + C.cols()) *
+           sizeof(T);
+  };
+  if (policy == NumaPolicy::Interleave) {
+    interleaveOverNodes(C.data(), bytes(C.rows()), ids);
+    return;
+  }
+  const int rowTiles = ceilDiv(C.rows(), tileRows);
+  for (int r = 0; r < rowTiles; ++r) {
+    // A band split between two nodes goes to the one with its middle tile.
+    const int node = pool.taskNode(rowTiles * colTiles,
+                                   r * colTiles + colTiles / 2);
+    const int i0 = r * tileRows;
+    moveToNode(C.row(i0), bytes(std::min(tileRows, C.rows() - i0)),
+               ids[node]);
+  }
+}
+
+} // namespace
+
+ParallelTiles parallelTiles(int m, int n, int mr, int nr, TileSizes tiles,
+                            int threads) {
+  // Start from the cache tiles and halve the larger side until there are at
+  // least four tiles per thread to balance, without going below four
+  // micro-tiles in either direction.
+  int tileRows = std::min(roundUp(m, mr), roundUp(tiles.mc, mr));
+  int tileCols = std::min(roundUp(n, nr), roundUp(tiles.nc, nr));
+  const int wanted = 4 * threads;
+  while (ceilDiv(m, tileRows) * ceilDiv(n, tileCols) < wanted) {
+    if (tileCols >= tileRows && tileCols > 4 * nr)
+      tileCols = roundUp(tileCols / 2, nr);
+    else if (tileRows > 4 * mr)
+      tileRows = roundUp(tileRows / 2, mr);
+    else
+      break;
+  }
+  return {tileRows, tileCols};
+}
+
+template <typename T>
+void multiplyParallel(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C, TileSizes tiles, ThreadPool &pool,
+                      const SimdOptions<T> &options) {
+  const TypedMicroKernel<T> &kernel = microKernel<T>();
+  const int m = options.transA ? A.cols() : A.rows();
+  const int K = options.transA ? A.rows() : A.cols();
+  const int n = options.transB ? B.rows() : B.cols();
+  const ParallelTiles shape =
+      parallelTiles(m, n, kernel.mr, kernel.nr, tiles, pool.size());
+  const int tileRows = shape.rows, tileCols = shape.cols;
+
+  // Tiles are numbered row by row, so the contiguous chunk each thread gets
+  // shares the same block rows of A.
+  const int rowTiles = ceilDiv(m, tileRows);
+  const int colTiles = ceilDiv(n, tileCols);
+
+  // Across NUMA nodes B is packed once ahead: one copy per node, packed by
+  // a thread of the node, under FirstTouch, or one copy spread over all of
+  // them under Interleave.
+  const NumaPolicy policy =
+      pool.nodes() > 1 ? numaPolicy() : NumaPolicy::None;
+  std::vector<PackedB<T>> packed;
+  if (policy != NumaPolicy::None && !options.packedB && K > 0) {
+    MATMUL_PHASE(Pack);
+    if (policy == NumaPolicy::FirstTouch) {
+      packed.resize(pool.nodes());
+      pool.forEachNode([&](int node) {
+        packed[node] = packWholeB(B, tiles.kc, kernel.nr, options.transB);
+      });
+    } else {
+      packed.push_back(packWholeB(B, tiles.kc, kernel.nr, options.transB));
+    }
+  }
+  if (policy != NumaPolicy::None && !pool.topology().synthetic &&
+      numaAvailable()) {
+    std::vector<int> ids;
+    for (int node = 0; node < pool.nodes(); ++node)
+      ids.push_back(pool.topology().nodes[node].id);
+    placeResult(C, tileRows, colTiles, pool, policy, ids);
+    if (policy == NumaPolicy::Interleave && !packed.empty())
+      interleaveOverNodes(packed[0].data.data(),
+                          packed[0].data.size() * sizeof(T), ids);
+  }
+
+  MATMUL_TASKS(rowTiles * colTiles, pool.size());
+  pool.parallelFor(rowTiles * colTiles, [&](int tile) {
+    const int i0 = tile / colTiles * tileRows;
+    const int j0 = tile % colTiles * tileCols;
+    const int rows = std::min(tileRows, m - i0);
+    const int cols = std::min(tileCols, n - j0);
+    SimdOptions<T> part = options;
+    if (!packed.empty())
+      part.packedB = &packed[packed.size() == 1 ? 0 : pool.currentNode()];
+    part.packedCol += j0;
+    if (part.beta != T(0))
+      part.addend = options.addend.block(i0, j0, rows, cols);
+    const ConstMatrixView<T> a = options.transA ? A.block(0, i0, K, rows)
+                                                : A.block(i0, 0, rows, K);
+    const ConstMatrixView<T> b = options.transB ? B.block(j0, 0, cols, K)
+                                                : B.block(0, j0, K, cols);
+    multiplySimd(a, b, C.block(i0, j0, rows, cols), tiles, part);
+  });
+}
+
+template void multiplyParallel(ConstMatrixView<int>, ConstMatrixView<int>,
+                               MatrixView<int>, TileSizes, ThreadPool &,
+                               const SimdOptions<int> &);
+template void multiplyParallel(ConstMatrixView<float>, ConstMatrixView<float>,
+                               MatrixView<float>, TileSizes, ThreadPool &,
+                               const SimdOptions<float> &);
+template void multiplyParallel(ConstMatrixView<double>,
+                               ConstMatrixView<double>, MatrixView<double>,
+                               TileSizes, ThreadPool &,
+                               const SimdOptions<double> &);
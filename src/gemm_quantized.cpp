@@ -0,0 +1,261 @@
+#include "engines.h"
+#include "microkernel.h"
+#include "packing.h"
+#include "quantized.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+// VNNI multiplies unsigned bytes of A with signed bytes of B, so int8 A is
+// packed as A + 128 and the extra 128 * (column sum of B) is removed again in
+// the write-back.
+constexpr int unsignedOffset = 128;
+
+void checkQuantization(const Quantization &quant, int count) {
+  const auto fits = [count](std::size_t size) {
+    return size == 1 || size == static_cast<std::size_t>(count);
+  };
+  if (!fits(quant.scale.size()) || !fits(quant.zeroPoint.size()))
+    throw std::invalid_argument("multiplyQuantized: quantization size");
+}
+
+template <typename T> T entry(const std::vector<T> &values, int index) {
+  return values.size() == 1 ? values[0] : values[index];
+}
+
+// Packs the rows x cols block A into row panels of height mr for a kernel
+// with the given group: A(p * mr + i, g * group + t) goes to
+// dst[((p * groups + g) * mr + i) * group + t]. Padding is zero.
+template <typename Packed, typename S>
+void packQuantizedA(ConstMatrixView<S> A, int mr, int group, int offset,
+                    Packed *dst) {
+  const int rows = A.rows(), cols = A.cols();
+  const int groups = (cols + group - 1) / group;
+  for (int p = 0; p < rows; p += mr, dst += mr * groups * group) {
+    std::fill(dst, dst + mr * groups * group, Packed());
+    const int height = std::min(mr, rows - p);
+    for (int i = 0; i < height; ++i) {
+      const S *a = A.row(p + i);
+      for (int k = 0; k < cols; ++k)
+        dst[(k / group * mr + i) * group + k % group] =
+            static_cast<Packed>(a[k] + offset);
+    }
+  }
+}
+
+// Packs the rows x cols block B into column panels of width nr:
+// B(g * group + t, q * nr + j) goes to dst[((q * groups + g) * nr + j) *
+// group + t]. Padding is zero.
+template <typename Packed, typename S>
+void packQuantizedB(ConstMatrixView<S> B, int nr, int group, Packed *dst) {
+  const int rows = B.rows(), cols = B.cols();
+  const int groups = (rows + group - 1) / group;
+  for (int q = 0; q < cols; q += nr, dst += nr * groups * group) {
+    std::fill(dst, dst + nr * groups * group, Packed());
+    const int width = std::min(nr, cols - q);
+    for (int k = 0; k < rows; ++k) {
+      const S *b = B.row(k) + q;
+      Packed *out = dst + k / group * nr * group + k % group;
+      for (int j = 0; j < width; ++j)
+        out[j * group] = static_cast<Packed>(b[j]);
+    }
+  }
+}
+
+// Zero-point correction and scaling of the int32 sums, applied row by row
+// while a finished tile is written back.
+struct Epilogue {
+  const Quantization &quantA, &quantB;
+  const std::uint32_t *rowSums, *colSums;
+  int K;
+  int offset;
+
+  template <typename O>
+  void operator()(const std::int32_t *acc, int i, int j0, int count,
+                  O *dst) const {
+    const std::uint32_t zA = entry(quantA.zeroPoint, i);
+    const std::uint32_t rowTerm =
+        static_cast<std::uint32_t>(K) * zA - rowSums[i];
+    const std::uint32_t colFactor = zA + static_cast<std::uint32_t>(offset);
+    const float scaleA = entry(quantA.scale, i);
+    for (int j = 0; j < count; ++j) {
+      const std::uint32_t zB = entry(quantB.zeroPoint, j0 + j);
+      const std::int32_t value = static_cast<std::int32_t>(
+          static_cast<std::uint32_t>(acc[j]) - colFactor * colSums[j0 + j] +
+          zB * rowTerm);
+      if constexpr (std::is_same_v<O, float>)
+        dst[j] = scaleA * entry(quantB.scale, j0 + j) * value;
+      else
+        dst[j] = value;
+    }
+  }
+};
+
+// Blocked product of one block of C. The int32 sums of one mc x nc block are
+// kept in a buffer until the last panel of K and written back through the
+// epilogue while still in cache. With a single panel of K the loops run
+// jc -> pc -> ic and each panel of B is packed once; with several, m is cut
+// into bands of mc rows around the K loop and B is packed once per band.
+// Packed is the element type of the kernel's panels.
+template <typename Packed, typename S, typename O>
+void multiplyQuantizedSerial(ConstMatrixView<S> A, ConstMatrixView<S> B,
+                             MatrixView<O> C, int i0, int j0,
+                             const QuantizedKernel &kernel, TileSizes tiles,
+                             const Epilogue &epilogue) {
+  const int mr = kernel.mr, nr = kernel.nr, group = kernel.group;
+  const int offset = epilogue.offset;
+  const int m = A.rows(), n = B.cols(), K = A.cols();
+  const int mc = std::max(mr, tiles.mc / mr * mr);
+  const int nc = std::max(nr, tiles.nc / nr * nr);
+  // Whole groups per K block; int8 panels are 4x smaller than int ones, so
+  // the blocks can be deeper for the same cache footprint.
+  const int kc = std::max<int>(
+      group, tiles.kc * 4 / static_cast<int>(sizeof(Packed)) / group * group);
+  const int band = K <= kc ? m : mc;
+
+  PackArena &arena = packArena();
+  const int ncPacked = (std::min(nc, n) + nr - 1) / nr * nr;
+  const int mcPacked = (std::min(mc, m) + mr - 1) / mr * mr;
+  const int kcPacked = (std::min(kc, K) + group - 1) / group * group;
+  Packed *packedB = arena.get<Packed>(
+      PackArena::SlotB, static_cast<std::size_t>(kcPacked) * ncPacked);
+  Packed *packedA = arena.get<Packed>(
+      PackArena::SlotA, static_cast<std::size_t>(mcPacked) * kcPacked);
+  std::int32_t *tile = arena.get<std::int32_t>(
+      PackArena::SlotC, static_cast<std::size_t>(mcPacked) * ncPacked);
+
+  for (int jc = 0; jc < n; jc += nc) {
+    const int nb = std::min(nc, n - jc);
+    const int nbPacked = (nb + nr - 1) / nr * nr;
+    if (K == 0) {
+      std::fill(tile, tile + nbPacked, 0);
+      for (int i = 0; i < m; ++i)
+        epilogue(tile, i0 + i, j0 + jc, nb, C.row(i) + jc);
+      continue;
+    }
+
+    for (int b0 = 0; b0 < m; b0 += band) {
+      const int b1 = std::min(m, b0 + band);
+      for (int pc = 0; pc < K; pc += kc) {
+        const int kb = std::min(kc, K - pc);
+        const int groups = (kb + group - 1) / group;
+        packQuantizedB(B.block(pc, jc, kb, nb), nr, group, packedB);
+
+        for (int ic = b0; ic < b1; ic += mc) {
+          const int mb = std::min(mc, b1 - ic);
+          packQuantizedA(A.block(ic, pc, mb, kb), mr, group, offset, packedA);
+          for (int jr = 0; jr < nb; jr += nr) {
+            const Packed *b = packedB + static_cast<std::size_t>(jr) *
+                                            groups * group;
+            for (int ir = 0; ir < mb; ir += mr) {
+              const Packed *a = packedA + static_cast<std::size_t>(ir) *
+                                              groups * group;
+              kernel.fn(groups, a, b,
+                        tile + static_cast<std::size_t>(ir) * nbPacked + jr,
+                        nbPacked, pc > 0);
+            }
+          }
+
+          if (pc + kb < K)
+            continue;
+          for (int i = 0; i < mb; ++i)
+            epilogue(tile + static_cast<std::size_t>(i) * nbPacked,
+                     i0 + ic + i, j0 + jc, nb, C.row(ic + i) + jc);
+        }
+      }
+    }
+  }
+}
+
+template <typename S, typename O>
+void multiplyQuantizedImpl(ConstMatrixView<S> A, const Quantization &quantA,
+                           ConstMatrixView<S> B, const Quantization &quantB,
+                           MatrixView<O> C) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument("multiplyQuantized: dimension mismatch");
+  checkQuantization(quantA, A.rows());
+  checkQuantization(quantB, B.cols());
+  if (C.empty())
+    return;
+
+  const QuantizedKernel &kernel =
+      std::is_same_v<S, std::int8_t> ? int8Kernel() : int16Kernel();
+  const int m = A.rows(), n = B.cols(), K = A.cols();
+  const int offset = kernel.group == 4 ? unsignedOffset : 0;
+
+  // Row sums of A and column sums of B for the zero-point correction.
+  std::vector<std::uint32_t> rowSums(m, 0), colSums(n, 0);
+  for (int i = 0; i < m; ++i)
+    for (int k = 0; k < K; ++k)
+      rowSums[i] += static_cast<std::uint32_t>(A(i, k));
+  for (int k = 0; k < K; ++k) {
+    const S *b = B.row(k);
+    for (int j = 0; j < n; ++j)
+      colSums[j] += static_cast<std::uint32_t>(b[j]);
+  }
+  const Epilogue epilogue{quantA, quantB, rowSums.data(), colSums.data(), K,
+                          offset};
+
+  const auto run = [&](int i0, int j0, int rows, int cols) {
+    ConstMatrixView<S> a = A.block(i0, 0, rows, K);
+    ConstMatrixView<S> b = B.block(0, j0, K, cols);
+    MatrixView<O> c = C.block(i0, j0, rows, cols);
+    if (kernel.group == 4)
+      multiplyQuantizedSerial<std::uint8_t>(a, b, c, i0, j0, kernel,
+                                            tileSizes(), epilogue);
+    else
+      multiplyQuantizedSerial<std::int16_t>(a, b, c, i0, j0, kernel,
+                                            tileSizes(), epilogue);
+  };
+
+  const long work = static_cast<long>(m) * K * n;
+  if (work < gemmParallelThreshold || threadCount() == 1) {
+    run(0, 0, m, n);
+    return;
+  }
+
+  ThreadPool &pool = *threadPool();
+  const ParallelTiles shape =
+      parallelTiles(m, n, kernel.mr, kernel.nr, tileSizes(), pool.size());
+  const int rowTiles = (m + shape.rows - 1) / shape.rows;
+  const int colTiles = (n + shape.cols - 1) / shape.cols;
+  pool.parallelFor(rowTiles * colTiles, [&](int index) {
+    const int i0 = index / colTiles * shape.rows;
+    const int j0 = index % colTiles * shape.cols;
+    run(i0, j0, std::min(shape.rows, m - i0), std::min(shape.cols, n - j0));
+  });
+}
+
+} // namespace
+
+void multiplyQuantized(ConstMatrixView<std::int8_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int8_t> B,
+                       const Quantization &quantB, MatrixView<std::int32_t> C) {
+  multiplyQuantizedImpl(A, quantA, B, quantB, C);
+}
+
+void multiplyQuantized(ConstMatrixView<std::int8_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int8_t> B,
+                       const Quantization &quantB, MatrixView<float> C) {
+  multiplyQuantizedImpl(A, quantA, B, quantB, C);
+}
+
+void multiplyQuantized(ConstMatrixView<std::int16_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int16_t> B,
+                       const Quantization &quantB, MatrixView<std::int32_t> C) {
+  multiplyQuantizedImpl(A, quantA, B, quantB, C);
+}
+
+void multiplyQuantized(ConstMatrixView<std::int16_t> A,
+                       const Quantization &quantA,
+                       ConstMatrixView<std::int16_t> B,
+                       const Quantization &quantB, MatrixView<float> C) {
+  multiplyQuantizedImpl(A, quantA, B, quantB, C);
+}
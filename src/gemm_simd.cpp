@@ -0,0 +1,135 @@
+#include "engines.h"
+#include "microkernel.h"
+#include "packing.h"
+#include "profiling.h"
+
+#include <algorithm>
+
+template <typename T>
+void multiplySimd(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                  TileSizes tiles, const SimdOptions<T> &options) {
+  using U = ArithmeticType<T>;
+  const TypedMicroKernel<T> &kernel = microKernel<T>();
+  const int mr = kernel.mr, nr = kernel.nr;
+  const int m = options.transA ? A.cols() : A.rows();
+  const int K = options.transA ? A.rows() : A.cols();
+  const int n = options.transB ? B.rows() : B.cols();
+  const U beta = static_cast<U>(options.beta);
+  const ConstMatrixView<T> D = options.addend;
+  // Whether the first block of k starts from beta * D rather than zero.
+  const bool addend = beta != U(0);
+
+  if (K == 0) {
+    for (int i = 0; i < m; ++i)
+      for (int j = 0; j < n; ++j)
+        C(i, j) = addend ? static_cast<T>(beta * static_cast<U>(D(i, j)))
+                         : T();
+    return;
+  }
+
+  // Same cache blocking as the tiled engine, rounded to whole micro-tiles.
+  const int mc = std::max(mr, tiles.mc / mr * mr);
+  const int nc = std::max(nr, tiles.nc / nr * nr);
+  const int kc = tiles.kc;
+  // B packed ahead is only usable with the blocking it was packed for.
+  const PackedB<T> *packed = options.packedB;
+  if (packed && (packed->kc != kc || packed->nr != nr))
+    packed = nullptr;
+
+  // GotoBLAS loop order: a kc x nc panel of B and an mc x kc block of A are
+  // packed into micro-panels, so the kernel streams both operands
+  // sequentially through memory whatever the leading dimensions are.
+  PackArena &arena = packArena();
+  const int ncPacked = (std::min(nc, n) + nr - 1) / nr * nr;
+  const int mcPacked = (std::min(mc, m) + mr - 1) / mr * mr;
+  T *packedB = arena.get<T>(PackArena::SlotB,
+                            static_cast<std::size_t>(kc) * ncPacked);
+  T *packedA = arena.get<T>(PackArena::SlotA,
+                            static_cast<std::size_t>(mcPacked) * kc);
+
+  // Partial micro-tiles on the bottom and right edges of C are computed into
+  // this scratch block and then copied out; it fits the largest kernel.
+  alignas(64) T cEdge[16 * 32];
+
+  for (int jc = 0; jc < n; jc += nc) {
+    const int nb = std::min(nc, n - jc);
+    for (int pc = 0; pc < K; pc += kc) {
+      const int kb = std::min(kc, K - pc);
+      const bool accumulate = pc > 0;
+      const T *panelsB = packedB;
+      if (packed) {
+        panelsB = packed->panels(pc, options.packedCol + jc);
+      } else {
+        MATMUL_PHASE(Pack);
+        if (options.transB)
+          packBTransposed(B.block(jc, pc, nb, kb), nr, packedB);
+        else
+          packB(B.block(pc, jc, kb, nb), nr, packedB);
+      }
+
+      for (int ic = 0; ic < m; ic += mc) {
+        const int mb = std::min(mc, m - ic);
+        {
+          MATMUL_PHASE(Pack);
+          // alpha is applied here, once per element of A.
+          if (options.transA)
+            packATransposed(A.block(pc, ic, kb, mb), mr, packedA,
+                            options.alpha);
+          else
+            packA(A.block(ic, pc, mb, kb), mr, packedA, options.alpha);
+        }
+        MATMUL_MICRO_TILES(static_cast<long>((mb + mr - 1) / mr) *
+                           ((nb + nr - 1) / nr));
+
+        for (int jr = 0; jr < nb; jr += nr) {
+          const int nTile = std::min(nr, nb - jr);
+          const T *b = panelsB + static_cast<std::size_t>(jr) * kb;
+          for (int ir = 0; ir < mb; ir += mr) {
+            const int mTile = std::min(mr, mb - ir);
+            const T *a = packedA + static_cast<std::size_t>(ir) * kb;
+            T *c = C.row(ic + ir) + jc + jr;
+            const T *d = addend ? D.row(ic + ir) + jc + jr : nullptr;
+            if (mTile == mr && nTile == nr) {
+              // The first block of k accumulates onto beta * D, scaled into
+              // the micro-tile of C just before the kernel loads it.
+              if (!accumulate && addend &&
+                  (d != c || D.ld() != C.ld() || beta != U(1)))
+                for (int i = 0; i < mr; ++i)
+                  for (int j = 0; j < nr; ++j)
+                    c[static_cast<long>(i) * C.ld() + j] = static_cast<T>(
+                        beta *
+                        static_cast<U>(d[static_cast<long>(i) * D.ld() + j]));
+              kernel.fn(kb, a, 1, mr, b, nr, c, C.ld(),
+                        accumulate || addend);
+              continue;
+            }
+            kernel.fn(kb, a, 1, mr, b, nr, cEdge, nr, false);
+            MATMUL_PHASE(Writeback);
+            for (int i = 0; i < mTile; ++i)
+              for (int j = 0; j < nTile; ++j) {
+                const U value = static_cast<U>(cEdge[i * nr + j]);
+                T &out = c[static_cast<long>(i) * C.ld() + j];
+                U base = U(0);
+                if (accumulate)
+                  base = static_cast<U>(out);
+                else if (addend)
+                  base = beta * static_cast<U>(d[static_cast<long>(i) * D.ld() +
+                                                 j]);
+                out = static_cast<T>(base + value);
+              }
+          }
+        }
+      }
+    }
+  }
+}
+
+template void multiplySimd(ConstMatrixView<int>, ConstMatrixView<int>,
+                           MatrixView<int>, TileSizes,
+                           const SimdOptions<int> &);
+template void multiplySimd(ConstMatrixView<float>, ConstMatrixView<float>,
+                           MatrixView<float>, TileSizes,
+                           const SimdOptions<float> &);
+template void multiplySimd(ConstMatrixView<double>, ConstMatrixView<double>,
+                           MatrixView<double>, TileSizes,
+                           const SimdOptions<double> &);
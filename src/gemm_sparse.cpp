@@ -0,0 +1,339 @@
+#include "engines.h"
+#include "microkernel.h"
+#include "packing.h"
+#include "sparse.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+std::atomic<double> densityThreshold{0.1};
+
+// Below this many dense multiply-adds sampling the density costs more than a
+// sparse product could save.
+constexpr long samplingThreshold = 64L * 64 * 64;
+
+// Below this many multiply-adds of non-zeros waking the pool costs more than
+// it saves.
+constexpr long parallelThreshold = 1L << 18;
+
+constexpr int densitySamples = 256;
+
+// Rows of A transposed at a time by the dense-times-CSC product.
+constexpr int rowBlock = 64;
+
+void checkDimensions(int rowsA, int colsA, int rowsB, int colsB, int rowsC,
+                     int colsC) {
+  if (colsA != rowsB || rowsC != rowsA || colsC != colsB)
+    throw std::invalid_argument("multiply: dimension mismatch");
+}
+
+// Runs body(first, last) on consecutive ranges of rows holding about the same
+// number of non-zeros of `rowStart`, over the pool when the work is large.
+template <typename Body>
+void forRowRanges(const std::vector<int> &rowStart, long work,
+                  const Body &body) {
+  const int rows = static_cast<int>(rowStart.size()) - 1;
+  if (work < parallelThreshold || threadCount() == 1 || rows < 2) {
+    body(0, rows);
+    return;
+  }
+
+  ThreadPool &pool = *threadPool();
+  const int ranges = std::min(rows, 4 * pool.size());
+  const long nonZeros = rowStart.back();
+  std::vector<int> first(ranges + 1, rows);
+  first[0] = 0;
+  for (int r = 1; r < ranges; ++r) {
+    // The first row whose non-zeros start at or after r / ranges of the
+    // total, but at least one row per range.
+    const long target = nonZeros * r / ranges;
+    const int row = static_cast<int>(
+        std::lower_bound(rowStart.begin(), rowStart.end() - 1, target) -
+        rowStart.begin());
+    first[r] = std::max(first[r - 1] + 1, std::min(row, rows - (ranges - r)));
+  }
+  pool.parallelFor(ranges,
+                   [&](int r) { body(first[r], first[r + 1]); });
+}
+
+template <typename T> double density(ConstMatrixView<T> A) {
+  const long size = static_cast<long>(A.rows()) * A.cols();
+  if (size == 0)
+    return 0;
+
+  long nonZeros = 0;
+  if (size <= 4 * densitySamples) {
+    for (int i = 0; i < A.rows(); ++i)
+      nonZeros += A.cols() - std::count(A.row(i), A.row(i) + A.cols(), T());
+    return static_cast<double>(nonZeros) / size;
+  }
+
+  // Positions from the golden-ratio sequence cover the matrix evenly without
+  // lining up with diagonals, bands or blocks, and are reproducible.
+  const double golden = 0.6180339887498949;
+  for (int s = 0; s < densitySamples; ++s) {
+    const double fraction = std::fmod((s + 0.5) * golden, 1.0);
+    const long position = static_cast<long>(fraction * size);
+    nonZeros += A(static_cast<int>(position / A.cols()),
+                  static_cast<int>(position % A.cols())) != T();
+  }
+  return static_cast<double>(nonZeros) / densitySamples;
+}
+
+} // namespace
+
+template <typename T>
+void multiply(const CsrMatrix<T> &A, DenseOperand<T> B, DenseResult<T> C) {
+  checkDimensions(A.rows(), A.cols(), B.rows(), B.cols(), C.rows(), C.cols());
+  const int n = B.cols();
+  const std::vector<int> &rowStart = A.rowStart();
+  const std::vector<int> &indices = A.indices();
+  const std::vector<T> &values = A.values();
+
+  // Each row of C is an axpy over the rows of B selected by row i of A, so
+  // the inner loop streams contiguous memory. The int products go through
+  // the SIMD row kernel, the floating-point ones vectorize as written.
+  forRowRanges(rowStart, static_cast<long>(A.nonZeros()) * n,
+               [&](int first, int last) {
+                 for (int i = first; i < last; ++i) {
+                   const int start = rowStart[i];
+                   const int count = rowStart[i + 1] - start;
+                   if constexpr (std::is_same_v<T, int>) {
+                     sparseRowKernel().fn(count, indices.data() + start,
+                                          values.data() + start, B.data(),
+                                          B.ld(), n, C.row(i));
+                   } else {
+                     T *c = C.row(i);
+                     std::fill(c, c + n, T());
+                     for (int p = start; p < start + count; ++p) {
+                       const T a = values[p];
+                       const T *b = B.row(indices[p]);
+                       for (int j = 0; j < n; ++j)
+                         c[j] += a * b[j];
+                     }
+                   }
+                 }
+               });
+}
+
+template <typename T>
+void multiply(DenseOperand<T> A, const CscMatrix<T> &B, DenseResult<T> C) {
+  checkDimensions(A.rows(), A.cols(), B.rows(), B.cols(), C.rows(), C.cols());
+  const int m = A.rows(), n = B.cols();
+  const std::vector<int> &colStart = B.colStart();
+  const std::vector<int> &indices = B.indices();
+  const std::vector<T> &values = B.values();
+
+  // Every row of C costs the same, so the ranges are split evenly.
+  std::vector<int> evenRows(m + 1);
+  for (int i = 0; i <= m; ++i)
+    evenRows[i] = i;
+  const long work = static_cast<long>(m) * B.nonZeros();
+
+  if constexpr (std::is_same_v<T, int>) {
+    // Row j of the transposed product is column j of B times A^T, a sparse
+    // row over the rows of A^T. Blocks of rowBlock rows of A are transposed
+    // into the arena, multiplied by the row kernel and transposed back.
+    const int k = A.cols();
+    const SparseRowKernel &kernel = sparseRowKernel();
+    forRowRanges(evenRows, work, [&](int first, int last) {
+      PackArena &arena = packArena();
+      int *transposed = arena.get<int>(PackArena::SlotA,
+                                       static_cast<std::size_t>(k) * rowBlock);
+      int *product = arena.get<int>(PackArena::SlotB,
+                                    static_cast<std::size_t>(n) * rowBlock);
+      for (int i0 = first; i0 < last; i0 += rowBlock) {
+        const int h = std::min(rowBlock, last - i0);
+        for (int r = 0; r < h; ++r) {
+          const int *a = A.row(i0 + r);
+          for (int p = 0; p < k; ++p)
+            transposed[p * h + r] = a[p];
+        }
+        for (int j = 0; j < n; ++j)
+          kernel.fn(colStart[j + 1] - colStart[j],
+                    indices.data() + colStart[j], values.data() + colStart[j],
+                    transposed, h, h, product + j * h);
+        for (int r = 0; r < h; ++r) {
+          int *c = C.row(i0 + r);
+          for (int j = 0; j < n; ++j)
+            c[j] = product[j * h + r];
+        }
+      }
+    });
+  } else {
+    forRowRanges(evenRows, work, [&](int first, int last) {
+      for (int i = first; i < last; ++i) {
+        const T *a = A.row(i);
+        T *c = C.row(i);
+        for (int j = 0; j < n; ++j) {
+          T sum = T();
+          for (int p = colStart[j]; p < colStart[j + 1]; ++p)
+            sum += a[indices[p]] * values[p];
+          c[j] = sum;
+        }
+      }
+    });
+  }
+}
+
+template <typename T>
+CsrMatrix<T> multiply(const CsrMatrix<T> &A, const CsrMatrix<T> &B) {
+  checkDimensions(A.rows(), A.cols(), B.rows(), B.cols(), A.rows(), B.cols());
+  using U = ArithmeticType<T>;
+  const int m = A.rows(), n = B.cols();
+  const std::vector<int> &startA = A.rowStart(), &startB = B.rowStart();
+  const std::vector<int> &indicesA = A.indices(), &indicesB = B.indices();
+  const std::vector<T> &valuesA = A.values(), &valuesB = B.values();
+
+  // Multiply-adds of row i, to balance both passes.
+  std::vector<int> workStart(m + 1, 0);
+  for (int i = 0; i < m; ++i) {
+    long work = 0;
+    for (int p = startA[i]; p < startA[i + 1]; ++p)
+      work += startB[indicesA[p] + 1] - startB[indicesA[p]];
+    workStart[i + 1] = static_cast<int>(
+        std::min<long>(workStart[i] + work, std::numeric_limits<int>::max()));
+  }
+  const long work = workStart[m];
+
+  // Symbolic pass: the number of distinct columns of each row of C, marking
+  // the columns already seen with the row index.
+  std::vector<int> rowStart(m + 1, 0);
+  forRowRanges(workStart, work, [&](int first, int last) {
+    std::vector<int> marker(n, -1);
+    for (int i = first; i < last; ++i) {
+      int count = 0;
+      for (int p = startA[i]; p < startA[i + 1]; ++p)
+        for (int q = startB[indicesA[p]]; q < startB[indicesA[p] + 1]; ++q)
+          if (marker[indicesB[q]] != i) {
+            marker[indicesB[q]] = i;
+            ++count;
+          }
+      rowStart[i + 1] = count;
+    }
+  });
+  for (int i = 0; i < m; ++i)
+    rowStart[i + 1] += rowStart[i];
+
+  // Numeric pass: a dense accumulator per range of rows gathers row i of C,
+  // then its columns are sorted and copied out.
+  std::vector<int> indices(rowStart[m]);
+  std::vector<T> values(rowStart[m]);
+  forRowRanges(workStart, work, [&](int first, int last) {
+    std::vector<U> accumulator(n);
+    std::vector<int> marker(n, -1);
+    for (int i = first; i < last; ++i) {
+      int *columns = indices.data() + rowStart[i];
+      int count = 0;
+      for (int p = startA[i]; p < startA[i + 1]; ++p) {
+        const U a = static_cast<U>(valuesA[p]);
+        for (int q = startB[indicesA[p]]; q < startB[indicesA[p] + 1]; ++q) {
+          const int j = indicesB[q];
+          if (marker[j] != i) {
+            marker[j] = i;
+            accumulator[j] = U();
+            columns[count++] = j;
+          }
+          accumulator[j] += a * static_cast<U>(valuesB[q]);
+        }
+      }
+      std::sort(columns, columns + count);
+      for (int p = 0; p < count; ++p)
+        values[rowStart[i] + p] = static_cast<T>(accumulator[columns[p]]);
+    }
+  });
+
+  return CsrMatrix<T>(m, n, std::move(rowStart), std::move(indices),
+                      std::move(values));
+}
+
+double estimateDensity(ConstMatrixView<int> A) { return density(A); }
+double estimateDensity(ConstMatrixView<float> A) { return density(A); }
+double estimateDensity(ConstMatrixView<double> A) { return density(A); }
+
+void setSparseDensityThreshold(double threshold) {
+  if (!(threshold >= 0 && threshold <= 1))
+    throw std::invalid_argument(
+        "setSparseDensityThreshold: threshold must be in [0, 1]");
+  densityThreshold.store(threshold, std::memory_order_relaxed);
+}
+
+double sparseDensityThreshold() {
+  return densityThreshold.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void multiplySparse(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                    MatrixView<T> C) {
+  if (density(A) <= density(B))
+    multiply(CsrMatrix<T>(A), B, C);
+  else
+    multiply(A, CscMatrix<T>(B), C);
+}
+
+template <typename T>
+bool isSparseProduct(ConstMatrixView<T> A, ConstMatrixView<T> B) {
+  const long work = static_cast<long>(A.rows()) * A.cols() * B.cols();
+  const double threshold = sparseDensityThreshold();
+  return work >= samplingThreshold &&
+         (density(A) <= threshold || density(B) <= threshold);
+}
+
+template <typename T>
+bool multiplyIfSparse(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C) {
+  const long work = static_cast<long>(A.rows()) * A.cols() * B.cols();
+  if (work < samplingThreshold)
+    return false;
+
+  const double threshold = sparseDensityThreshold();
+  if (density(A) <= threshold) {
+    multiply(CsrMatrix<T>(A), B, C);
+    return true;
+  }
+  if (density(B) <= threshold) {
+    multiply(A, CscMatrix<T>(B), C);
+    return true;
+  }
+  return false;
+}
+
+template void multiply(const CsrMatrix<int> &, DenseOperand<int>,
+                       DenseResult<int>);
+template void multiply(DenseOperand<int>, const CscMatrix<int> &,
+                       DenseResult<int>);
+template CsrMatrix<int> multiply(const CsrMatrix<int> &,
+                                 const CsrMatrix<int> &);
+template void multiplySparse(ConstMatrixView<int>, ConstMatrixView<int>,
+                             MatrixView<int>);
+template bool isSparseProduct(ConstMatrixView<int>, ConstMatrixView<int>);
+template bool multiplyIfSparse(ConstMatrixView<int>, ConstMatrixView<int>,
+                               MatrixView<int>);
+template void multiply(const CsrMatrix<float> &, DenseOperand<float>,
+                       DenseResult<float>);
+template void multiply(DenseOperand<float>, const CscMatrix<float> &,
+                       DenseResult<float>);
+template CsrMatrix<float> multiply(const CsrMatrix<float> &,
+                                 const CsrMatrix<float> &);
+template void multiplySparse(ConstMatrixView<float>, ConstMatrixView<float>,
+                             MatrixView<float>);
+template bool isSparseProduct(ConstMatrixView<float>, ConstMatrixView<float>);
+template bool multiplyIfSparse(ConstMatrixView<float>, ConstMatrixView<float>,
+                               MatrixView<float>);
+template void multiply(const CsrMatrix<double> &, DenseOperand<double>,
+                       DenseResult<double>);
+template void multiply(DenseOperand<double>, const CscMatrix<double> &,
+                       DenseResult<double>);
+template CsrMatrix<double> multiply(const CsrMatrix<double> &,
+                                 const CsrMatrix<double> &);
+template void multiplySparse(ConstMatrixView<double>, ConstMatrixView<double>,
+                             MatrixView<double>);
+template bool isSparseProduct(ConstMatrixView<double>, ConstMatrixView<double>);
+template bool multiplyIfSparse(ConstMatrixView<double>, ConstMatrixView<double>,
+                               MatrixView<double>);
@@ -0,0 +1,142 @@
+#include "engines.h"
+#include "strassen.h"
+
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<int> crossoverSize{512};
+
+// Element-wise helpers in the arithmetic of the engines, so that for int
+// every intermediate wraps modulo 2^32 exactly like the classical engines.
+// The element type is called E here, since T names a Winograd temporary.
+template <typename E>
+void add(ConstMatrixView<E> X, ConstMatrixView<E> Y, MatrixView<E> Z) {
+  using U = ArithmeticType<E>;
+  for (int i = 0; i < Z.rows(); ++i) {
+    const E *x = X.row(i), *y = Y.row(i);
+    E *z = Z.row(i);
+    for (int j = 0; j < Z.cols(); ++j)
+      z[j] = static_cast<E>(static_cast<U>(x[j]) + static_cast<U>(y[j]));
+  }
+}
+
+template <typename E>
+void subtract(ConstMatrixView<E> X, ConstMatrixView<E> Y, MatrixView<E> Z) {
+  using U = ArithmeticType<E>;
+  for (int i = 0; i < Z.rows(); ++i) {
+    const E *x = X.row(i), *y = Y.row(i);
+    E *z = Z.row(i);
+    for (int j = 0; j < Z.cols(); ++j)
+      z[j] = static_cast<E>(static_cast<U>(x[j]) - static_cast<U>(y[j]));
+  }
+}
+
+template <typename E>
+void strassen(ConstMatrixView<E> A, ConstMatrixView<E> B, MatrixView<E> C,
+              int crossover, const ClassicalEngine<E> &leaf);
+
+// Winograd's variant: 7 half-size products and 15 additions, scheduled so
+// that the quadrants of C serve as accumulators and only three temporaries
+// are needed per level. All dimensions of A and B are even here.
+template <typename E>
+void winogradStep(ConstMatrixView<E> A, ConstMatrixView<E> B, MatrixView<E> C,
+                  int crossover, const ClassicalEngine<E> &leaf) {
+  const int m = A.rows() / 2, k = A.cols() / 2, n = B.cols() / 2;
+  ConstMatrixView<E> A11 = A.block(0, 0, m, k), A12 = A.block(0, k, m, k);
+  ConstMatrixView<E> A21 = A.block(m, 0, m, k), A22 = A.block(m, k, m, k);
+  ConstMatrixView<E> B11 = B.block(0, 0, k, n), B12 = B.block(0, n, k, n);
+  ConstMatrixView<E> B21 = B.block(k, 0, k, n), B22 = B.block(k, n, k, n);
+  MatrixView<E> C11 = C.block(0, 0, m, n), C12 = C.block(0, n, m, n);
+  MatrixView<E> C21 = C.block(m, 0, m, n), C22 = C.block(m, n, m, n);
+
+  Matrix<E> S(m, k), T(k, n), P(m, n);
+
+  subtract<E>(A11, A21, S);              // S3
+  subtract<E>(B22, B12, T);              // T3
+  strassen<E>(S, T, C21, crossover, leaf); // P7
+  add<E>(A21, A22, S);                   // S1
+  subtract<E>(B12, B11, T);              // T1
+  strassen<E>(S, T, C22, crossover, leaf); // P5
+  subtract<E>(S, A11, S);                // S2 = S1 - A11
+  subtract<E>(B22, T, T);                // T2 = B22 - T1
+  strassen<E>(S, T, C12, crossover, leaf); // P6
+  strassen<E>(A11, B11, C11, crossover, leaf); // P1
+
+  add<E>(C12, C11, C12); // U2 = P1 + P6
+  add<E>(C21, C12, C21); // U3 = U2 + P7
+  add<E>(C12, C22, C12); // U4 = U2 + P5
+  add<E>(C22, C21, C22); // U7 = U3 + P5 = C22
+
+  subtract<E>(A12, S, S);                // S4 = A12 - S2
+  strassen<E>(S, B22, P, crossover, leaf); // P3
+  add<E>(C12, P, C12);                   // U5 = U4 + P3 = C12
+
+  subtract<E>(T, B21, T);                // T4 = T2 - B21
+  strassen<E>(A22, T, P, crossover, leaf); // P4
+  subtract<E>(C21, P, C21);              // U6 = U3 - P4 = C21
+
+  strassen<E>(A12, B21, P, crossover, leaf); // P2
+  add<E>(C11, P, C11);                   // U1 = P1 + P2 = C11
+}
+
+// Odd dimensions are handled by dynamic peeling: the even leading part goes
+// through Winograd's step and the last row, column and rank-1 term left over
+// are fixed up with classical products.
+template <typename E>
+void strassen(ConstMatrixView<E> A, ConstMatrixView<E> B, MatrixView<E> C,
+              int crossover, const ClassicalEngine<E> &leaf) {
+  const int m = A.rows(), K = A.cols(), n = B.cols();
+  if (m < crossover || K < crossover || n < crossover) {
+    leaf(A, B, C);
+    return;
+  }
+
+  const int me = m & ~1, ke = K & ~1, ne = n & ~1;
+  winogradStep<E>(A.block(0, 0, me, ke), B.block(0, 0, ke, ne),
+               C.block(0, 0, me, ne), crossover, leaf);
+
+  if (ke != K) {
+    // C(0:me, 0:ne) += A(0:me, K-1) * B(K-1, 0:ne)
+    using U = ArithmeticType<E>;
+    const E *b = B.row(ke);
+    for (int i = 0; i < me; ++i) {
+      const U a = static_cast<U>(A(i, ke));
+      U *c = reinterpret_cast<U *>(C.row(i));
+      for (int j = 0; j < ne; ++j)
+        c[j] += a * static_cast<U>(b[j]);
+    }
+  }
+  if (ne != n)
+    leaf(A, B.block(0, ne, K, 1), C.block(0, ne, m, 1));
+  if (me != m)
+    leaf(A.block(me, 0, 1, K), B.block(0, 0, K, ne), C.block(me, 0, 1, ne));
+}
+
+} // namespace
+
+void setStrassenCrossover(int crossover) {
+  if (crossover < 2)
+    throw std::invalid_argument("setStrassenCrossover: crossover must be >= 2");
+  crossoverSize.store(crossover, std::memory_order_relaxed);
+}
+
+int strassenCrossover() {
+  return crossoverSize.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void multiplyStrassen(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C, const ClassicalEngine<T> &leaf) {
+  strassen(A, B, C, strassenCrossover(), leaf);
+}
+
+template void multiplyStrassen(ConstMatrixView<int>, ConstMatrixView<int>,
+                               MatrixView<int>, const ClassicalEngine<int> &);
+template void multiplyStrassen(ConstMatrixView<float>, ConstMatrixView<float>,
+                               MatrixView<float>,
+                               const ClassicalEngine<float> &);
+template void multiplyStrassen(ConstMatrixView<double>,
+                               ConstMatrixView<double>, MatrixView<double>,
+                               const ClassicalEngine<double> &);
@@ -0,0 +1,327 @@
+#include "engines.h"
+#include "microkernel.h"
+#include "profiling.h"
+#include "structure.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> detectionEnabled{false};
+
+// Below this many popcounts waking the pool costs more than it saves.
+constexpr long parallelThreshold = 1L << 18;
+
+// Bytes of packed columns of B a block keeps in L2 while the rows of A
+// stream past.
+constexpr long binaryBlockBytes = 256L * 1024;
+
+// Rows of A a task of the binary product takes at a time (the kernel
+// handles four rows together).
+constexpr int rowGranularity = 16;
+
+struct Analysis {
+  Structure structure = Structure::General;
+  // For a permutation, the column of the one of each row.
+  std::vector<int> columns;
+};
+
+// One pass over the rows of M, stopping at the first row that rules out
+// both a diagonal and a binary matrix. The counts of a row have no
+// dependence between elements, so the compiler vectorizes them.
+Analysis analyse(ConstMatrixView<int> M, bool wantColumns) {
+  const int rows = M.rows(), cols = M.cols();
+  const bool square = rows == cols;
+  bool binary = true, diagonal = square, unitDiagonal = square;
+  bool permutation = square;
+  long nonZeros = 0;
+  std::vector<char> taken;
+  Analysis analysis;
+  if (permutation) {
+    taken.assign(cols, 0);
+    if (wantColumns)
+      analysis.columns.resize(rows);
+  }
+
+  for (int i = 0; i < rows; ++i) {
+    const int *row = M.row(i);
+    int count = 0;
+    unsigned high = 0;
+    for (int j = 0; j < cols; ++j) {
+      count += row[j] != 0;
+      high |= static_cast<unsigned>(row[j]) & ~1u;
+    }
+    nonZeros += count;
+    binary = binary && high == 0;
+    if (diagonal) {
+      diagonal = count == (row[i] != 0);
+      unitDiagonal = unitDiagonal && row[i] == 1;
+    }
+    if (permutation) {
+      permutation = binary && count == 1;
+      if (permutation) {
+        const int column =
+            static_cast<int>(std::find(row, row + cols, 1) - row);
+        permutation = !taken[column];
+        taken[column] = 1;
+        if (wantColumns)
+          analysis.columns[i] = column;
+      }
+    }
+    if (!binary && !diagonal)
+      return {};
+  }
+
+  if (nonZeros == 0)
+    analysis.structure = Structure::Zero;
+  else if (diagonal && unitDiagonal)
+    analysis.structure = Structure::Identity;
+  else if (permutation)
+    analysis.structure = Structure::Permutation;
+  else if (diagonal)
+    analysis.structure = Structure::Diagonal;
+  else if (binary)
+    analysis.structure = Structure::Binary;
+  if (analysis.structure != Structure::Permutation)
+    analysis.columns.clear();
+  return analysis;
+}
+
+void copyRows(ConstMatrixView<int> M, MatrixView<int> C) {
+  for (int i = 0; i < C.rows(); ++i)
+    std::copy(M.row(i), M.row(i) + C.cols(), C.row(i));
+}
+
+// C = P * B for the permutation P whose row i has its one in columns[i]:
+// row i of C is row columns[i] of B.
+void gatherRows(const std::vector<int> &columns, ConstMatrixView<int> B,
+                MatrixView<int> C) {
+  for (int i = 0; i < C.rows(); ++i)
+    std::copy(B.row(columns[i]), B.row(columns[i]) + C.cols(), C.row(i));
+}
+
+// C = A * P: column columns[p] of C is column p of A.
+void scatterColumns(ConstMatrixView<int> A, const std::vector<int> &columns,
+                    MatrixView<int> C) {
+  for (int i = 0; i < C.rows(); ++i) {
+    const int *a = A.row(i);
+    int *c = C.row(i);
+    for (int p = 0; p < A.cols(); ++p)
+      c[columns[p]] = a[p];
+  }
+}
+
+// C = D * B for a diagonal D: row i of B scaled by D(i, i).
+void scaleRows(ConstMatrixView<int> D, ConstMatrixView<int> B,
+               MatrixView<int> C) {
+  for (int i = 0; i < C.rows(); ++i) {
+    const unsigned d = static_cast<unsigned>(D(i, i));
+    const int *b = B.row(i);
+    int *c = C.row(i);
+    for (int j = 0; j < C.cols(); ++j)
+      c[j] = static_cast<int>(d * static_cast<unsigned>(b[j]));
+  }
+}
+
+// C = A * D for a diagonal D: column j of A scaled by D(j, j).
+void scaleColumns(ConstMatrixView<int> A, ConstMatrixView<int> D,
+                  MatrixView<int> C) {
+  std::vector<unsigned> d(D.rows());
+  for (int j = 0; j < D.rows(); ++j)
+    d[j] = static_cast<unsigned>(D(j, j));
+  for (int i = 0; i < C.rows(); ++i) {
+    const int *a = A.row(i);
+    int *c = C.row(i);
+    for (int j = 0; j < C.cols(); ++j)
+      c[j] = static_cast<int>(static_cast<unsigned>(a[j]) * d[j]);
+  }
+}
+
+// Rows of A packed 64 elements to a word, bit b of word w of row i holding
+// A(i, 64 * w + b).
+std::vector<std::uint64_t> packRows(ConstMatrixView<int> A, int words) {
+  std::vector<std::uint64_t> packed(static_cast<std::size_t>(A.rows()) * words);
+  for (int i = 0; i < A.rows(); ++i) {
+    const int *a = A.row(i);
+    std::uint64_t *p = packed.data() + static_cast<std::size_t>(i) * words;
+    for (int p0 = 0; p0 < A.cols(); p0 += 64) {
+      const int length = std::min(64, A.cols() - p0);
+      std::uint64_t word = 0;
+      for (int b = 0; b < length; ++b)
+        word |= static_cast<std::uint64_t>(a[p0 + b]) << b;
+      p[p0 / 64] = word;
+    }
+  }
+  return packed;
+}
+
+// Columns of B packed the same way, 64 rows of B at a time.
+std::vector<std::uint64_t> packColumns(ConstMatrixView<int> B, int words) {
+  std::vector<std::uint64_t> packed(static_cast<std::size_t>(B.cols()) * words);
+  for (int p = 0; p < B.rows(); ++p) {
+    const int *b = B.row(p);
+    const int w = p / 64, bit = p % 64;
+    for (int j = 0; j < B.cols(); ++j)
+      packed[static_cast<std::size_t>(j) * words + w] |=
+          static_cast<std::uint64_t>(b[j]) << bit;
+  }
+  return packed;
+}
+
+// C = A * B for two matrices of zeros and ones, with the binary kernel of
+// the current instruction set.
+void binaryProduct(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                   MatrixView<int> C) {
+  const int m = A.rows(), k = A.cols(), n = B.cols();
+  if (k == 0) {
+    for (int i = 0; i < m; ++i)
+      std::fill(C.row(i), C.row(i) + n, 0);
+    return;
+  }
+  const int words = (k + 63) / 64;
+  const std::vector<std::uint64_t> a = packRows(A, words);
+  const std::vector<std::uint64_t> b = packColumns(B, words);
+  const BinaryKernel &kernel = binaryKernel();
+  const int block = static_cast<int>(std::max<long>(
+      4, binaryBlockBytes / (static_cast<long>(words) * 8)));
+  const int units = (m + rowGranularity - 1) / rowGranularity;
+  const long work = static_cast<long>(m) * n * words;
+
+  // Rows [first, last) of C, block of columns by block of columns.
+  const auto rows = [&](int first, int last) {
+    for (int j0 = 0; j0 < n; j0 += block)
+      kernel.fn(last - first, std::min(block, n - j0), words,
+                a.data() + static_cast<std::size_t>(first) * words,
+                b.data() + static_cast<std::size_t>(j0) * words,
+                C.row(first) + j0, C.ld());
+  };
+  if (work < parallelThreshold || threadCount() == 1 || units < 2) {
+    MATMUL_ENGINE(Engine::Simd);
+    rows(0, m);
+    return;
+  }
+
+  MATMUL_ENGINE(Engine::Parallel);
+  ThreadPool &pool = *threadPool();
+  const int ranges = std::min(units, 4 * pool.size());
+  pool.parallelFor(ranges, [&](int r) {
+    const int first =
+        static_cast<int>(static_cast<long>(units) * r / ranges) *
+        rowGranularity;
+    const int last = std::min(
+        m, static_cast<int>(static_cast<long>(units) * (r + 1) / ranges) *
+               rowGranularity);
+    rows(first, last);
+  });
+}
+
+// Whether the structures of A and B select one of the paths below.
+bool hasStructuredPath(Structure a, Structure b) {
+  return a == Structure::Zero || a == Structure::Identity ||
+         a == Structure::Permutation || a == Structure::Diagonal ||
+         b == Structure::Zero || b == Structure::Identity ||
+         b == Structure::Permutation || b == Structure::Diagonal ||
+         (a == Structure::Binary && b == Structure::Binary);
+}
+
+} // namespace
+
+Structure detectStructure(ConstMatrixView<int> M) {
+  return analyse(M, false).structure;
+}
+
+const char *structureName(Structure structure) {
+  switch (structure) {
+  case Structure::General:
+    return "general";
+  case Structure::Zero:
+    return "zero";
+  case Structure::Identity:
+    return "identity";
+  case Structure::Permutation:
+    return "permutation";
+  case Structure::Diagonal:
+    return "diagonal";
+  case Structure::Binary:
+    return "binary";
+  }
+  return "unknown";
+}
+
+void setStructureDetection(bool enabled) {
+  detectionEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool structureDetection() {
+  return detectionEnabled.load(std::memory_order_relaxed);
+}
+
+void multiplyBinary(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                    MatrixView<int> C) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument("multiplyBinary: dimension mismatch");
+  const auto isBinary = [](ConstMatrixView<int> M) {
+    for (int i = 0; i < M.rows(); ++i) {
+      unsigned high = 0;
+      for (int j = 0; j < M.cols(); ++j)
+        high |= static_cast<unsigned>(M(i, j)) & ~1u;
+      if (high != 0)
+        return false;
+    }
+    return true;
+  };
+  if (!isBinary(A) || !isBinary(B))
+    throw std::invalid_argument("multiplyBinary: elements must be 0 or 1");
+  if (C.empty())
+    return;
+  MATMUL_CALL(Engine::Auto, profileTypeName<int>(), A.rows(), A.cols(),
+              B.cols());
+  binaryProduct(A, B, C);
+}
+
+bool isStructuredProduct(ConstMatrixView<int> A, ConstMatrixView<int> B) {
+  if (!structureDetection())
+    return false;
+  return hasStructuredPath(detectStructure(A), detectStructure(B));
+}
+
+bool multiplyIfStructured(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                          MatrixView<int> C) {
+  if (!structureDetection())
+    return false;
+  const Analysis a = analyse(A, true);
+  // B is only analysed when A leaves a choice.
+  Analysis b;
+  if (a.structure != Structure::Zero && a.structure != Structure::Identity)
+    b = analyse(B, true);
+  if (!hasStructuredPath(a.structure, b.structure))
+    return false;
+
+  if (a.structure == Structure::Binary && b.structure == Structure::Binary) {
+    binaryProduct(A, B, C);
+    return true;
+  }
+
+  MATMUL_ENGINE(Engine::Simd);
+  if (a.structure == Structure::Zero || b.structure == Structure::Zero) {
+    for (int i = 0; i < C.rows(); ++i)
+      std::fill(C.row(i), C.row(i) + C.cols(), 0);
+  } else if (a.structure == Structure::Identity) {
+    copyRows(B, C);
+  } else if (b.structure == Structure::Identity) {
+    copyRows(A, C);
+  } else if (a.structure == Structure::Permutation) {
+    gatherRows(a.columns, B, C);
+  } else if (b.structure == Structure::Permutation) {
+    scatterColumns(A, b.columns, C);
+  } else if (a.structure == Structure::Diagonal) {
+    scaleRows(A, B, C);
+  } else {
+    scaleColumns(A, B, C);
+  }
+  return true;
+}
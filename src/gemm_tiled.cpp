@@ -0,0 +1,131 @@
+#include "engines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::mutex tileMutex;
+bool tilesReady = false;
+TileSizes currentTiles;
+
+long cacheSize(int name, long fallback) {
+  long size = sysconf(name);
+  return size > 0 ? size : fallback;
+}
+
+int roundDown(long value, int multiple) {
+  return static_cast<int>(std::max<long>(multiple, value / multiple * multiple));
+}
+
+} // namespace
+
+template <typename T>
+void multiplyTiled(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                   TileSizes tiles) {
+  using U = ArithmeticType<T>;
+  const int m = A.rows(), n = B.cols(), K = A.cols();
+
+  for (int i = 0; i < m; ++i)
+    std::fill(C.row(i), C.row(i) + n, T());
+
+  // The innermost loop runs along a row of B and C, so it streams contiguous
+  // memory and vectorizes; the j/k/i blocks keep the working set in cache.
+  for (int jc = 0; jc < n; jc += tiles.nc) {
+    const int nb = std::min(tiles.nc, n - jc);
+    for (int pc = 0; pc < K; pc += tiles.kc) {
+      const int kb = std::min(tiles.kc, K - pc);
+      for (int ic = 0; ic < m; ic += tiles.mc) {
+        const int mb = std::min(tiles.mc, m - ic);
+        for (int i = ic; i < ic + mb; ++i) {
+          const T *a = A.row(i);
+          U *c = reinterpret_cast<U *>(C.row(i) + jc);
+          for (int k = pc; k < pc + kb; ++k) {
+            const U aik = static_cast<U>(a[k]);
+            const T *b = B.row(k) + jc;
+            for (int j = 0; j < nb; ++j)
+              c[j] += aik * static_cast<U>(b[j]);
+          }
+        }
+      }
+    }
+  }
+}
+
+template void multiplyTiled(ConstMatrixView<int>, ConstMatrixView<int>,
+                            MatrixView<int>, TileSizes);
+template void multiplyTiled(ConstMatrixView<float>, ConstMatrixView<float>,
+                            MatrixView<float>, TileSizes);
+template void multiplyTiled(ConstMatrixView<double>, ConstMatrixView<double>,
+                            MatrixView<double>, TileSizes);
+
+TileSizes tileSizes() {
+  {
+    std::lock_guard<std::mutex> lock(tileMutex);
+    if (tilesReady)
+      return currentTiles;
+  }
+  TileSizes calibrated = calibrateTileSizes();
+  std::lock_guard<std::mutex> lock(tileMutex);
+  if (!tilesReady) {
+    currentTiles = calibrated;
+    tilesReady = true;
+  }
+  return currentTiles;
+}
+
+void setTileSizes(TileSizes sizes) {
+  if (sizes.mc <= 0 || sizes.nc <= 0 || sizes.kc <= 0)
+    throw std::invalid_argument("setTileSizes: tile sizes must be positive");
+  std::lock_guard<std::mutex> lock(tileMutex);
+  currentTiles = sizes;
+  tilesReady = true;
+}
+
+TileSizes calibrateTileSizes() {
+  const long l1 = cacheSize(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+  const long l2 = cacheSize(_SC_LEVEL2_CACHE_SIZE, 256 * 1024);
+  const long l3 = cacheSize(_SC_LEVEL3_CACHE_SIZE, 8 * 1024 * 1024);
+  const long elem = sizeof(int);
+
+  // For each kc, nc fills half of L2 with the B panel (and keeps a C row in
+  // half of L1), and mc fills a quarter of L3 with the A block.
+  std::vector<TileSizes> candidates;
+  for (int kc : {64, 128, 256, 512}) {
+    const long nc = std::min(l2 / 2 / (elem * kc), l1 / 2 / elem);
+    const long mc = std::min<long>(l3 / 4 / (elem * kc), 1024);
+    candidates.push_back({roundDown(mc, 8), roundDown(nc, 16), kc});
+  }
+
+  // Time every candidate on a product large enough to spill out of L1.
+  const int size = 256;
+  Matrix<int> A(size, size), B(size, size), C(size, size);
+  for (int i = 0; i < size; ++i)
+    for (int j = 0; j < size; ++j) {
+      A(i, j) = (i * 7 + j * 3) % 21 - 10;
+      B(i, j) = (i * 5 + j * 11) % 19 - 9;
+    }
+
+  TileSizes best = candidates.front();
+  double bestTime = std::numeric_limits<double>::max();
+  for (const TileSizes &candidate : candidates) {
+    double fastest = std::numeric_limits<double>::max();
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      auto start = std::chrono::steady_clock::now();
+      multiplyTiled<int>(A, B, C, candidate);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      fastest = std::min(fastest, elapsed.count());
+    }
+    if (fastest < bestTime) {
+      bestTime = fastest;
+      best = candidate;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,138 @@
+#include "engines.h"
+#include "microkernel.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Below this many elements streamed waking the pool costs more than it
+// saves.
+constexpr long parallelThreshold = 1L << 18;
+
+// Length of the pieces of a dot product. Their sums are added in order
+// whether or not they ran in parallel, so the result does not depend on the
+// number of threads.
+constexpr int dotChunk = 1 << 14;
+
+// Tasks split the rows of a gemv in multiples of this many rows, and the
+// columns of a gevm in multiples of this many columns (whole cache lines).
+constexpr int rowGranularity = 16;
+constexpr int columnGranularity = 64;
+
+bool runsInParallel(long elements) {
+  return elements >= parallelThreshold && threadCount() > 1;
+}
+
+// Runs body(first, last) on ranges of [0, count) that are multiples of
+// `granularity`, about four per thread of the pool when the product streams
+// enough elements.
+template <typename Body>
+void forRanges(int count, int granularity, long elements, const Body &body) {
+  const int units = (count + granularity - 1) / granularity;
+  if (!runsInParallel(elements) || units < 2) {
+    MATMUL_ENGINE(Engine::Simd);
+    body(0, count);
+    return;
+  }
+
+  MATMUL_ENGINE(Engine::Parallel);
+  ThreadPool &pool = *threadPool();
+  const int ranges = std::min(units, 4 * pool.size());
+  pool.parallelFor(ranges, [&](int r) {
+    const int first =
+        static_cast<int>(static_cast<long>(units) * r / ranges) * granularity;
+    const int last = std::min(
+        count,
+        static_cast<int>(static_cast<long>(units) * (r + 1) / ranges) *
+            granularity);
+    body(first, last);
+  });
+}
+
+// The k x 1 column x as a contiguous array, gathered into `copy` if its
+// elements are apart.
+template <typename T>
+const T *contiguousColumn(ConstMatrixView<T> x, std::vector<T> &copy) {
+  if (x.ld() == 1 || x.rows() <= 1)
+    return x.data();
+  copy.resize(x.rows());
+  for (int p = 0; p < x.rows(); ++p)
+    copy[p] = x(p, 0);
+  return copy.data();
+}
+
+template <typename T>
+void dot(ConstMatrixView<T> a, const T *x, MatrixView<T> C) {
+  using U = ArithmeticType<T>;
+  const VectorKernel<T> &kernel = vectorKernel<T>();
+  const int k = a.cols();
+  const int chunks = std::max(1, (k + dotChunk - 1) / dotChunk);
+  std::vector<T> partial(chunks);
+  forRanges(chunks, 1, k, [&](int first, int last) {
+    for (int c = first; c < last; ++c) {
+      const int p = c * dotChunk;
+      kernel.gemv(1, std::min(dotChunk, k - p), a.row(0) + p, a.ld(), x + p,
+                  &partial[c], 1);
+    }
+  });
+  U sum = 0;
+  for (const T value : partial)
+    sum += static_cast<U>(value);
+  C(0, 0) = static_cast<T>(sum);
+}
+
+} // namespace
+
+bool isVectorProduct(int m, int k, int n) {
+  return m == 1 || k == 1 || n == 1;
+}
+
+template <typename T>
+bool multiplyIfVector(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                      MatrixView<T> C) {
+  const int m = A.rows(), k = A.cols(), n = B.cols();
+  if (!isVectorProduct(m, k, n))
+    return false;
+
+  const VectorKernel<T> &kernel = vectorKernel<T>();
+  if (k == 1) {
+    // Rank-1 update: every row of C is a multiple of the row B.
+    forRanges(m, 1, static_cast<long>(m) * n, [&](int first, int last) {
+      kernel.outer(last - first, n, A.row(first), A.ld(), B.row(0),
+                   C.row(first), C.ld());
+    });
+    return true;
+  }
+
+  std::vector<T> copy;
+  if (n == 1) {
+    const T *x = contiguousColumn(B, copy);
+    if (m == 1) {
+      dot(A, x, C);
+      return true;
+    }
+    forRanges(m, rowGranularity, static_cast<long>(m) * k,
+              [&](int first, int last) {
+                kernel.gemv(last - first, k, A.row(first), A.ld(), x,
+                            C.row(first), C.ld());
+              });
+    return true;
+  }
+
+  // m == 1: y = a * B, the columns of B split between the threads.
+  forRanges(n, columnGranularity, static_cast<long>(k) * n,
+            [&](int first, int last) {
+              kernel.gevm(k, last - first, A.row(0), B.row(0) + first,
+                          B.ld(), C.row(0) + first);
+            });
+  return true;
+}
+
+template bool multiplyIfVector(ConstMatrixView<int>, ConstMatrixView<int>,
+                               MatrixView<int>);
+template bool multiplyIfVector(ConstMatrixView<float>, ConstMatrixView<float>,
+                               MatrixView<float>);
+template bool multiplyIfVector(ConstMatrixView<double>,
+                               ConstMatrixView<double>, MatrixView<double>);
@@ -0,0 +1,203 @@
+#include "accumulation.h"
+#include "matrix_multiplication.h"
+#include "engines.h"
+#include "microkernel.h"
+#include "packing.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+template <typename T>
+void checkDimensions(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                     MatrixView<T> C) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument("multiply: dimension mismatch");
+}
+
+// Write-back of one row of an int64 tile into C. Checked records whether any
+// element was out of range instead of branching per element.
+struct StoreInt64 {
+  void operator()(const std::int64_t *src, int count, std::int64_t *dst) {
+    std::copy(src, src + count, dst);
+  }
+};
+
+struct StoreChecked {
+  bool overflow = false;
+  void operator()(const std::int64_t *src, int count, int *dst) {
+    bool out = false;
+    for (int j = 0; j < count; ++j) {
+      out |= src[j] < INT_MIN || src[j] > INT_MAX;
+      dst[j] = static_cast<int>(static_cast<std::uint32_t>(src[j]));
+    }
+    overflow |= out;
+  }
+};
+
+struct StoreSaturate {
+  void operator()(const std::int64_t *src, int count, int *dst) {
+    for (int j = 0; j < count; ++j)
+      dst[j] = static_cast<int>(
+          std::min<std::int64_t>(std::max<std::int64_t>(src[j], INT_MIN),
+                                 INT_MAX));
+  }
+};
+
+// Blocked product with the wide micro-kernels. The int64 sums of one mc x nc
+// block of C are kept in a buffer until the last panel of K and then stored
+// through `store`, so the scratch stays mc x nc whatever the size. With a
+// single panel of K the loops run in the order of multiplySimd and each
+// panel of B is packed once; with several, m is cut into bands of mc rows
+// around the K loop and B is packed once per band.
+template <typename T, typename Store>
+void multiplyWideSerial(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                        MatrixView<T> C, TileSizes tiles, Store &store) {
+  const WideMicroKernel &kernel = wideMicroKernel();
+  const int mr = kernel.mr, nr = kernel.nr;
+  const int m = A.rows(), n = B.cols(), K = A.cols();
+  const int mc = std::max(mr, tiles.mc / mr * mr);
+  const int nc = std::max(nr, tiles.nc / nr * nr);
+  const int kc = tiles.kc;
+  const int band = K <= kc ? m : mc;
+
+  PackArena &arena = packArena();
+  const int ncPacked = (std::min(nc, n) + nr - 1) / nr * nr;
+  const int mcPacked = (std::min(mc, m) + mr - 1) / mr * mr;
+  int *packedB = arena.get<int>(PackArena::SlotB,
+                                static_cast<std::size_t>(std::min(kc, K)) *
+                                    ncPacked);
+  int *packedA = arena.get<int>(PackArena::SlotA,
+                                static_cast<std::size_t>(mcPacked) *
+                                    std::min(kc, K));
+  // The sums are padded to whole micro-tiles, so edges need no special case.
+  std::int64_t *sums = arena.get<std::int64_t>(
+      PackArena::SlotC, static_cast<std::size_t>(mcPacked) * ncPacked);
+
+  for (int jc = 0; jc < n; jc += nc) {
+    const int nb = std::min(nc, n - jc);
+    const int nbPacked = (nb + nr - 1) / nr * nr;
+    if (K == 0) {
+      MATMUL_PHASE(Writeback);
+      std::fill(sums, sums + nbPacked, 0);
+      for (int i = 0; i < m; ++i)
+        store(sums, nb, C.row(i) + jc);
+      continue;
+    }
+
+    for (int i0 = 0; i0 < m; i0 += band) {
+      const int i1 = std::min(m, i0 + band);
+      for (int pc = 0; pc < K; pc += kc) {
+        const int kb = std::min(kc, K - pc);
+        {
+          MATMUL_PHASE(Pack);
+          packB(B.block(pc, jc, kb, nb), nr, packedB);
+        }
+
+        for (int ic = i0; ic < i1; ic += mc) {
+          const int mb = std::min(mc, i1 - ic);
+          {
+            MATMUL_PHASE(Pack);
+            packA(A.block(ic, pc, mb, kb), mr, packedA);
+          }
+          MATMUL_MICRO_TILES(static_cast<long>((mb + mr - 1) / mr) *
+                             ((nb + nr - 1) / nr));
+          for (int jr = 0; jr < nb; jr += nr) {
+            const int *b = packedB + static_cast<std::size_t>(jr) * kb;
+            for (int ir = 0; ir < mb; ir += mr) {
+              const int *a = packedA + static_cast<std::size_t>(ir) * kb;
+              kernel.fn(kb, a, 1, mr, b, nr,
+                        sums + static_cast<std::size_t>(ir) * nbPacked + jr,
+                        nbPacked, pc > 0);
+            }
+          }
+
+          if (pc + kb < K)
+            continue;
+          MATMUL_PHASE(Writeback);
+          for (int i = 0; i < mb; ++i)
+            store(sums + static_cast<std::size_t>(i) * nbPacked, nb,
+                  C.row(ic + i) + jc);
+        }
+      }
+    }
+  }
+}
+
+// Spreads large products over the shared pool, one Store per tile so that
+// the Checked flag needs no synchronization until the end.
+template <typename T, typename Store>
+void multiplyWide(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                  MatrixView<T> C, Store &store) {
+  checkDimensions(A, B, C);
+  if (C.empty())
+    return;
+
+  const TileSizes tiles = tileSizes();
+  const int m = A.rows(), n = B.cols(), K = A.cols();
+  const long work = static_cast<long>(m) * K * n;
+  MATMUL_CALL(Engine::Auto, profileTypeName<T>(), m, K, n);
+  if (work < gemmParallelThreshold || threadCount() == 1) {
+    MATMUL_ENGINE(Engine::Simd);
+    multiplyWideSerial(A, B, C, tiles, store);
+    return;
+  }
+  MATMUL_ENGINE(Engine::Parallel);
+
+  ThreadPool &pool = *threadPool();
+  const WideMicroKernel &kernel = wideMicroKernel();
+  const ParallelTiles shape =
+      parallelTiles(m, n, kernel.mr, kernel.nr, tiles, pool.size());
+  const int rowTiles = (m + shape.rows - 1) / shape.rows;
+  const int colTiles = (n + shape.cols - 1) / shape.cols;
+  std::atomic<bool> overflow{false};
+  MATMUL_TASKS(rowTiles * colTiles, pool.size());
+  pool.parallelFor(rowTiles * colTiles, [&](int index) {
+    const int i0 = index / colTiles * shape.rows;
+    const int j0 = index % colTiles * shape.cols;
+    const int rows = std::min(shape.rows, m - i0);
+    const int cols = std::min(shape.cols, n - j0);
+    Store local;
+    multiplyWideSerial(A.block(i0, 0, rows, K), B.block(0, j0, K, cols),
+                       C.block(i0, j0, rows, cols), tiles, local);
+    if constexpr (std::is_same_v<Store, StoreChecked>)
+      if (local.overflow)
+        overflow.store(true, std::memory_order_relaxed);
+  });
+  if constexpr (std::is_same_v<Store, StoreChecked>)
+    store.overflow |= overflow.load();
+}
+
+} // namespace
+
+void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C,
+              Accumulation accumulation) {
+  switch (accumulation) {
+  case Accumulation::Wrap:
+    multiply(A, B, C);
+    break;
+  case Accumulation::Checked: {
+    StoreChecked store;
+    multiplyWide(A, B, C, store);
+    if (store.overflow)
+      throw std::overflow_error("multiply: result does not fit in an int");
+    break;
+  }
+  case Accumulation::Saturate: {
+    StoreSaturate store;
+    multiplyWide(A, B, C, store);
+    break;
+  }
+  }
+}
+
+void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B,
+              MatrixView<std::int64_t> C) {
+  StoreInt64 store;
+  multiplyWide(A, B, C, store);
+}
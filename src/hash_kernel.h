@@ -0,0 +1,43 @@
+#ifndef HASH_KERNEL_H
+#define HASH_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Constants of the hash row kernels (see HashRowKernelFn in microkernel.h)
+// and the stripe loop they share. Each translation unit passes its own
+// stripe and scramble functions, which work on the eight accumulators in
+// the registers of its instruction set; the anonymous namespace keeps the
+// instantiations of different instruction sets apart.
+namespace {
+
+constexpr int hashLanes = 8;
+constexpr std::size_t hashStripeBytes = hashLanes * sizeof(std::uint64_t);
+constexpr std::uint64_t hashPrime32 = 0x9E3779B1u;
+constexpr std::uint64_t hashStripeStep = 0xC2B2AE3D27D4EB4Full;
+alignas(64) constexpr std::uint64_t hashSecret[hashLanes] = {
+    0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull,
+    0x1F67B3B7A4A44072ull, 0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull,
+    0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull};
+
+// Runs stripe(data, s) on every 64-byte stripe s of the row, the last one
+// zero-padded, then scramble().
+template <typename Stripe, typename Scramble>
+void hashStripes(const char *row, std::size_t bytes, Stripe stripe,
+                 Scramble scramble) {
+  std::uint64_t s = 0;
+  std::size_t offset = 0;
+  for (; offset + hashStripeBytes <= bytes; offset += hashStripeBytes)
+    stripe(row + offset, s++);
+  if (offset < bytes) {
+    alignas(64) char tail[hashStripeBytes] = {};
+    std::memcpy(tail, row + offset, bytes - offset);
+    stripe(tail, s);
+  }
+  scramble();
+}
+
+} // namespace
+
+#endif // HASH_KERNEL_H
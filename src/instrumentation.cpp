@@ -0,0 +1,401 @@
+#include "instrumentation.h"
+#include "profiling.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+
+#ifdef MATMUL_INSTRUMENTATION
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using profiling::Phase;
+
+constexpr int phaseCount = static_cast<int>(Phase::Count);
+
+long long nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Cycles, instructions, cache references and cache misses of the calling
+// thread, opened as one perf_event group on first use.
+class CounterGroup {
+public:
+  ~CounterGroup() {
+    for (int fd : fds_)
+      if (fd >= 0)
+        close(fd);
+  }
+
+  // Current values; false if the counters are not available.
+  bool read(long long values[4]) {
+    if (!opened_)
+      open();
+    if (fds_[0] < 0)
+      return false;
+    struct {
+      std::uint64_t count;
+      std::uint64_t values[4];
+    } group;
+    if (::read(fds_[0], &group, sizeof(group)) != sizeof(group))
+      return false;
+    for (int i = 0; i < 4; ++i)
+      values[i] = static_cast<long long>(group.values[i]);
+    return true;
+  }
+
+private:
+  void open() {
+    opened_ = true;
+    const std::uint64_t events[4] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < 4; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = events[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      const int group = i == 0 ? -1 : fds_[0];
+      fds_[i] = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+      if (fds_[i] < 0) {
+        for (int j = 0; j < i; ++j) {
+          close(fds_[j]);
+          fds_[j] = -1;
+        }
+        return;
+      }
+    }
+  }
+
+  bool opened_ = false;
+  int fds_[4] = {-1, -1, -1, -1};
+};
+
+std::atomic<int> nextThreadId{0};
+
+struct ThreadState {
+  profiling::Call *call = nullptr;
+  Phase phase = Phase::Compute;
+  long long since = 0;
+  int id = nextThreadId.fetch_add(1);
+  CounterGroup counters;
+};
+
+thread_local ThreadState threadState;
+
+struct Span {
+  int thread;
+  long long start;
+  long long end;
+};
+
+struct Record {
+  CallProfile profile;
+  int thread;
+  std::vector<Span> spans;
+};
+
+std::mutex recordsMutex;
+std::deque<Record> records;
+long long epoch = -1;
+
+} // namespace
+
+namespace profiling {
+
+struct Call {
+  Engine engine;
+  std::atomic<bool> engineSet{false};
+  const char *type;
+  int m, k, n;
+  long long start = 0;
+  std::atomic<long long> phaseNs[phaseCount] = {};
+  std::atomic<long> microTiles{0};
+  std::atomic<long> tasks{0};
+  std::atomic<int> threads{1};
+  std::atomic<bool> countersAvailable{true};
+  std::atomic<long long> counters[4] = {};
+  std::mutex spansMutex;
+  std::vector<Span> spans;
+
+  void addCounters(const long long before[4], const long long after[4]) {
+    for (int i = 0; i < 4; ++i)
+      counters[i].fetch_add(after[i] - before[i], std::memory_order_relaxed);
+  }
+};
+
+namespace {
+
+// Credits the time since the last switch to the current phase and call.
+void switchPhase(Phase phase) {
+  const long long now = nowNs();
+  if (threadState.call)
+    threadState.call->phaseNs[static_cast<int>(threadState.phase)].fetch_add(
+        now - threadState.since, std::memory_order_relaxed);
+  threadState.since = now;
+  threadState.phase = phase;
+}
+
+void store(Call &call, long long end) {
+  CallProfile profile;
+  profile.engine = call.engine;
+  profile.type = call.type;
+  profile.m = call.m;
+  profile.k = call.k;
+  profile.n = call.n;
+  profile.seconds = (end - call.start) * 1e-9;
+  const auto phaseSeconds = [&](Phase phase) {
+    return call.phaseNs[static_cast<int>(phase)] * 1e-9;
+  };
+  profile.packSeconds = phaseSeconds(Phase::Pack);
+  profile.computeSeconds = phaseSeconds(Phase::Compute);
+  profile.writebackSeconds = phaseSeconds(Phase::Writeback);
+  if (profile.seconds > 0)
+    profile.gops = 2.0 * call.m * call.k * call.n / profile.seconds / 1e9;
+  profile.microTiles = call.microTiles;
+  profile.tasks = call.tasks;
+  profile.threads = call.threads;
+  const double busy =
+      profile.packSeconds + profile.computeSeconds + profile.writebackSeconds;
+  if (profile.seconds > 0)
+    profile.utilization =
+        std::min(1.0, busy / (profile.threads * profile.seconds));
+  profile.counters.available = call.countersAvailable;
+  if (profile.counters.available) {
+    profile.counters.cycles = call.counters[0];
+    profile.counters.instructions = call.counters[1];
+    profile.counters.cacheReferences = call.counters[2];
+    profile.counters.cacheMisses = call.counters[3];
+  }
+
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  if (epoch < 0)
+    epoch = call.start;
+  profile.start = (call.start - epoch) * 1e-9;
+  if (records.size() == callProfileCapacity)
+    records.pop_front();
+  std::lock_guard<std::mutex> spansLock(call.spansMutex);
+  records.push_back({profile, threadState.id, std::move(call.spans)});
+}
+
+// Counters of the calling thread when the call started.
+thread_local long long callCounters[4];
+
+} // namespace
+
+CallScope::CallScope(Engine engine, const char *type, int m, int k, int n) {
+  if (threadState.call)
+    return;
+  call_ = new Call;
+  call_->engine = engine;
+  call_->type = type;
+  call_->m = m;
+  call_->k = k;
+  call_->n = n;
+  if (!threadState.counters.read(callCounters))
+    call_->countersAvailable = false;
+  call_->start = nowNs();
+  threadState.call = call_;
+  threadState.phase = Phase::Compute;
+  threadState.since = call_->start;
+}
+
+CallScope::~CallScope() {
+  if (!call_)
+    return;
+  switchPhase(Phase::Compute);
+  const long long end = threadState.since;
+  long long counters[4];
+  if (call_->countersAvailable && threadState.counters.read(counters))
+    call_->addCounters(callCounters, counters);
+  else
+    call_->countersAvailable = false;
+  threadState.call = nullptr;
+  store(*call_, end);
+  delete call_;
+}
+
+PhaseScope::PhaseScope(Phase phase) : outer_(threadState.phase) {
+  switchPhase(phase);
+}
+
+PhaseScope::~PhaseScope() { switchPhase(outer_); }
+
+TaskScope::TaskScope(Call *call)
+    : call_(call), outer_(threadState.call), outerPhase_(threadState.phase) {
+  switchPhase(Phase::Compute);
+  start_ = threadState.since;
+  // A thread already working for the call has its counters read around the
+  // outer scope.
+  if (call_ && call_ != outer_) {
+    threadState.call = call_;
+    if (!threadState.counters.read(counters_))
+      call_->countersAvailable = false;
+  }
+}
+
+TaskScope::~TaskScope() {
+  switchPhase(outerPhase_);
+  if (!call_)
+    return;
+  if (call_ != outer_) {
+    long long counters[4];
+    if (call_->countersAvailable && threadState.counters.read(counters))
+      call_->addCounters(counters_, counters);
+    else
+      call_->countersAvailable = false;
+    threadState.call = outer_;
+  }
+  std::lock_guard<std::mutex> lock(call_->spansMutex);
+  call_->spans.push_back({threadState.id, start_, threadState.since});
+}
+
+Call *currentCall() { return threadState.call; }
+
+void setEngine(Engine engine) {
+  if (threadState.call && !threadState.call->engineSet.exchange(true))
+    threadState.call->engine = engine;
+}
+
+void addMicroTiles(long count) {
+  if (threadState.call)
+    threadState.call->microTiles.fetch_add(count, std::memory_order_relaxed);
+}
+
+void addTasks(long count, int threads) {
+  Call *call = threadState.call;
+  if (!call)
+    return;
+  call->tasks.fetch_add(count, std::memory_order_relaxed);
+  int seen = call->threads.load(std::memory_order_relaxed);
+  while (seen < threads &&
+         !call->threads.compare_exchange_weak(seen, threads))
+    ;
+}
+
+} // namespace profiling
+
+namespace {
+
+const char *engineName(Engine engine) {
+  switch (engine) {
+  case Engine::Auto:
+    return "Auto";
+  case Engine::Reference:
+    return "Reference";
+  case Engine::Tiled:
+    return "Tiled";
+  case Engine::Simd:
+    return "Simd";
+  case Engine::Parallel:
+    return "Parallel";
+  case Engine::Strassen:
+    return "Strassen";
+  case Engine::Sparse:
+    return "Sparse";
+  }
+  return "";
+}
+
+double microseconds(long long ns) { return ns * 1e-3; }
+
+void writeEvents(std::FILE *file) {
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  const char *separator = "\n";
+  for (const Record &record : records) {
+    const CallProfile &p = record.profile;
+    std::fprintf(file,
+                 "%s{\"name\":\"multiply %dx%dx%d\",\"cat\":\"call\","
+                 "\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                 "\"dur\":%.3f,\"args\":{\"engine\":\"%s\",\"type\":\"%s\","
+                 "\"gops\":%.3f,\"pack_ms\":%.3f,\"compute_ms\":%.3f,"
+                 "\"writeback_ms\":%.3f,\"micro_tiles\":%ld,\"tasks\":%ld,"
+                 "\"threads\":%d,\"utilization\":%.3f",
+                 separator, p.m, p.k, p.n, record.thread, p.start * 1e6,
+                 p.seconds * 1e6, engineName(p.engine), p.type, p.gops,
+                 p.packSeconds * 1e3, p.computeSeconds * 1e3,
+                 p.writebackSeconds * 1e3, p.microTiles, p.tasks, p.threads,
+                 p.utilization);
+    if (p.counters.available)
+      std::fprintf(file,
+                   ",\"cycles\":%lld,\"instructions\":%lld,\"ipc\":%.3f,"
+                   "\"cache_references\":%lld,\"cache_misses\":%lld",
+                   p.counters.cycles, p.counters.instructions,
+                   p.counters.instructionsPerCycle(),
+                   p.counters.cacheReferences, p.counters.cacheMisses);
+    std::fputs("}}", file);
+    separator = ",\n";
+    for (const Span &span : record.spans)
+      std::fprintf(file,
+                   ",\n{\"name\":\"task\",\"cat\":\"task\",\"ph\":\"X\","
+                   "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                   span.thread, microseconds(span.start - epoch),
+                   microseconds(span.end - span.start));
+  }
+}
+
+} // namespace
+
+bool instrumentationEnabled() { return true; }
+
+std::vector<CallProfile> callProfiles() {
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  std::vector<CallProfile> profiles;
+  for (const Record &record : records)
+    profiles.push_back(record.profile);
+  return profiles;
+}
+
+void clearCallProfiles() {
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  records.clear();
+}
+
+#else
+
+namespace {
+
+void writeEvents(std::FILE *) {}
+
+} // namespace
+
+bool instrumentationEnabled() { return false; }
+
+std::vector<CallProfile> callProfiles() { return {}; }
+
+void clearCallProfiles() {}
+
+#endif // MATMUL_INSTRUMENTATION
+
+void writeChromeTrace(const std::string &path) {
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (!file)
+    throw std::system_error(errno, std::generic_category(),
+                            "writeChromeTrace: cannot open " + path);
+  std::fputs("{\"traceEvents\":[", file);
+  writeEvents(file);
+  std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+  const bool failed = std::ferror(file) != 0;
+  if (std::fclose(file) != 0 || failed)
+    throw std::system_error(errno, std::generic_category(),
+                            "writeChromeTrace: cannot write " + path);
+}
@@ -1,6 +1,318 @@
-#include <iostream>
+#include "matrix_multiplication.h"
 
-int main() {
-    std::cout << "Welcome to the first part of the project!" << std::endl;
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+// matmul: loads A and B from files, multiplies them and stores C, timing the
+// three phases separately. The format of each file follows its extension:
+// .csv and .mtx are parsed as CSV and Matrix Market (matrix_io.h), anything
+// else is a binary matrix file (out_of_core.h) that is mapped, not parsed.
+
+namespace {
+
+const char usage[] =
+    "usage: matmul [options] A B C\n"
+    "Computes C = A * B. Files ending in .csv and .mtx are CSV and Matrix\n"
+    "Market, other files are binary matrix files.\n"
+    "\n"
+    "options:\n"
+    "  --engine NAME   auto (default), reference, tiled, simd, parallel,\n"
+    "                  strassen or sparse\n"
+    "  --type NAME     int, float or double; defaults to the element type\n"
+    "                  of a binary A, int otherwise\n"
+    "  --threads N     threads of the parallel engines\n"
+    "  --budget BYTES  multiply binary files out of core within this much\n"
+    "                  memory (suffixes K, M and G)\n"
+    "  --tile RxC      tile shape of a binary C (default: one tile)\n";
+
+enum class Format { Binary, Csv, MatrixMarket };
+
+struct Options {
+  Engine engine = Engine::Auto;
+  std::optional<ElementType> type;
+  std::size_t budget = 0;
+  int tileRows = 0;
+  int tileCols = 0;
+  std::string pathA, pathB, pathC;
+};
+
+// Thrown for invalid command lines, which print the usage.
+struct UsageError : std::invalid_argument {
+  using std::invalid_argument::invalid_argument;
+};
+
+bool endsWith(const std::string &text, const std::string &suffix) {
+  return text.size() >= suffix.size() &&
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Format formatOf(const std::string &path) {
+  if (endsWith(path, ".csv"))
+    return Format::Csv;
+  if (endsWith(path, ".mtx"))
+    return Format::MatrixMarket;
+  return Format::Binary;
+}
+
+Engine parseEngine(const std::string &name) {
+  const std::pair<const char *, Engine> engines[] = {
+      {"auto", Engine::Auto},         {"reference", Engine::Reference},
+      {"tiled", Engine::Tiled},       {"simd", Engine::Simd},
+      {"parallel", Engine::Parallel}, {"strassen", Engine::Strassen},
+      {"sparse", Engine::Sparse}};
+  for (const auto &engine : engines)
+    if (name == engine.first)
+      return engine.second;
+  throw UsageError("unknown engine " + name);
+}
+
+ElementType parseType(const std::string &name) {
+  if (name == "int")
+    return ElementType::Int32;
+  if (name == "float")
+    return ElementType::Float32;
+  if (name == "double")
+    return ElementType::Float64;
+  throw UsageError("unknown type " + name);
+}
+
+long parsePositive(const std::string &text, const char *option) {
+  std::size_t end = 0;
+  long value = 0;
+  try {
+    value = std::stol(text, &end);
+  } catch (const std::exception &) {
+  }
+  if (value <= 0 || end == 0)
+    throw UsageError(std::string("invalid value for ") + option);
+  return value;
+}
+
+std::size_t parseBytes(const std::string &text) {
+  std::string digits = text;
+  std::size_t unit = 1;
+  const char suffix = text.empty() ? '\0' : text.back();
+  if (suffix == 'K' || suffix == 'M' || suffix == 'G') {
+    unit = suffix == 'K' ? 1UL << 10 : suffix == 'M' ? 1UL << 20 : 1UL << 30;
+    digits.pop_back();
+  }
+  return static_cast<std::size_t>(parsePositive(digits, "--budget")) * unit;
+}
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  std::string paths[3];
+  int pathCount = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+      if (i + 1 == argc)
+        throw UsageError("missing value for " + arg);
+      const std::string value = argv[++i];
+      if (arg == "--engine") {
+        options.engine = parseEngine(value);
+      } else if (arg == "--type") {
+        options.type = parseType(value);
+      } else if (arg == "--threads") {
+        setThreadCount(static_cast<int>(parsePositive(value, "--threads")));
+      } else if (arg == "--budget") {
+        options.budget = parseBytes(value);
+      } else if (arg == "--tile") {
+        const std::size_t x = value.find('x');
+        if (x == std::string::npos)
+          throw UsageError("invalid value for --tile");
+        options.tileRows =
+            static_cast<int>(parsePositive(value.substr(0, x), "--tile"));
+        options.tileCols =
+            static_cast<int>(parsePositive(value.substr(x + 1), "--tile"));
+      } else {
+        throw UsageError("unknown option " + arg);
+      }
+    } else if (pathCount < 3) {
+      paths[pathCount++] = arg;
+    } else {
+      throw UsageError("too many files");
+    }
+  }
+  if (pathCount != 3)
+    throw UsageError("expected the files of A, B and C");
+  options.pathA = paths[0];
+  options.pathB = paths[1];
+  options.pathC = paths[2];
+  return options;
+}
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Operand loaded from a file. A binary file stored as a single tile is used
+// in place through its mapping; the others are read into `matrix`.
+template <typename T> struct Operand {
+  MappedMatrix<T> file;
+  Matrix<T> matrix;
+  bool inPlace = false;
+
+  MatrixView<const T> view() const {
+    return inPlace ? file.tile(0, 0) : matrix.view();
+  }
+};
+
+template <typename T> Operand<T> load(const std::string &path) {
+  Operand<T> operand;
+  switch (formatOf(path)) {
+  case Format::Csv:
+    operand.matrix = readCsv<T>(path);
+    break;
+  case Format::MatrixMarket:
+    operand.matrix = readMatrixMarket<T>(path);
+    break;
+  case Format::Binary:
+    operand.file = MappedMatrix<T>::open(path);
+    if (operand.file.tileRowCount() == 1 && operand.file.tileColCount() == 1) {
+      operand.inPlace = true;
+    } else {
+      operand.matrix = Matrix<T>(operand.file.rows(), operand.file.cols());
+      operand.file.read(0, 0, operand.matrix.view());
+    }
+    break;
+  }
+  return operand;
+}
+
+// Binary file for an m x n C, as one tile unless --tile says otherwise.
+template <typename T>
+MappedMatrix<T> createResult(const Options &options, int m, int n) {
+  return MappedMatrix<T>::create(
+      options.pathC, m, n, options.tileRows ? options.tileRows : std::max(m, 1),
+      options.tileCols ? options.tileCols : std::max(n, 1));
+}
+
+void report(double load, double compute, double store, long m, long k,
+            long n) {
+  std::printf("load     %10.3f s\n", load);
+  std::printf("compute  %10.3f s  %.2f GOPS\n", compute,
+              compute > 0 ? 2.0 * m * k * n / compute / 1e9 : 0.0);
+  std::printf("store    %10.3f s\n", store);
+}
+
+// Out of core: the operands stay in their mappings and C is written block by
+// block during the compute phase.
+template <typename T> void runOutOfCore(const Options &options) {
+  if (formatOf(options.pathA) != Format::Binary ||
+      formatOf(options.pathB) != Format::Binary ||
+      formatOf(options.pathC) != Format::Binary)
+    throw UsageError("--budget needs binary matrix files");
+
+  Clock::time_point start = Clock::now();
+  const MappedMatrix<T> A = MappedMatrix<T>::open(options.pathA);
+  const MappedMatrix<T> B = MappedMatrix<T>::open(options.pathB);
+  MappedMatrix<T> C = createResult<T>(options, A.rows(), B.cols());
+  const double load = secondsSince(start);
+
+  start = Clock::now();
+  multiplyOutOfCore(A, B, C, options.budget);
+  const double compute = secondsSince(start);
+
+  start = Clock::now();
+  C.flush();
+  report(load, compute, secondsSince(start), A.rows(), A.cols(), B.cols());
+}
+
+template <typename T> void run(const Options &options) {
+  if (options.budget > 0) {
+    runOutOfCore<T>(options);
+    return;
+  }
+
+  Clock::time_point start = Clock::now();
+  const Operand<T> A = load<T>(options.pathA);
+  const Operand<T> B = load<T>(options.pathB);
+  const MatrixView<const T> a = A.view(), b = B.view();
+  const double load = secondsSince(start);
+  if (a.cols() != b.rows())
+    throw std::invalid_argument(
+        "A is " + std::to_string(a.rows()) + "x" + std::to_string(a.cols()) +
+        " but B is " + std::to_string(b.rows()) + "x" +
+        std::to_string(b.cols()));
+  const int m = a.rows(), n = b.cols();
+
+  // A binary C of one tile is computed in place in its mapping, so storing
+  // it only writes the pages back.
+  const Format format = formatOf(options.pathC);
+  MappedMatrix<T> file;
+  Matrix<T> result;
+  MatrixView<T> c;
+  if (format == Format::Binary) {
+    file = createResult<T>(options, m, n);
+    if (file.tileRowCount() == 1 && file.tileColCount() == 1)
+      c = file.writableTile(0, 0);
+  }
+  if (!c.data()) {
+    result = Matrix<T>(m, n);
+    c = result.view();
+  }
+
+  start = Clock::now();
+  multiply(a, b, c, options.engine);
+  const double compute = secondsSince(start);
+
+  start = Clock::now();
+  if (format == Format::Csv) {
+    writeCsv(options.pathC, c);
+  } else if (format == Format::MatrixMarket) {
+    writeMatrixMarket(options.pathC, c);
+  } else {
+    if (c.data() == result.data())
+      file.write(0, 0, c);
+    file.flush();
+  }
+  report(load, compute, secondsSince(start), m, a.cols(), n);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc == 2 && std::string(argv[1]) == "--help") {
+    std::fputs(usage, stdout);
     return 0;
+  }
+  try {
+    const Options options = parseOptions(argc, argv);
+    // Calibrating the tiles and starting the pool are one-time costs that
+    // would otherwise land in the compute time.
+    tileSizes();
+    threadPool();
+    ElementType type = ElementType::Int32;
+    if (options.type)
+      type = *options.type;
+    else if (formatOf(options.pathA) == Format::Binary)
+      type = matrixFileElementType(options.pathA);
+
+    switch (type) {
+    case ElementType::Int32:
+      run<int>(options);
+      break;
+    case ElementType::Float32:
+      run<float>(options);
+      break;
+    case ElementType::Float64:
+      run<double>(options);
+      break;
+    }
+  } catch (const UsageError &error) {
+    std::fprintf(stderr, "matmul: %s\n%s", error.what(), usage);
+    return 2;
+  } catch (const std::exception &error) {
+    std::fprintf(stderr, "matmul: %s\n", error.what());
+    return 1;
+  }
+  return 0;
 }
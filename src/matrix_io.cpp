@@ -0,0 +1,397 @@
+#include "matrix_io.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Below this many bytes a file is parsed or formatted in one chunk.
+constexpr std::size_t parallelBytes = 1 << 20;
+
+[[noreturn]] void throwSystemError(const char *function,
+                                   const std::string &path) {
+  throw std::system_error(errno, std::generic_category(),
+                          std::string(function) + ": " + path);
+}
+
+[[noreturn]] void throwFormatError(const char *function,
+                                   const std::string &what, long record) {
+  throw std::runtime_error(std::string(function) + ": " + what + " " +
+                           std::to_string(record + 1));
+}
+
+// Read-only private mapping of a whole file.
+class MappedFile {
+public:
+  MappedFile(const char *function, const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throwSystemError(function, path);
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      ::close(fd);
+      throwSystemError(function, path);
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+    if (size_ > 0) {
+      void *map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) {
+        ::close(fd);
+        throwSystemError(function, path);
+      }
+      data_ = static_cast<const char *>(map);
+      // The parsers read front to back.
+      ::madvise(map, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+  ~MappedFile() {
+    if (data_)
+      ::munmap(const_cast<char *>(data_), size_);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *begin() const { return data_; }
+  const char *end() const { return data_ + size_; }
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+const char *skipBlanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t'))
+    ++p;
+  return p;
+}
+
+// End of the line starting at p, without the newline and trailing blanks.
+const char *lineEnd(const char *p, const char *end, const char **next) {
+  const char *newline = std::find(p, end, '\n');
+  *next = newline == end ? end : newline + 1;
+  while (newline > p && (newline[-1] == '\r' || newline[-1] == ' ' ||
+                         newline[-1] == '\t'))
+    --newline;
+  return newline;
+}
+
+// Lines holding data: not blank and not starting with `comment`.
+bool isRecord(const char *begin, const char *end, char comment) {
+  begin = skipBlanks(begin, end);
+  return begin < end && *begin != comment;
+}
+
+// Range of whole lines and the index of its first record.
+struct Chunk {
+  const char *begin;
+  const char *end;
+  long firstRecord;
+};
+
+// Splits [begin, end) into chunks of whole lines, one per task of the pool
+// for large inputs, and numbers their records in a parallel counting pass.
+// Returns the chunks and stores the number of records in `records`.
+std::vector<Chunk> recordChunks(const char *begin, const char *end,
+                                char comment, long *records) {
+  const std::size_t size = static_cast<std::size_t>(end - begin);
+  std::shared_ptr<ThreadPool> pool = threadPool();
+  const int count = size < parallelBytes ? 1 : 4 * pool->size();
+
+  std::vector<Chunk> chunks;
+  const char *start = begin;
+  for (int c = 1; c <= count && start < end; ++c) {
+    const char *stop = c == count ? end : begin + size * c / count;
+    if (stop < start)
+      continue;
+    stop = std::find(stop, end, '\n');
+    stop = stop == end ? end : stop + 1;
+    chunks.push_back({start, stop, 0});
+    start = stop;
+  }
+
+  std::vector<long> counts(chunks.size(), 0);
+  pool->parallelFor(static_cast<int>(chunks.size()), [&](int c) {
+    const char *next;
+    for (const char *p = chunks[c].begin; p < chunks[c].end; p = next)
+      counts[c] += isRecord(p, lineEnd(p, chunks[c].end, &next), comment);
+  });
+  long total = 0;
+  for (std::size_t c = 0; c < chunks.size(); ++c) {
+    chunks[c].firstRecord = total;
+    total += counts[c];
+  }
+  *records = total;
+  return chunks;
+}
+
+// Runs record(index, begin, end) on every record of the chunks, over the
+// pool.
+template <typename Record>
+void forEachRecord(const std::vector<Chunk> &chunks, char comment,
+                   const Record &record) {
+  threadPool()->parallelFor(static_cast<int>(chunks.size()), [&](int c) {
+    long index = chunks[c].firstRecord;
+    const char *next;
+    for (const char *p = chunks[c].begin; p < chunks[c].end; p = next) {
+      const char *end = lineEnd(p, chunks[c].end, &next);
+      if (isRecord(p, end, comment))
+        record(index++, skipBlanks(p, end), end);
+    }
+  });
+}
+
+// Parses one number at p, after optional blanks and a plus sign. Returns the
+// end of the number, or nullptr if there is none.
+template <typename T>
+const char *parseNumber(const char *p, const char *end, T &value) {
+  p = skipBlanks(p, end);
+  if (p < end && *p == '+')
+    ++p;
+  const std::from_chars_result result = std::from_chars(p, end, value);
+  return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+// Number of comma-separated fields of a line.
+int fieldCount(const char *begin, const char *end) {
+  return static_cast<int>(std::count(begin, end, ',')) + 1;
+}
+
+// Formats `parts` pieces in parallel with format(part, text), then writes
+// them to `path` in order.
+template <typename Format>
+void writeParts(const char *function, const std::string &path, int parts,
+                const Format &format) {
+  std::vector<std::string> texts(parts);
+  threadPool()->parallelFor(parts, [&](int p) { format(p, texts[p]); });
+
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    throwSystemError(function, path);
+  bool ok = true;
+  for (const std::string &text : texts)
+    ok = ok && std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok)
+    throwSystemError(function, path);
+}
+
+// Appends the shortest text that reads back as the same value.
+template <typename T> void appendNumber(std::string &text, T value) {
+  char buffer[32];
+  const std::to_chars_result result =
+      std::to_chars(buffer, buffer + sizeof buffer, value);
+  text.append(buffer, result.ptr);
+}
+
+// Pieces the writers format in parallel, about 64 kB of text each.
+int partCount(long elements) {
+  return static_cast<int>(std::clamp(elements / 8192, 1L, 4096L));
+}
+
+template <typename T>
+void writeCsvFile(const std::string &path, MatrixView<const T> A) {
+  const int rows = A.rows();
+  const long elements = static_cast<long>(rows) * A.cols();
+  const int parts = std::max(1, std::min(rows, partCount(elements)));
+  writeParts("writeCsv", path, parts, [&](int p, std::string &text) {
+    for (int i = rows * static_cast<long>(p) / parts;
+         i < rows * static_cast<long>(p + 1) / parts; ++i) {
+      for (int j = 0; j < A.cols(); ++j) {
+        if (j > 0)
+          text += ',';
+        appendNumber(text, A(i, j));
+      }
+      text += '\n';
+    }
+  });
+}
+
+template <typename T>
+void writeMatrixMarketFile(const std::string &path, MatrixView<const T> A) {
+  const int cols = A.cols();
+  const long elements = static_cast<long>(A.rows()) * cols;
+  const int parts = std::max(1, std::min(cols, partCount(elements)));
+  writeParts("writeMatrixMarket", path, parts + 1,
+             [&](int p, std::string &text) {
+               if (p == 0) {
+                 text = std::is_same_v<T, int>
+                            ? "%%MatrixMarket matrix array integer general\n"
+                            : "%%MatrixMarket matrix array real general\n";
+                 text += std::to_string(A.rows()) + ' ' +
+                         std::to_string(cols) + '\n';
+                 return;
+               }
+               --p;
+               for (int j = cols * static_cast<long>(p) / parts;
+                    j < cols * static_cast<long>(p + 1) / parts; ++j)
+                 for (int i = 0; i < A.rows(); ++i) {
+                   appendNumber(text, A(i, j));
+                   text += '\n';
+                 }
+             });
+}
+
+std::string lowercase(std::string word) {
+  for (char &c : word)
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return word;
+}
+
+} // namespace
+
+template <typename T> Matrix<T> readCsv(const std::string &path) {
+  const MappedFile file("readCsv", path);
+  long rows;
+  const std::vector<Chunk> chunks =
+      recordChunks(file.begin(), file.end(), '\0', &rows);
+  if (rows == 0)
+    return Matrix<T>();
+
+  // The first record gives the number of columns.
+  const char *first = file.begin(), *next;
+  const char *firstEnd = lineEnd(first, file.end(), &next);
+  while (!isRecord(first, firstEnd, '\0')) {
+    first = next;
+    firstEnd = lineEnd(first, file.end(), &next);
+  }
+  const int cols = fieldCount(first, firstEnd);
+  if (rows > INT32_MAX)
+    throw std::runtime_error("readCsv: too many rows in " + path);
+
+  Matrix<T> A(static_cast<int>(rows), cols);
+  forEachRecord(chunks, '\0', [&](long i, const char *p, const char *end) {
+    T *row = A.row(static_cast<int>(i));
+    for (int j = 0; j < cols; ++j) {
+      if (j > 0) {
+        p = skipBlanks(p, end);
+        if (p == end || *p != ',')
+          throwFormatError("readCsv", "too few fields in row", i);
+        ++p;
+      }
+      p = parseNumber(p, end, row[j]);
+      if (!p)
+        throwFormatError("readCsv", "invalid number in row", i);
+    }
+    if (skipBlanks(p, end) != end)
+      throwFormatError("readCsv", "unexpected text in row", i);
+  });
+  return A;
+}
+
+template <typename T> Matrix<T> readMatrixMarket(const std::string &path) {
+  const MappedFile file("readMatrixMarket", path);
+  const char *p = file.begin(), *next;
+  const char *end = lineEnd(p, file.end(), &next);
+
+  // Banner: %%MatrixMarket matrix <format> <field> <symmetry>
+  std::vector<std::string> banner;
+  for (const char *word = p; word < end;) {
+    const char *stop = std::find_if(word, end, [](char c) {
+      return c == ' ' || c == '\t';
+    });
+    banner.push_back(lowercase(std::string(word, stop)));
+    word = skipBlanks(stop, end);
+  }
+  if (banner.size() != 5 || banner[0] != "%%matrixmarket" ||
+      banner[1] != "matrix")
+    throw std::runtime_error("readMatrixMarket: " + path +
+                             " is not a Matrix Market file");
+  const bool coordinate = banner[2] == "coordinate";
+  const bool pattern = banner[3] == "pattern";
+  const bool symmetric = banner[4] == "symmetric";
+  if ((!coordinate && banner[2] != "array") ||
+      (banner[3] != "integer" && banner[3] != "real" &&
+       banner[3] != "double" && !pattern) ||
+      (!symmetric && banner[4] != "general") ||
+      (symmetric && !coordinate) || (pattern && !coordinate))
+    throw std::runtime_error("readMatrixMarket: unsupported format in " +
+                             path);
+
+  // Comments, then the size line: rows cols [entries].
+  do {
+    p = next;
+    end = lineEnd(p, file.end(), &next);
+  } while (p < file.end() && !isRecord(p, end, '%'));
+  long rows = 0, cols = 0, entries = 0;
+  p = parseNumber(p, end, rows);
+  p = p ? parseNumber(p, end, cols) : nullptr;
+  if (p && coordinate)
+    p = parseNumber(p, end, entries);
+  if (!p || skipBlanks(p, end) != end || rows < 0 || cols < 0 ||
+      entries < 0 || rows > INT32_MAX || cols > INT32_MAX)
+    throw std::runtime_error("readMatrixMarket: invalid size line in " +
+                             path);
+  if (!coordinate)
+    entries = rows * cols;
+
+  long records;
+  const std::vector<Chunk> chunks =
+      recordChunks(next, file.end(), '%', &records);
+  if (records != entries)
+    throw std::runtime_error("readMatrixMarket: expected " +
+                             std::to_string(entries) + " entries in " + path +
+                             ", found " + std::to_string(records));
+
+  Matrix<T> A(static_cast<int>(rows), static_cast<int>(cols));
+  forEachRecord(chunks, '%', [&](long e, const char *p, const char *end) {
+    long i = e % std::max(rows, 1L), j = e / std::max(rows, 1L);
+    T value = T(1);
+    if (coordinate) {
+      p = parseNumber(p, end, i);
+      p = p ? parseNumber(p, end, j) : nullptr;
+      if (!p || --i < 0 || --j < 0 || i >= rows || j >= cols)
+        throwFormatError("readMatrixMarket", "invalid position in entry", e);
+    }
+    if (!pattern)
+      p = parseNumber(p, end, value);
+    if (!p || skipBlanks(p, end) != end)
+      throwFormatError("readMatrixMarket", "invalid value in entry", e);
+    A(static_cast<int>(i), static_cast<int>(j)) = value;
+    if (symmetric)
+      A(static_cast<int>(j), static_cast<int>(i)) = value;
+  });
+  return A;
+}
+
+void writeCsv(const std::string &path, MatrixView<const int> A) {
+  writeCsvFile(path, A);
+}
+void writeCsv(const std::string &path, MatrixView<const float> A) {
+  writeCsvFile(path, A);
+}
+void writeCsv(const std::string &path, MatrixView<const double> A) {
+  writeCsvFile(path, A);
+}
+
+void writeMatrixMarket(const std::string &path, MatrixView<const int> A) {
+  writeMatrixMarketFile(path, A);
+}
+void writeMatrixMarket(const std::string &path, MatrixView<const float> A) {
+  writeMatrixMarketFile(path, A);
+}
+void writeMatrixMarket(const std::string &path, MatrixView<const double> A) {
+  writeMatrixMarketFile(path, A);
+}
+
+template Matrix<int> readCsv(const std::string &);
+template Matrix<float> readCsv(const std::string &);
+template Matrix<double> readCsv(const std::string &);
+template Matrix<int> readMatrixMarket(const std::string &);
+template Matrix<float> readMatrixMarket(const std::string &);
+template Matrix<double> readMatrixMarket(const std::string &);
@@ -0,0 +1,266 @@
+#ifndef MICROKERNEL_H
+#define MICROKERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_features.h"
+
+// A micro-kernel computes an mr x nr block of C from kc columns of A and kc
+// rows of B, keeping the whole block of C in registers:
+//   C(i, j) = sum_k A(i, k) * B(k, j)        (accumulate == false)
+//   C(i, j) += sum_k A(i, k) * B(k, j)       (accumulate == true)
+// A(i, k) is read at A[i * rsA + k * csA], so the same kernel runs on a
+// row-major block (rsA = lda, csA = 1) or a packed column-major panel
+// (rsA = 1, csA = mr). B(k, j) is read at B[k * rsB + j]; each of its rows
+// must hold nr readable elements. C is row-major with leading dimension ldc.
+template <typename T>
+using TypedMicroKernelFn = void (*)(int kc, const T *A, long rsA, long csA,
+                                    const T *B, long rsB, T *C, long ldc,
+                                    bool accumulate);
+
+template <typename T> struct TypedMicroKernel {
+  SimdIsa isa;
+  int mr;
+  int nr;
+  TypedMicroKernelFn<T> fn;
+};
+
+using MicroKernelFn = TypedMicroKernelFn<int>;
+using MicroKernel = TypedMicroKernel<int>;
+
+// Kernels for each instruction set; the SIMD ones are only compiled on x86-64,
+// each in its own translation unit built with the matching -m flags. The
+// floating-point kernels use FMA from AVX2 on.
+const MicroKernel &scalarMicroKernel();
+const TypedMicroKernel<float> &scalarFloatMicroKernel();
+const TypedMicroKernel<double> &scalarDoubleMicroKernel();
+#ifdef MATMUL_X86_KERNELS
+const MicroKernel &sse41MicroKernel();
+const TypedMicroKernel<float> &sse41FloatMicroKernel();
+const TypedMicroKernel<double> &sse41DoubleMicroKernel();
+const MicroKernel &avx2MicroKernel();
+const TypedMicroKernel<float> &avx2FloatMicroKernel();
+const TypedMicroKernel<double> &avx2DoubleMicroKernel();
+const MicroKernel &avx512MicroKernel();
+const TypedMicroKernel<float> &avx512FloatMicroKernel();
+const TypedMicroKernel<double> &avx512DoubleMicroKernel();
+#endif
+
+// Kernel for element type T of the instruction set returned by simdIsa().
+template <typename T = int> const TypedMicroKernel<T> &microKernel();
+template <> const TypedMicroKernel<int> &microKernel<int>();
+template <> const TypedMicroKernel<float> &microKernel<float>();
+template <> const TypedMicroKernel<double> &microKernel<double>();
+
+// Wide micro-kernels have the same interface but sign-extend every product
+// to 64 bits and accumulate into an int64 block of C, so the sums are exact
+// as long as they fit in 64 bits.
+using WideMicroKernelFn = void (*)(int kc, const int *A, long rsA, long csA,
+                                   const int *B, long rsB, std::int64_t *C,
+                                   long ldc, bool accumulate);
+
+struct WideMicroKernel {
+  SimdIsa isa;
+  int mr;
+  int nr;
+  WideMicroKernelFn fn;
+};
+
+const WideMicroKernel &scalarWideMicroKernel();
+#ifdef MATMUL_X86_KERNELS
+const WideMicroKernel &sse41WideMicroKernel();
+const WideMicroKernel &avx2WideMicroKernel();
+const WideMicroKernel &avx512WideMicroKernel();
+#endif
+
+// Wide kernel of the instruction set returned by simdIsa().
+const WideMicroKernel &wideMicroKernel();
+
+// A batch kernel computes `lanes` small independent products at once, one
+// per SIMD lane. Operands are interleaved lane by lane: element (i, p) of the
+// l-th (m x k) matrix A is at A[(i * k + p) * lanes + l], and likewise for
+// the (k x n) matrices B and the (m x n) results C.
+using BatchKernelFn = void (*)(int m, int k, int n, const int *A,
+                               const int *B, int *C);
+
+struct BatchKernel {
+  SimdIsa isa;
+  int lanes;
+  BatchKernelFn fn;
+};
+
+const BatchKernel &scalarBatchKernel();
+#ifdef MATMUL_X86_KERNELS
+const BatchKernel &sse41BatchKernel();
+const BatchKernel &avx2BatchKernel();
+const BatchKernel &avx512BatchKernel();
+#endif
+
+// Batch kernel of the instruction set returned by simdIsa().
+const BatchKernel &batchKernel();
+
+// A sparse row kernel computes one row of a sparse-times-dense product,
+//   C[j] = sum_p values[p] * B[indices[p] * ldb + j]     for j in [0, n),
+// keeping blocks of C in registers across all `count` non-zeros so that C is
+// written once. Sums wrap modulo 2^32.
+using SparseRowKernelFn = void (*)(int count, const int *indices,
+                                   const int *values, const int *B, long ldb,
+                                   int n, int *C);
+
+struct SparseRowKernel {
+  SimdIsa isa;
+  SparseRowKernelFn fn;
+};
+
+const SparseRowKernel &scalarSparseRowKernel();
+#ifdef MATMUL_X86_KERNELS
+const SparseRowKernel &sse41SparseRowKernel();
+const SparseRowKernel &avx2SparseRowKernel();
+const SparseRowKernel &avx512SparseRowKernel();
+#endif
+
+// Sparse row kernel of the instruction set returned by simdIsa().
+const SparseRowKernel &sparseRowKernel();
+
+// Vector kernels compute the products with a dimension of 1, which have no
+// reuse to block for and only stream their operands (sums wrap modulo 2^32
+// for int):
+// - gemv: y[i * incy] = sum_p A[i * lda + p] * x[p] for i in [0, m);
+// - gevm: y[j] = sum_p a[p] * B[p * ldb + j] for j in [0, n);
+// - outer: C[i * ldc + j] = a[i * inca] * b[j].
+template <typename T>
+using GemvFn = void (*)(int m, int k, const T *A, long lda, const T *x, T *y,
+                        long incy);
+template <typename T>
+using GevmFn = void (*)(int k, int n, const T *a, const T *B, long ldb, T *y);
+template <typename T>
+using OuterFn = void (*)(int m, int n, const T *a, long inca, const T *b,
+                         T *C, long ldc);
+
+template <typename T> struct VectorKernel {
+  SimdIsa isa;
+  GemvFn<T> gemv;
+  GevmFn<T> gevm;
+  OuterFn<T> outer;
+};
+
+// Defined for int, float and double.
+template <typename T> const VectorKernel<T> &scalarVectorKernel();
+#ifdef MATMUL_X86_KERNELS
+template <typename T> const VectorKernel<T> &sse41VectorKernel();
+template <typename T> const VectorKernel<T> &avx2VectorKernel();
+template <typename T> const VectorKernel<T> &avx512VectorKernel();
+#endif
+
+// Vector kernel for element type T of the instruction set returned by
+// simdIsa().
+template <typename T> const VectorKernel<T> &vectorKernel();
+
+// A binary kernel computes an m x n block of the product of two matrices of
+// zeros and ones packed 64 elements per word, bit b of word w standing for
+// element 64 * w + b: row i of A is at A[i * words], column j of B at
+// B[j * words], and
+//   C[i * ldc + j] = sum_w popcount(A[i * words + w] & B[j * words + w]).
+using BinaryKernelFn = void (*)(int m, int n, int words,
+                                const std::uint64_t *A, const std::uint64_t *B,
+                                int *C, long ldc);
+
+struct BinaryKernel {
+  SimdIsa isa;
+  BinaryKernelFn fn;
+};
+
+const BinaryKernel &scalarBinaryKernel();
+#ifdef MATMUL_X86_KERNELS
+const BinaryKernel &sse41BinaryKernel();
+const BinaryKernel &avx2BinaryKernel();
+const BinaryKernel &avx512BinaryKernel();
+#endif
+
+// Binary kernel of the instruction set returned by simdIsa().
+const BinaryKernel &binaryKernel();
+
+// A Philox kernel runs Philox4x32-10 on `blocks` consecutive counters: block
+// b has the counter words {low, high, stream, 0}, low and high the halves of
+// first + b, the key words are the low and high halves of `seed`, and its
+// four output words go to out[4 * b] .. out[4 * b + 3]. Every instruction set
+// computes the same words.
+using PhiloxKernelFn = void (*)(std::uint64_t first, int blocks,
+                                std::uint64_t seed, std::uint32_t stream,
+                                std::uint32_t *out);
+
+struct PhiloxKernel {
+  SimdIsa isa;
+  PhiloxKernelFn fn;
+};
+
+const PhiloxKernel &scalarPhiloxKernel();
+#ifdef MATMUL_X86_KERNELS
+const PhiloxKernel &sse41PhiloxKernel();
+const PhiloxKernel &avx2PhiloxKernel();
+const PhiloxKernel &avx512PhiloxKernel();
+#endif
+
+// Philox kernel of the instruction set returned by simdIsa().
+const PhiloxKernel &philoxKernel();
+
+// A hash row kernel folds a row of `bytes` bytes into the eight 64-bit
+// accumulators of a fingerprint (product_cache.h). For every 64-byte stripe
+// s of the row, zero-padded at the end, with d[l] its l-th 64-bit word and
+// x = d[l] ^ (hashSecret[l] + s * hashStripeStep) (hash_kernel.h),
+//   acc[l] += d[l] + (x mod 2^32) * (x >> 32),
+// after which every accumulator is scrambled:
+//   acc[l] = (acc[l] ^ (acc[l] >> 47) ^ hashSecret[l]) * hashPrime32.
+// All sums wrap modulo 2^64, so every instruction set computes the same
+// values.
+using HashRowKernelFn = void (*)(const void *row, std::size_t bytes,
+                                 std::uint64_t *acc);
+
+struct HashRowKernel {
+  SimdIsa isa;
+  HashRowKernelFn fn;
+};
+
+const HashRowKernel &scalarHashRowKernel();
+#ifdef MATMUL_X86_KERNELS
+const HashRowKernel &sse41HashRowKernel();
+const HashRowKernel &avx2HashRowKernel();
+const HashRowKernel &avx512HashRowKernel();
+#endif
+
+// Hash row kernel of the instruction set returned by simdIsa().
+const HashRowKernel &hashRowKernel();
+
+// A quantized kernel computes an mr x nr int32 block of C from packed panels
+// of small integers, `group` consecutive values of k per 32-bit lane:
+// A(i, g * group + t) is at A[(g * mr + i) * group + t] and B(g * group + t, j)
+// at B[(g * nr + j) * group + t], for g in [0, groups). With group == 2 both
+// panels hold int16; with group == 4 (VNNI) A holds uint8 values offset by
+// +128 and B holds int8. Sums wrap modulo 2^32.
+using QuantizedKernelFn = void (*)(int groups, const void *A, const void *B,
+                                   std::int32_t *C, long ldc, bool accumulate);
+
+struct QuantizedKernel {
+  SimdIsa isa;
+  int mr;
+  int nr;
+  int group;
+  QuantizedKernelFn fn;
+};
+
+// Kernels on int16 pairs, also used for int8 operands widened when packed.
+const QuantizedKernel &scalarInt16Kernel();
+#ifdef MATMUL_X86_KERNELS
+const QuantizedKernel &sse41Int16Kernel();
+const QuantizedKernel &avx2Int16Kernel();
+const QuantizedKernel &avx512VnniInt16Kernel();
+const QuantizedKernel &avx512VnniInt8Kernel();
+#endif
+
+// Quantized kernels of the instruction set returned by simdIsa(). Below
+// Avx512Vnni the int8 kernel is the int16 one.
+const QuantizedKernel &int16Kernel();
+const QuantizedKernel &int8Kernel();
+
+#endif // MICROKERNEL_H
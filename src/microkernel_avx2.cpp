@@ -0,0 +1,379 @@
+#include "batch_kernel.h"
+#include "binary_kernel.h"
+#include "hash_kernel.h"
+#include "microkernel.h"
+#include "philox_kernel.h"
+#include "vector_kernel.h"
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+constexpr int MR = 4;
+constexpr int NR = 16;
+
+// 4x16 block of C in 8 ymm accumulators, products with vpmulld. Together
+// with the two rows of B and the broadcast of A this uses 11 of the 16 ymm
+// registers.
+void kernel4x16(int kc, const int *A, long rsA, long csA, const int *B,
+                long rsB, int *C, long ldc, bool accumulate) {
+  __m256i c[MR][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < MR; ++i) {
+    if (accumulate) {
+      c[i][0] =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(C + i * ldc));
+      c[i][1] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(C + i * ldc + 8));
+    } else {
+      c[i][0] = _mm256_setzero_si256();
+      c[i][1] = _mm256_setzero_si256();
+    }
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    const __m256i b0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+    const __m256i b1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + 8));
+#pragma GCC unroll 4
+    for (int i = 0; i < MR; ++i) {
+      const __m256i a = _mm256_set1_epi32(A[i * rsA + k * csA]);
+      c[i][0] = _mm256_add_epi32(c[i][0], _mm256_mullo_epi32(a, b0));
+      c[i][1] = _mm256_add_epi32(c[i][1], _mm256_mullo_epi32(a, b1));
+    }
+  }
+
+#pragma GCC unroll 4
+  for (int i = 0; i < MR; ++i) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + i * ldc), c[i][0]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + i * ldc + 8),
+                        c[i][1]);
+  }
+}
+
+// Wide 4x8 block in 8 ymm accumulators of four int64 each. vpmuldq multiplies
+// the sign-extended low halves of the 64-bit lanes into exact products.
+void wideKernel4x8(int kc, const int *A, long rsA, long csA, const int *B,
+                   long rsB, std::int64_t *C, long ldc, bool accumulate) {
+  __m256i c[4][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    if (accumulate) {
+      c[i][0] =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(C + i * ldc));
+      c[i][1] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(C + i * ldc + 4));
+    } else {
+      c[i][0] = _mm256_setzero_si256();
+      c[i][1] = _mm256_setzero_si256();
+    }
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    const __m256i b0 = _mm256_cvtepi32_epi64(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)));
+    const __m256i b1 = _mm256_cvtepi32_epi64(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 4)));
+#pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i) {
+      const __m256i a = _mm256_set1_epi64x(A[i * rsA + k * csA]);
+      c[i][0] = _mm256_add_epi64(c[i][0], _mm256_mul_epi32(a, b0));
+      c[i][1] = _mm256_add_epi64(c[i][1], _mm256_mul_epi32(a, b1));
+    }
+  }
+
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + i * ldc), c[i][0]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + i * ldc + 4),
+                        c[i][1]);
+  }
+}
+
+// Register operations of the floating-point kernels.
+struct FloatOps {
+  using Reg = __m256;
+  static constexpr int width = 8;
+  static Reg zero() { return _mm256_setzero_ps(); }
+  static Reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static Reg broadcast(float x) { return _mm256_set1_ps(x); }
+  static Reg mulAdd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+  static void store(float *p, Reg x) { _mm256_storeu_ps(p, x); }
+};
+
+struct DoubleOps {
+  using Reg = __m256d;
+  static constexpr int width = 4;
+  static Reg zero() { return _mm256_setzero_pd(); }
+  static Reg load(const double *p) { return _mm256_loadu_pd(p); }
+  static Reg broadcast(double x) { return _mm256_set1_pd(x); }
+  static Reg mulAdd(Reg a, Reg b, Reg c) { return _mm256_fmadd_pd(a, b, c); }
+  static void store(double *p, Reg x) { _mm256_storeu_pd(p, x); }
+};
+
+// Rows x (2 * width) block of C with FMA. Six rows give 12 independent
+// accumulators, enough to hide the FMA latency on two ports, and leave room
+// for the two rows of B and the broadcast of A.
+template <typename Ops, typename T, int Rows>
+void floatingKernel(int kc, const T *A, long rsA, long csA, const T *B,
+                    long rsB, T *C, long ldc, bool accumulate) {
+  constexpr int W = Ops::width;
+  typename Ops::Reg c[Rows][2];
+#pragma GCC unroll 8
+  for (int i = 0; i < Rows; ++i) {
+    c[i][0] = accumulate ? Ops::load(C + i * ldc) : Ops::zero();
+    c[i][1] = accumulate ? Ops::load(C + i * ldc + W) : Ops::zero();
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const T *b = B + k * rsB;
+    const typename Ops::Reg b0 = Ops::load(b), b1 = Ops::load(b + W);
+#pragma GCC unroll 8
+    for (int i = 0; i < Rows; ++i) {
+      const typename Ops::Reg a = Ops::broadcast(A[i * rsA + k * csA]);
+      c[i][0] = Ops::mulAdd(a, b0, c[i][0]);
+      c[i][1] = Ops::mulAdd(a, b1, c[i][1]);
+    }
+  }
+
+#pragma GCC unroll 8
+  for (int i = 0; i < Rows; ++i) {
+    Ops::store(C + i * ldc, c[i][0]);
+    Ops::store(C + i * ldc + W, c[i][1]);
+  }
+}
+
+// 4x16 int32 block from int16 pairs with vpmaddwd.
+void int16Kernel4x16(int groups, const void *A, const void *B,
+                     std::int32_t *C, long ldc, bool accumulate) {
+  const std::int16_t *a = static_cast<const std::int16_t *>(A);
+  const std::int16_t *b = static_cast<const std::int16_t *>(B);
+  __m256i c[4][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    if (accumulate) {
+      c[i][0] =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(C + i * ldc));
+      c[i][1] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(C + i * ldc + 8));
+    } else {
+      c[i][0] = _mm256_setzero_si256();
+      c[i][1] = _mm256_setzero_si256();
+    }
+  }
+
+  for (int g = 0; g < groups; ++g, a += 2 * 4, b += 2 * 16) {
+    const __m256i b0 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+    const __m256i b1 =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + 16));
+#pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i) {
+      std::int32_t pair;
+      std::memcpy(&pair, a + 2 * i, sizeof pair);
+      const __m256i ai = _mm256_set1_epi32(pair);
+      c[i][0] = _mm256_add_epi32(c[i][0], _mm256_madd_epi16(ai, b0));
+      c[i][1] = _mm256_add_epi32(c[i][1], _mm256_madd_epi16(ai, b1));
+    }
+  }
+
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + i * ldc), c[i][0]);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + i * ldc + 8),
+                        c[i][1]);
+  }
+}
+
+// Row of a sparse-times-dense product: 32 columns at a time in four ymm
+// accumulators, then one register at a time and a scalar tail.
+void sparseRow(int count, const int *indices, const int *values,
+               const int *B, long ldb, int n, int *C) {
+  int j = 0;
+  for (; j + 32 <= n; j += 32) {
+    __m256i c[4];
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r)
+      c[r] = _mm256_setzero_si256();
+    for (int p = 0; p < count; ++p) {
+      const __m256i a = _mm256_set1_epi32(values[p]);
+      const int *b = B + indices[p] * ldb + j;
+#pragma GCC unroll 4
+      for (int r = 0; r < 4; ++r) {
+        const __m256i row =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + r * 8));
+        c[r] = _mm256_add_epi32(c[r], _mm256_mullo_epi32(a, row));
+      }
+    }
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r)
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + j + r * 8), c[r]);
+  }
+  for (; j + 8 <= n; j += 8) {
+    __m256i c = _mm256_setzero_si256();
+    for (int p = 0; p < count; ++p) {
+      const int *b = B + indices[p] * ldb + j;
+      const __m256i a = _mm256_set1_epi32(values[p]);
+      const __m256i row =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+      c = _mm256_add_epi32(c, _mm256_mullo_epi32(a, row));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(C + j), c);
+  }
+  for (; j < n; ++j) {
+    unsigned sum = 0;
+    for (int p = 0; p < count; ++p)
+      sum += static_cast<unsigned>(values[p]) *
+             static_cast<unsigned>(B[indices[p] * ldb + j]);
+    C[j] = static_cast<int>(sum);
+  }
+}
+
+// Hash row kernel, the eight accumulators in two ymm registers, products
+// with vpmuludq. The 64-bit products of the scramble are put together from
+// two 32-bit ones, which gives the low 64 bits of acc * hashPrime32.
+void hashRow(const void *row, std::size_t bytes, std::uint64_t *acc) {
+  const auto load = [](const void *p, int r) {
+    return _mm256_loadu_si256(static_cast<const __m256i *>(p) + r);
+  };
+  const __m256i secret[2] = {load(hashSecret, 0), load(hashSecret, 1)};
+  __m256i a[2] = {load(acc, 0), load(acc, 1)};
+  hashStripes(
+      static_cast<const char *>(row), bytes,
+      [&](const char *stripe, std::uint64_t s) {
+        const __m256i offset =
+            _mm256_set1_epi64x(static_cast<long long>(s * hashStripeStep));
+        for (int r = 0; r < 2; ++r) {
+          const __m256i d = load(stripe, r);
+          const __m256i x =
+              _mm256_xor_si256(d, _mm256_add_epi64(secret[r], offset));
+          const __m256i product =
+              _mm256_mul_epu32(x, _mm256_srli_epi64(x, 32));
+          a[r] = _mm256_add_epi64(a[r], _mm256_add_epi64(d, product));
+        }
+      },
+      [&] {
+        const __m256i prime = _mm256_set1_epi64x(hashPrime32);
+        for (int r = 0; r < 2; ++r) {
+          const __m256i x = _mm256_xor_si256(
+              _mm256_xor_si256(a[r], _mm256_srli_epi64(a[r], 47)), secret[r]);
+          const __m256i high =
+              _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+          a[r] = _mm256_add_epi64(_mm256_mul_epu32(x, prime),
+                                  _mm256_slli_epi64(high, 32));
+        }
+      });
+  for (int r = 0; r < 2; ++r)
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + r, a[r]);
+}
+
+// Philox operations on eight counters. vpmuludq multiplies the even lanes;
+// the odd ones are shifted down for a second multiply.
+struct PhiloxOps {
+  using Reg = __m256i;
+  static constexpr int lanes = 8;
+  static Reg load(const std::uint32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static Reg set1(std::uint32_t x) {
+    return _mm256_set1_epi32(static_cast<int>(x));
+  }
+  static Reg xor3(Reg a, Reg b, Reg c) {
+    return _mm256_xor_si256(_mm256_xor_si256(a, b), c);
+  }
+  static void multiply(Reg a, std::uint32_t m, Reg &hi, Reg &lo) {
+    const Reg factor = set1(m);
+    const Reg even = _mm256_mul_epu32(a, factor);
+    const Reg odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), factor);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+  }
+  // Each 128-bit half holds four blocks once transposed.
+  static void store(std::uint32_t *out, Reg c0, Reg c1, Reg c2, Reg c3) {
+    const Reg t0 = _mm256_unpacklo_epi32(c0, c1);
+    const Reg t1 = _mm256_unpackhi_epi32(c0, c1);
+    const Reg t2 = _mm256_unpacklo_epi32(c2, c3);
+    const Reg t3 = _mm256_unpackhi_epi32(c2, c3);
+    const Reg u0 = _mm256_unpacklo_epi64(t0, t2);
+    const Reg u1 = _mm256_unpackhi_epi64(t0, t2);
+    const Reg u2 = _mm256_unpacklo_epi64(t1, t3);
+    const Reg u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i *o = reinterpret_cast<__m256i *>(out);
+    _mm256_storeu_si256(o, _mm256_permute2x128_si256(u0, u1, 0x20));
+    _mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(u2, u3, 0x20));
+    _mm256_storeu_si256(o + 2, _mm256_permute2x128_si256(u0, u1, 0x31));
+    _mm256_storeu_si256(o + 3, _mm256_permute2x128_si256(u2, u3, 0x31));
+  }
+};
+
+} // namespace
+
+const MicroKernel &avx2MicroKernel() {
+  static const MicroKernel kernel{SimdIsa::Avx2, MR, NR, kernel4x16};
+  return kernel;
+}
+
+const TypedMicroKernel<float> &avx2FloatMicroKernel() {
+  static const TypedMicroKernel<float> kernel{
+      SimdIsa::Avx2, 6, 16, floatingKernel<FloatOps, float, 6>};
+  return kernel;
+}
+
+const TypedMicroKernel<double> &avx2DoubleMicroKernel() {
+  static const TypedMicroKernel<double> kernel{
+      SimdIsa::Avx2, 6, 8, floatingKernel<DoubleOps, double, 6>};
+  return kernel;
+}
+
+const WideMicroKernel &avx2WideMicroKernel() {
+  static const WideMicroKernel kernel{SimdIsa::Avx2, 4, 8, wideKernel4x8};
+  return kernel;
+}
+
+const SparseRowKernel &avx2SparseRowKernel() {
+  static const SparseRowKernel kernel{SimdIsa::Avx2, sparseRow};
+  return kernel;
+}
+
+const BatchKernel &avx2BatchKernel() {
+  static const BatchKernel kernel{SimdIsa::Avx2, 8,
+                                  interleavedProducts<8>};
+  return kernel;
+}
+
+const QuantizedKernel &avx2Int16Kernel() {
+  static const QuantizedKernel kernel{SimdIsa::Avx2, 4, 16, 2,
+                                      int16Kernel4x16};
+  return kernel;
+}
+
+const BinaryKernel &avx2BinaryKernel() {
+  static const BinaryKernel kernel{SimdIsa::Avx2, popcountProducts};
+  return kernel;
+}
+
+const PhiloxKernel &avx2PhiloxKernel() {
+  static const PhiloxKernel kernel{SimdIsa::Avx2, philoxGroups<PhiloxOps>};
+  return kernel;
+}
+
+const HashRowKernel &avx2HashRowKernel() {
+  static const HashRowKernel kernel{SimdIsa::Avx2, hashRow};
+  return kernel;
+}
+
+// Two ymm registers of partial sums per row of gemv.
+template <typename T> const VectorKernel<T> &avx2VectorKernel() {
+  static const VectorKernel<T> kernel{SimdIsa::Avx2,
+                                      gemv<T, 2 * 32 / sizeof(T)>, gevm<T>,
+                                      outer<T>};
+  return kernel;
+}
+
+template const VectorKernel<int> &avx2VectorKernel();
+template const VectorKernel<float> &avx2VectorKernel();
+template const VectorKernel<double> &avx2VectorKernel();
@@ -0,0 +1,311 @@
+#include "batch_kernel.h"
+#include "binary_kernel.h"
+#include "hash_kernel.h"
+#include "microkernel.h"
+#include "philox_kernel.h"
+#include "vector_kernel.h"
+
+#include <immintrin.h>
+
+namespace {
+
+constexpr int MR = 8;
+constexpr int NR = 32;
+
+// 8x32 block of C in 16 zmm accumulators, products with vpmulld.
+void kernel8x32(int kc, const int *A, long rsA, long csA, const int *B,
+                long rsB, int *C, long ldc, bool accumulate) {
+  __m512i c[MR][2];
+#pragma GCC unroll 8
+  for (int i = 0; i < MR; ++i) {
+    if (accumulate) {
+      c[i][0] = _mm512_loadu_si512(C + i * ldc);
+      c[i][1] = _mm512_loadu_si512(C + i * ldc + 16);
+    } else {
+      c[i][0] = _mm512_setzero_si512();
+      c[i][1] = _mm512_setzero_si512();
+    }
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    const __m512i b0 = _mm512_loadu_si512(b);
+    const __m512i b1 = _mm512_loadu_si512(b + 16);
+#pragma GCC unroll 8
+    for (int i = 0; i < MR; ++i) {
+      const __m512i a = _mm512_set1_epi32(A[i * rsA + k * csA]);
+      c[i][0] = _mm512_add_epi32(c[i][0], _mm512_mullo_epi32(a, b0));
+      c[i][1] = _mm512_add_epi32(c[i][1], _mm512_mullo_epi32(a, b1));
+    }
+  }
+
+#pragma GCC unroll 8
+  for (int i = 0; i < MR; ++i) {
+    _mm512_storeu_si512(C + i * ldc, c[i][0]);
+    _mm512_storeu_si512(C + i * ldc + 16, c[i][1]);
+  }
+}
+
+// Wide 8x16 block in 16 zmm accumulators of eight int64 each. vpmuldq
+// multiplies the sign-extended low halves of the 64-bit lanes.
+void wideKernel8x16(int kc, const int *A, long rsA, long csA, const int *B,
+                    long rsB, std::int64_t *C, long ldc, bool accumulate) {
+  __m512i c[8][2];
+#pragma GCC unroll 8
+  for (int i = 0; i < 8; ++i) {
+    if (accumulate) {
+      c[i][0] = _mm512_loadu_si512(C + i * ldc);
+      c[i][1] = _mm512_loadu_si512(C + i * ldc + 8);
+    } else {
+      c[i][0] = _mm512_setzero_si512();
+      c[i][1] = _mm512_setzero_si512();
+    }
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    const __m512i b0 = _mm512_cvtepi32_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)));
+    const __m512i b1 = _mm512_cvtepi32_epi64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + 8)));
+#pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i) {
+      const __m512i a = _mm512_set1_epi64(A[i * rsA + k * csA]);
+      c[i][0] = _mm512_add_epi64(c[i][0], _mm512_mul_epi32(a, b0));
+      c[i][1] = _mm512_add_epi64(c[i][1], _mm512_mul_epi32(a, b1));
+    }
+  }
+
+#pragma GCC unroll 8
+  for (int i = 0; i < 8; ++i) {
+    _mm512_storeu_si512(C + i * ldc, c[i][0]);
+    _mm512_storeu_si512(C + i * ldc + 8, c[i][1]);
+  }
+}
+
+// Register operations of the floating-point kernels.
+struct FloatOps {
+  using Reg = __m512;
+  static constexpr int width = 16;
+  static Reg zero() { return _mm512_setzero_ps(); }
+  static Reg load(const float *p) { return _mm512_loadu_ps(p); }
+  static Reg broadcast(float x) { return _mm512_set1_ps(x); }
+  static Reg mulAdd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+  static void store(float *p, Reg x) { _mm512_storeu_ps(p, x); }
+};
+
+struct DoubleOps {
+  using Reg = __m512d;
+  static constexpr int width = 8;
+  static Reg zero() { return _mm512_setzero_pd(); }
+  static Reg load(const double *p) { return _mm512_loadu_pd(p); }
+  static Reg broadcast(double x) { return _mm512_set1_pd(x); }
+  static Reg mulAdd(Reg a, Reg b, Reg c) { return _mm512_fmadd_pd(a, b, c); }
+  static void store(double *p, Reg x) { _mm512_storeu_pd(p, x); }
+};
+
+// Rows x (2 * width) block of C with FMA. Twelve rows use 24 of the 32 zmm
+// registers as accumulators.
+template <typename Ops, typename T, int Rows>
+void floatingKernel(int kc, const T *A, long rsA, long csA, const T *B,
+                    long rsB, T *C, long ldc, bool accumulate) {
+  constexpr int W = Ops::width;
+  typename Ops::Reg c[Rows][2];
+#pragma GCC unroll 12
+  for (int i = 0; i < Rows; ++i) {
+    c[i][0] = accumulate ? Ops::load(C + i * ldc) : Ops::zero();
+    c[i][1] = accumulate ? Ops::load(C + i * ldc + W) : Ops::zero();
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const T *b = B + k * rsB;
+    const typename Ops::Reg b0 = Ops::load(b), b1 = Ops::load(b + W);
+#pragma GCC unroll 12
+    for (int i = 0; i < Rows; ++i) {
+      const typename Ops::Reg a = Ops::broadcast(A[i * rsA + k * csA]);
+      c[i][0] = Ops::mulAdd(a, b0, c[i][0]);
+      c[i][1] = Ops::mulAdd(a, b1, c[i][1]);
+    }
+  }
+
+#pragma GCC unroll 12
+  for (int i = 0; i < Rows; ++i) {
+    Ops::store(C + i * ldc, c[i][0]);
+    Ops::store(C + i * ldc + W, c[i][1]);
+  }
+}
+
+// Row of a sparse-times-dense product: 64 columns at a time in four zmm
+// accumulators, then one register at a time and a scalar tail.
+void sparseRow(int count, const int *indices, const int *values,
+               const int *B, long ldb, int n, int *C) {
+  int j = 0;
+  for (; j + 64 <= n; j += 64) {
+    __m512i c[4];
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r)
+      c[r] = _mm512_setzero_si512();
+    for (int p = 0; p < count; ++p) {
+      const __m512i a = _mm512_set1_epi32(values[p]);
+      const int *b = B + indices[p] * ldb + j;
+#pragma GCC unroll 4
+      for (int r = 0; r < 4; ++r) {
+        const __m512i row = _mm512_loadu_si512(b + r * 16);
+        c[r] = _mm512_add_epi32(c[r], _mm512_mullo_epi32(a, row));
+      }
+    }
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r)
+      _mm512_storeu_si512(C + j + r * 16, c[r]);
+  }
+  for (; j + 16 <= n; j += 16) {
+    __m512i c = _mm512_setzero_si512();
+    for (int p = 0; p < count; ++p) {
+      const int *b = B + indices[p] * ldb + j;
+      const __m512i a = _mm512_set1_epi32(values[p]);
+      const __m512i row = _mm512_loadu_si512(b);
+      c = _mm512_add_epi32(c, _mm512_mullo_epi32(a, row));
+    }
+    _mm512_storeu_si512(C + j, c);
+  }
+  for (; j < n; ++j) {
+    unsigned sum = 0;
+    for (int p = 0; p < count; ++p)
+      sum += static_cast<unsigned>(values[p]) *
+             static_cast<unsigned>(B[indices[p] * ldb + j]);
+    C[j] = static_cast<int>(sum);
+  }
+}
+
+// Hash row kernel, the eight accumulators in one zmm register, products with
+// vpmuludq. The 64-bit products of the scramble are put together from two
+// 32-bit ones, which gives the low 64 bits of acc * hashPrime32.
+void hashRow(const void *row, std::size_t bytes, std::uint64_t *acc) {
+  const __m512i secret = _mm512_loadu_si512(hashSecret);
+  __m512i a = _mm512_loadu_si512(acc);
+  hashStripes(
+      static_cast<const char *>(row), bytes,
+      [&](const char *stripe, std::uint64_t s) {
+        const __m512i offset =
+            _mm512_set1_epi64(static_cast<long long>(s * hashStripeStep));
+        const __m512i d = _mm512_loadu_si512(stripe);
+        const __m512i x = _mm512_xor_si512(d, _mm512_add_epi64(secret, offset));
+        const __m512i product = _mm512_mul_epu32(x, _mm512_srli_epi64(x, 32));
+        a = _mm512_add_epi64(a, _mm512_add_epi64(d, product));
+      },
+      [&] {
+        const __m512i prime = _mm512_set1_epi64(hashPrime32);
+        const __m512i x = _mm512_xor_si512(
+            _mm512_xor_si512(a, _mm512_srli_epi64(a, 47)), secret);
+        const __m512i high = _mm512_mul_epu32(_mm512_srli_epi64(x, 32), prime);
+        a = _mm512_add_epi64(_mm512_mul_epu32(x, prime),
+                             _mm512_slli_epi64(high, 32));
+      });
+  _mm512_storeu_si512(acc, a);
+}
+
+// Philox operations on sixteen counters. vpmuludq multiplies the even
+// lanes; the odd ones are shifted down for a second multiply.
+struct PhiloxOps {
+  using Reg = __m512i;
+  static constexpr int lanes = 16;
+  static Reg load(const std::uint32_t *p) { return _mm512_loadu_si512(p); }
+  static Reg set1(std::uint32_t x) {
+    return _mm512_set1_epi32(static_cast<int>(x));
+  }
+  static Reg xor3(Reg a, Reg b, Reg c) {
+    return _mm512_ternarylogic_epi32(a, b, c, 0x96);
+  }
+  static void multiply(Reg a, std::uint32_t m, Reg &hi, Reg &lo) {
+    const Reg factor = set1(m);
+    const Reg even = _mm512_mul_epu32(a, factor);
+    const Reg odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), factor);
+    hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+    lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+  }
+  // Each 128-bit quarter holds four blocks once transposed.
+  static void store(std::uint32_t *out, Reg c0, Reg c1, Reg c2, Reg c3) {
+    const Reg t0 = _mm512_unpacklo_epi32(c0, c1);
+    const Reg t1 = _mm512_unpackhi_epi32(c0, c1);
+    const Reg t2 = _mm512_unpacklo_epi32(c2, c3);
+    const Reg t3 = _mm512_unpackhi_epi32(c2, c3);
+    const Reg u0 = _mm512_unpacklo_epi64(t0, t2);
+    const Reg u1 = _mm512_unpackhi_epi64(t0, t2);
+    const Reg u2 = _mm512_unpacklo_epi64(t1, t3);
+    const Reg u3 = _mm512_unpackhi_epi64(t1, t3);
+    const Reg v0 = _mm512_shuffle_i32x4(u0, u1, _MM_SHUFFLE(1, 0, 1, 0));
+    const Reg v1 = _mm512_shuffle_i32x4(u2, u3, _MM_SHUFFLE(1, 0, 1, 0));
+    const Reg v2 = _mm512_shuffle_i32x4(u0, u1, _MM_SHUFFLE(3, 2, 3, 2));
+    const Reg v3 = _mm512_shuffle_i32x4(u2, u3, _MM_SHUFFLE(3, 2, 3, 2));
+    _mm512_storeu_si512(out,
+                        _mm512_shuffle_i32x4(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm512_storeu_si512(out + 16,
+                        _mm512_shuffle_i32x4(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+    _mm512_storeu_si512(out + 32,
+                        _mm512_shuffle_i32x4(v2, v3, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm512_storeu_si512(out + 48,
+                        _mm512_shuffle_i32x4(v2, v3, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+};
+
+} // namespace
+
+const MicroKernel &avx512MicroKernel() {
+  static const MicroKernel kernel{SimdIsa::Avx512, MR, NR, kernel8x32};
+  return kernel;
+}
+
+const TypedMicroKernel<float> &avx512FloatMicroKernel() {
+  static const TypedMicroKernel<float> kernel{
+      SimdIsa::Avx512, 12, 32, floatingKernel<FloatOps, float, 12>};
+  return kernel;
+}
+
+const TypedMicroKernel<double> &avx512DoubleMicroKernel() {
+  static const TypedMicroKernel<double> kernel{
+      SimdIsa::Avx512, 12, 16, floatingKernel<DoubleOps, double, 12>};
+  return kernel;
+}
+
+const WideMicroKernel &avx512WideMicroKernel() {
+  static const WideMicroKernel kernel{SimdIsa::Avx512, 8, 16, wideKernel8x16};
+  return kernel;
+}
+
+const SparseRowKernel &avx512SparseRowKernel() {
+  static const SparseRowKernel kernel{SimdIsa::Avx512, sparseRow};
+  return kernel;
+}
+
+const BatchKernel &avx512BatchKernel() {
+  static const BatchKernel kernel{SimdIsa::Avx512, 16,
+                                  interleavedProducts<16>};
+  return kernel;
+}
+
+const BinaryKernel &avx512BinaryKernel() {
+  static const BinaryKernel kernel{SimdIsa::Avx512, popcountProducts};
+  return kernel;
+}
+
+const PhiloxKernel &avx512PhiloxKernel() {
+  static const PhiloxKernel kernel{SimdIsa::Avx512, philoxGroups<PhiloxOps>};
+  return kernel;
+}
+
+const HashRowKernel &avx512HashRowKernel() {
+  static const HashRowKernel kernel{SimdIsa::Avx512, hashRow};
+  return kernel;
+}
+
+// Two zmm registers of partial sums per row of gemv.
+template <typename T> const VectorKernel<T> &avx512VectorKernel() {
+  static const VectorKernel<T> kernel{SimdIsa::Avx512,
+                                      gemv<T, 2 * 64 / sizeof(T)>, gevm<T>,
+                                      outer<T>};
+  return kernel;
+}
+
+template const VectorKernel<int> &avx512VectorKernel();
+template const VectorKernel<float> &avx512VectorKernel();
+template const VectorKernel<double> &avx512VectorKernel();
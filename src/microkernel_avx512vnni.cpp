@@ -0,0 +1,71 @@
+#include "microkernel.h"
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+constexpr int MR = 8;
+constexpr int NR = 32;
+
+// 8x32 int32 block in 16 zmm accumulators. Each step broadcasts one group of
+// A (two int16 or four uint8 values in 32 bits) and multiplies it with the
+// matching groups of 32 columns of B, summing the products into the lanes:
+// vpdpwssd for int16 pairs, vpdpbusd for uint8 x int8 quads.
+template <int Group>
+void dotKernel8x32(int groups, const void *A, const void *B, std::int32_t *C,
+                   long ldc, bool accumulate) {
+  const char *a = static_cast<const char *>(A);
+  const char *b = static_cast<const char *>(B);
+  __m512i c[MR][2];
+#pragma GCC unroll 8
+  for (int i = 0; i < MR; ++i) {
+    if (accumulate) {
+      c[i][0] = _mm512_loadu_si512(C + i * ldc);
+      c[i][1] = _mm512_loadu_si512(C + i * ldc + 16);
+    } else {
+      c[i][0] = _mm512_setzero_si512();
+      c[i][1] = _mm512_setzero_si512();
+    }
+  }
+
+  // Both groups are 4 bytes, so the panels advance by 4 bytes per row or
+  // column whatever the element type.
+  for (int g = 0; g < groups; ++g, a += 4 * MR, b += 4 * NR) {
+    const __m512i b0 = _mm512_loadu_si512(b);
+    const __m512i b1 = _mm512_loadu_si512(b + 64);
+#pragma GCC unroll 8
+    for (int i = 0; i < MR; ++i) {
+      std::int32_t group;
+      std::memcpy(&group, a + 4 * i, sizeof group);
+      const __m512i ai = _mm512_set1_epi32(group);
+      if constexpr (Group == 2) {
+        c[i][0] = _mm512_dpwssd_epi32(c[i][0], ai, b0);
+        c[i][1] = _mm512_dpwssd_epi32(c[i][1], ai, b1);
+      } else {
+        c[i][0] = _mm512_dpbusd_epi32(c[i][0], ai, b0);
+        c[i][1] = _mm512_dpbusd_epi32(c[i][1], ai, b1);
+      }
+    }
+  }
+
+#pragma GCC unroll 8
+  for (int i = 0; i < MR; ++i) {
+    _mm512_storeu_si512(C + i * ldc, c[i][0]);
+    _mm512_storeu_si512(C + i * ldc + 16, c[i][1]);
+  }
+}
+
+} // namespace
+
+const QuantizedKernel &avx512VnniInt16Kernel() {
+  static const QuantizedKernel kernel{SimdIsa::Avx512Vnni, MR, NR, 2,
+                                      dotKernel8x32<2>};
+  return kernel;
+}
+
+const QuantizedKernel &avx512VnniInt8Kernel() {
+  static const QuantizedKernel kernel{SimdIsa::Avx512Vnni, MR, NR, 4,
+                                      dotKernel8x32<4>};
+  return kernel;
+}
@@ -0,0 +1,192 @@
+#include "batch_kernel.h"
+#include "binary_kernel.h"
+#include "hash_kernel.h"
+#include "microkernel.h"
+#include "philox_kernel.h"
+#include "vector_kernel.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr int MR = 4;
+constexpr int NR = 4;
+
+// Portable fallback: the 4x4 block of C lives in 16 scalar accumulators.
+void kernel4x4(int kc, const int *A, long rsA, long csA, const int *B,
+               long rsB, int *C, long ldc, bool accumulate) {
+  unsigned c[MR][NR] = {};
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    for (int i = 0; i < MR; ++i) {
+      const unsigned a = static_cast<unsigned>(A[i * rsA + k * csA]);
+      for (int j = 0; j < NR; ++j)
+        c[i][j] += a * static_cast<unsigned>(b[j]);
+    }
+  }
+  for (int i = 0; i < MR; ++i)
+    for (int j = 0; j < NR; ++j) {
+      int &out = C[i * ldc + j];
+      out = static_cast<int>(accumulate ? static_cast<unsigned>(out) + c[i][j]
+                                        : c[i][j]);
+    }
+}
+
+// Wide 4x4 block: 64-bit products and sums, wrapping like the SIMD kernels.
+void wideKernel4x4(int kc, const int *A, long rsA, long csA, const int *B,
+                   long rsB, std::int64_t *C, long ldc, bool accumulate) {
+  std::uint64_t c[MR][NR] = {};
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    for (int i = 0; i < MR; ++i) {
+      const std::int64_t a = A[i * rsA + k * csA];
+      for (int j = 0; j < NR; ++j)
+        c[i][j] += static_cast<std::uint64_t>(a * b[j]);
+    }
+  }
+  for (int i = 0; i < MR; ++i)
+    for (int j = 0; j < NR; ++j) {
+      std::int64_t &out = C[i * ldc + j];
+      out = static_cast<std::int64_t>(
+          accumulate ? static_cast<std::uint64_t>(out) + c[i][j] : c[i][j]);
+    }
+}
+
+// Floating-point 4x4 block, same loops as the int one.
+template <typename T>
+void floatingKernel4x4(int kc, const T *A, long rsA, long csA, const T *B,
+                       long rsB, T *C, long ldc, bool accumulate) {
+  T c[MR][NR] = {};
+  for (int k = 0; k < kc; ++k) {
+    const T *b = B + k * rsB;
+    for (int i = 0; i < MR; ++i) {
+      const T a = A[i * rsA + k * csA];
+      for (int j = 0; j < NR; ++j)
+        c[i][j] += a * b[j];
+    }
+  }
+  for (int i = 0; i < MR; ++i)
+    for (int j = 0; j < NR; ++j) {
+      T &out = C[i * ldc + j];
+      out = accumulate ? out + c[i][j] : c[i][j];
+    }
+}
+
+// 4x4 int32 block from int16 pairs. Each product fits in an int, their sums
+// wrap in unsigned arithmetic like the SIMD kernels.
+void int16Kernel4x4(int groups, const void *A, const void *B, std::int32_t *C,
+                    long ldc, bool accumulate) {
+  const std::int16_t *a = static_cast<const std::int16_t *>(A);
+  const std::int16_t *b = static_cast<const std::int16_t *>(B);
+  std::uint32_t c[MR][NR] = {};
+  for (int g = 0; g < groups; ++g, a += 2 * MR, b += 2 * NR)
+    for (int i = 0; i < MR; ++i)
+      for (int j = 0; j < NR; ++j)
+        c[i][j] += static_cast<std::uint32_t>(a[2 * i] * b[2 * j]) +
+                   static_cast<std::uint32_t>(a[2 * i + 1] * b[2 * j + 1]);
+  for (int i = 0; i < MR; ++i)
+    for (int j = 0; j < NR; ++j) {
+      std::int32_t &out = C[i * ldc + j];
+      out = static_cast<std::int32_t>(
+          accumulate ? static_cast<std::uint32_t>(out) + c[i][j] : c[i][j]);
+    }
+}
+
+void sparseRow(int count, const int *indices, const int *values,
+               const int *B, long ldb, int n, int *C) {
+  unsigned *c = reinterpret_cast<unsigned *>(C);
+  std::fill(c, c + n, 0u);
+  for (int p = 0; p < count; ++p) {
+    const unsigned a = static_cast<unsigned>(values[p]);
+    const int *b = B + indices[p] * ldb;
+    for (int j = 0; j < n; ++j)
+      c[j] += a * static_cast<unsigned>(b[j]);
+  }
+}
+
+// Hash row kernel, one accumulator at a time.
+void hashRow(const void *row, std::size_t bytes, std::uint64_t *acc) {
+  hashStripes(
+      static_cast<const char *>(row), bytes,
+      [acc](const char *stripe, std::uint64_t s) {
+        std::uint64_t d[hashLanes];
+        std::memcpy(d, stripe, hashStripeBytes);
+        for (int l = 0; l < hashLanes; ++l) {
+          const std::uint64_t x = d[l] ^ (hashSecret[l] + s * hashStripeStep);
+          acc[l] += d[l] + (x & 0xFFFFFFFFu) * (x >> 32);
+        }
+      },
+      [acc] {
+        for (int l = 0; l < hashLanes; ++l)
+          acc[l] = (acc[l] ^ (acc[l] >> 47) ^ hashSecret[l]) * hashPrime32;
+      });
+}
+
+} // namespace
+
+const MicroKernel &scalarMicroKernel() {
+  static const MicroKernel kernel{SimdIsa::Scalar, MR, NR, kernel4x4};
+  return kernel;
+}
+
+const TypedMicroKernel<float> &scalarFloatMicroKernel() {
+  static const TypedMicroKernel<float> kernel{SimdIsa::Scalar, MR, NR,
+                                              floatingKernel4x4<float>};
+  return kernel;
+}
+
+const TypedMicroKernel<double> &scalarDoubleMicroKernel() {
+  static const TypedMicroKernel<double> kernel{SimdIsa::Scalar, MR, NR,
+                                               floatingKernel4x4<double>};
+  return kernel;
+}
+
+const WideMicroKernel &scalarWideMicroKernel() {
+  static const WideMicroKernel kernel{SimdIsa::Scalar, MR, NR, wideKernel4x4};
+  return kernel;
+}
+
+const BatchKernel &scalarBatchKernel() {
+  static const BatchKernel kernel{SimdIsa::Scalar, 4,
+                                  interleavedProducts<4>};
+  return kernel;
+}
+
+const SparseRowKernel &scalarSparseRowKernel() {
+  static const SparseRowKernel kernel{SimdIsa::Scalar, sparseRow};
+  return kernel;
+}
+
+const QuantizedKernel &scalarInt16Kernel() {
+  static const QuantizedKernel kernel{SimdIsa::Scalar, MR, NR, 2,
+                                      int16Kernel4x4};
+  return kernel;
+}
+
+const BinaryKernel &scalarBinaryKernel() {
+  static const BinaryKernel kernel{SimdIsa::Scalar, popcountProducts};
+  return kernel;
+}
+
+const PhiloxKernel &scalarPhiloxKernel() {
+  static const PhiloxKernel kernel{SimdIsa::Scalar, philoxBlocks<4>};
+  return kernel;
+}
+
+const HashRowKernel &scalarHashRowKernel() {
+  static const HashRowKernel kernel{SimdIsa::Scalar, hashRow};
+  return kernel;
+}
+
+// Four partial sums per row of gemv.
+template <typename T> const VectorKernel<T> &scalarVectorKernel() {
+  static const VectorKernel<T> kernel{SimdIsa::Scalar,
+                                      gemv<T, 4>, gevm<T>,
+                                      outer<T>};
+  return kernel;
+}
+
+template const VectorKernel<int> &scalarVectorKernel();
+template const VectorKernel<float> &scalarVectorKernel();
+template const VectorKernel<double> &scalarVectorKernel();
@@ -0,0 +1,365 @@
+#include "batch_kernel.h"
+#include "binary_kernel.h"
+#include "hash_kernel.h"
+#include "microkernel.h"
+#include "philox_kernel.h"
+#include "vector_kernel.h"
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+constexpr int MR = 4;
+constexpr int NR = 8;
+
+// 4x8 block of C in 8 xmm accumulators, products with pmulld.
+void kernel4x8(int kc, const int *A, long rsA, long csA, const int *B,
+               long rsB, int *C, long ldc, bool accumulate) {
+  __m128i c[MR][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < MR; ++i) {
+    if (accumulate) {
+      c[i][0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(C + i * ldc));
+      c[i][1] =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(C + i * ldc + 4));
+    } else {
+      c[i][0] = _mm_setzero_si128();
+      c[i][1] = _mm_setzero_si128();
+    }
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    const __m128i b1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 4));
+#pragma GCC unroll 4
+    for (int i = 0; i < MR; ++i) {
+      const __m128i a = _mm_set1_epi32(A[i * rsA + k * csA]);
+      c[i][0] = _mm_add_epi32(c[i][0], _mm_mullo_epi32(a, b0));
+      c[i][1] = _mm_add_epi32(c[i][1], _mm_mullo_epi32(a, b1));
+    }
+  }
+
+#pragma GCC unroll 4
+  for (int i = 0; i < MR; ++i) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + i * ldc), c[i][0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + i * ldc + 4), c[i][1]);
+  }
+}
+
+// Wide 4x4 block in 8 xmm accumulators of two int64 each. pmuldq multiplies
+// the sign-extended low halves of the 64-bit lanes into exact products.
+void wideKernel4x4(int kc, const int *A, long rsA, long csA, const int *B,
+                   long rsB, std::int64_t *C, long ldc, bool accumulate) {
+  __m128i c[4][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    if (accumulate) {
+      c[i][0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(C + i * ldc));
+      c[i][1] =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(C + i * ldc + 2));
+    } else {
+      c[i][0] = _mm_setzero_si128();
+      c[i][1] = _mm_setzero_si128();
+    }
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const int *b = B + k * rsB;
+    const __m128i b0 = _mm_cvtepi32_epi64(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(b)));
+    const __m128i b1 = _mm_cvtepi32_epi64(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(b + 2)));
+#pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i) {
+      const __m128i a = _mm_set1_epi64x(A[i * rsA + k * csA]);
+      c[i][0] = _mm_add_epi64(c[i][0], _mm_mul_epi32(a, b0));
+      c[i][1] = _mm_add_epi64(c[i][1], _mm_mul_epi32(a, b1));
+    }
+  }
+
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + i * ldc), c[i][0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + i * ldc + 2), c[i][1]);
+  }
+}
+
+// Register operations of the floating-point kernels. SSE4.1 has no FMA, so
+// the multiply-add is a mulps/addps pair.
+struct FloatOps {
+  using Reg = __m128;
+  static constexpr int width = 4;
+  static Reg zero() { return _mm_setzero_ps(); }
+  static Reg load(const float *p) { return _mm_loadu_ps(p); }
+  static Reg broadcast(float x) { return _mm_set1_ps(x); }
+  static Reg mulAdd(Reg a, Reg b, Reg c) {
+    return _mm_add_ps(c, _mm_mul_ps(a, b));
+  }
+  static void store(float *p, Reg x) { _mm_storeu_ps(p, x); }
+};
+
+struct DoubleOps {
+  using Reg = __m128d;
+  static constexpr int width = 2;
+  static Reg zero() { return _mm_setzero_pd(); }
+  static Reg load(const double *p) { return _mm_loadu_pd(p); }
+  static Reg broadcast(double x) { return _mm_set1_pd(x); }
+  static Reg mulAdd(Reg a, Reg b, Reg c) {
+    return _mm_add_pd(c, _mm_mul_pd(a, b));
+  }
+  static void store(double *p, Reg x) { _mm_storeu_pd(p, x); }
+};
+
+// Rows x (2 * width) block of C in 2 * Rows accumulators.
+template <typename Ops, typename T, int Rows>
+void floatingKernel(int kc, const T *A, long rsA, long csA, const T *B,
+                    long rsB, T *C, long ldc, bool accumulate) {
+  constexpr int W = Ops::width;
+  typename Ops::Reg c[Rows][2];
+#pragma GCC unroll 8
+  for (int i = 0; i < Rows; ++i) {
+    c[i][0] = accumulate ? Ops::load(C + i * ldc) : Ops::zero();
+    c[i][1] = accumulate ? Ops::load(C + i * ldc + W) : Ops::zero();
+  }
+
+  for (int k = 0; k < kc; ++k) {
+    const T *b = B + k * rsB;
+    const typename Ops::Reg b0 = Ops::load(b), b1 = Ops::load(b + W);
+#pragma GCC unroll 8
+    for (int i = 0; i < Rows; ++i) {
+      const typename Ops::Reg a = Ops::broadcast(A[i * rsA + k * csA]);
+      c[i][0] = Ops::mulAdd(a, b0, c[i][0]);
+      c[i][1] = Ops::mulAdd(a, b1, c[i][1]);
+    }
+  }
+
+#pragma GCC unroll 8
+  for (int i = 0; i < Rows; ++i) {
+    Ops::store(C + i * ldc, c[i][0]);
+    Ops::store(C + i * ldc + W, c[i][1]);
+  }
+}
+
+// 4x8 int32 block from int16 pairs with pmaddwd, which multiplies the pairs
+// and adds the two products of each 32-bit lane.
+void int16Kernel4x8(int groups, const void *A, const void *B, std::int32_t *C,
+                    long ldc, bool accumulate) {
+  const std::int16_t *a = static_cast<const std::int16_t *>(A);
+  const std::int16_t *b = static_cast<const std::int16_t *>(B);
+  __m128i c[4][2];
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    if (accumulate) {
+      c[i][0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(C + i * ldc));
+      c[i][1] =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(C + i * ldc + 4));
+    } else {
+      c[i][0] = _mm_setzero_si128();
+      c[i][1] = _mm_setzero_si128();
+    }
+  }
+
+  for (int g = 0; g < groups; ++g, a += 2 * 4, b += 2 * 8) {
+    const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    const __m128i b1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 8));
+#pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i) {
+      std::int32_t pair;
+      std::memcpy(&pair, a + 2 * i, sizeof pair);
+      const __m128i ai = _mm_set1_epi32(pair);
+      c[i][0] = _mm_add_epi32(c[i][0], _mm_madd_epi16(ai, b0));
+      c[i][1] = _mm_add_epi32(c[i][1], _mm_madd_epi16(ai, b1));
+    }
+  }
+
+#pragma GCC unroll 4
+  for (int i = 0; i < 4; ++i) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + i * ldc), c[i][0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + i * ldc + 4), c[i][1]);
+  }
+}
+
+// Row of a sparse-times-dense product: 16 columns at a time in four xmm
+// accumulators, then one register at a time and a scalar tail.
+void sparseRow(int count, const int *indices, const int *values,
+               const int *B, long ldb, int n, int *C) {
+  int j = 0;
+  for (; j + 16 <= n; j += 16) {
+    __m128i c[4];
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r)
+      c[r] = _mm_setzero_si128();
+    for (int p = 0; p < count; ++p) {
+      const __m128i a = _mm_set1_epi32(values[p]);
+      const int *b = B + indices[p] * ldb + j;
+#pragma GCC unroll 4
+      for (int r = 0; r < 4; ++r) {
+        const __m128i row =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + r * 4));
+        c[r] = _mm_add_epi32(c[r], _mm_mullo_epi32(a, row));
+      }
+    }
+#pragma GCC unroll 4
+    for (int r = 0; r < 4; ++r)
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(C + j + r * 4), c[r]);
+  }
+  for (; j + 4 <= n; j += 4) {
+    __m128i c = _mm_setzero_si128();
+    for (int p = 0; p < count; ++p) {
+      const int *b = B + indices[p] * ldb + j;
+      const __m128i a = _mm_set1_epi32(values[p]);
+      const __m128i row =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+      c = _mm_add_epi32(c, _mm_mullo_epi32(a, row));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(C + j), c);
+  }
+  for (; j < n; ++j) {
+    unsigned sum = 0;
+    for (int p = 0; p < count; ++p)
+      sum += static_cast<unsigned>(values[p]) *
+             static_cast<unsigned>(B[indices[p] * ldb + j]);
+    C[j] = static_cast<int>(sum);
+  }
+}
+
+// Hash row kernel, the eight accumulators in four xmm registers, products
+// with pmuludq. The 64-bit products of the scramble are put together from
+// two 32-bit ones, which gives the low 64 bits of acc * hashPrime32.
+void hashRow(const void *row, std::size_t bytes, std::uint64_t *acc) {
+  const auto load = [](const void *p, int r) {
+    return _mm_loadu_si128(static_cast<const __m128i *>(p) + r);
+  };
+  __m128i secret[4], a[4];
+  for (int r = 0; r < 4; ++r) {
+    secret[r] = load(hashSecret, r);
+    a[r] = load(acc, r);
+  }
+  hashStripes(
+      static_cast<const char *>(row), bytes,
+      [&](const char *stripe, std::uint64_t s) {
+        const __m128i offset =
+            _mm_set1_epi64x(static_cast<long long>(s * hashStripeStep));
+        for (int r = 0; r < 4; ++r) {
+          const __m128i d = load(stripe, r);
+          const __m128i x = _mm_xor_si128(d, _mm_add_epi64(secret[r], offset));
+          const __m128i product = _mm_mul_epu32(x, _mm_srli_epi64(x, 32));
+          a[r] = _mm_add_epi64(a[r], _mm_add_epi64(d, product));
+        }
+      },
+      [&] {
+        const __m128i prime = _mm_set1_epi64x(hashPrime32);
+        for (int r = 0; r < 4; ++r) {
+          const __m128i x = _mm_xor_si128(
+              _mm_xor_si128(a[r], _mm_srli_epi64(a[r], 47)), secret[r]);
+          const __m128i high = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+          a[r] = _mm_add_epi64(_mm_mul_epu32(x, prime),
+                               _mm_slli_epi64(high, 32));
+        }
+      });
+  for (int r = 0; r < 4; ++r)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + r, a[r]);
+}
+
+// Philox operations on four counters. pmuludq multiplies the even lanes;
+// the odd ones are shifted down for a second multiply.
+struct PhiloxOps {
+  using Reg = __m128i;
+  static constexpr int lanes = 4;
+  static Reg load(const std::uint32_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  }
+  static Reg set1(std::uint32_t x) {
+    return _mm_set1_epi32(static_cast<int>(x));
+  }
+  static Reg xor3(Reg a, Reg b, Reg c) {
+    return _mm_xor_si128(_mm_xor_si128(a, b), c);
+  }
+  static void multiply(Reg a, std::uint32_t m, Reg &hi, Reg &lo) {
+    const Reg factor = set1(m);
+    const Reg even = _mm_mul_epu32(a, factor);
+    const Reg odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), factor);
+    hi = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+    lo = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+  }
+  static void store(std::uint32_t *out, Reg c0, Reg c1, Reg c2, Reg c3) {
+    const Reg t0 = _mm_unpacklo_epi32(c0, c1), t1 = _mm_unpackhi_epi32(c0, c1);
+    const Reg t2 = _mm_unpacklo_epi32(c2, c3), t3 = _mm_unpackhi_epi32(c2, c3);
+    __m128i *o = reinterpret_cast<__m128i *>(out);
+    _mm_storeu_si128(o, _mm_unpacklo_epi64(t0, t2));
+    _mm_storeu_si128(o + 1, _mm_unpackhi_epi64(t0, t2));
+    _mm_storeu_si128(o + 2, _mm_unpacklo_epi64(t1, t3));
+    _mm_storeu_si128(o + 3, _mm_unpackhi_epi64(t1, t3));
+  }
+};
+
+} // namespace
+
+const MicroKernel &sse41MicroKernel() {
+  static const MicroKernel kernel{SimdIsa::Sse41, MR, NR, kernel4x8};
+  return kernel;
+}
+
+const TypedMicroKernel<float> &sse41FloatMicroKernel() {
+  static const TypedMicroKernel<float> kernel{
+      SimdIsa::Sse41, 4, 8, floatingKernel<FloatOps, float, 4>};
+  return kernel;
+}
+
+const TypedMicroKernel<double> &sse41DoubleMicroKernel() {
+  static const TypedMicroKernel<double> kernel{
+      SimdIsa::Sse41, 4, 4, floatingKernel<DoubleOps, double, 4>};
+  return kernel;
+}
+
+const WideMicroKernel &sse41WideMicroKernel() {
+  static const WideMicroKernel kernel{SimdIsa::Sse41, 4, 4, wideKernel4x4};
+  return kernel;
+}
+
+const SparseRowKernel &sse41SparseRowKernel() {
+  static const SparseRowKernel kernel{SimdIsa::Sse41, sparseRow};
+  return kernel;
+}
+
+const BatchKernel &sse41BatchKernel() {
+  static const BatchKernel kernel{SimdIsa::Sse41, 4,
+                                  interleavedProducts<4>};
+  return kernel;
+}
+
+const QuantizedKernel &sse41Int16Kernel() {
+  static const QuantizedKernel kernel{SimdIsa::Sse41, 4, 8, 2, int16Kernel4x8};
+  return kernel;
+}
+
+const BinaryKernel &sse41BinaryKernel() {
+  static const BinaryKernel kernel{SimdIsa::Sse41, popcountProducts};
+  return kernel;
+}
+
+const PhiloxKernel &sse41PhiloxKernel() {
+  static const PhiloxKernel kernel{SimdIsa::Sse41, philoxGroups<PhiloxOps>};
+  return kernel;
+}
+
+const HashRowKernel &sse41HashRowKernel() {
+  static const HashRowKernel kernel{SimdIsa::Sse41, hashRow};
+  return kernel;
+}
+
+// Two xmm registers of partial sums per row of gemv.
+template <typename T> const VectorKernel<T> &sse41VectorKernel() {
+  static const VectorKernel<T> kernel{SimdIsa::Sse41,
+                                      gemv<T, 2 * 16 / sizeof(T)>, gevm<T>,
+                                      outer<T>};
+  return kernel;
+}
+
+template const VectorKernel<int> &sse41VectorKernel();
+template const VectorKernel<float> &sse41VectorKernel();
+template const VectorKernel<double> &sse41VectorKernel();
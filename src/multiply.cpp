@@ -0,0 +1,451 @@
+#include "matrix_multiplication.h"
+#include "engines.h"
+#include "microkernel.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+template <typename T>
+void checkDimensions(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                     MatrixView<T> C) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument("multiply: dimension mismatch");
+}
+
+// Below this many multiply-adds the operands fit in L1 and blocking and
+// micro-kernel calls only add loop overhead.
+constexpr long tiledThreshold = 32L * 32 * 32;
+
+Engine selectClassicalEngine(int m, int k, int n) {
+  const long work = static_cast<long>(m) * k * n;
+  if (work < tiledThreshold)
+    return Engine::Reference;
+  if (work < gemmParallelThreshold || threadCount() == 1)
+    return Engine::Simd;
+  return Engine::Parallel;
+}
+
+template <typename T>
+Engine selectClassicalEngine(ConstMatrixView<T> A, ConstMatrixView<T> B) {
+  return selectClassicalEngine(A.rows(), A.cols(), B.cols());
+}
+
+// Strassen is only picked for int, whose arithmetic is exact; with floating
+// point it changes the rounding errors, so it has to be asked for.
+template <typename T>
+Engine selectEngine(ConstMatrixView<T> A, ConstMatrixView<T> B) {
+  if (!std::is_same_v<T, int>)
+    return selectClassicalEngine(A, B);
+
+  // One Winograd step only pays off when the half-size products are still
+  // above the crossover.
+  const int smallest = std::min({A.rows(), A.cols(), B.cols()});
+  if (smallest >= 2 * strassenCrossover())
+    return Engine::Strassen;
+  return selectClassicalEngine(A, B);
+}
+
+template <typename T>
+void run(Engine engine, ConstMatrixView<T> A, ConstMatrixView<T> B,
+         MatrixView<T> C);
+
+// Leaves of the Strassen recursion use the best classical engine for their
+// own shape.
+template <typename T>
+void runClassical(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                  MatrixView<T> C) {
+  run(selectClassicalEngine(A, B), A, B, C);
+}
+
+// Small int sizes first go to the unrolled kernels of fixed_matrix.h.
+bool runFixedSize(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                  MatrixView<int> C) {
+  return multiplyFixedSize(A, B, C);
+}
+
+template <typename T>
+bool runFixedSize(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<T>) {
+  return false;
+}
+
+// With structure detection on, int operands are analysed next
+// (structure.h).
+bool runStructured(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                   MatrixView<int> C) {
+  return multiplyIfStructured(A, B, C);
+}
+
+template <typename T>
+bool runStructured(ConstMatrixView<T>, ConstMatrixView<T>, MatrixView<T>) {
+  return false;
+}
+
+template <typename T>
+void run(Engine engine, ConstMatrixView<T> A, ConstMatrixView<T> B,
+         MatrixView<T> C) {
+  if (engine != Engine::Auto)
+    MATMUL_ENGINE(engine);
+  switch (engine) {
+  case Engine::Auto:
+    if (runFixedSize(A, B, C) || runStructured(A, B, C) ||
+        multiplyIfVector(A, B, C))
+      break;
+    if (multiplyIfSparse(A, B, C))
+      MATMUL_ENGINE(Engine::Sparse);
+    else
+      run(selectEngine(A, B), A, B, C);
+    break;
+  case Engine::Reference:
+    multiplyReference(A, B, C);
+    break;
+  case Engine::Tiled:
+    multiplyTiled(A, B, C, tileSizes());
+    break;
+  case Engine::Simd:
+    multiplySimd(A, B, C, tileSizes());
+    break;
+  case Engine::Parallel:
+    multiplyParallel(A, B, C, tileSizes(), *threadPool());
+    break;
+  case Engine::Strassen:
+    multiplyStrassen<T>(A, B, C, runClassical<T>);
+    break;
+  case Engine::Sparse:
+    multiplySparse(A, B, C);
+    break;
+  }
+}
+
+template <typename T>
+void multiplyChecked(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                     MatrixView<T> C, Engine engine) {
+  checkDimensions(A, B, C);
+  if (C.empty())
+    return;
+
+  MATMUL_CALL(engine, profileTypeName<T>(), A.rows(), A.cols(), B.cols());
+  run(engine, A, B, C);
+}
+
+// C = op(A) * op(B). Reference, Simd and Parallel read the transposed
+// operands in place; the other engines get transposed copies.
+template <typename T>
+void multiplyTransposed(ConstMatrixView<T> A, bool transA,
+                        ConstMatrixView<T> B, bool transB, MatrixView<T> C,
+                        Engine engine) {
+  const int m = transA ? A.cols() : A.rows();
+  const int k = transA ? A.rows() : A.cols();
+  const int n = transB ? B.rows() : B.cols();
+  if ((transB ? B.cols() : B.rows()) != k || C.rows() != m || C.cols() != n)
+    throw std::invalid_argument("multiply: dimension mismatch");
+  if (!transA && !transB) {
+    multiplyChecked(A, B, C, engine);
+    return;
+  }
+  if (C.empty())
+    return;
+
+  MATMUL_CALL(engine, profileTypeName<T>(), m, k, n);
+  if (engine == Engine::Auto)
+    engine = selectClassicalEngine(m, k, n);
+  SimdOptions<T> options;
+  options.transA = transA;
+  options.transB = transB;
+  switch (engine) {
+  case Engine::Reference:
+    MATMUL_ENGINE(Engine::Reference);
+    multiplyReferenceTransposed(A, transA, B, transB, C);
+    break;
+  case Engine::Simd:
+    MATMUL_ENGINE(Engine::Simd);
+    multiplySimd(A, B, C, tileSizes(), options);
+    break;
+  case Engine::Parallel:
+    MATMUL_ENGINE(Engine::Parallel);
+    multiplyParallel(A, B, C, tileSizes(), *threadPool(), options);
+    break;
+  default: {
+    const Matrix<T> a = transA ? transpose(Matrix<T>(A)) : Matrix<T>();
+    const Matrix<T> b = transB ? transpose(Matrix<T>(B)) : Matrix<T>();
+    run(engine, transA ? a.view() : A, transB ? b.view() : B, C);
+    break;
+  }
+  }
+}
+
+bool isStructured(ConstMatrixView<int> A, ConstMatrixView<int> B) {
+  return isStructuredProduct(A, B);
+}
+
+template <typename T>
+bool isStructured(ConstMatrixView<T>, ConstMatrixView<T>) {
+  return false;
+}
+
+} // namespace
+
+template <typename T> void prepareProduct(PreparedProduct<T> &product) {
+  const ConstMatrixView<T> A = product.A, B = product.B;
+  checkDimensions(A, B, product.C);
+  if (product.C.empty())
+    return;
+
+  // Auto stays unresolved when it would take the fixed-size, structured,
+  // vector or sparse route, which have nothing to pack.
+  product.tiles = tileSizes();
+  if (product.engine == Engine::Auto &&
+      !(std::is_same_v<T, int> &&
+        hasFixedSizeKernel(A.rows(), A.cols(), B.cols())) &&
+      !isStructured(A, B) && !isVectorProduct(A.rows(), A.cols(), B.cols()) &&
+      !isSparseProduct(A, B))
+    product.engine = selectEngine(A, B);
+  if (product.engine != Engine::Simd && product.engine != Engine::Parallel)
+    return;
+  const int nr = microKernel<T>().nr;
+  const PackedB<T> *packed = product.packedB.get();
+  if (!packed || packed->rows != B.rows() || packed->cols != B.cols() ||
+      packed->kc != product.tiles.kc || packed->nr != nr)
+    product.packedB = std::make_shared<const PackedB<T>>(
+        packWholeB(B, product.tiles.kc, nr));
+}
+
+template <typename T> void runProduct(const PreparedProduct<T> &product) {
+  if (product.C.empty())
+    return;
+  MATMUL_CALL(product.engine, profileTypeName<T>(), product.A.rows(),
+              product.A.cols(), product.B.cols());
+  SimdOptions<T> options;
+  options.packedB = product.packedB.get();
+  switch (product.engine) {
+  case Engine::Simd:
+    MATMUL_ENGINE(Engine::Simd);
+    multiplySimd(product.A, product.B, product.C, product.tiles, options);
+    break;
+  case Engine::Parallel:
+    MATMUL_ENGINE(Engine::Parallel);
+    multiplyParallel(product.A, product.B, product.C, product.tiles,
+                     *threadPool(), options);
+    break;
+  default:
+    run(product.engine, product.A, product.B, product.C);
+    break;
+  }
+}
+
+template <typename T>
+void multiplyFused(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+                   T alpha, T beta, ConstMatrixView<T> D) {
+  if (C.empty())
+    return;
+  MATMUL_CALL(Engine::Auto, profileTypeName<T>(), A.rows(), A.cols(),
+              B.cols());
+  SimdOptions<T> options;
+  options.alpha = alpha;
+  options.beta = beta;
+  options.addend = D;
+  switch (selectClassicalEngine(A, B)) {
+  case Engine::Parallel:
+    MATMUL_ENGINE(Engine::Parallel);
+    multiplyParallel(A, B, C, tileSizes(), *threadPool(), options);
+    return;
+  case Engine::Simd:
+    MATMUL_ENGINE(Engine::Simd);
+    multiplySimd(A, B, C, tileSizes(), options);
+    return;
+  default:
+    break;
+  }
+
+  MATMUL_ENGINE(Engine::Reference);
+  using U = ArithmeticType<T>;
+  const U a = static_cast<U>(alpha), b = static_cast<U>(beta);
+  for (int i = 0; i < A.rows(); ++i) {
+    for (int j = 0; j < B.cols(); ++j) {
+      U sum = 0;
+      for (int k = 0; k < A.cols(); ++k)
+        sum += static_cast<U>(A(i, k)) * static_cast<U>(B(k, j));
+      sum *= a;
+      if (b != U(0))
+        sum += b * static_cast<U>(D(i, j));
+      C(i, j) = static_cast<T>(sum);
+    }
+  }
+}
+
+template void multiplyFused(ConstMatrixView<int>, ConstMatrixView<int>,
+                            MatrixView<int>, int, int, ConstMatrixView<int>);
+template void multiplyFused(ConstMatrixView<float>, ConstMatrixView<float>,
+                            MatrixView<float>, float, float,
+                            ConstMatrixView<float>);
+template void multiplyFused(ConstMatrixView<double>, ConstMatrixView<double>,
+                            MatrixView<double>, double, double,
+                            ConstMatrixView<double>);
+
+template void prepareProduct(PreparedProduct<int> &);
+template void prepareProduct(PreparedProduct<float> &);
+template void prepareProduct(PreparedProduct<double> &);
+template void runProduct(const PreparedProduct<int> &);
+template void runProduct(const PreparedProduct<float> &);
+template void runProduct(const PreparedProduct<double> &);
+
+// Same triple loop as multiplyMatricesWithoutErrors, on contiguous views.
+// For int, accumulates in unsigned arithmetic so that overflow wraps instead
+// of being undefined behaviour.
+template <typename T>
+void multiplyReference(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                       MatrixView<T> C) {
+  using U = ArithmeticType<T>;
+  for (int i = 0; i < A.rows(); ++i) {
+    const T *a = A.row(i);
+    T *c = C.row(i);
+    for (int j = 0; j < B.cols(); ++j) {
+      U sum = 0;
+      for (int k = 0; k < A.cols(); ++k)
+        sum += static_cast<U>(a[k]) * static_cast<U>(B(k, j));
+      c[j] = static_cast<T>(sum);
+    }
+  }
+}
+
+template void multiplyReference(ConstMatrixView<int>, ConstMatrixView<int>,
+                                MatrixView<int>);
+template void multiplyReference(ConstMatrixView<float>, ConstMatrixView<float>,
+                                MatrixView<float>);
+template void multiplyReference(ConstMatrixView<double>,
+                                ConstMatrixView<double>, MatrixView<double>);
+
+template <typename T>
+void multiplyReferenceTransposed(ConstMatrixView<T> A, bool transA,
+                                 ConstMatrixView<T> B, bool transB,
+                                 MatrixView<T> C) {
+  using U = ArithmeticType<T>;
+  const int m = C.rows(), n = C.cols();
+  const int K = transA ? A.rows() : A.cols();
+  if (transB) {
+    for (int i = 0; i < m; ++i) {
+      for (int j = 0; j < n; ++j) {
+        const T *b = B.row(j);
+        U sum = 0;
+        if (transA)
+          for (int k = 0; k < K; ++k)
+            sum += static_cast<U>(A(k, i)) * static_cast<U>(b[k]);
+        else
+          for (int k = 0; k < K; ++k)
+            sum += static_cast<U>(A(i, k)) * static_cast<U>(b[k]);
+        C(i, j) = static_cast<T>(sum);
+      }
+    }
+    return;
+  }
+
+  // A^T * B: row k of B, scaled by A(k, i), is added to row i of C.
+  for (int i = 0; i < m; ++i) {
+    T *c = C.row(i);
+    std::fill(c, c + n, T());
+    for (int k = 0; k < K; ++k) {
+      const U a = static_cast<U>(A(k, i));
+      const T *b = B.row(k);
+      for (int j = 0; j < n; ++j)
+        c[j] = static_cast<T>(static_cast<U>(c[j]) + a * static_cast<U>(b[j]));
+    }
+  }
+}
+
+template void multiplyReferenceTransposed(ConstMatrixView<int>, bool,
+                                          ConstMatrixView<int>, bool,
+                                          MatrixView<int>);
+template void multiplyReferenceTransposed(ConstMatrixView<float>, bool,
+                                          ConstMatrixView<float>, bool,
+                                          MatrixView<float>);
+template void multiplyReferenceTransposed(ConstMatrixView<double>, bool,
+                                          ConstMatrixView<double>, bool,
+                                          MatrixView<double>);
+
+void multiply(ConstMatrixView<int> A, ConstMatrixView<int> B, MatrixView<int> C,
+              Engine engine) {
+  multiplyChecked(A, B, C, engine);
+}
+
+void multiply(ConstMatrixView<float> A, ConstMatrixView<float> B,
+              MatrixView<float> C, Engine engine) {
+  multiplyChecked(A, B, C, engine);
+}
+
+void multiply(ConstMatrixView<double> A, ConstMatrixView<double> B,
+              MatrixView<double> C, Engine engine) {
+  multiplyChecked(A, B, C, engine);
+}
+
+void multiply(ConstMatrixView<int> A, Transpose transA, ConstMatrixView<int> B,
+              Transpose transB, MatrixView<int> C, Engine engine) {
+  multiplyTransposed(A, transA == Transpose::Yes, B, transB == Transpose::Yes,
+                     C, engine);
+}
+
+void multiply(ConstMatrixView<float> A, Transpose transA,
+              ConstMatrixView<float> B, Transpose transB, MatrixView<float> C,
+              Engine engine) {
+  multiplyTransposed(A, transA == Transpose::Yes, B, transB == Transpose::Yes,
+                     C, engine);
+}
+
+void multiply(ConstMatrixView<double> A, Transpose transA,
+              ConstMatrixView<double> B, Transpose transB,
+              MatrixView<double> C, Engine engine) {
+  multiplyTransposed(A, transA == Transpose::Yes, B, transB == Transpose::Yes,
+                     C, engine);
+}
+
+Matrix<int> multiply(const Matrix<int> &A, const Matrix<int> &B,
+                     Engine engine) {
+  Matrix<int> C(A.rows(), B.cols());
+  multiply(A.view(), B.view(), C.view(), engine);
+  return C;
+}
+
+Matrix<float> multiply(const Matrix<float> &A, const Matrix<float> &B,
+                       Engine engine) {
+  Matrix<float> C(A.rows(), B.cols());
+  multiply(A.view(), B.view(), C.view(), engine);
+  return C;
+}
+
+Matrix<double> multiply(const Matrix<double> &A, const Matrix<double> &B,
+                        Engine engine) {
+  Matrix<double> C(A.rows(), B.cols());
+  multiply(A.view(), B.view(), C.view(), engine);
+  return C;
+}
+
+void multiply(const std::vector<std::vector<int>> &A,
+              const std::vector<std::vector<int>> &B,
+              std::vector<std::vector<int>> &C, int rowsA, int colsA, int colsB,
+              Engine engine) {
+  if (static_cast<int>(A.size()) != rowsA ||
+      static_cast<int>(B.size()) != colsA)
+    throw std::invalid_argument("multiply: dimension mismatch");
+
+  // The column counts come from the arguments, not from the first row, so
+  // that products with an empty operand keep their shape.
+  const auto copy = [](const std::vector<std::vector<int>> &nested,
+                       Matrix<int> &M) {
+    for (int i = 0; i < M.rows(); ++i) {
+      if (static_cast<int>(nested[i].size()) != M.cols())
+        throw std::invalid_argument("multiply: dimension mismatch");
+      std::copy(nested[i].begin(), nested[i].end(), M.row(i));
+    }
+  };
+  Matrix<int> a(rowsA, colsA), b(colsA, colsB);
+  copy(A, a);
+  copy(B, b);
+
+  Matrix<int> c = multiply(a, b, engine);
+  C.resize(rowsA);
+  for (int i = 0; i < rowsA; ++i)
+    C[i].assign(c.row(i), c.row(i) + colsB);
+}
@@ -0,0 +1,217 @@
+#include "matrix_multiplication.h"
+#include "engines.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// Product waiting in the submission queue.
+class Job {
+public:
+  explicit Job(MultiplyCallback done) : done_(std::move(done)) {}
+  virtual ~Job() = default;
+
+  // Stage 1, on the preparing thread. Errors are kept for stage 2.
+  void prepare() {
+    try {
+      prepareProduct();
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+  }
+
+  // Stage 2, on the dispatcher thread.
+  void run() {
+    if (!error_) {
+      try {
+        runProduct();
+      } catch (...) {
+        error_ = std::current_exception();
+      }
+    }
+    done_(error_);
+  }
+
+private:
+  virtual void prepareProduct() = 0;
+  virtual void runProduct() = 0;
+
+  MultiplyCallback done_;
+  std::exception_ptr error_;
+};
+
+template <typename T> class TypedJob : public Job {
+public:
+  TypedJob(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+           Engine engine, MultiplyCallback done)
+      : Job(std::move(done)) {
+    product_.A = A;
+    product_.B = B;
+    product_.C = C;
+    product_.engine = engine;
+  }
+
+private:
+  void prepareProduct() override { ::prepareProduct(product_); }
+  void runProduct() override {
+    ::runProduct(product_);
+    // The packed copy of B is not needed any more.
+    product_.packedB.reset();
+  }
+
+  PreparedProduct<T> product_;
+};
+
+// Two-stage pipeline: the preparing thread takes jobs from `submitted` and
+// moves them to `prepared`, staying at most one job ahead of the dispatcher,
+// which runs them. Both threads live as long as the queue.
+class SubmissionQueue {
+public:
+  SubmissionQueue() {
+    // The pool and the tile sizes are created before the queue, so that they
+    // are destroyed after it at exit.
+    threadPool();
+    tileSizes();
+    preparer_ = std::thread([this] { prepareLoop(); });
+    dispatcher_ = std::thread([this] { dispatchLoop(); });
+  }
+
+  // Finishes the jobs still queued.
+  ~SubmissionQueue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    changed_.notify_all();
+    preparer_.join();
+    dispatcher_.join();
+  }
+
+  void submit(std::unique_ptr<Job> job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      submitted_.push_back(std::move(job));
+    }
+    changed_.notify_all();
+  }
+
+private:
+  void prepareLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      // At exit, a job still running may submit more from its callback.
+      changed_.wait(lock, [&] {
+        return (!submitted_.empty() && prepared_.empty()) ||
+               (stopping_ && submitted_.empty() && prepared_.empty() &&
+                !running_);
+      });
+      if (submitted_.empty())
+        break;
+      std::unique_ptr<Job> job = std::move(submitted_.front());
+      submitted_.pop_front();
+      ++preparing_;
+      lock.unlock();
+      job->prepare();
+      lock.lock();
+      --preparing_;
+      prepared_.push_back(std::move(job));
+      changed_.notify_all();
+    }
+  }
+
+  void dispatchLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      changed_.wait(lock, [&] {
+        return !prepared_.empty() ||
+               (stopping_ && submitted_.empty() && preparing_ == 0);
+      });
+      if (prepared_.empty())
+        break;
+      std::unique_ptr<Job> job = std::move(prepared_.front());
+      prepared_.pop_front();
+      // Frees the preparing thread to start on the next job.
+      running_ = true;
+      changed_.notify_all();
+      lock.unlock();
+      job->run();
+      job.reset();
+      lock.lock();
+      running_ = false;
+      changed_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<std::unique_ptr<Job>> submitted_;
+  std::deque<std::unique_ptr<Job>> prepared_;
+  int preparing_ = 0;
+  bool running_ = false;
+  bool stopping_ = false;
+  std::thread preparer_;
+  std::thread dispatcher_;
+};
+
+SubmissionQueue &submissionQueue() {
+  static SubmissionQueue queue;
+  return queue;
+}
+
+template <typename T>
+void submit(ConstMatrixView<T> A, ConstMatrixView<T> B, MatrixView<T> C,
+            MultiplyCallback done, Engine engine) {
+  submissionQueue().submit(
+      std::make_unique<TypedJob<T>>(A, B, C, engine, std::move(done)));
+}
+
+template <typename T>
+std::future<void> submitWithFuture(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                                   MatrixView<T> C, Engine engine) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  submit(A, B, C,
+         [promise](std::exception_ptr error) {
+           if (error)
+             promise->set_exception(error);
+           else
+             promise->set_value();
+         },
+         engine);
+  return future;
+}
+
+} // namespace
+
+std::future<void> multiplyAsync(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                                MatrixView<int> C, Engine engine) {
+  return submitWithFuture(A, B, C, engine);
+}
+std::future<void> multiplyAsync(ConstMatrixView<float> A,
+                                ConstMatrixView<float> B, MatrixView<float> C,
+                                Engine engine) {
+  return submitWithFuture(A, B, C, engine);
+}
+std::future<void> multiplyAsync(ConstMatrixView<double> A,
+                                ConstMatrixView<double> B,
+                                MatrixView<double> C, Engine engine) {
+  return submitWithFuture(A, B, C, engine);
+}
+
+void multiplyAsync(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                   MatrixView<int> C, MultiplyCallback done, Engine engine) {
+  submit(A, B, C, std::move(done), engine);
+}
+void multiplyAsync(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                   MatrixView<float> C, MultiplyCallback done, Engine engine) {
+  submit(A, B, C, std::move(done), engine);
+}
+void multiplyAsync(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                   MatrixView<double> C, MultiplyCallback done, Engine engine) {
+  submit(A, B, C, std::move(done), engine);
+}
@@ -0,0 +1,22 @@
+#ifndef NUMA_MEMORY_H
+#define NUMA_MEMORY_H
+
+#include <cstddef>
+#include <vector>
+
+// Page placement for the NUMA policies of numa_policy.h, by node id. Pages
+// are migrated with move_pages, which sets no memory policy on the range:
+// the buffer is the caller's, and later allocations in it must not be tied
+// to a node. Best effort: the range is shrunk to the whole pages it covers,
+// pages not touched yet are left to first touch, and nothing happens without
+// libnuma or when the kernel refuses (the pages then stay where they are,
+// which is only slower).
+
+// Moves the pages to `node`.
+void moveToNode(const void *data, std::size_t bytes, int node);
+
+// Spreads the pages round robin over `nodes`.
+void interleaveOverNodes(const void *data, std::size_t bytes,
+                         const std::vector<int> &nodes);
+
+#endif // NUMA_MEMORY_H
@@ -0,0 +1,131 @@
+#include "numa_policy.h"
+#include "numa_memory.h"
+
+#include <cstdint>
+#include <sched.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#ifdef MATMUL_HAVE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+namespace {
+
+// CPUs of the process affinity mask, in increasing order.
+std::vector<int> allowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &allowed))
+        cpus.push_back(cpu);
+  if (cpus.empty())
+    cpus.push_back(0);
+  return cpus;
+}
+
+#ifdef MATMUL_HAVE_LIBNUMA
+// Migrates page p of the range to nodes[p % nodes.size()]. move_pages leaves
+// the memory policy of the range alone, so the caller's buffer keeps
+// allocating and faulting as it did before.
+void placePages(const void *data, std::size_t bytes,
+                const std::vector<int> &nodes) {
+  if (!numaAvailable() || nodes.empty())
+    return;
+  const std::uintptr_t page =
+      static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+  const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(data);
+  const std::uintptr_t begin = (start + page - 1) / page * page;
+  const std::uintptr_t end = (start + bytes) / page * page;
+  if (begin >= end)
+    return;
+
+  const std::size_t count = (end - begin) / page;
+  std::vector<void *> pages(count);
+  std::vector<int> targets(count), status(count);
+  for (std::size_t p = 0; p < count; ++p) {
+    pages[p] = reinterpret_cast<void *>(begin + p * page);
+    targets[p] = nodes[p % nodes.size()];
+  }
+  numa_move_pages(0, count, pages.data(), targets.data(), status.data(),
+                  MPOL_MF_MOVE);
+}
+#endif
+
+} // namespace
+
+NumaTopology NumaTopology::detect() {
+  const std::vector<int> allowed = allowedCpus();
+  NumaTopology topology;
+#ifdef MATMUL_HAVE_LIBNUMA
+  if (numaAvailable()) {
+    bitmask *cpus = numa_allocate_cpumask();
+    for (int id = 0; id <= numa_max_node(); ++id) {
+      if (!numa_bitmask_isbitset(numa_all_nodes_ptr, id) ||
+          numa_node_to_cpus(id, cpus) != 0)
+        continue;
+      NumaNode node;
+      node.id = id;
+      for (int cpu : allowed)
+        if (numa_bitmask_isbitset(cpus, cpu))
+          node.cpus.push_back(cpu);
+      // Memory-only nodes run no workers.
+      if (!node.cpus.empty())
+        topology.nodes.push_back(node);
+    }
+    numa_free_cpumask(cpus);
+  }
+#endif
+  if (topology.nodes.empty())
+    topology.nodes.push_back({0, allowed});
+  return topology;
+}
+
+NumaTopology NumaTopology::makeSynthetic(int count) {
+  if (count <= 0)
+    throw std::invalid_argument("makeSynthetic: node count must be positive");
+  const std::vector<int> cpus = allowedCpus();
+  const int size = static_cast<int>(cpus.size());
+  NumaTopology topology;
+  topology.synthetic = true;
+  for (int id = 0; id < count; ++id) {
+    NumaNode node;
+    node.id = id;
+    const long first = static_cast<long>(size) * id / count;
+    const long last = static_cast<long>(size) * (id + 1) / count;
+    if (count <= size)
+      node.cpus.assign(cpus.begin() + first, cpus.begin() + last);
+    else
+      node.cpus.push_back(cpus[id % size]);
+    topology.nodes.push_back(node);
+  }
+  return topology;
+}
+
+bool numaAvailable() {
+#ifdef MATMUL_HAVE_LIBNUMA
+  static const bool available = numa_available() >= 0;
+  return available;
+#else
+  return false;
+#endif
+}
+
+void moveToNode(const void *data, std::size_t bytes, int node) {
+#ifdef MATMUL_HAVE_LIBNUMA
+  placePages(data, bytes, {node});
+#else
+  (void)data, (void)bytes, (void)node;
+#endif
+}
+
+void interleaveOverNodes(const void *data, std::size_t bytes,
+                         const std::vector<int> &nodes) {
+#ifdef MATMUL_HAVE_LIBNUMA
+  placePages(data, bytes, nodes);
+#else
+  (void)data, (void)bytes, (void)nodes;
+#endif
+}
@@ -0,0 +1,501 @@
+#include "out_of_core.h"
+#include "matrix_multiplication.h"
+#include "engines.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+const char magic[8] = {'M', 'A', 'T', 'M', 'U', 'L', '0', '1'};
+constexpr std::uint32_t formatVersion = 1;
+
+// The tiles start one page in, so that they are page-aligned.
+constexpr std::size_t headerBytes = 4096;
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t elementType;
+  std::uint64_t rows;
+  std::uint64_t cols;
+  std::uint32_t tileRows;
+  std::uint32_t tileCols;
+};
+
+template <typename T> constexpr ElementType elementTypeOf();
+template <> constexpr ElementType elementTypeOf<int>() {
+  return ElementType::Int32;
+}
+template <> constexpr ElementType elementTypeOf<float>() {
+  return ElementType::Float32;
+}
+template <> constexpr ElementType elementTypeOf<double>() {
+  return ElementType::Float64;
+}
+
+[[noreturn]] void throwSystemError(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(),
+                          "MappedMatrix: " + what);
+}
+
+std::size_t tileBytes(std::size_t tileRows, std::size_t tileCols,
+                      std::size_t elementBytes) {
+  return tileRows * tileCols * elementBytes;
+}
+
+// Size of the file `header` describes, in `bytes`. Returns false if it does
+// not fit in a size_t, which a corrupt header can ask for.
+bool fileBytes(const FileHeader &header, std::size_t elementBytes,
+               std::size_t &bytes) {
+  const std::size_t tileRowCount =
+      (header.rows + header.tileRows - 1) / header.tileRows;
+  const std::size_t tileColCount =
+      (header.cols + header.tileCols - 1) / header.tileCols;
+  std::size_t tiles, tile;
+  return !__builtin_mul_overflow(tileRowCount, tileColCount, &tiles) &&
+         !__builtin_mul_overflow(static_cast<std::size_t>(header.tileRows),
+                                 static_cast<std::size_t>(header.tileCols),
+                                 &tile) &&
+         !__builtin_mul_overflow(tile, elementBytes, &tile) &&
+         !__builtin_mul_overflow(tiles, tile, &bytes) &&
+         !__builtin_add_overflow(bytes, headerBytes, &bytes);
+}
+
+void checkBlock(int row, int col, int rows, int cols, int matrixRows,
+                int matrixCols) {
+  if (row < 0 || col < 0 || rows < 0 || cols < 0 || row > matrixRows - rows ||
+      col > matrixCols - cols)
+    throw std::invalid_argument("MappedMatrix: block out of range");
+}
+
+} // namespace
+
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::create(const std::string &path, int rows,
+                                        int cols, int tileRows, int tileCols) {
+  if (rows < 0 || cols < 0 || tileRows < 1 || tileCols < 1)
+    throw std::invalid_argument("MappedMatrix: invalid dimensions");
+
+  FileHeader header = {};
+  std::memcpy(header.magic, magic, sizeof magic);
+  header.version = formatVersion;
+  header.elementType = static_cast<std::uint32_t>(elementTypeOf<T>());
+  header.rows = static_cast<std::uint64_t>(rows);
+  header.cols = static_cast<std::uint64_t>(cols);
+  header.tileRows = static_cast<std::uint32_t>(tileRows);
+  header.tileCols = static_cast<std::uint32_t>(tileCols);
+
+  std::size_t bytes;
+  if (!fileBytes(header, sizeof(T), bytes) ||
+      bytes > static_cast<std::size_t>(std::numeric_limits<off_t>::max()))
+    throw std::invalid_argument("MappedMatrix: file too large");
+
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throwSystemError("cannot create " + path);
+  // The file is extended with a hole, so the tiles read as zeros and take
+  // no disk space until they are written.
+  if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0 ||
+      ::pwrite(fd, &header, sizeof header, 0) !=
+          static_cast<ssize_t>(sizeof header)) {
+    const int error = errno;
+    ::close(fd);
+    errno = error;
+    throwSystemError("cannot write " + path);
+  }
+  return map(path, fd, true);
+}
+
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::open(const std::string &path, bool writable) {
+  const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+  if (fd < 0)
+    throwSystemError("cannot open " + path);
+  return map(path, fd, writable);
+}
+
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::map(const std::string &path, int fd,
+                                     bool writable) {
+  // Owns the descriptor from here on, so that errors below release it.
+  MappedMatrix matrix;
+  matrix.fd_ = fd;
+  matrix.writable_ = writable;
+
+  struct stat status;
+  if (::fstat(fd, &status) != 0)
+    throwSystemError("cannot stat " + path);
+  matrix.size_ = static_cast<std::size_t>(status.st_size);
+  if (matrix.size_ < headerBytes)
+    throw std::runtime_error("MappedMatrix: " + path + " is not a matrix file");
+
+  void *map = ::mmap(nullptr, matrix.size_,
+                     writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                     fd, 0);
+  if (map == MAP_FAILED)
+    throwSystemError("cannot map " + path);
+  matrix.map_ = static_cast<unsigned char *>(map);
+
+  FileHeader header;
+  std::memcpy(&header, matrix.map_, sizeof header);
+  std::size_t bytes;
+  if (std::memcmp(header.magic, magic, sizeof magic) != 0 ||
+      header.version != formatVersion || header.tileRows == 0 ||
+      header.tileCols == 0 || header.rows > INT32_MAX ||
+      header.cols > INT32_MAX || header.tileRows > INT32_MAX ||
+      header.tileCols > INT32_MAX ||
+      !fileBytes(header, sizeof(T), bytes) || bytes > matrix.size_)
+    throw std::runtime_error("MappedMatrix: " + path + " is not a matrix file");
+  if (header.elementType != static_cast<std::uint32_t>(elementTypeOf<T>()))
+    throw std::runtime_error("MappedMatrix: " + path +
+                             " holds another element type");
+
+  matrix.rows_ = static_cast<int>(header.rows);
+  matrix.cols_ = static_cast<int>(header.cols);
+  matrix.tileRows_ = static_cast<int>(header.tileRows);
+  matrix.tileCols_ = static_cast<int>(header.tileCols);
+  return matrix;
+}
+
+template <typename T> MappedMatrix<T>::~MappedMatrix() { unmap(); }
+
+template <typename T>
+MappedMatrix<T>::MappedMatrix(MappedMatrix &&other) noexcept {
+  *this = std::move(other);
+}
+
+template <typename T>
+MappedMatrix<T> &MappedMatrix<T>::operator=(MappedMatrix &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    fd_ = std::exchange(other.fd_, -1);
+    map_ = std::exchange(other.map_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    rows_ = std::exchange(other.rows_, 0);
+    cols_ = std::exchange(other.cols_, 0);
+    tileRows_ = std::exchange(other.tileRows_, 1);
+    tileCols_ = std::exchange(other.tileCols_, 1);
+    writable_ = std::exchange(other.writable_, false);
+  }
+  return *this;
+}
+
+template <typename T> void MappedMatrix<T>::unmap() noexcept {
+  if (map_)
+    ::munmap(map_, size_);
+  if (fd_ >= 0)
+    ::close(fd_);
+  map_ = nullptr;
+  fd_ = -1;
+}
+
+template <typename T> T *MappedMatrix<T>::tileData(int i, int j) const {
+  const std::size_t index = static_cast<std::size_t>(i) * tileColCount() + j;
+  return reinterpret_cast<T *>(map_ + headerBytes +
+                               index * tileBytes(tileRows_, tileCols_,
+                                                 sizeof(T)));
+}
+
+template <typename T>
+MatrixView<const T> MappedMatrix<T>::tile(int i, int j) const {
+  if (i < 0 || j < 0 || i >= tileRowCount() || j >= tileColCount())
+    throw std::invalid_argument("MappedMatrix: tile index out of range");
+  return MatrixView<const T>(tileData(i, j),
+                             std::min(tileRows_, rows_ - i * tileRows_),
+                             std::min(tileCols_, cols_ - j * tileCols_),
+                             tileCols_);
+}
+
+template <typename T>
+MatrixView<T> MappedMatrix<T>::writableTile(int i, int j) {
+  if (!writable_)
+    throw std::invalid_argument("MappedMatrix: read-only mapping");
+  const MatrixView<const T> view = tile(i, j);
+  return MatrixView<T>(const_cast<T *>(view.data()), view.rows(), view.cols(),
+                       view.ld());
+}
+
+// Calls part(i, j, top, left, height, width) for the part of the block at
+// (row, col) that lies in each tile (i, j), in matrix coordinates.
+template <typename T>
+template <typename Part>
+void MappedMatrix<T>::forEachTilePart(int row, int col, int rows, int cols,
+                                      Part part) const {
+  checkBlock(row, col, rows, cols, rows_, cols_);
+  if (rows == 0 || cols == 0)
+    return;
+  for (int i = row / tileRows_; i * tileRows_ < row + rows; ++i)
+    for (int j = col / tileCols_; j * tileCols_ < col + cols; ++j) {
+      const int top = std::max(row, i * tileRows_);
+      const int left = std::max(col, j * tileCols_);
+      const int bottom = std::min(row + rows, (i + 1) * tileRows_);
+      const int right = std::min(col + cols, (j + 1) * tileCols_);
+      part(i, j, top, left, bottom - top, right - left);
+    }
+}
+
+template <typename T>
+void MappedMatrix<T>::read(int row, int col, MatrixView<T> block) const {
+  forEachTilePart(row, col, block.rows(), block.cols(),
+                  [&](int i, int j, int top, int left, int height, int width) {
+                    const MatrixView<const T> source = tile(i, j).block(
+                        top - i * tileRows_, left - j * tileCols_, height,
+                        width);
+                    for (int r = 0; r < height; ++r)
+                      std::copy(source.row(r), source.row(r) + width,
+                                block.row(top - row + r) + (left - col));
+                  });
+}
+
+template <typename T>
+void MappedMatrix<T>::write(int row, int col, MatrixView<const T> block) {
+  forEachTilePart(row, col, block.rows(), block.cols(),
+                  [&](int i, int j, int top, int left, int height, int width) {
+                    const MatrixView<T> target = writableTile(i, j).block(
+                        top - i * tileRows_, left - j * tileCols_, height,
+                        width);
+                    const MatrixView<const T> source =
+                        block.block(top - row, left - col, height, width);
+                    for (int r = 0; r < height; ++r)
+                      std::copy(source.row(r), source.row(r) + width,
+                                target.row(r));
+                  });
+}
+
+// Advises the tiles overlapping the block, one call per row of tiles since
+// the tiles of a row are contiguous in the file. The range is widened to
+// whole pages; advice is only a hint, so failures are ignored.
+template <typename T>
+template <typename Advice>
+void MappedMatrix<T>::adviseTiles(int row, int col, int rows, int cols,
+                                  Advice advice) const {
+  checkBlock(row, col, rows, cols, rows_, cols_);
+  if (rows == 0 || cols == 0)
+    return;
+  const std::uintptr_t page =
+      static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+  const int lastTileCol = (col + cols - 1) / tileCols_;
+  for (int i = row / tileRows_; i * tileRows_ < row + rows; ++i) {
+    const std::uintptr_t first =
+        reinterpret_cast<std::uintptr_t>(tileData(i, col / tileCols_));
+    const std::uintptr_t last =
+        reinterpret_cast<std::uintptr_t>(tileData(i, lastTileCol)) +
+        tileBytes(tileRows_, tileCols_, sizeof(T));
+    const std::uintptr_t start = first / page * page;
+    const std::uintptr_t end = (last + page - 1) / page * page;
+    ::madvise(reinterpret_cast<void *>(start), end - start, advice);
+  }
+}
+
+template <typename T>
+void MappedMatrix<T>::prefetch(int row, int col, int rows, int cols) const {
+  adviseTiles(row, col, rows, cols, MADV_WILLNEED);
+}
+
+template <typename T>
+void MappedMatrix<T>::release(int row, int col, int rows, int cols) const {
+  // Pages of a shared file mapping stay in the page cache, so written data
+  // is not lost; only the mapping of the process lets go of them.
+  adviseTiles(row, col, rows, cols, MADV_DONTNEED);
+}
+
+template <typename T> void MappedMatrix<T>::flush() {
+  if (map_ && writable_ && ::msync(map_, size_, MS_SYNC) != 0)
+    throwSystemError("cannot write back the mapping");
+}
+
+ElementType matrixFileElementType(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throwSystemError("cannot open " + path);
+  FileHeader header;
+  const ssize_t bytes = ::pread(fd, &header, sizeof header, 0);
+  ::close(fd);
+  if (bytes != static_cast<ssize_t>(sizeof header) ||
+      std::memcmp(header.magic, magic, sizeof magic) != 0 ||
+      header.elementType < static_cast<std::uint32_t>(ElementType::Int32) ||
+      header.elementType > static_cast<std::uint32_t>(ElementType::Float64))
+    throw std::runtime_error("MappedMatrix: " + path + " is not a matrix file");
+  return static_cast<ElementType>(header.elementType);
+}
+
+namespace {
+
+// One block product of the out-of-core schedule: C(row, col) += A(row, k) *
+// B(k, col), with the blocks of A and B staged in a buffer slot.
+struct Step {
+  int row, col, k;
+  int rows, cols, depth;
+};
+
+// Double-buffered handoff between the thread reading blocks and the thread
+// multiplying them. A slot is filled by the reader, then emptied by the
+// multiplier; `failure` carries an exception of either side to the other.
+struct Pipeline {
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool full[2] = {false, false};
+  bool stop = false;
+  std::exception_ptr failure;
+};
+
+} // namespace
+
+template <typename T>
+void multiplyOutOfCore(const MappedMatrix<T> &A, const MappedMatrix<T> &B,
+                       MappedMatrix<T> &C, std::size_t memoryBudget) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument("multiplyOutOfCore: dimension mismatch");
+  if (!C.writable())
+    throw std::invalid_argument("multiplyOutOfCore: C is read-only");
+
+  // Square blocks of side b: the accumulator and the product of C, and two
+  // slots of an A and a B block, make six b x b buffers. Multiples of 16
+  // keep the in-memory products on whole micro-tiles.
+  int b = static_cast<int>(
+      std::sqrt(static_cast<double>(memoryBudget) / (6 * sizeof(T))));
+  if (b < 16)
+    throw std::invalid_argument("multiplyOutOfCore: memory budget too small");
+  b -= b % 16;
+
+  const int m = A.rows(), n = B.cols(), k = A.cols();
+  if (m == 0 || n == 0)
+    return;
+  const int bm = std::min(b, m), bn = std::min(b, n), bk = std::min(b, k);
+
+  std::vector<Step> steps;
+  for (int row = 0; row < m; row += bm)
+    for (int col = 0; col < n; col += bn)
+      // An empty inner dimension still takes one step, to zero C.
+      for (int p = 0; p == 0 || p < k; p += std::max(bk, 1))
+        steps.push_back({row, col, p, std::min(bm, m - row),
+                         std::min(bn, n - col), std::min(bk, k - p)});
+
+  Matrix<T> accumulator(bm, bn), product(bm, bn);
+  Matrix<T> blocksA[2] = {Matrix<T>(bm, bk), Matrix<T>(bm, bk)};
+  Matrix<T> blocksB[2] = {Matrix<T>(bk, bn), Matrix<T>(bk, bn)};
+  Pipeline pipeline;
+
+  // The reader copies the blocks of step s into slot s % 2 while the step
+  // before is multiplied, and asks the kernel to read ahead the blocks of
+  // step s + 1. The copied ranges are released at once, so the resident
+  // part of the mappings stays within a few blocks.
+  std::thread reader([&] {
+    try {
+      for (std::size_t s = 0; s < steps.size(); ++s) {
+        const Step &step = steps[s];
+        const int slot = static_cast<int>(s % 2);
+        {
+          std::unique_lock<std::mutex> lock(pipeline.mutex);
+          pipeline.changed.wait(
+              lock, [&] { return !pipeline.full[slot] || pipeline.stop; });
+          if (pipeline.stop)
+            return;
+        }
+        if (s + 1 < steps.size()) {
+          const Step &next = steps[s + 1];
+          A.prefetch(next.row, next.k, next.rows, next.depth);
+          B.prefetch(next.k, next.col, next.depth, next.cols);
+        }
+        A.read(step.row, step.k,
+               blocksA[slot].view().block(0, 0, step.rows, step.depth));
+        A.release(step.row, step.k, step.rows, step.depth);
+        B.read(step.k, step.col,
+               blocksB[slot].view().block(0, 0, step.depth, step.cols));
+        B.release(step.k, step.col, step.depth, step.cols);
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.full[slot] = true;
+        pipeline.changed.notify_all();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(pipeline.mutex);
+      pipeline.failure = std::current_exception();
+      pipeline.stop = true;
+      pipeline.changed.notify_all();
+    }
+  });
+
+  using U = ArithmeticType<T>;
+  try {
+    for (std::size_t s = 0; s < steps.size(); ++s) {
+      const Step &step = steps[s];
+      const int slot = static_cast<int>(s % 2);
+      {
+        std::unique_lock<std::mutex> lock(pipeline.mutex);
+        pipeline.changed.wait(
+            lock, [&] { return pipeline.full[slot] || pipeline.stop; });
+        if (pipeline.stop)
+          break;
+      }
+
+      // The first step of a block of C writes the accumulator directly, the
+      // others add their product to it.
+      const bool first = step.k == 0;
+      MatrixView<T> sum = accumulator.view().block(0, 0, step.rows, step.cols);
+      MatrixView<T> target =
+          first ? sum : product.view().block(0, 0, step.rows, step.cols);
+      multiply(blocksA[slot].view().block(0, 0, step.rows, step.depth),
+               blocksB[slot].view().block(0, 0, step.depth, step.cols),
+               target);
+      if (!first)
+        for (int i = 0; i < step.rows; ++i) {
+          U *c = reinterpret_cast<U *>(sum.row(i));
+          const U *p = reinterpret_cast<const U *>(target.row(i));
+          for (int j = 0; j < step.cols; ++j)
+            c[j] += p[j];
+        }
+      {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.full[slot] = false;
+        pipeline.changed.notify_all();
+      }
+
+      // Written pages go back to the file in the background; releasing them
+      // keeps the written part of C out of the memory of the process.
+      if (s + 1 == steps.size() || steps[s + 1].k == 0) {
+        C.write(step.row, step.col, sum);
+        C.release(step.row, step.col, step.rows, step.cols);
+      }
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(pipeline.mutex);
+      pipeline.stop = true;
+      pipeline.changed.notify_all();
+    }
+    reader.join();
+    throw;
+  }
+  reader.join();
+  if (pipeline.failure)
+    std::rethrow_exception(pipeline.failure);
+}
+
+template class MappedMatrix<int>;
+template class MappedMatrix<float>;
+template class MappedMatrix<double>;
+
+template void multiplyOutOfCore(const MappedMatrix<int> &,
+                                const MappedMatrix<int> &, MappedMatrix<int> &,
+                                std::size_t);
+template void multiplyOutOfCore(const MappedMatrix<float> &,
+                                const MappedMatrix<float> &,
+                                MappedMatrix<float> &, std::size_t);
+template void multiplyOutOfCore(const MappedMatrix<double> &,
+                                const MappedMatrix<double> &,
+                                MappedMatrix<double> &, std::size_t);
@@ -0,0 +1,35 @@
+#include "packing.h"
+
+#include <algorithm>
+#include <new>
+
+PackArena::~PackArena() {
+  for (void *data : data_)
+    ::operator delete(data, std::align_val_t(64));
+}
+
+void *PackArena::reserve(Slot slot, std::size_t bytes) {
+  if (bytes <= size_[slot])
+    return data_[slot];
+  // Grow by at least half again, so a slowly increasing size settles quickly.
+  const std::size_t grown = std::max(bytes, size_[slot] + size_[slot] / 2);
+  ::operator delete(data_[slot], std::align_val_t(64));
+  data_[slot] = nullptr;
+  size_[slot] = 0;
+  data_[slot] = ::operator new(grown, std::align_val_t(64));
+  size_[slot] = grown;
+  ++allocations_;
+  return data_[slot];
+}
+
+std::size_t PackArena::capacity() const {
+  std::size_t total = 0;
+  for (std::size_t size : size_)
+    total += size;
+  return total;
+}
+
+PackArena &packArena() {
+  thread_local PackArena arena;
+  return arena;
+}
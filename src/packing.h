@@ -0,0 +1,185 @@
+#ifndef PACKING_H
+#define PACKING_H
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.h"
+
+// Scratch buffers for packed operands. Each buffer only grows, so after the
+// first calls of a given size the engines no longer touch the allocator.
+// Every thread has its own arena (packArena()), so packing needs no locks and
+// the panels stay in the cache of the core that uses them.
+class PackArena {
+public:
+  enum Slot { SlotA, SlotB, SlotC, SlotCount };
+
+  PackArena() = default;
+  ~PackArena();
+  PackArena(const PackArena &) = delete;
+  PackArena &operator=(const PackArena &) = delete;
+
+  // 64-byte aligned buffer of at least `count` elements of type T for `slot`.
+  // The previous contents of the slot are not preserved when it grows.
+  template <typename T> T *get(Slot slot, std::size_t count) {
+    return static_cast<T *>(reserve(slot, count * sizeof(T)));
+  }
+
+  // Total bytes held and number of allocations made by this arena.
+  std::size_t capacity() const;
+  long allocations() const { return allocations_; }
+
+private:
+  void *reserve(Slot slot, std::size_t bytes);
+
+  void *data_[SlotCount] = {};
+  std::size_t size_[SlotCount] = {};
+  long allocations_ = 0;
+};
+
+// Arena of the calling thread.
+PackArena &packArena();
+
+// Packs the rows x cols block A into row panels of height mr, as read by a
+// micro-kernel with rsA = 1, csA = mr: panel p holds A(p * mr + i, k) at
+// dst[p * mr * cols + k * mr + i]. Rows past the end of A are zero-filled.
+template <typename T> void packA(MatrixView<const T> A, int mr, T *dst) {
+  const int rows = A.rows(), cols = A.cols();
+  for (int p = 0; p < rows; p += mr) {
+    const int height = std::min(mr, rows - p);
+    for (int k = 0; k < cols; ++k) {
+      for (int i = 0; i < height; ++i)
+        dst[i] = A(p + i, k);
+      for (int i = height; i < mr; ++i)
+        dst[i] = T();
+      dst += mr;
+    }
+  }
+}
+
+// The same with every element multiplied by `scale`; int wraps like the
+// engines do.
+template <typename T>
+void packA(MatrixView<const T> A, int mr, T *dst, T scale) {
+  if (scale == T(1)) {
+    packA(A, mr, dst);
+    return;
+  }
+  using U = std::conditional_t<std::is_same_v<T, int>, unsigned, T>;
+  const int rows = A.rows(), cols = A.cols();
+  for (int p = 0; p < rows; p += mr) {
+    const int height = std::min(mr, rows - p);
+    for (int k = 0; k < cols; ++k) {
+      for (int i = 0; i < height; ++i)
+        dst[i] = static_cast<T>(static_cast<U>(scale) *
+                                static_cast<U>(A(p + i, k)));
+      for (int i = height; i < mr; ++i)
+        dst[i] = T();
+      dst += mr;
+    }
+  }
+}
+
+// packA() of the transpose of At, read in place: At(k, i) is element (i, k)
+// of the block, so each panel row is a contiguous run of a row of At.
+template <typename T>
+void packATransposed(MatrixView<const T> At, int mr, T *dst,
+                     T scale = T(1)) {
+  using U = std::conditional_t<std::is_same_v<T, int>, unsigned, T>;
+  const int rows = At.cols(), cols = At.rows();
+  for (int p = 0; p < rows; p += mr) {
+    const int height = std::min(mr, rows - p);
+    for (int k = 0; k < cols; ++k) {
+      const T *a = At.row(k) + p;
+      if (scale == T(1))
+        std::copy(a, a + height, dst);
+      else
+        for (int i = 0; i < height; ++i)
+          dst[i] = static_cast<T>(static_cast<U>(scale) *
+                                  static_cast<U>(a[i]));
+      std::fill(dst + height, dst + mr, T());
+      dst += mr;
+    }
+  }
+}
+
+// Packs the rows x cols block B into column panels of width nr, as read by a
+// micro-kernel with rsB = nr: panel q holds B(k, q * nr + j) at
+// dst[q * nr * rows + k * nr + j]. Columns past the end of B are zero-filled.
+template <typename T> void packB(MatrixView<const T> B, int nr, T *dst) {
+  const int rows = B.rows(), cols = B.cols();
+  for (int q = 0; q < cols; q += nr) {
+    const int width = std::min(nr, cols - q);
+    for (int k = 0; k < rows; ++k) {
+      const T *b = B.row(k) + q;
+      std::copy(b, b + width, dst);
+      std::fill(dst + width, dst + nr, T());
+      dst += nr;
+    }
+  }
+}
+
+// packB() of the transpose of Bt, read in place: each of the nr columns of
+// a panel is a contiguous row of Bt, written with a stride of nr.
+template <typename T>
+void packBTransposed(MatrixView<const T> Bt, int nr, T *dst) {
+  const int rows = Bt.cols(), cols = Bt.rows();
+  for (int q = 0; q < cols; q += nr) {
+    const int width = std::min(nr, cols - q);
+    for (int j = 0; j < width; ++j) {
+      const T *b = Bt.row(q + j);
+      for (int k = 0; k < rows; ++k)
+        dst[static_cast<std::size_t>(k) * nr + j] = b[k];
+    }
+    for (int j = width; j < nr; ++j)
+      for (int k = 0; k < rows; ++k)
+        dst[static_cast<std::size_t>(k) * nr + j] = T();
+    dst += static_cast<std::size_t>(nr) * rows;
+  }
+}
+
+// The whole of B packed ahead of a product, for the Simd and Parallel engines
+// to use instead of packing their panels of B themselves: every block of kc
+// rows holds all the columns in packB() panels of width nr, so the panels of
+// any column range starting at a multiple of nr are contiguous.
+template <typename T> struct PackedB {
+  int rows = 0;
+  int cols = 0;
+  int kc = 0;
+  int nr = 0;
+  std::vector<T, AlignedAllocator<T>> data;
+
+  // Panels of rows pc ... pc + kc - 1 (pc a multiple of kc) from column col.
+  const T *panels(int pc, int col) const {
+    const std::size_t paddedCols = (cols + nr - 1) / nr * nr;
+    const int kb = std::min(kc, rows - pc);
+    return data.data() + static_cast<std::size_t>(pc) * paddedCols +
+           static_cast<std::size_t>(col) * kb;
+  }
+};
+
+// Packs op(B), B^T when `transposed`.
+template <typename T>
+PackedB<T> packWholeB(MatrixView<const T> B, int kc, int nr,
+                      bool transposed = false) {
+  PackedB<T> packed;
+  packed.rows = transposed ? B.cols() : B.rows();
+  packed.cols = transposed ? B.rows() : B.cols();
+  packed.kc = kc;
+  packed.nr = nr;
+  const std::size_t paddedCols = (packed.cols + nr - 1) / nr * nr;
+  packed.data.resize(paddedCols * packed.rows);
+  for (int pc = 0; pc < packed.rows; pc += kc) {
+    const int kb = std::min(kc, packed.rows - pc);
+    T *dst = packed.data.data() + static_cast<std::size_t>(pc) * paddedCols;
+    if (transposed)
+      packBTransposed(B.block(0, pc, packed.cols, kb), nr, dst);
+    else
+      packB(B.block(pc, 0, kb, packed.cols), nr, dst);
+  }
+  return packed;
+}
+
+#endif // PACKING_H
@@ -0,0 +1,126 @@
+#ifndef PHILOX_KERNEL_H
+#define PHILOX_KERNEL_H
+
+#include <algorithm>
+#include <cstdint>
+
+// Philox kernels (see PhiloxKernelFn in microkernel.h). philoxLanes runs up
+// to Lanes counters with plain arrays: philoxBlocks, the kernel of the
+// scalar translation unit, is made of it, and the others use it for their
+// tails. philoxGroups runs the counters in registers, with the operations
+// of an Ops struct of the including translation unit:
+//   Reg, lanes, load(p), set1(x), xor3(a, b, c),
+//   multiply(a, m, hi, lo): the halves of the 64-bit products a * m,
+//   store(out, c0, c1, c2, c3): the blocks of the lanes, interleaved.
+// The anonymous namespace keeps the instantiations of different instruction
+// sets apart.
+namespace {
+
+constexpr std::uint32_t philoxM0 = 0xD2511F53u;
+constexpr std::uint32_t philoxM1 = 0xCD9E8D57u;
+constexpr std::uint32_t philoxW0 = 0x9E3779B9u;
+constexpr std::uint32_t philoxW1 = 0xBB67AE85u;
+constexpr int philoxRounds = 10;
+
+template <int Lanes>
+void philoxLanes(std::uint64_t first, int count, std::uint64_t seed,
+                 std::uint32_t stream, std::uint32_t *out) {
+  std::uint32_t c0[Lanes], c1[Lanes], c2[Lanes], c3[Lanes];
+  for (int l = 0; l < Lanes; ++l) {
+    const std::uint64_t counter = first + static_cast<std::uint64_t>(l);
+    c0[l] = static_cast<std::uint32_t>(counter);
+    c1[l] = static_cast<std::uint32_t>(counter >> 32);
+    c2[l] = stream;
+    c3[l] = 0;
+  }
+  std::uint32_t k0 = static_cast<std::uint32_t>(seed);
+  std::uint32_t k1 = static_cast<std::uint32_t>(seed >> 32);
+  for (int r = 0; r < philoxRounds; ++r) {
+    for (int l = 0; l < Lanes; ++l) {
+      const std::uint64_t p0 = static_cast<std::uint64_t>(philoxM0) * c0[l];
+      const std::uint64_t p1 = static_cast<std::uint64_t>(philoxM1) * c2[l];
+      const std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32);
+      const std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32);
+      c0[l] = hi1 ^ c1[l] ^ k0;
+      c1[l] = static_cast<std::uint32_t>(p1);
+      c2[l] = hi0 ^ c3[l] ^ k1;
+      c3[l] = static_cast<std::uint32_t>(p0);
+    }
+    k0 += philoxW0;
+    k1 += philoxW1;
+  }
+  for (int l = 0; l < count; ++l) {
+    out[4 * l] = c0[l];
+    out[4 * l + 1] = c1[l];
+    out[4 * l + 2] = c2[l];
+    out[4 * l + 3] = c3[l];
+  }
+}
+
+template <int Lanes>
+void philoxBlocks(std::uint64_t first, int blocks, std::uint64_t seed,
+                  std::uint32_t stream, std::uint32_t *out) {
+  int b = 0;
+  for (; b + Lanes <= blocks; b += Lanes)
+    philoxLanes<Lanes>(first + b, Lanes, seed, stream, out + 4 * b);
+  if (b < blocks)
+    philoxLanes<Lanes>(first + b, blocks - b, seed, stream, out + 4 * b);
+}
+
+// Two registers of counters go through the rounds together, so the
+// multiplies of one hide the latency of the other.
+constexpr int philoxRegisters = 2;
+
+template <typename Ops>
+void philoxGroup(std::uint64_t first, std::uint64_t seed, std::uint32_t stream,
+                 std::uint32_t *out) {
+  using Reg = typename Ops::Reg;
+  constexpr int R = philoxRegisters;
+  std::uint32_t low[R * Ops::lanes], high[R * Ops::lanes];
+  for (int l = 0; l < R * Ops::lanes; ++l) {
+    const std::uint64_t counter = first + static_cast<std::uint64_t>(l);
+    low[l] = static_cast<std::uint32_t>(counter);
+    high[l] = static_cast<std::uint32_t>(counter >> 32);
+  }
+  Reg c0[R], c1[R], c2[R], c3[R];
+  for (int g = 0; g < R; ++g) {
+    c0[g] = Ops::load(low + g * Ops::lanes);
+    c1[g] = Ops::load(high + g * Ops::lanes);
+    c2[g] = Ops::set1(stream);
+    c3[g] = Ops::set1(0);
+  }
+  std::uint32_t k0 = static_cast<std::uint32_t>(seed);
+  std::uint32_t k1 = static_cast<std::uint32_t>(seed >> 32);
+  for (int r = 0; r < philoxRounds; ++r) {
+    const Reg key0 = Ops::set1(k0), key1 = Ops::set1(k1);
+    for (int g = 0; g < R; ++g) {
+      Reg hi0, lo0, hi1, lo1;
+      Ops::multiply(c0[g], philoxM0, hi0, lo0);
+      Ops::multiply(c2[g], philoxM1, hi1, lo1);
+      c0[g] = Ops::xor3(hi1, c1[g], key0);
+      c1[g] = lo1;
+      c2[g] = Ops::xor3(hi0, c3[g], key1);
+      c3[g] = lo0;
+    }
+    k0 += philoxW0;
+    k1 += philoxW1;
+  }
+  for (int g = 0; g < R; ++g)
+    Ops::store(out + 4 * g * Ops::lanes, c0[g], c1[g], c2[g], c3[g]);
+}
+
+template <typename Ops>
+void philoxGroups(std::uint64_t first, int blocks, std::uint64_t seed,
+                  std::uint32_t stream, std::uint32_t *out) {
+  constexpr int group = philoxRegisters * Ops::lanes;
+  int b = 0;
+  for (; b + group <= blocks; b += group)
+    philoxGroup<Ops>(first + b, seed, stream, out + 4 * b);
+  for (; b < blocks; b += Ops::lanes)
+    philoxLanes<Ops::lanes>(first + b, std::min(Ops::lanes, blocks - b), seed,
+                            stream, out + 4 * b);
+}
+
+} // namespace
+
+#endif // PHILOX_KERNEL_H
@@ -0,0 +1,322 @@
+#include "product_cache.h"
+#include "engines.h"
+#include "hash_kernel.h"
+#include "microkernel.h"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+constexpr std::uint64_t prime64 = 0x9E3779B185EBCA87ull;
+
+std::uint64_t mix(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+// The rows go through the hash row kernel; the shape, the element size and
+// the accumulators are then mixed into one word.
+template <typename T> std::uint64_t fingerprintOf(ConstMatrixView<T> M) {
+  const HashRowKernelFn hashRow = hashRowKernel().fn;
+  std::uint64_t acc[hashLanes];
+  std::copy(hashSecret, hashSecret + hashLanes, acc);
+  const std::size_t bytes = static_cast<std::size_t>(M.cols()) * sizeof(T);
+  for (int i = 0; i < M.rows(); ++i)
+    hashRow(M.row(i), bytes, acc);
+  std::uint64_t h = mix((static_cast<std::uint64_t>(M.rows()) << 32 |
+                         static_cast<std::uint32_t>(M.cols())) ^
+                        sizeof(T) * prime64);
+  for (int l = 0; l < hashLanes; ++l)
+    h = mix(h ^ acc[l]) * prime64;
+  return mix(h);
+}
+
+// Identifies a packed B or a stored result: the fingerprints of the
+// operands (a is 0 for packed B), the shape of the product, the element
+// type, and the engine of a result or the panel sizes of a packed B.
+struct Key {
+  std::uint64_t a = 0;
+  std::uint64_t b = 0;
+  int m = 0;
+  int k = 0;
+  int n = 0;
+  std::size_t type = 0;
+  int engine = 0;
+  int kc = 0;
+  int nr = 0;
+
+  bool operator==(const Key &other) const {
+    return a == other.a && b == other.b && m == other.m && k == other.k &&
+           n == other.n && type == other.type && engine == other.engine &&
+           kc == other.kc && nr == other.nr;
+  }
+};
+
+struct KeyHash {
+  std::size_t operator()(const Key &key) const {
+    const std::uint64_t shape = static_cast<std::uint64_t>(key.k) << 32 |
+                                static_cast<std::uint32_t>(key.n);
+    return static_cast<std::size_t>(key.a ^ mix(key.b ^ mix(shape)));
+  }
+};
+
+// Element types are told apart by their size and whether they are integers.
+template <typename T> constexpr std::size_t typeCode() {
+  return sizeof(T) * 2 + (std::is_integral_v<T> ? 1 : 0);
+}
+
+// Entries of one kind, most recently used first, within a byte budget.
+class Lru {
+public:
+  explicit Lru(std::size_t budget) : budget_(budget) {}
+
+  std::shared_ptr<const void> find(const Key &key) {
+    const auto found = index_.find(key);
+    if (found == index_.end())
+      return nullptr;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return found->second->value;
+  }
+
+  // Returns the number of entries evicted to make room; a value larger than
+  // the whole budget is not stored.
+  long insert(const Key &key, std::shared_ptr<const void> value,
+              std::size_t bytes) {
+    if (bytes > budget_)
+      return 0;
+    erase(key);
+    long evicted = 0;
+    while (bytes_ + bytes > budget_) {
+      erase(entries_.back().key);
+      ++evicted;
+    }
+    entries_.push_front({key, std::move(value), bytes});
+    index_[key] = entries_.begin();
+    bytes_ += bytes;
+    return evicted;
+  }
+
+  void clear() {
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+  }
+
+  std::size_t bytes() const { return bytes_; }
+
+private:
+  struct Entry {
+    Key key;
+    std::shared_ptr<const void> value;
+    std::size_t bytes;
+  };
+
+  void erase(const Key &key) {
+    const auto found = index_.find(key);
+    if (found == index_.end())
+      return;
+    bytes_ -= found->second->bytes;
+    entries_.erase(found->second);
+    index_.erase(found);
+  }
+
+  std::size_t budget_;
+  std::size_t bytes_ = 0;
+  std::list<Entry> entries_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+};
+
+template <typename T>
+void checkDimensions(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                     MatrixView<T> C, const char *message) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument(message);
+}
+
+template <typename T>
+void multiplyPacked(ConstMatrixView<T> A, const PackedMatrix<T> &B,
+                    MatrixView<T> C, Engine engine) {
+  checkDimensions(A, B.view(), C, "multiply: dimension mismatch");
+  PreparedProduct<T> product;
+  product.A = A;
+  product.B = B.view();
+  product.C = C;
+  product.engine = engine;
+  product.packedB = std::static_pointer_cast<const PackedB<T>>(B.panels());
+  prepareProduct(product);
+  runProduct(product);
+}
+
+template <typename T> void copy(ConstMatrixView<T> from, MatrixView<T> to) {
+  for (int i = 0; i < from.rows(); ++i)
+    std::copy(from.row(i), from.row(i) + from.cols(), to.row(i));
+}
+
+} // namespace
+
+std::uint64_t fingerprint(ConstMatrixView<int> M) { return fingerprintOf(M); }
+std::uint64_t fingerprint(ConstMatrixView<float> M) {
+  return fingerprintOf(M);
+}
+std::uint64_t fingerprint(ConstMatrixView<double> M) {
+  return fingerprintOf(M);
+}
+
+template <typename T>
+PackedMatrix<T>::PackedMatrix(ConstMatrixView<T> B) : B_(B) {
+  auto packed = std::make_shared<const PackedB<T>>(
+      packWholeB(B, tileSizes().kc, microKernel<T>().nr));
+  bytes_ = packed->data.size() * sizeof(T);
+  panels_ = std::move(packed);
+}
+
+template class PackedMatrix<int>;
+template class PackedMatrix<float>;
+template class PackedMatrix<double>;
+
+void multiply(ConstMatrixView<int> A, const PackedMatrix<int> &B,
+              MatrixView<int> C, Engine engine) {
+  multiplyPacked(A, B, C, engine);
+}
+
+void multiply(ConstMatrixView<float> A, const PackedMatrix<float> &B,
+              MatrixView<float> C, Engine engine) {
+  multiplyPacked(A, B, C, engine);
+}
+
+void multiply(ConstMatrixView<double> A, const PackedMatrix<double> &B,
+              MatrixView<double> C, Engine engine) {
+  multiplyPacked(A, B, C, engine);
+}
+
+struct ProductCache::Impl {
+  Impl(std::size_t resultBudget, std::size_t packedBudget)
+      : results(resultBudget), packed(packedBudget),
+        storeResults(resultBudget > 0) {}
+
+  std::mutex mutex;
+  Lru results;
+  Lru packed;
+  bool storeResults;
+  ProductCacheStats stats;
+};
+
+ProductCache::ProductCache(std::size_t resultBudget, std::size_t packedBudget)
+    : impl_(std::make_unique<Impl>(resultBudget, packedBudget)) {}
+
+ProductCache::~ProductCache() = default;
+
+template <typename T>
+void ProductCache::multiplyCached(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                                  MatrixView<T> C, Engine engine) {
+  checkDimensions(A, B, C, "ProductCache::multiply: dimension mismatch");
+  if (C.empty())
+    return;
+
+  Impl &impl = *impl_;
+  const std::uint64_t fingerprintB = fingerprint(B);
+  Key resultKey;
+  if (impl.storeResults) {
+    resultKey.a = fingerprint(A);
+    resultKey.b = fingerprintB;
+    resultKey.m = A.rows();
+    resultKey.k = A.cols();
+    resultKey.n = B.cols();
+    resultKey.type = typeCode<T>();
+    resultKey.engine = static_cast<int>(engine);
+    std::shared_ptr<const void> stored;
+    {
+      std::lock_guard<std::mutex> lock(impl.mutex);
+      stored = impl.results.find(resultKey);
+      if (stored)
+        ++impl.stats.resultHits;
+      else
+        ++impl.stats.resultMisses;
+    }
+    if (stored) {
+      copy(static_cast<const Matrix<T> *>(stored.get())->view(), C);
+      return;
+    }
+  }
+
+  PreparedProduct<T> product;
+  product.A = A;
+  product.B = B;
+  product.C = C;
+  product.engine = engine;
+  Key packedKey;
+  packedKey.b = fingerprintB;
+  packedKey.k = B.rows();
+  packedKey.n = B.cols();
+  packedKey.type = typeCode<T>();
+  packedKey.kc = tileSizes().kc;
+  packedKey.nr = microKernel<T>().nr;
+  {
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    product.packedB = std::static_pointer_cast<const PackedB<T>>(
+        impl.packed.find(packedKey));
+  }
+  const PackedB<T> *cached = product.packedB.get();
+  prepareProduct(product);
+  if (product.engine == Engine::Simd || product.engine == Engine::Parallel) {
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    if (product.packedB.get() == cached) {
+      ++impl.stats.packHits;
+    } else {
+      ++impl.stats.packMisses;
+      impl.stats.evictions += impl.packed.insert(
+          packedKey, product.packedB, product.packedB->data.size() * sizeof(T));
+    }
+  }
+  runProduct(product);
+
+  if (impl.storeResults) {
+    auto result = std::make_shared<Matrix<T>>(C.rows(), C.cols());
+    copy(ConstMatrixView<T>(C), result->view());
+    const std::size_t bytes =
+        static_cast<std::size_t>(C.rows()) * C.cols() * sizeof(T);
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    impl.stats.evictions +=
+        impl.results.insert(resultKey, std::move(result), bytes);
+  }
+}
+
+void ProductCache::multiply(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                            MatrixView<int> C, Engine engine) {
+  multiplyCached(A, B, C, engine);
+}
+
+void ProductCache::multiply(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                            MatrixView<float> C, Engine engine) {
+  multiplyCached(A, B, C, engine);
+}
+
+void ProductCache::multiply(ConstMatrixView<double> A,
+                            ConstMatrixView<double> B, MatrixView<double> C,
+                            Engine engine) {
+  multiplyCached(A, B, C, engine);
+}
+
+ProductCacheStats ProductCache::stats() const {
+  std::lock_guard<std::mutex> lock(impl_->mutex);
+  ProductCacheStats stats = impl_->stats;
+  stats.packedBytes = impl_->packed.bytes();
+  stats.resultBytes = impl_->results.bytes();
+  return stats;
+}
+
+void ProductCache::clear() {
+  std::lock_guard<std::mutex> lock(impl_->mutex);
+  impl_->packed.clear();
+  impl_->results.clear();
+  impl_->stats = ProductCacheStats();
+}
@@ -0,0 +1,111 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+// Probes of instrumentation.h, placed in the engines. Without
+// MATMUL_INSTRUMENTATION every macro expands to nothing.
+//
+// MATMUL_CALL opens the profile of a call on the calling thread; nested
+// calls on the same thread add to the outer one. MATMUL_PHASE attributes the
+// time until the end of the enclosing scope to a phase, pausing the phase it
+// interrupts. MATMUL_TASK credits a thread-pool task, on whichever thread
+// runs it, to the call that submitted it.
+
+#include <cstdint>
+#include <type_traits>
+
+// Element type of a call as named in CallProfile::type.
+template <typename T> constexpr const char *profileTypeName() {
+  if constexpr (std::is_same_v<T, int>)
+    return "int";
+  else if constexpr (std::is_same_v<T, float>)
+    return "float";
+  else if constexpr (std::is_same_v<T, double>)
+    return "double";
+  else
+    return "int64";
+}
+
+#ifdef MATMUL_INSTRUMENTATION
+
+#include "engine.h"
+
+namespace profiling {
+
+enum class Phase { Compute, Pack, Writeback, Idle, Count };
+
+struct Call;
+
+class CallScope {
+public:
+  CallScope(Engine engine, const char *type, int m, int k, int n);
+  ~CallScope();
+  CallScope(const CallScope &) = delete;
+  CallScope &operator=(const CallScope &) = delete;
+
+private:
+  Call *call_ = nullptr;
+};
+
+class PhaseScope {
+public:
+  explicit PhaseScope(Phase phase);
+  ~PhaseScope();
+  PhaseScope(const PhaseScope &) = delete;
+  PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+  Phase outer_;
+};
+
+class TaskScope {
+public:
+  explicit TaskScope(Call *call);
+  ~TaskScope();
+  TaskScope(const TaskScope &) = delete;
+  TaskScope &operator=(const TaskScope &) = delete;
+
+private:
+  Call *call_;
+  Call *outer_;
+  Phase outerPhase_;
+  long long start_;
+  long long counters_[4];
+};
+
+// Call being profiled on this thread, or nullptr.
+Call *currentCall();
+
+// Engine that runs the current call; the first one named wins, so the
+// leaves of Strassen do not override it.
+void setEngine(Engine engine);
+void addMicroTiles(long count);
+void addTasks(long count, int threads);
+
+} // namespace profiling
+
+#define MATMUL_PROFILE_CONCAT2(a, b) a##b
+#define MATMUL_PROFILE_CONCAT(a, b) MATMUL_PROFILE_CONCAT2(a, b)
+#define MATMUL_CALL(engine, type, m, k, n)                                     \
+  profiling::CallScope MATMUL_PROFILE_CONCAT(matmulCall, __LINE__)(            \
+      engine, type, m, k, n)
+#define MATMUL_PHASE(phase)                                                    \
+  profiling::PhaseScope MATMUL_PROFILE_CONCAT(matmulPhase, __LINE__)(          \
+      profiling::Phase::phase)
+#define MATMUL_TASK(call)                                                      \
+  profiling::TaskScope MATMUL_PROFILE_CONCAT(matmulTask, __LINE__)(call)
+#define MATMUL_ENGINE(engine) profiling::setEngine(engine)
+#define MATMUL_MICRO_TILES(count) profiling::addMicroTiles(count)
+#define MATMUL_TASKS(count, threads) profiling::addTasks(count, threads)
+
+#else
+
+#define MATMUL_CALL(engine, type, m, k, n) ((void)0)
+#define MATMUL_PHASE(phase) ((void)0)
+#define MATMUL_TASK(call) ((void)0)
+#define MATMUL_ENGINE(engine) ((void)0)
+#define MATMUL_MICRO_TILES(count) ((void)0)
+#define MATMUL_TASKS(count, threads) ((void)0)
+
+#endif // MATMUL_INSTRUMENTATION
+
+#endif // PROFILING_H
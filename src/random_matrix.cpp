@@ -0,0 +1,278 @@
+#include "random_matrix.h"
+#include "microkernel.h"
+#include "philox_kernel.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// Below this many elements waking the pool costs more than it saves.
+constexpr long parallelThreshold = 1L << 16;
+
+// Elements of a row generated at a time, so the words of a long row stay in
+// L1 between the Philox kernel and the conversion.
+constexpr int chunk = 2048;
+
+// Streams of counter word 2: element values and sparse choices.
+constexpr std::uint32_t valueStream = 0;
+constexpr std::uint32_t maskStream = 1;
+
+template <typename T>
+constexpr int wordsPerElement = std::is_same_v<T, double> ? 2 : 1;
+
+// Words [first, first + count) of a stream, in `buffer`.
+const std::uint32_t *streamWords(std::uint64_t seed, std::uint32_t stream,
+                                 std::uint64_t first, int count,
+                                 std::vector<std::uint32_t> &buffer) {
+  const std::uint64_t block = first / 4;
+  const int offset = static_cast<int>(first % 4);
+  const int blocks = (offset + count + 3) / 4;
+  buffer.resize(4 * static_cast<std::size_t>(blocks));
+  philoxKernel().fn(block, blocks, seed, stream, buffer.data());
+  return buffer.data() + offset;
+}
+
+// Maps the words of a stream to values of [low, high] (see random_matrix.h).
+// A range below 2^32 keeps the products within 32 x 32 -> 64 bits, which
+// vectorize.
+struct UniformMap {
+  std::uint32_t low;
+  std::uint32_t range;
+  bool full;
+
+  UniformMap(int low, int high)
+      : low(static_cast<std::uint32_t>(low)),
+        range(static_cast<std::uint32_t>(high) - this->low + 1),
+        full(range == 0) {}
+
+  void operator()(const std::uint32_t *words, int count, int *out) const {
+    if (full) {
+      for (int j = 0; j < count; ++j)
+        out[j] = static_cast<int>(low + words[j]);
+      return;
+    }
+    for (int j = 0; j < count; ++j)
+      out[j] = static_cast<int>(
+          low + static_cast<std::uint32_t>(
+                    static_cast<std::uint64_t>(words[j]) * range >> 32));
+  }
+};
+
+template <typename T> struct FloatingMap {
+  T low;
+  T scale;
+
+  FloatingMap(T low, T high) : low(low), scale(high - low) {}
+
+  void operator()(const std::uint32_t *words, int count, T *out) const {
+    if constexpr (std::is_same_v<T, float>) {
+      for (int j = 0; j < count; ++j)
+        out[j] = low + scale * (static_cast<float>(static_cast<int>(
+                                    words[j] >> 8)) *
+                                0x1p-24f);
+    } else {
+      for (int j = 0; j < count; ++j) {
+        const std::uint64_t bits =
+            (static_cast<std::uint64_t>(words[2 * j]) << 32 |
+             words[2 * j + 1]) >>
+            11;
+        out[j] = low + scale * (static_cast<double>(bits) * 0x1p-53);
+      }
+    }
+  }
+};
+
+template <typename T>
+using ValueMap =
+    std::conditional_t<std::is_same_v<T, int>, UniformMap, FloatingMap<T>>;
+
+// Runs body(first, last) on ranges of the rows of M, over the pool when M is
+// large enough. The values never depend on how the rows are split.
+template <typename T, typename Body>
+void forRows(MatrixView<T> M, const Body &body) {
+  const int rows = M.rows();
+  if (static_cast<long>(rows) * M.cols() < parallelThreshold ||
+      threadCount() == 1 || rows < 2) {
+    body(0, rows);
+    return;
+  }
+
+  ThreadPool &pool = *threadPool();
+  const int ranges = std::min(rows, 4 * pool.size());
+  pool.parallelFor(ranges, [&](int r) {
+    body(static_cast<int>(static_cast<long>(rows) * r / ranges),
+         static_cast<int>(static_cast<long>(rows) * (r + 1) / ranges));
+  });
+}
+
+template <typename T>
+void checkRange(const char *function, T low, T high) {
+  if (!(low <= high))
+    throw std::invalid_argument(std::string(function) +
+                                ": low must not exceed high");
+}
+
+// Elements [j0, j1) of row i of M from the value stream.
+template <typename T>
+void uniformRow(MatrixView<T> M, int i, int j0, int j1, std::uint64_t seed,
+                const ValueMap<T> &map, std::vector<std::uint32_t> &buffer) {
+  constexpr int W = wordsPerElement<T>;
+  const std::uint64_t rowStart = static_cast<std::uint64_t>(i) * M.cols();
+  for (int j = j0; j < j1; j += chunk) {
+    const int count = std::min(chunk, j1 - j);
+    const std::uint32_t *words =
+        streamWords(seed, valueStream, (rowStart + j) * W, count * W, buffer);
+    map(words, count, M.row(i) + j);
+  }
+}
+
+template <typename T>
+void uniform(MatrixView<T> M, T low, T high, std::uint64_t seed) {
+  checkRange("fillUniform", low, high);
+  const ValueMap<T> map(low, high);
+  forRows(M, [&](int first, int last) {
+    std::vector<std::uint32_t> buffer;
+    for (int i = first; i < last; ++i)
+      uniformRow(M, i, 0, M.cols(), seed, map, buffer);
+  });
+}
+
+template <typename T>
+void banded(MatrixView<T> M, int lower, int upper, T low, T high,
+            std::uint64_t seed) {
+  if (lower < 0 || upper < 0)
+    throw std::invalid_argument("fillBanded: negative bandwidth");
+  checkRange("fillBanded", low, high);
+  const ValueMap<T> map(low, high);
+  forRows(M, [&](int first, int last) {
+    std::vector<std::uint32_t> buffer;
+    for (int i = first; i < last; ++i) {
+      T *row = M.row(i);
+      const long from = std::max(0L, static_cast<long>(i) - lower);
+      const long to =
+          std::min<long>(M.cols(), static_cast<long>(i) + upper + 1);
+      if (from >= to) {
+        std::fill(row, row + M.cols(), T(0));
+        continue;
+      }
+      std::fill(row, row + from, T(0));
+      uniformRow(M, i, static_cast<int>(from), static_cast<int>(to), seed, map,
+                 buffer);
+      std::fill(row + to, row + M.cols(), T(0));
+    }
+  });
+}
+
+template <typename T>
+void sparse(MatrixView<T> M, double density, T low, T high,
+            std::uint64_t seed) {
+  if (!(density >= 0 && density <= 1))
+    throw std::invalid_argument("fillSparse: density must be in [0, 1]");
+  checkRange("fillSparse", low, high);
+  const ValueMap<T> map(low, high);
+  // A mask word below the threshold keeps its element.
+  const std::uint64_t threshold =
+      static_cast<std::uint64_t>(density * 4294967296.0);
+  if (threshold > 0xFFFFFFFFu) {
+    uniform(M, low, high, seed);
+    return;
+  }
+  const std::uint32_t keep = static_cast<std::uint32_t>(threshold);
+  forRows(M, [&](int first, int last) {
+    std::vector<std::uint32_t> buffer, maskBuffer;
+    for (int i = first; i < last; ++i) {
+      uniformRow(M, i, 0, M.cols(), seed, map, buffer);
+      T *row = M.row(i);
+      const std::uint64_t rowStart = static_cast<std::uint64_t>(i) * M.cols();
+      for (int j = 0; j < M.cols(); j += chunk) {
+        const int count = std::min(chunk, M.cols() - j);
+        const std::uint32_t *mask =
+            streamWords(seed, maskStream, rowStart + j, count, maskBuffer);
+        for (int q = 0; q < count; ++q)
+          row[j + q] = mask[q] < keep ? row[j + q] : T(0);
+      }
+    }
+  });
+}
+
+} // namespace
+
+std::array<std::uint32_t, 4> philox4x32(std::array<std::uint32_t, 4> counter,
+                                        std::array<std::uint32_t, 2> key) {
+  std::array<std::uint32_t, 4> c = counter;
+  std::uint32_t k0 = key[0], k1 = key[1];
+  for (int r = 0; r < philoxRounds; ++r) {
+    const std::uint64_t p0 = static_cast<std::uint64_t>(philoxM0) * c[0];
+    const std::uint64_t p1 = static_cast<std::uint64_t>(philoxM1) * c[2];
+    c = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k0,
+         static_cast<std::uint32_t>(p1),
+         static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k1,
+         static_cast<std::uint32_t>(p0)};
+    k0 += philoxW0;
+    k1 += philoxW1;
+  }
+  return c;
+}
+
+void fillUniform(MatrixView<int> M, int low, int high, std::uint64_t seed) {
+  uniform(M, low, high, seed);
+}
+
+void fillUniform(MatrixView<float> M, float low, float high,
+                 std::uint64_t seed) {
+  uniform(M, low, high, seed);
+}
+
+void fillUniform(MatrixView<double> M, double low, double high,
+                 std::uint64_t seed) {
+  uniform(M, low, high, seed);
+}
+
+template <typename T> void fillIdentity(MatrixView<T> M) {
+  forRows(M, [&](int first, int last) {
+    for (int i = first; i < last; ++i) {
+      std::fill(M.row(i), M.row(i) + M.cols(), T(0));
+      if (i < M.cols())
+        M(i, i) = T(1);
+    }
+  });
+}
+
+template void fillIdentity(MatrixView<int>);
+template void fillIdentity(MatrixView<float>);
+template void fillIdentity(MatrixView<double>);
+
+void fillBanded(MatrixView<int> M, int lower, int upper, int low, int high,
+                std::uint64_t seed) {
+  banded(M, lower, upper, low, high, seed);
+}
+
+void fillBanded(MatrixView<float> M, int lower, int upper, float low,
+                float high, std::uint64_t seed) {
+  banded(M, lower, upper, low, high, seed);
+}
+
+void fillBanded(MatrixView<double> M, int lower, int upper, double low,
+                double high, std::uint64_t seed) {
+  banded(M, lower, upper, low, high, seed);
+}
+
+void fillSparse(MatrixView<int> M, double density, int low, int high,
+                std::uint64_t seed) {
+  sparse(M, density, low, high, seed);
+}
+
+void fillSparse(MatrixView<float> M, double density, float low, float high,
+                std::uint64_t seed) {
+  sparse(M, density, low, high, seed);
+}
+
+void fillSparse(MatrixView<double> M, double density, double low,
+                double high, std::uint64_t seed) {
+  sparse(M, density, low, high, seed);
+}
@@ -0,0 +1,371 @@
+#include "thread_pool.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <exception>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+
+struct ThreadPool::Job {
+  const std::function<void(int)> *fn;
+  std::atomic<int> remaining;
+  std::mutex mutex;
+  std::condition_variable done;
+  std::exception_ptr error;
+#ifdef MATMUL_INSTRUMENTATION
+  // Profiled call that submitted the job, credited with its tasks.
+  profiling::Call *call = nullptr;
+#endif
+};
+
+namespace {
+
+// Pool and queue of the worker running on this thread, if any, so that a
+// nested parallelFor() starts with the worker's own deque.
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local int currentQueue = -1;
+
+std::mutex settingsMutex;
+int configuredThreads = 0;
+bool configuredPinning = false;
+NumaPolicy configuredPolicy = NumaPolicy::None;
+std::vector<NumaNode> configuredNodes;
+bool configuredSynthetic = false;
+std::shared_ptr<ThreadPool> sharedPool;
+
+void pinToCpu(int worker) {
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return;
+  const int cpus = CPU_COUNT(&allowed);
+  if (cpus == 0)
+    return;
+  // Worker w gets the (w + 1)-th allowed CPU, leaving the first one to the
+  // calling thread.
+  int target = (worker + 1) % cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &allowed) || target-- != 0)
+      continue;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    return;
+  }
+}
+
+// Binds the calling thread to the CPUs of a node, or with `pin` to the one
+// of them picked by its rank among the workers of the node.
+void bindToNode(const NumaNode &node, int rank, bool pin) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pin) {
+    CPU_SET(node.cpus[rank % node.cpus.size()], &set);
+  } else {
+    for (int cpu : node.cpus)
+      CPU_SET(cpu, &set);
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(int threads, bool pin, const NumaTopology &topology)
+    : topology_(topology) {
+  if (threads <= 0)
+    throw std::invalid_argument("ThreadPool: thread count must be positive");
+  for (int i = 0; i < threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+  nodes_ = std::max(
+      1, std::min(threads, static_cast<int>(topology.nodes.size())));
+  for (int q = 0; q < threads; ++q)
+    queueNode_.push_back(static_cast<int>(static_cast<long>(q) * nodes_ /
+                                          threads));
+  boundPending_ = std::vector<std::atomic<int>>(nodes_);
+
+  // The last queue belongs to the threads calling parallelFor().
+  for (int w = 0; w + 1 < threads; ++w) {
+    const int node = queueNode_[w];
+    const int rank = static_cast<int>(
+        std::count(queueNode_.begin(), queueNode_.begin() + w, node));
+    const NumaNode bound = nodes_ > 1 ? topology.nodes[node] : NumaNode();
+    workers_.emplace_back([this, w, pin, bound, rank] {
+      if (!bound.cpus.empty())
+        bindToNode(bound, rank, pin);
+      else if (pin)
+        pinToCpu(w);
+      workerLoop(w);
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &worker : workers_)
+    worker.join();
+}
+
+bool ThreadPool::popOwn(int queue, Task &task) {
+  Queue &q = *queues_[queue];
+  std::lock_guard<std::mutex> lock(q.mutex);
+  if (q.tasks.empty())
+    return false;
+  task = q.tasks.back();
+  q.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::steal(int thief, Task &task) {
+  // Victims on the thief's node first, then the others.
+  const int node = queueNode_[thief];
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int offset = 1; offset < size(); ++offset) {
+      const int victim = (thief + offset) % size();
+      if ((queueNode_[victim] == node) != (pass == 0))
+        continue;
+      Queue &q = *queues_[victim];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      // The oldest task the thief may run; a task bound to another node
+      // must not hide the ones queued behind it.
+      const auto it =
+          std::find_if(q.tasks.begin(), q.tasks.end(), [node](const Task &t) {
+            return t.node < 0 || t.node == node;
+          });
+      if (it == q.tasks.end())
+        continue;
+      task = *it;
+      q.tasks.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(const Task &task) {
+  (task.node < 0 ? pending_ : boundPending_[task.node])
+      .fetch_sub(1, std::memory_order_relaxed);
+  Job &job = *task.job;
+  try {
+    MATMUL_TASK(job.call);
+    (*job.fn)(task.index);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (!job.error)
+      job.error = std::current_exception();
+  }
+  // Decremented under the job mutex: parallelFor() takes it before returning,
+  // so the job cannot be destroyed while this thread still touches it.
+  std::lock_guard<std::mutex> lock(job.mutex);
+  if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    job.done.notify_all();
+}
+
+void ThreadPool::workerLoop(int queue) {
+  currentPool = this;
+  currentQueue = queue;
+  // Only tasks this worker may run keep it awake: tasks bound to other nodes
+  // are not counted.
+  const std::atomic<int> &bound = boundPending_[queueNode_[queue]];
+  const auto runnable = [this, &bound] {
+    return pending_.load(std::memory_order_relaxed) > 0 ||
+           bound.load(std::memory_order_relaxed) > 0;
+  };
+  for (;;) {
+    Task task;
+    if (popOwn(queue, task) || steal(queue, task)) {
+      run(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    wake_.wait(lock, [this, &runnable] { return stopping_ || runnable(); });
+    if (stopping_ && !runnable())
+      return;
+  }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)> &task) {
+  if (count <= 0)
+    return;
+  if (count == 1 || size() == 1) {
+    for (int i = 0; i < count; ++i)
+      task(i);
+    return;
+  }
+
+  Job job;
+  job.fn = &task;
+  job.remaining.store(count, std::memory_order_relaxed);
+#ifdef MATMUL_INSTRUMENTATION
+  job.call = profiling::currentCall();
+#endif
+
+  // Contiguous chunks keep neighbouring tasks, which usually share operand
+  // data, on the same thread until stealing kicks in.
+  const int queues = size();
+  for (int q = 0; q < queues; ++q) {
+    const int begin = static_cast<int>(static_cast<long>(count) * q / queues);
+    const int end = static_cast<int>(static_cast<long>(count) * (q + 1) / queues);
+    if (begin == end)
+      continue;
+    std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+    // Pushed in reverse so that the owner, popping from the back, walks its
+    // chunk in order while thieves take the far end.
+    for (int i = end - 1; i >= begin; --i)
+      queues_[q]->tasks.push_back({&job, i, -1});
+  }
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    pending_.fetch_add(count, std::memory_order_relaxed);
+  }
+  wake_.notify_all();
+  wait(job);
+}
+
+int ThreadPool::taskNode(int count, int index) const {
+  // Inverse of the chunking of parallelFor().
+  const int queues = size();
+  int q = static_cast<int>(static_cast<long>(index) * queues / count);
+  while (q + 1 < queues &&
+         static_cast<long>(count) * (q + 1) / queues <= index)
+    ++q;
+  while (q > 0 && static_cast<long>(count) * q / queues > index)
+    --q;
+  return queueNode_[q];
+}
+
+int ThreadPool::currentNode() const {
+  return queueNode_[currentPool == this ? currentQueue : size() - 1];
+}
+
+void ThreadPool::forEachNode(const std::function<void(int)> &task) {
+  if (nodes_ == 1) {
+    task(0);
+    return;
+  }
+
+  Job job;
+  job.fn = &task;
+  job.remaining.store(nodes_, std::memory_order_relaxed);
+#ifdef MATMUL_INSTRUMENTATION
+  job.call = profiling::currentCall();
+#endif
+  for (int node = 0; node < nodes_; ++node) {
+    // The first queue of the node; a node whose only queue is the caller's
+    // may have nobody to run a bound task, so it gets an unbound one.
+    const int q = static_cast<int>(
+        std::find(queueNode_.begin(), queueNode_.end(), node) -
+        queueNode_.begin());
+    std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+    const int bound = q + 1 < size() ? node : -1;
+    queues_[q]->tasks.push_back({&job, node, bound});
+    std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+    (bound < 0 ? pending_ : boundPending_[bound])
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+  wake_.notify_all();
+  wait(job);
+}
+
+void ThreadPool::wait(Job &job) {
+  const int own = currentPool == this ? currentQueue : size() - 1;
+  MATMUL_PHASE(Idle);
+  while (job.remaining.load(std::memory_order_acquire) > 0) {
+    Task next;
+    if (popOwn(own, next) || steal(own, next)) {
+      run(next);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.done.wait(lock, [&job] {
+      return job.remaining.load(std::memory_order_acquire) == 0;
+    });
+  }
+
+  std::lock_guard<std::mutex> lock(job.mutex);
+  if (job.error)
+    std::rethrow_exception(job.error);
+}
+
+std::shared_ptr<ThreadPool> threadPool() {
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  if (!sharedPool) {
+    const int threads = configuredThreads > 0
+                            ? configuredThreads
+                            : static_cast<int>(std::thread::hardware_concurrency());
+    NumaTopology topology;
+    if (configuredPolicy != NumaPolicy::None) {
+      if (configuredNodes.empty())
+        topology = NumaTopology::detect();
+      else
+        topology = {configuredNodes, configuredSynthetic};
+    }
+    sharedPool = std::make_shared<ThreadPool>(std::max(threads, 1),
+                                              configuredPinning, topology);
+  }
+  return sharedPool;
+}
+
+void setThreadCount(int threads) {
+  if (threads <= 0)
+    throw std::invalid_argument("setThreadCount: thread count must be positive");
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  if (threads == configuredThreads)
+    return;
+  configuredThreads = threads;
+  // Calls in flight keep their reference to the old pool.
+  sharedPool.reset();
+}
+
+int threadCount() { return threadPool()->size(); }
+
+void setThreadPinning(bool pin) {
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  if (pin == configuredPinning)
+    return;
+  configuredPinning = pin;
+  sharedPool.reset();
+}
+
+bool threadPinning() {
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  return configuredPinning;
+}
+
+void setNumaPolicy(NumaPolicy policy) {
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  if (policy == configuredPolicy)
+    return;
+  configuredPolicy = policy;
+  sharedPool.reset();
+}
+
+NumaPolicy numaPolicy() {
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  return configuredPolicy;
+}
+
+void setNumaTopology(const NumaTopology &topology) {
+  if (topology.nodes.empty())
+    throw std::invalid_argument("setNumaTopology: no nodes");
+  for (const NumaNode &node : topology.nodes)
+    if (node.cpus.empty())
+      throw std::invalid_argument("setNumaTopology: node without CPUs");
+  std::lock_guard<std::mutex> lock(settingsMutex);
+  configuredNodes = topology.nodes;
+  configuredSynthetic = topology.synthetic;
+  sharedPool.reset();
+}
+
+NumaTopology numaTopology() {
+  {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    if (!configuredNodes.empty())
+      return {configuredNodes, configuredSynthetic};
+  }
+  return NumaTopology::detect();
+}
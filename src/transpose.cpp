@@ -0,0 +1,141 @@
+#include "transpose.h"
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Blocks up to this many elements on a side are transposed by plain loops;
+// 32 x 32 doubles are 8 KiB, a quarter of the smallest L1.
+constexpr int transposeLeaf = 32;
+
+template <typename T>
+void transposeBlock(ConstMatrixView<T> A, MatrixView<T> At) {
+  const int rows = A.rows(), cols = A.cols();
+  if (rows <= transposeLeaf && cols <= transposeLeaf) {
+    for (int i = 0; i < rows; ++i) {
+      const T *a = A.row(i);
+      for (int j = 0; j < cols; ++j)
+        At(j, i) = a[j];
+    }
+    return;
+  }
+  if (rows >= cols) {
+    const int half = rows / 2;
+    transposeBlock(A.block(0, 0, half, cols), At.block(0, 0, cols, half));
+    transposeBlock(A.block(half, 0, rows - half, cols),
+                   At.block(0, half, cols, rows - half));
+  } else {
+    const int half = cols / 2;
+    transposeBlock(A.block(0, 0, rows, half), At.block(0, 0, half, rows));
+    transposeBlock(A.block(0, half, rows, cols - half),
+                   At.block(half, 0, cols - half, rows));
+  }
+}
+
+// Swaps X with Y^T, X being rows x cols and Y cols x rows.
+template <typename T> void swapTransposed(MatrixView<T> X, MatrixView<T> Y) {
+  const int rows = X.rows(), cols = X.cols();
+  if (rows <= transposeLeaf && cols <= transposeLeaf) {
+    for (int i = 0; i < rows; ++i)
+      for (int j = 0; j < cols; ++j)
+        std::swap(X(i, j), Y(j, i));
+    return;
+  }
+  if (rows >= cols) {
+    const int half = rows / 2;
+    swapTransposed(X.block(0, 0, half, cols), Y.block(0, 0, cols, half));
+    swapTransposed(X.block(half, 0, rows - half, cols),
+                   Y.block(0, half, cols, rows - half));
+  } else {
+    const int half = cols / 2;
+    swapTransposed(X.block(0, 0, rows, half), Y.block(0, 0, half, rows));
+    swapTransposed(X.block(0, half, rows, cols - half),
+                   Y.block(half, 0, cols - half, rows));
+  }
+}
+
+template <typename T> void transposeSquare(MatrixView<T> A) {
+  const int n = A.rows();
+  if (n <= transposeLeaf) {
+    for (int i = 0; i < n; ++i)
+      for (int j = i + 1; j < n; ++j)
+        std::swap(A(i, j), A(j, i));
+    return;
+  }
+  const int half = n / 2;
+  transposeSquare(A.block(0, 0, half, half));
+  transposeSquare(A.block(half, half, n - half, n - half));
+  swapTransposed(A.block(0, half, half, n - half),
+                 A.block(half, 0, n - half, half));
+}
+
+// Transposes the unpadded rows x cols matrix stored at data in place: the
+// element at index p = i * cols + j moves to j * rows + i, which is
+// p * rows modulo rows * cols - 1 for all but the last element.
+template <typename T> void transposeCycles(T *data, int rows, int cols) {
+  const long size = static_cast<long>(rows) * cols;
+  if (size < 3)
+    return;
+  const long modulus = size - 1;
+  std::vector<bool> moved(size, false);
+  for (long start = 1; start < modulus; ++start) {
+    if (moved[start])
+      continue;
+    // Carry the element of each position to its destination around the
+    // cycle until it closes.
+    T carried = data[start];
+    long p = start;
+    do {
+      const long next = p * rows % modulus;
+      std::swap(carried, data[next]);
+      moved[next] = true;
+      p = next;
+    } while (p != start);
+  }
+}
+
+} // namespace
+
+template <typename T> void transpose(ConstMatrixView<T> A, MatrixView<T> At) {
+  if (At.rows() != A.cols() || At.cols() != A.rows())
+    throw std::invalid_argument("transpose: dimension mismatch");
+  transposeBlock(A, At);
+}
+
+template <typename T> Matrix<T> transpose(const Matrix<T> &A) {
+  Matrix<T> At(A.cols(), A.rows());
+  transpose(A.view(), At.view());
+  return At;
+}
+
+template <typename T> void transposeInPlace(MatrixView<T> A) {
+  if (A.rows() != A.cols())
+    throw std::invalid_argument("transposeInPlace: view is not square");
+  transposeSquare(A);
+}
+
+template <typename T> void transposeInPlace(Matrix<T> &A) {
+  if (A.rows() == A.cols()) {
+    transposeSquare(A.view());
+  } else if (A.ld() == A.cols()) {
+    transposeCycles(A.data(), A.rows(), A.cols());
+    A.reshape(A.cols(), A.rows());
+  } else {
+    A = transpose(A);
+  }
+}
+
+template void transpose(ConstMatrixView<int>, MatrixView<int>);
+template void transpose(ConstMatrixView<float>, MatrixView<float>);
+template void transpose(ConstMatrixView<double>, MatrixView<double>);
+template Matrix<int> transpose(const Matrix<int> &);
+template Matrix<float> transpose(const Matrix<float> &);
+template Matrix<double> transpose(const Matrix<double> &);
+template void transposeInPlace(MatrixView<int>);
+template void transposeInPlace(MatrixView<float>);
+template void transposeInPlace(MatrixView<double>);
+template void transposeInPlace(Matrix<int> &);
+template void transposeInPlace(Matrix<float> &);
+template void transposeInPlace(Matrix<double> &);
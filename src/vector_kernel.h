@@ -0,0 +1,95 @@
+#ifndef VECTOR_KERNEL_H
+#define VECTOR_KERNEL_H
+
+#include <algorithm>
+#include <type_traits>
+
+// Generic vector kernels (see VectorKernel in microkernel.h). Like the batch
+// kernels, they keep their sums in arrays whose innermost loop runs across
+// Lanes independent elements, so every translation unit that instantiates
+// them turns that loop into vector instructions of its own instruction set,
+// without reassociating floating-point sums. The anonymous namespace keeps
+// the instantiations of different instruction sets apart.
+namespace {
+
+// Sums wrap modulo 2^32 for int.
+template <typename T>
+using VectorSum = std::conditional_t<std::is_same_v<T, int>, unsigned, T>;
+
+// Rows handled together by gemv, sharing each load of x.
+constexpr int gemvRows = 4;
+
+// Columns of y kept in L1 by gevm while the rows of B stream past.
+constexpr int gevmBlock = 1024;
+
+// Dot products of `rows` rows of A with x, Lanes partial sums per row.
+template <typename T, int Lanes, int Rows>
+void gemvBlock(int k, const T *A, long lda, const T *x, T *y, long incy) {
+  using U = VectorSum<T>;
+  U sum[Rows][Lanes] = {};
+  int p = 0;
+  for (; p + Lanes <= k; p += Lanes)
+    for (int r = 0; r < Rows; ++r)
+      for (int l = 0; l < Lanes; ++l)
+        sum[r][l] += static_cast<U>(A[r * lda + p + l]) *
+                     static_cast<U>(x[p + l]);
+  for (int r = 0; r < Rows; ++r) {
+    U total = 0;
+    for (int l = 0; l < Lanes; ++l)
+      total += sum[r][l];
+    for (int q = p; q < k; ++q)
+      total += static_cast<U>(A[r * lda + q]) * static_cast<U>(x[q]);
+    y[r * incy] = static_cast<T>(total);
+  }
+}
+
+template <typename T, int Lanes>
+void gemv(int m, int k, const T *A, long lda, const T *x, T *y, long incy) {
+  int i = 0;
+  for (; i + gemvRows <= m; i += gemvRows)
+    gemvBlock<T, Lanes, gemvRows>(k, A + i * lda, lda, x, y + i * incy, incy);
+  for (; i < m; ++i)
+    gemvBlock<T, Lanes, 1>(k, A + i * lda, lda, x, y + i * incy, incy);
+}
+
+template <typename T>
+void gevm(int k, int n, const T *a, const T *B, long ldb, T *y) {
+  using U = VectorSum<T>;
+  U sum[gevmBlock];
+  for (int j0 = 0; j0 < n; j0 += gevmBlock) {
+    const int width = std::min(gevmBlock, n - j0);
+    std::fill(sum, sum + width, U(0));
+    int p = 0;
+    for (; p + 4 <= k; p += 4) {
+      const U a0 = a[p], a1 = a[p + 1], a2 = a[p + 2], a3 = a[p + 3];
+      const T *b = B + p * ldb + j0;
+      for (int j = 0; j < width; ++j)
+        sum[j] += a0 * static_cast<U>(b[j]) + a1 * static_cast<U>(b[ldb + j]) +
+                  a2 * static_cast<U>(b[2 * ldb + j]) +
+                  a3 * static_cast<U>(b[3 * ldb + j]);
+    }
+    for (; p < k; ++p) {
+      const U ap = a[p];
+      const T *b = B + p * ldb + j0;
+      for (int j = 0; j < width; ++j)
+        sum[j] += ap * static_cast<U>(b[j]);
+    }
+    for (int j = 0; j < width; ++j)
+      y[j0 + j] = static_cast<T>(sum[j]);
+  }
+}
+
+template <typename T>
+void outer(int m, int n, const T *a, long inca, const T *b, T *C, long ldc) {
+  using U = VectorSum<T>;
+  for (int i = 0; i < m; ++i) {
+    const U ai = a[i * inca];
+    T *c = C + i * ldc;
+    for (int j = 0; j < n; ++j)
+      c[j] = static_cast<T>(ai * static_cast<U>(b[j]));
+  }
+}
+
+} // namespace
+
+#endif // VECTOR_KERNEL_H
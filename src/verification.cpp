@@ -0,0 +1,281 @@
+#include "verification.h"
+#include "checksums.h"
+#include "engines.h"
+#include "matrix_multiplication.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+template <typename T>
+void checkDimensions(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                     ConstMatrixView<T> C) {
+  if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+    throw std::invalid_argument("verify: dimension mismatch");
+}
+
+// Sums are exact in the wrapping arithmetic of int, and taken in double for
+// floating point.
+template <typename T>
+using Sum = std::conditional_t<std::is_same_v<T, int>, unsigned, double>;
+
+template <typename T, typename V>
+std::vector<V> multiplyVector(ConstMatrixView<T> M, const std::vector<V> &x) {
+  std::vector<V> y(M.rows(), V(0));
+  for (int i = 0; i < M.rows(); ++i) {
+    const T *row = M.row(i);
+    V sum = 0;
+    for (int j = 0; j < M.cols(); ++j)
+      sum += static_cast<V>(row[j]) * x[j];
+    y[i] = sum;
+  }
+  return y;
+}
+
+// The same with |M|.
+template <typename T>
+std::vector<double> multiplyAbsolute(ConstMatrixView<T> M,
+                                     const std::vector<double> &x) {
+  std::vector<double> y(M.rows(), 0.0);
+  for (int i = 0; i < M.rows(); ++i) {
+    const T *row = M.row(i);
+    double sum = 0;
+    for (int j = 0; j < M.cols(); ++j)
+      sum += std::abs(static_cast<double>(row[j])) * x[j];
+    y[i] = sum;
+  }
+  return y;
+}
+
+// Whether `value` is within the floating-point error bound of `expected`,
+// `bound` being the magnitude of the terms and `terms` their number.
+template <typename T>
+bool withinBound(double value, double expected, double bound, long terms,
+                 double tolerance) {
+  const double limit = tolerance * static_cast<double>(terms + 2) *
+                           std::numeric_limits<T>::epsilon() * bound +
+                       std::numeric_limits<T>::min();
+  // Also false for NaN.
+  return std::abs(value - expected) <= limit;
+}
+
+bool freivaldsRound(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                    ConstMatrixView<int> C, std::mt19937_64 &random,
+                    const VerificationOptions &) {
+  std::vector<unsigned> x(B.cols());
+  for (unsigned &value : x)
+    value = static_cast<unsigned>(random());
+  return multiplyVector(A, multiplyVector(B, x)) == multiplyVector(C, x);
+}
+
+template <typename T>
+bool freivaldsRound(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                    ConstMatrixView<T> C, std::mt19937_64 &random,
+                    const VerificationOptions &options) {
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  std::vector<double> x(B.cols()), absX(B.cols());
+  for (int j = 0; j < B.cols(); ++j) {
+    x[j] = uniform(random);
+    absX[j] = std::abs(x[j]);
+  }
+  const std::vector<double> expected =
+      multiplyVector(A, multiplyVector(B, x));
+  const std::vector<double> bound =
+      multiplyAbsolute(A, multiplyAbsolute(B, absX));
+  const std::vector<double> actual = multiplyVector(C, x);
+  for (int i = 0; i < C.rows(); ++i)
+    if (!withinBound<T>(actual[i], expected[i], bound[i], A.cols(),
+                        options.tolerance))
+      return false;
+  return true;
+}
+
+template <typename T>
+bool verify(ConstMatrixView<T> A, ConstMatrixView<T> B, ConstMatrixView<T> C,
+            const VerificationOptions &options) {
+  checkDimensions(A, B, C);
+  if (options.rounds <= 0)
+    throw std::invalid_argument("verify: rounds must be positive");
+  std::mt19937_64 random(options.seed != 0 ? options.seed
+                                           : std::random_device{}());
+  for (int round = 0; round < options.rounds; ++round)
+    if (!freivaldsRound(A, B, C, random, options))
+      return false;
+  return true;
+}
+
+template <typename T>
+void multiplyAndVerify(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                       MatrixView<T> C, Engine engine,
+                       const VerificationOptions &options) {
+  multiply(A, B, C, engine);
+  if (!verify<T>(A, B, C, options))
+    throw std::runtime_error("multiplyVerified: product failed verification");
+}
+
+template <typename T>
+ChecksumReport multiplyChecksummed(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                                   MatrixView<T> C, Engine engine) {
+  checkDimensions<T>(A, B, C);
+  const Matrix<T> Af = appendColumnSums(A);
+  const Matrix<T> Bf = appendRowSums(B);
+  Matrix<T> Cf(A.rows() + 1, B.cols() + 1);
+  multiply(Af.view(), Bf.view(), Cf.view(), engine);
+  const ChecksumReport report = checkChecksums(A, B, Cf.view());
+  for (int i = 0; i < C.rows(); ++i)
+    std::copy(Cf.row(i), Cf.row(i) + C.cols(), C.row(i));
+  return report;
+}
+
+} // namespace
+
+template <typename T> Matrix<T> appendColumnSums(ConstMatrixView<T> A) {
+  Matrix<T> Af(A.rows() + 1, A.cols());
+  std::vector<Sum<T>> sums(A.cols(), Sum<T>(0));
+  for (int i = 0; i < A.rows(); ++i) {
+    std::copy(A.row(i), A.row(i) + A.cols(), Af.row(i));
+    for (int j = 0; j < A.cols(); ++j)
+      sums[j] += static_cast<Sum<T>>(A(i, j));
+  }
+  for (int j = 0; j < A.cols(); ++j)
+    Af(A.rows(), j) = static_cast<T>(sums[j]);
+  return Af;
+}
+
+template <typename T> Matrix<T> appendRowSums(ConstMatrixView<T> B) {
+  Matrix<T> Bf(B.rows(), B.cols() + 1);
+  for (int i = 0; i < B.rows(); ++i) {
+    std::copy(B.row(i), B.row(i) + B.cols(), Bf.row(i));
+    Sum<T> sum = 0;
+    for (int j = 0; j < B.cols(); ++j)
+      sum += static_cast<Sum<T>>(B(i, j));
+    Bf(i, B.cols()) = static_cast<T>(sum);
+  }
+  return Bf;
+}
+
+template <typename T>
+ChecksumReport checkChecksums(ConstMatrixView<T> A, ConstMatrixView<T> B,
+                              MatrixView<T> Cf) {
+  const int m = A.rows(), n = B.cols(), K = A.cols();
+  constexpr bool exact = std::is_same_v<T, int>;
+
+  // Magnitudes bounding the rounding errors: |A| |B| e for the rows and
+  // e^T |A| |B| for the columns.
+  std::vector<double> rowBound, columnBound;
+  if (!exact) {
+    rowBound = multiplyAbsolute(
+        A, multiplyAbsolute(B, std::vector<double>(n, 1.0)));
+    std::vector<double> absColumnSums(K, 0.0);
+    for (int i = 0; i < m; ++i)
+      for (int k = 0; k < K; ++k)
+        absColumnSums[k] += std::abs(static_cast<double>(A(i, k)));
+    columnBound.assign(n, 0.0);
+    for (int k = 0; k < K; ++k)
+      for (int j = 0; j < n; ++j)
+        columnBound[j] +=
+            absColumnSums[k] * std::abs(static_cast<double>(B(k, j)));
+  }
+
+  ChecksumReport report;
+  std::vector<Sum<T>> rowSums(m, Sum<T>(0)), columnSums(n, Sum<T>(0));
+  for (int i = 0; i < m; ++i)
+    for (int j = 0; j < n; ++j) {
+      rowSums[i] += static_cast<Sum<T>>(Cf(i, j));
+      columnSums[j] += static_cast<Sum<T>>(Cf(i, j));
+    }
+  const auto agrees = [&](Sum<T> sum, T checksum,
+                          const std::vector<double> &bound, int index,
+                          long terms) {
+    if constexpr (exact)
+      return sum == static_cast<Sum<T>>(checksum);
+    else
+      return withinBound<T>(sum, checksum, bound[index], terms, 1.0);
+  };
+  for (int i = 0; i < m; ++i)
+    if (!agrees(rowSums[i], Cf(i, n), rowBound, i, 2L * (K + n)))
+      report.rows.push_back(i);
+  for (int j = 0; j < n; ++j)
+    if (!agrees(columnSums[j], Cf(m, j), columnBound, j, 2L * (K + m)))
+      report.columns.push_back(j);
+
+  if (report.rows.size() == 1 && report.columns.size() == 1) {
+    const int i = report.rows[0], j = report.columns[0];
+    const Sum<T> missing = static_cast<Sum<T>>(Cf(i, n)) - rowSums[i];
+    Cf(i, j) = static_cast<T>(static_cast<Sum<T>>(Cf(i, j)) + missing);
+    report.corrected = true;
+  }
+  return report;
+}
+
+template Matrix<int> appendColumnSums(ConstMatrixView<int>);
+template Matrix<float> appendColumnSums(ConstMatrixView<float>);
+template Matrix<double> appendColumnSums(ConstMatrixView<double>);
+template Matrix<int> appendRowSums(ConstMatrixView<int>);
+template Matrix<float> appendRowSums(ConstMatrixView<float>);
+template Matrix<double> appendRowSums(ConstMatrixView<double>);
+template ChecksumReport checkChecksums(ConstMatrixView<int>,
+                                       ConstMatrixView<int>, MatrixView<int>);
+template ChecksumReport checkChecksums(ConstMatrixView<float>,
+                                       ConstMatrixView<float>,
+                                       MatrixView<float>);
+template ChecksumReport checkChecksums(ConstMatrixView<double>,
+                                       ConstMatrixView<double>,
+                                       MatrixView<double>);
+
+bool verifyProduct(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                   ConstMatrixView<int> C, const VerificationOptions &options) {
+  return verify(A, B, C, options);
+}
+
+bool verifyProduct(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                   ConstMatrixView<float> C,
+                   const VerificationOptions &options) {
+  return verify(A, B, C, options);
+}
+
+bool verifyProduct(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                   ConstMatrixView<double> C,
+                   const VerificationOptions &options) {
+  return verify(A, B, C, options);
+}
+
+void multiplyVerified(ConstMatrixView<int> A, ConstMatrixView<int> B,
+                      MatrixView<int> C, Engine engine,
+                      const VerificationOptions &options) {
+  multiplyAndVerify(A, B, C, engine, options);
+}
+
+void multiplyVerified(ConstMatrixView<float> A, ConstMatrixView<float> B,
+                      MatrixView<float> C, Engine engine,
+                      const VerificationOptions &options) {
+  multiplyAndVerify(A, B, C, engine, options);
+}
+
+void multiplyVerified(ConstMatrixView<double> A, ConstMatrixView<double> B,
+                      MatrixView<double> C, Engine engine,
+                      const VerificationOptions &options) {
+  multiplyAndVerify(A, B, C, engine, options);
+}
+
+ChecksumReport multiplyWithChecksums(ConstMatrixView<int> A,
+                                     ConstMatrixView<int> B, MatrixView<int> C,
+                                     Engine engine) {
+  return multiplyChecksummed(A, B, C, engine);
+}
+
+ChecksumReport multiplyWithChecksums(ConstMatrixView<float> A,
+                                     ConstMatrixView<float> B,
+                                     MatrixView<float> C, Engine engine) {
+  return multiplyChecksummed(A, B, C, engine);
+}
+
+ChecksumReport multiplyWithChecksums(ConstMatrixView<double> A,
+                                     ConstMatrixView<double> B,
+                                     MatrixView<double> C, Engine engine) {
+  return multiplyChecksummed(A, B, C, engine);
+}
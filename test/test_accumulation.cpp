@@ -0,0 +1,167 @@
+#include "matrix_multiplication.h"
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the overflow-safe accumulation policies. Results are checked
+// against an exact 64-bit triple loop, for every instruction set this CPU
+// supports.
+
+// Fills the matrix with random values close to INT_MIN or INT_MAX, so that
+// almost every product of two rows overflows an int
+void fillMatrixWithBigValues(Matrix<int>& A) {
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            int offset = std::rand() % 1000;
+            A(i, j) = std::rand() % 2 ? INT_MAX - offset : INT_MIN + offset;
+        }
+    }
+}
+
+// Exact product in 64-bit arithmetic
+Matrix<std::int64_t> exactProduct(ConstMatrixView<int> A, ConstMatrixView<int> B) {
+    Matrix<std::int64_t> C(A.rows(), B.cols(), 0);
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < B.cols(); ++j) {
+            for (int k = 0; k < A.cols(); ++k) {
+                C(i, j) += static_cast<std::int64_t>(A(i, k)) * B(k, j);
+            }
+        }
+    }
+    return C;
+}
+
+TEST(AccumulationTest, Int64ResultsAreExact) {
+
+    // Partial micro-tiles and several K blocks
+    setTileSizes({24, 48, 20});
+
+    Matrix<int> A(37, 45), B(45, 53);
+    fillMatrixWithBigValues(A);
+    fillMatrixWithBigValues(B);
+    Matrix<std::int64_t> expected = exactProduct(A, B);
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        Matrix<std::int64_t> C(37, 53);
+        multiply(A, B, C);
+        ASSERT_EQ(C, expected) << simdIsaName(isa);
+    }
+    setSimdIsa(detectSimdIsa());
+    setTileSizes(calibrateTileSizes());
+}
+
+TEST(AccumulationTest, SaturateClampsToIntRange) {
+
+    Matrix<int> A(21, 70), B(70, 19);
+    fillMatrixWithBigValues(A);
+    fillMatrixRandomly(B);
+    Matrix<std::int64_t> exact = exactProduct(A, B);
+    Matrix<int> expected(21, 19);
+    for (int i = 0; i < 21; ++i) {
+        for (int j = 0; j < 19; ++j) {
+            expected(i, j) = static_cast<int>(std::min<std::int64_t>(std::max<std::int64_t>(exact(i, j), INT_MIN), INT_MAX));
+        }
+    }
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        Matrix<int> C(21, 19);
+        multiply(A, B, C, Accumulation::Saturate);
+        ASSERT_EQ(C, expected) << simdIsaName(isa);
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(AccumulationTest, CheckedThrowsOnlyOnOverflow) {
+
+    Matrix<int> A(30, 40), B(40, 25), C(30, 25);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    multiply(A, B, C, Accumulation::Checked);
+    ASSERT_EQ(C, expectedProduct(A, B));
+
+    // A single element out of range is enough
+    A(29, 39) = INT_MAX;
+    B(39, 24) = 2;
+    ASSERT_THROW(multiply(A, B, C, Accumulation::Checked), std::overflow_error);
+}
+
+TEST(AccumulationTest, WrapMatchesIntEngines) {
+
+    Matrix<int> A(20, 30, 2000000000), B(30, 20, 3), C(20, 20);
+
+    multiply(A, B, C, Accumulation::Wrap);
+
+    ASSERT_EQ(C, multiply(A, B, Engine::Reference));
+}
+
+TEST(AccumulationTest, ParallelTiles) {
+
+    setThreadCount(4);
+
+    Matrix<int> A(200, 150), B(150, 170);
+    fillMatrixWithBigValues(A);
+    fillMatrixWithBigValues(B);
+    Matrix<std::int64_t> C(200, 170);
+
+    multiply(A, B, C);
+    ASSERT_EQ(C, exactProduct(A, B));
+
+    Matrix<int> narrow(200, 170);
+    ASSERT_THROW(multiply(A, B, narrow, Accumulation::Checked), std::overflow_error);
+}
+
+TEST(AccumulationTest, SingleThreadSeveralBands) {
+
+    // Above the parallel threshold on one thread: m spans several mc bands
+    // and K several kc panels, all with one mc x nc block of sums.
+    setThreadCount(1);
+    setTileSizes({48, 64, 40});
+
+    Matrix<int> A(300, 210), B(210, 150);
+    fillMatrixWithBigValues(A);
+    fillMatrixWithBigValues(B);
+    Matrix<std::int64_t> exact = exactProduct(A, B);
+    Matrix<int> expected(300, 150);
+    for (int i = 0; i < 300; ++i) {
+        for (int j = 0; j < 150; ++j) {
+            expected(i, j) = static_cast<int>(std::min<std::int64_t>(std::max<std::int64_t>(exact(i, j), INT_MIN), INT_MAX));
+        }
+    }
+
+    Matrix<std::int64_t> C(300, 150);
+    multiply(A, B, C);
+    EXPECT_EQ(C, exact);
+    Matrix<int> saturated(300, 150);
+    multiply(A, B, saturated, Accumulation::Saturate);
+    EXPECT_EQ(saturated, expected);
+
+    setTileSizes(calibrateTileSizes());
+    setThreadCount(4);
+}
+
+TEST(AccumulationTest, EmptyInnerDimension) {
+
+    Matrix<int> A(5, 0), B(0, 6);
+    Matrix<std::int64_t> C(5, 6, 7);
+
+    multiply(A, B, C);
+
+    ASSERT_EQ(C, Matrix<std::int64_t>(5, 6, 0));
+}
+
+TEST(AccumulationTest, DimensionMismatch) {
+
+    Matrix<int> A(3, 4), B(5, 6);
+    Matrix<std::int64_t> C(3, 6);
+    Matrix<int> narrow(3, 6);
+
+    ASSERT_THROW(multiply(A, B, C), std::invalid_argument);
+    ASSERT_THROW(multiply(A, B, narrow, Accumulation::Saturate), std::invalid_argument);
+}
@@ -0,0 +1,153 @@
+#include "matrix_multiplication.h"
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the asynchronous products of async.h. Every product is checked
+// against multiplyMatricesWithoutErrors.
+
+// Operands and result of one submitted product
+struct Product {
+    Product(int m, int k, int n) : A(m, k), B(k, n), C(m, n) {
+        fillMatrixRandomly(A);
+        fillMatrixRandomly(B);
+    }
+    Matrix<int> A, B, C;
+};
+
+TEST(AsyncTest, FuturesOfManyProducts) {
+
+    setThreadCount(4);
+    const int shapes[][3] = {{200, 300, 250}, {3, 3, 3}, {64, 1000, 70},
+                             {1, 500, 1}, {129, 65, 257}, {4, 0, 4}};
+    const Engine engines[] = {Engine::Auto, Engine::Simd, Engine::Parallel};
+
+    std::vector<Product> products;
+    for (int e = 0; e < 3; ++e)
+        for (const auto& shape : shapes)
+            products.emplace_back(shape[0], shape[1], shape[2]);
+    std::vector<std::future<void>> futures;
+    for (std::size_t p = 0; p < products.size(); ++p)
+        futures.push_back(multiplyAsync(products[p].A.view(), products[p].B.view(), products[p].C.view(),
+                                        engines[p / 6]));
+
+    for (std::size_t p = 0; p < products.size(); ++p) {
+        futures[p].get();
+        EXPECT_EQ(products[p].C, expectedProduct(products[p].A, products[p].B)) << "product " << p;
+    }
+}
+
+TEST(AsyncTest, PackedPanelsAcrossBlocks) {
+
+    // Small tiles give several blocks of k and of columns, whose panels of B
+    // are taken from the copy packed ahead.
+    const TileSizes saved = tileSizes();
+    setTileSizes({32, 48, 24});
+    std::vector<Product> products;
+    for (int p = 0; p < 8; ++p)
+        products.emplace_back(70 + p, 100 + 13 * p, 90 + 7 * p);
+    std::vector<std::future<void>> futures;
+    for (std::size_t p = 0; p < products.size(); ++p)
+        futures.push_back(multiplyAsync(products[p].A.view(), products[p].B.view(), products[p].C.view(),
+                                        p % 2 ? Engine::Simd : Engine::Parallel));
+    for (std::size_t p = 0; p < products.size(); ++p) {
+        futures[p].get();
+        EXPECT_EQ(products[p].C, expectedProduct(products[p].A, products[p].B));
+    }
+    setTileSizes(saved);
+}
+
+TEST(AsyncTest, CallbacksRunInSubmissionOrder) {
+
+    std::vector<Product> products;
+    for (int p = 0; p < 20; ++p)
+        products.emplace_back(10 + 5 * p, 40, 30);
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<int> order;
+    for (int p = 0; p < 20; ++p) {
+        multiplyAsync(products[p].A.view(), products[p].B.view(), products[p].C.view(),
+                      [&, p](std::exception_ptr error) {
+                          EXPECT_FALSE(error);
+                          std::lock_guard<std::mutex> lock(mutex);
+                          order.push_back(p);
+                          finished.notify_all();
+                      });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return order.size() == 20; });
+
+    for (int p = 0; p < 20; ++p) {
+        EXPECT_EQ(order[p], p);
+        EXPECT_EQ(products[p].C, expectedProduct(products[p].A, products[p].B));
+    }
+}
+
+TEST(AsyncTest, CallbackSubmitsNextProduct) {
+
+    Product first(50, 60, 70), second(50, 70, 40);
+    std::promise<void> done;
+    multiplyAsync(first.A.view(), first.B.view(), first.C.view(), [&](std::exception_ptr) {
+        second.A = first.C;
+        multiplyAsync(second.A.view(), second.B.view(), second.C.view(),
+                      [&](std::exception_ptr) { done.set_value(); });
+    });
+    done.get_future().get();
+
+    EXPECT_EQ(second.C, expectedProduct(expectedProduct(first.A, first.B), second.B));
+}
+
+TEST(AsyncTest, ErrorsReachFutureAndCallback) {
+
+    Matrix<int> A(4, 5), B(6, 3), C(4, 3);
+    std::future<void> future = multiplyAsync(A.view(), B.view(), C.view());
+    EXPECT_THROW(future.get(), std::invalid_argument);
+
+    std::promise<std::exception_ptr> reported;
+    multiplyAsync(A.view(), B.view(), C.view(),
+                  [&](std::exception_ptr error) { reported.set_value(error); });
+    const std::exception_ptr error = reported.get_future().get();
+    ASSERT_TRUE(error);
+    EXPECT_THROW(std::rethrow_exception(error), std::invalid_argument);
+
+    // The queue keeps going after a failed product.
+    Product product(30, 40, 50);
+    multiplyAsync(product.A.view(), product.B.view(), product.C.view()).get();
+    EXPECT_EQ(product.C, expectedProduct(product.A, product.B));
+}
+
+TEST(AsyncTest, FloatingPoint) {
+
+    Matrix<float> Af(150, 200), Bf(200, 100), Cf(150, 100);
+    Matrix<double> Ad(150, 200), Bd(200, 100), Cd(150, 100);
+    for (int i = 0; i < 150; ++i)
+        for (int k = 0; k < 200; ++k)
+            Af(i, k) = static_cast<float>(Ad(i, k) = (std::rand() % 20) - 10);
+    for (int k = 0; k < 200; ++k)
+        for (int j = 0; j < 100; ++j)
+            Bf(k, j) = static_cast<float>(Bd(k, j) = (std::rand() % 20) - 10);
+
+    std::future<void> single = multiplyAsync(Af.view(), Bf.view(), Cf.view(), Engine::Parallel);
+    std::future<void> dual = multiplyAsync(Ad.view(), Bd.view(), Cd.view());
+    single.get();
+    dual.get();
+
+    // Sums of small integers are exact in both types.
+    for (int i = 0; i < 150; ++i) {
+        for (int j = 0; j < 100; ++j) {
+            double expected = 0;
+            for (int k = 0; k < 200; ++k)
+                expected += Ad(i, k) * Bd(k, j);
+            EXPECT_EQ(Cd(i, j), expected);
+            EXPECT_EQ(Cf(i, j), static_cast<float>(expected));
+        }
+    }
+}
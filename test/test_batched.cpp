@@ -0,0 +1,92 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the batched API. Every product of a batch is checked against
+// multiplyMatricesWithoutErrors, for every instruction set this CPU supports.
+
+// Checks a strided batch of `batch` products of the given shape
+void checkStridedBatch(int batch, int m, int k, int n) {
+    // Every matrix of the batch is a band of rows of one tall matrix
+    Matrix<int> A(batch * m, k), B(batch * k, n), C(batch * m, n);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    multiplyBatched(batch, m, k, n, A.data(), A.ld(), static_cast<long>(m) * A.ld(),
+                    B.data(), B.ld(), static_cast<long>(k) * B.ld(),
+                    C.data(), C.ld(), static_cast<long>(m) * C.ld());
+
+    for (int b = 0; b < batch; ++b) {
+        Matrix<int> expected = expectedProduct(A.view().block(b * m, 0, m, k), B.view().block(b * k, 0, k, n));
+        ASSERT_EQ(Matrix<int>(C.view().block(b * m, 0, m, n)), expected) << "product " << b;
+    }
+}
+
+TEST(BatchedMultiplicationTest, SmallInterleavedProducts) {
+
+    // Batch sizes that leave the last group of lanes partially filled
+    for (int isa = 0; isa <= static_cast<int>(detectSimdIsa()); ++isa) {
+        setSimdIsa(static_cast<SimdIsa>(isa));
+        checkStridedBatch(37, 3, 5, 4);
+        checkStridedBatch(1, 1, 1, 1);
+        checkStridedBatch(100, 8, 8, 8);
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(BatchedMultiplicationTest, LargerProductsInParallel) {
+
+    setThreadCount(4);
+    checkStridedBatch(9, 20, 33, 17);
+}
+
+TEST(BatchedMultiplicationTest, PointerArray) {
+
+    const int batch = 21;
+    std::vector<Matrix<int>> A(batch, Matrix<int>(4, 6)), B(batch, Matrix<int>(6, 2)), C(batch, Matrix<int>(4, 2));
+    std::vector<const int*> a, b;
+    std::vector<int*> c;
+    for (int i = 0; i < batch; ++i) {
+        fillMatrixRandomly(A[i]);
+        fillMatrixRandomly(B[i]);
+        a.push_back(A[i].data());
+        b.push_back(B[i].data());
+        c.push_back(C[i].data());
+    }
+
+    multiplyBatched(batch, 4, 6, 2, a.data(), 6, b.data(), 2, c.data(), 2);
+
+    for (int i = 0; i < batch; ++i) {
+        ASSERT_EQ(C[i], expectedProduct(A[i], B[i])) << "product " << i;
+    }
+}
+
+TEST(BatchedMultiplicationTest, MixedShapeViews) {
+
+    std::vector<Matrix<int>> A, B, C;
+    for (int i = 0; i < 12; ++i) {
+        A.emplace_back(1 + i, 2 + i % 5);
+        B.emplace_back(2 + i % 5, 3 + i % 4);
+        C.emplace_back(1 + i, 3 + i % 4);
+        fillMatrixRandomly(A.back());
+        fillMatrixRandomly(B.back());
+    }
+    std::vector<ConstMatrixView<int>> a(A.begin(), A.end()), b(B.begin(), B.end());
+    std::vector<MatrixView<int>> c(C.begin(), C.end());
+
+    multiplyBatched(a, b, c);
+
+    for (int i = 0; i < 12; ++i) {
+        ASSERT_EQ(C[i], expectedProduct(A[i], B[i])) << "product " << i;
+    }
+}
+
+TEST(BatchedMultiplicationTest, InvalidLeadingDimension) {
+
+    std::vector<int> buffer(64);
+
+    ASSERT_THROW(multiplyBatched(2, 2, 4, 2, buffer.data(), 3, 8, buffer.data(), 2, 8, buffer.data(), 2, 4), std::invalid_argument);
+}
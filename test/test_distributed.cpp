@@ -0,0 +1,145 @@
+#include "matrix_multiplication.h"
+#include "distributed.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <mpi.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the distributed products. The executable runs under mpiexec on
+// four processes (see CMakeLists.txt) and has its own main(): every process
+// runs every test, and only rank 0 prints the results.
+
+// Fills the matrix with values of the interval [-10, 9] that depend only on
+// the seed, so that every process builds the same operands
+template <typename T>
+void fillMatrixRandomly(Matrix<T>& A, unsigned seed) {
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            seed = seed * 1103515245u + 12345u;
+            A(i, j) = static_cast<T>(static_cast<int>((seed >> 16) % 20) - 10);
+        }
+    }
+}
+
+int rank() {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank;
+}
+
+// Multiplies whole matrices held by rank 0 and checks C there
+void checkFromRoot(const ProcessGrid& grid, int m, int k, int n,
+                   DistributedAlgorithm algorithm) {
+    Matrix<int> A(m, k), B(k, n), C(m, n);
+    fillMatrixRandomly(A, 1);
+    fillMatrixRandomly(B, 2);
+    multiplyFromRoot(grid, A.view(), B.view(), C.view(), algorithm);
+    if (rank() == 0) {
+        EXPECT_EQ(C, expectedProduct(A.view(), B.view())) << m << "x" << k << "x" << n;
+    }
+}
+
+TEST(DistributedTest, SummaOnEveryGridShape) {
+
+    const int shapes[][2] = {{0, 0}, {1, 4}, {4, 1}, {2, 2}};
+    for (const auto& shape : shapes) {
+        ProcessGrid grid(MPI_COMM_WORLD, shape[0], shape[1]);
+        checkFromRoot(grid, 37, 53, 29, DistributedAlgorithm::Summa);
+        checkFromRoot(grid, 64, 600, 48, DistributedAlgorithm::Summa);
+        checkFromRoot(grid, 3, 2, 1, DistributedAlgorithm::Summa);
+    }
+}
+
+TEST(DistributedTest, CannonOnSquareGrid) {
+
+    ProcessGrid grid(MPI_COMM_WORLD, 2, 2);
+    checkFromRoot(grid, 37, 53, 29, DistributedAlgorithm::Cannon);
+    checkFromRoot(grid, 64, 600, 48, DistributedAlgorithm::Cannon);
+    checkFromRoot(grid, 5, 1, 3, DistributedAlgorithm::Cannon);
+}
+
+TEST(DistributedTest, LocalBlocks) {
+
+    // Every process passes its own blocks and checks its block of C.
+    const int m = 41, k = 35, n = 50;
+    Matrix<int> A(m, k), B(k, n);
+    fillMatrixRandomly(A, 3);
+    fillMatrixRandomly(B, 4);
+    const Matrix<int> expected = expectedProduct(A.view(), B.view());
+
+    ProcessGrid grid(MPI_COMM_WORLD, 2, 2);
+    const BlockRange rows = blockRange(m, grid.rows(), grid.row());
+    const BlockRange cols = blockRange(n, grid.cols(), grid.col());
+    const BlockRange depthA = blockRange(k, grid.cols(), grid.col());
+    const BlockRange depthB = blockRange(k, grid.rows(), grid.row());
+    for (DistributedAlgorithm algorithm :
+         {DistributedAlgorithm::Summa, DistributedAlgorithm::Cannon}) {
+        Matrix<int> C(rows.size, cols.size);
+        multiplyDistributed(grid, m, k, n,
+                            A.view().block(rows.begin, depthA.begin, rows.size, depthA.size),
+                            B.view().block(depthB.begin, cols.begin, depthB.size, cols.size),
+                            C.view(), algorithm);
+        EXPECT_EQ(C, Matrix<int>(expected.view().block(rows.begin, cols.begin, rows.size, cols.size)));
+    }
+}
+
+TEST(DistributedTest, FloatingPoint) {
+
+    ProcessGrid grid(MPI_COMM_WORLD);
+    Matrix<double> A(30, 70), B(70, 20), C(30, 20);
+    fillMatrixRandomly(A, 5);
+    fillMatrixRandomly(B, 6);
+    multiplyFromRoot(grid, A.view(), B.view(), C.view());
+    Matrix<float> Af(30, 70), Bf(70, 20), Cf(30, 20);
+    fillMatrixRandomly(Af, 5);
+    fillMatrixRandomly(Bf, 6);
+    multiplyFromRoot(grid, Af.view(), Bf.view(), Cf.view(),
+                     DistributedAlgorithm::Cannon);
+    if (rank() != 0)
+        return;
+    for (int i = 0; i < 30; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            double expected = 0;
+            for (int l = 0; l < 70; ++l)
+                expected += A(i, l) * B(l, j);
+            EXPECT_NEAR(C(i, j), expected, 1e-9);
+            EXPECT_NEAR(Cf(i, j), expected, 1e-3);
+        }
+    }
+}
+
+TEST(DistributedTest, InvalidArguments) {
+
+    EXPECT_THROW(ProcessGrid(MPI_COMM_WORLD, 3, 1), std::invalid_argument);
+
+    ProcessGrid line(MPI_COMM_WORLD, 1, 4);
+    Matrix<int> A(8, 2), B(8, 2), C(8, 2);
+    EXPECT_THROW(multiplyDistributed(line, 8, 8, 8, A.view(), B.view(), C.view(),
+                                     DistributedAlgorithm::Cannon),
+                 std::invalid_argument);
+    Matrix<int> wrong(7, 2);
+    EXPECT_THROW(multiplyDistributed(line, 8, 8, 8, wrong.view(), B.view(), C.view()),
+                 std::invalid_argument);
+
+    // A mismatch on the root is reported on every process.
+    Matrix<int> X(4, 5), Y(6, 4), Z(4, 4);
+    EXPECT_THROW(multiplyFromRoot(line, X.view(), Y.view(), Z.view()),
+                 std::invalid_argument);
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    testing::InitGoogleTest(&argc, argv);
+    if (rank() != 0) {
+        testing::TestEventListeners& listeners = testing::UnitTest::GetInstance()->listeners();
+        delete listeners.Release(listeners.default_result_printer());
+    }
+    const int result = RUN_ALL_TESTS();
+    // Any failing process fails the run.
+    int failed = result != 0, anyFailed = 0;
+    MPI_Allreduce(&failed, &anyFailed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return anyFailed;
+}
@@ -0,0 +1,169 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the lazy expressions of expression.h. Products of int matrices
+// are checked against multiplyMatricesWithoutErrors.
+
+// alpha * P + beta * D, element by element
+Matrix<int> expectedSum(int alpha, const Matrix<int>& P, int beta, const Matrix<int>& D) {
+    Matrix<int> expected(P.rows(), P.cols());
+    for (int i = 0; i < P.rows(); ++i)
+        for (int j = 0; j < P.cols(); ++j)
+            expected(i, j) = alpha * P(i, j) + beta * D(i, j);
+    return expected;
+}
+
+TEST(ExpressionTest, ScaledProductPlusScaledMatrix) {
+
+    // Sizes of the Reference, Simd and Parallel engines, with edge tiles.
+    setThreadCount(4);
+    const int shapes[][3] = {{5, 7, 3}, {1, 1, 1}, {70, 90, 50}, {129, 65, 257}, {300, 200, 250}};
+    for (const auto& shape : shapes) {
+        const Matrix<int> A = randomMatrix(shape[0], shape[1]);
+        const Matrix<int> B = randomMatrix(shape[1], shape[2]);
+        const Matrix<int> C = randomMatrix(shape[0], shape[2]);
+        const Matrix<int> product = expectedProduct(A, B);
+
+        Matrix<int> D = 3 * A * B + 2 * C;
+        EXPECT_EQ(D, expectedSum(3, product, 2, C)) << shape[0] << "x" << shape[1] << "x" << shape[2];
+        Matrix<int> E = A * B - C;
+        EXPECT_EQ(E, expectedSum(1, product, -1, C));
+        Matrix<int> F = C + A * (B * -2);
+        EXPECT_EQ(F, expectedSum(-2, product, 1, C));
+        Matrix<int> G = A * B;
+        EXPECT_EQ(G, product);
+    }
+}
+
+TEST(ExpressionTest, AccumulatesInPlace) {
+
+    const Matrix<int> A = randomMatrix(150, 120), B = randomMatrix(120, 170);
+    Matrix<int> C = randomMatrix(150, 170);
+    const Matrix<int> before = C;
+
+    evaluate(A * B + C, C.view());
+    EXPECT_EQ(C, expectedSum(1, expectedProduct(A, B), 1, before));
+
+    // Into a block of a larger matrix, adding the block itself.
+    Matrix<int> big = randomMatrix(200, 200);
+    const Matrix<int> original = big;
+    const MatrixView<int> block = big.view().block(10, 20, 150, 170);
+    evaluate(2 * A * B - 3 * block, block);
+    Matrix<int> blockBefore(150, 170);
+    for (int i = 0; i < 150; ++i)
+        for (int j = 0; j < 170; ++j)
+            blockBefore(i, j) = original(10 + i, 20 + j);
+    const Matrix<int> expected = expectedSum(2, expectedProduct(A, B), -3, blockBefore);
+    for (int i = 0; i < 200; ++i)
+        for (int j = 0; j < 200; ++j) {
+            const bool inside = i >= 10 && i < 160 && j >= 20 && j < 190;
+            EXPECT_EQ(big(i, j), inside ? expected(i - 10, j - 20) : original(i, j));
+        }
+}
+
+TEST(ExpressionTest, OperandAliasingTheResult) {
+
+    // C = C * B reads C while writing it, so it goes through a temporary.
+    const Matrix<int> B = randomMatrix(100, 100);
+    Matrix<int> C = randomMatrix(100, 100);
+    const Matrix<int> before = C;
+    evaluate(C * B, C.view());
+    EXPECT_EQ(C, expectedProduct(before, B));
+
+    // A shifted block of C as the addend.
+    Matrix<int> A = randomMatrix(100, 100), big = randomMatrix(101, 101);
+    const Matrix<int> original = big;
+    evaluate(A * B + big.view().block(1, 1, 100, 100), big.view().block(0, 0, 100, 100));
+    Matrix<int> shifted(100, 100);
+    for (int i = 0; i < 100; ++i)
+        for (int j = 0; j < 100; ++j)
+            shifted(i, j) = original(i + 1, j + 1);
+    const Matrix<int> expected = expectedSum(1, expectedProduct(A, B), 1, shifted);
+    for (int i = 0; i < 100; ++i)
+        for (int j = 0; j < 100; ++j)
+            EXPECT_EQ(big(i, j), expected(i, j));
+}
+
+TEST(ExpressionTest, Chains) {
+
+    const Matrix<int> A = randomMatrix(30, 35), B = randomMatrix(35, 15), C = randomMatrix(15, 5),
+                      D = randomMatrix(5, 10), E = randomMatrix(10, 20);
+    Matrix<int> three = A * B * C;
+    EXPECT_EQ(three, expectedProduct(expectedProduct(A, B), C));
+    Matrix<int> five = A * (B * C) * D * E;
+    EXPECT_EQ(five, expectedProduct(expectedProduct(expectedProduct(expectedProduct(A, B), C), D), E));
+
+    // The sum of two chains, and a chain plus a matrix.
+    const Matrix<int> F = randomMatrix(30, 5), G = randomMatrix(20, 5);
+    Matrix<int> sums = A * B * C - 2 * F * D * (E * G);
+    const Matrix<int> right = expectedProduct(expectedProduct(expectedProduct(F, D), E), G);
+    EXPECT_EQ(sums, expectedSum(1, expectedProduct(expectedProduct(A, B), C), -2, right));
+    Matrix<int> chainPlus = 5 * A * B * C + F;
+    EXPECT_EQ(chainPlus, expectedSum(5, expectedProduct(expectedProduct(A, B), C), 1, F));
+}
+
+TEST(ExpressionTest, ChainOrder) {
+
+    const ChainOrder order = optimalChainOrder({30, 35, 15, 5, 10, 20, 25});
+    EXPECT_EQ(order.cost, 15125);
+    EXPECT_EQ(order.parenthesization, "((0 (1 2)) ((3 4) 5))");
+
+    EXPECT_EQ(optimalChainOrder({10, 20}).cost, 0);
+    EXPECT_EQ(optimalChainOrder({10, 20}).parenthesization, "0");
+    EXPECT_EQ(optimalChainOrder({10, 100, 5, 50}).cost, 7500);
+    EXPECT_EQ(optimalChainOrder({10, 100, 5, 50}).parenthesization, "((0 1) 2)");
+    EXPECT_THROW(optimalChainOrder({10}), std::invalid_argument);
+    EXPECT_THROW(optimalChainOrder({10, -1, 4}), std::invalid_argument);
+}
+
+TEST(ExpressionTest, FloatingPoint) {
+
+    setThreadCount(4);
+    Matrix<float> Af(200, 150), Bf(150, 180), Cf(200, 180);
+    Matrix<double> Ad(200, 150), Bd(150, 180), Cd(200, 180);
+    for (int i = 0; i < 200; ++i)
+        for (int k = 0; k < 150; ++k)
+            Af(i, k) = static_cast<float>(Ad(i, k) = (std::rand() % 20) - 10);
+    for (int k = 0; k < 150; ++k)
+        for (int j = 0; j < 180; ++j)
+            Bf(k, j) = static_cast<float>(Bd(k, j) = (std::rand() % 20) - 10);
+    for (int i = 0; i < 200; ++i)
+        for (int j = 0; j < 180; ++j)
+            Cf(i, j) = static_cast<float>(Cd(i, j) = (std::rand() % 20) - 10);
+
+    // Scales that are powers of two keep the sums of small integers exact.
+    Matrix<float> Df = 0.5f * Af * Bf + 0.25f * Cf;
+    evaluate(Ad * Bd * 2.0 + Cd, Cd.view());
+    for (int i = 0; i < 200; ++i) {
+        for (int j = 0; j < 180; ++j) {
+            double product = 0;
+            for (int k = 0; k < 150; ++k)
+                product += Ad(i, k) * Bd(k, j);
+            EXPECT_EQ(Df(i, j), static_cast<float>(0.5 * product + 0.25 * Cf(i, j)));
+            EXPECT_EQ(Cd(i, j), 2.0 * product + Cf(i, j));
+        }
+    }
+}
+
+TEST(ExpressionTest, EmptyInnerDimension) {
+
+    const Matrix<int> A(6, 0), B(0, 4), C = randomMatrix(6, 4);
+    Matrix<int> D = A * B + 3 * C;
+    EXPECT_EQ(D, expectedSum(0, C, 3, C));
+    Matrix<int> E = A * B;
+    EXPECT_EQ(E, Matrix<int>(6, 4));
+}
+
+TEST(ExpressionTest, DimensionMismatch) {
+
+    const Matrix<int> A(4, 5), B(6, 3), C(4, 3), D(5, 3);
+    EXPECT_THROW(A * B, std::invalid_argument);
+    EXPECT_THROW(A * D + B, std::invalid_argument);
+    Matrix<int> wrong(3, 3);
+    EXPECT_THROW(evaluate(A * D, wrong.view()), std::invalid_argument);
+    EXPECT_THROW(evaluate(A * D + C, wrong.view()), std::invalid_argument);
+}
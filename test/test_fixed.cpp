@@ -0,0 +1,64 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the compile-time specialized kernels and their runtime routing.
+
+// 2x2 product evaluated entirely at compile time
+constexpr FixedMatrix<int, 2, 2> fixedA{{1, 2, 3, 4}};
+constexpr FixedMatrix<int, 2, 2> fixedB{{5, 6, 7, 8}};
+static_assert(multiply(fixedA, fixedB) == FixedMatrix<int, 2, 2>{{19, 22, 43, 50}},
+              "constexpr 2x2 product");
+
+TEST(FixedSizeMultiplicationTest, FixedMatrixProduct) {
+
+    FixedMatrix<int, 3, 4> A;
+    FixedMatrix<int, 4, 2> B;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            A(i, j) = (std::rand() % 20) - 10;
+            B(j, i % 2) = (std::rand() % 20) - 10;
+        }
+    }
+
+    FixedMatrix<int, 3, 2> C = multiply(A, B);
+
+    ASSERT_EQ(Matrix<int>(C.view()), expectedProduct(Matrix<int>(A.view()), Matrix<int>(B.view())));
+}
+
+TEST(FixedSizeMultiplicationTest, RoutedSizes) {
+
+    for (int size : {2, 3, 4, 8}) {
+        const int shapes[3][3] = {{size, size, size}, {1, size, size}, {size, size, 1}};
+        for (const auto& shape : shapes) {
+            ASSERT_TRUE(hasFixedSizeKernel(shape[0], shape[1], shape[2]));
+
+            Matrix<int> A(shape[0], shape[1]), B(shape[1], shape[2]);
+            fillMatrixRandomly(A);
+            fillMatrixRandomly(B);
+
+            ASSERT_EQ(multiply(A, B), expectedProduct(A, B)) << shape[0] << "x" << shape[1] << "x" << shape[2];
+        }
+    }
+}
+
+TEST(FixedSizeMultiplicationTest, PaddedViews) {
+
+    Matrix<int> big(12, 12);
+    fillMatrixRandomly(big);
+    ConstMatrixView<int> A = big.view().block(1, 1, 4, 4);
+    ConstMatrixView<int> B = big.view().block(6, 3, 4, 4);
+    Matrix<int> C(4, 4, 9, 0);
+
+    multiply(A, B, C);
+
+    ASSERT_EQ(C, expectedProduct(Matrix<int>(A), Matrix<int>(B)));
+}
+
+TEST(FixedSizeMultiplicationTest, OtherSizesAreNotRouted) {
+
+    ASSERT_FALSE(hasFixedSizeKernel(5, 5, 5));
+    ASSERT_FALSE(hasFixedSizeKernel(2, 3, 4));
+}
@@ -0,0 +1,99 @@
+#include "matrix_multiplication.h"
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the float and double engines. Results are compared with a
+// long double triple loop, up to a tolerance that grows with K.
+
+// Checks C against the product of A and B computed in long double
+template <typename T>
+void expectNearProduct(const Matrix<T>& A, const Matrix<T>& B, const Matrix<T>& C, const char* what) {
+    const long double tolerance = A.cols() * (sizeof(T) == 4 ? 1e-6L : 1e-14L);
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < B.cols(); ++j) {
+            long double expected = 0;
+            for (int k = 0; k < A.cols(); ++k) {
+                expected += static_cast<long double>(A(i, k)) * B(k, j);
+            }
+            ASSERT_LE(std::fabs(expected - C(i, j)), tolerance) << what << " at (" << i << ", " << j << ")";
+        }
+    }
+}
+
+template <typename T>
+void checkEngines() {
+    // Partial micro-tiles and partial cache tiles
+    setTileSizes({24, 48, 20});
+
+    Matrix<T> A(37, 45), B(45, 53);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        expectNearProduct(A, B, multiply(A, B, Engine::Simd), simdIsaName(isa));
+    }
+    setSimdIsa(detectSimdIsa());
+
+    for (Engine engine : {Engine::Auto, Engine::Reference, Engine::Tiled, Engine::Parallel}) {
+        expectNearProduct(A, B, multiply(A, B, engine), "engine");
+    }
+    setTileSizes(calibrateTileSizes());
+}
+
+TEST(FloatingMultiplicationTest, FloatEngines) {
+
+    checkEngines<float>();
+}
+
+TEST(FloatingMultiplicationTest, DoubleEngines) {
+
+    checkEngines<double>();
+}
+
+TEST(FloatingMultiplicationTest, ParallelSubMatrixViews) {
+
+    setThreadCount(4);
+
+    Matrix<double> bigA(300, 260), bigB(270, 290);
+    fillMatrixRandomly(bigA);
+    fillMatrixRandomly(bigB);
+    Matrix<double> A(bigA.view().block(3, 5, 290, 250));
+    Matrix<double> B(bigB.view().block(7, 2, 250, 280));
+    Matrix<double> C(290, 280, 300, 0.0);
+
+    multiply(bigA.view().block(3, 5, 290, 250), bigB.view().block(7, 2, 250, 280), C, Engine::Parallel);
+
+    expectNearProduct(A, B, C, "parallel");
+}
+
+TEST(FloatingMultiplicationTest, Strassen) {
+
+    setStrassenCrossover(16);
+
+    Matrix<float> A(67, 70), B(70, 65);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    // Strassen adds and subtracts operands before multiplying, so its error
+    // bound is a few times larger than the classical one
+    Matrix<float> C = multiply(A, B, Engine::Strassen);
+    Matrix<float> classical = multiply(A, B, Engine::Reference);
+    for (int i = 0; i < C.rows(); ++i) {
+        for (int j = 0; j < C.cols(); ++j) {
+            ASSERT_NEAR(C(i, j), classical(i, j), 1e-3f);
+        }
+    }
+    setStrassenCrossover(512);
+}
+
+TEST(FloatingMultiplicationTest, DimensionMismatch) {
+
+    Matrix<float> A(3, 4), B(5, 6), C(3, 6);
+
+    ASSERT_THROW(multiply(A, B, C), std::invalid_argument);
+}
@@ -0,0 +1,36 @@
+#include "test_helpers.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+// Reference implementation, from src/matrix_mult.cpp
+void multiplyMatricesWithoutErrors(const std::vector<std::vector<int>>& A, const std::vector<std::vector<int>>& B,
+                                   std::vector<std::vector<int>>& C, int rowsA, int colsA, int colsB);
+
+void fillMatrixRandomly(Matrix<int>& A) {
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            A(i, j) = (std::rand() % 20) - 10;
+        }
+    }
+}
+
+Matrix<int> expectedProduct(ConstMatrixView<int> A, ConstMatrixView<int> B) {
+    std::vector<std::vector<int>> expected(A.rows(), std::vector<int>(B.cols(), 0));
+    multiplyMatricesWithoutErrors(Matrix<int>(A).toNested(), Matrix<int>(B).toNested(), expected, A.rows(), A.cols(), B.cols());
+    return Matrix<int>(expected);
+}
+
+std::vector<SimdIsa> supportedIsas() {
+    std::vector<SimdIsa> isas;
+    for (int isa = 0; isa <= static_cast<int>(detectSimdIsa()); ++isa) {
+        isas.push_back(static_cast<SimdIsa>(isa));
+    }
+    return isas;
+}
+
+TempFile::TempFile(const std::string& name)
+    : path(testing::TempDir() + testing::UnitTest::GetInstance()->current_test_info()->name() + "_" +
+           std::to_string(getpid()) + "_" + name) {}
+
+TempFile::~TempFile() { std::remove(path.c_str()); }
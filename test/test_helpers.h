@@ -0,0 +1,50 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Helpers shared by the tests of the matrix_multiplication library, built
+// once together with the reference implementation (src/matrix_mult.cpp).
+
+// Fills the matrix with random values of the interval [-10, 9]
+void fillMatrixRandomly(Matrix<int>& A);
+
+// Fills the matrix with random values of the interval [-1, 1]
+template <typename T>
+void fillMatrixRandomly(Matrix<T>& A) {
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            A(i, j) = static_cast<T>(std::rand() % 2001 - 1000) / 1000;
+        }
+    }
+}
+
+// Matrix of the given shape filled by fillMatrixRandomly()
+template <typename T = int>
+Matrix<T> randomMatrix(int rows, int cols) {
+    Matrix<T> M(rows, cols);
+    fillMatrixRandomly(M);
+    return M;
+}
+
+// Runs the reference implementation on the nested copies of A and B
+Matrix<int> expectedProduct(ConstMatrixView<int> A, ConstMatrixView<int> B);
+
+// Every instruction set the CPU supports
+std::vector<SimdIsa> supportedIsas();
+
+// File of the gtest temporary directory, removed when it goes out of scope.
+// The name is prefixed with the test name and the process id, so tests run
+// in parallel by ctest never share a file.
+struct TempFile {
+    explicit TempFile(const std::string& name);
+    ~TempFile();
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+    std::string path;
+};
+
+#endif // TEST_HELPERS_H
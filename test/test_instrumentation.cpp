@@ -0,0 +1,168 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include "test_helpers.h"
+
+// Tests for the per-call profiles of instrumentation.h. Most of them need a
+// library built with -DMATMUL_INSTRUMENTATION=ON and are skipped otherwise.
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// Profile of a single product run with the given engine
+CallProfile profileOf(int m, int k, int n, Engine engine) {
+    Matrix<int> A(m, k), B(k, n), C(m, n);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    clearCallProfiles();
+    multiply(A.view(), B.view(), C.view(), engine);
+    const std::vector<CallProfile> profiles = callProfiles();
+    EXPECT_EQ(profiles.size(), 1u);
+    return profiles.empty() ? CallProfile() : profiles.back();
+}
+
+#define REQUIRE_INSTRUMENTATION()                                   \
+    if (!instrumentationEnabled())                                  \
+        GTEST_SKIP() << "built without MATMUL_INSTRUMENTATION"
+
+TEST(InstrumentationTest, DisabledBuildRecordsNothing) {
+
+    if (instrumentationEnabled())
+        GTEST_SKIP() << "built with MATMUL_INSTRUMENTATION";
+    Matrix<int> A(64, 64), B(64, 64);
+    multiply(A, B);
+    EXPECT_TRUE(callProfiles().empty());
+
+    TempFile trace("empty_trace.json");
+    writeChromeTrace(trace.path);
+    EXPECT_NE(readFile(trace.path).find("\"traceEvents\":["), std::string::npos);
+}
+
+TEST(InstrumentationTest, SimdCallPhases) {
+
+    REQUIRE_INSTRUMENTATION();
+    const CallProfile profile = profileOf(200, 300, 100, Engine::Simd);
+
+    EXPECT_EQ(profile.engine, Engine::Simd);
+    EXPECT_STREQ(profile.type, "int");
+    EXPECT_EQ(profile.m, 200);
+    EXPECT_EQ(profile.k, 300);
+    EXPECT_EQ(profile.n, 100);
+    EXPECT_GT(profile.seconds, 0);
+    EXPECT_GT(profile.gops, 0);
+    EXPECT_GT(profile.packSeconds, 0);
+    EXPECT_GT(profile.computeSeconds, 0);
+    EXPECT_GT(profile.microTiles, 0);
+    EXPECT_EQ(profile.tasks, 0);
+    EXPECT_EQ(profile.threads, 1);
+    EXPECT_GT(profile.utilization, 0.5);
+    EXPECT_LE(profile.utilization, 1.0);
+    EXPECT_LE(profile.packSeconds + profile.computeSeconds + profile.writebackSeconds,
+              profile.seconds * 1.01);
+}
+
+TEST(InstrumentationTest, ParallelCallTasks) {
+
+    REQUIRE_INSTRUMENTATION();
+    setThreadCount(4);
+    const CallProfile profile = profileOf(300, 300, 300, Engine::Parallel);
+
+    EXPECT_EQ(profile.engine, Engine::Parallel);
+    EXPECT_GE(profile.tasks, 16);
+    EXPECT_EQ(profile.threads, 4);
+    EXPECT_GT(profile.utilization, 0);
+    EXPECT_LE(profile.utilization, 1.0);
+    EXPECT_GT(profile.microTiles, 0);
+}
+
+TEST(InstrumentationTest, AutoRecordsTheEngineThatRan) {
+
+    REQUIRE_INSTRUMENTATION();
+    setThreadCount(1);
+    EXPECT_EQ(profileOf(8, 8, 8, Engine::Auto).engine, Engine::Auto);
+    EXPECT_EQ(profileOf(20, 20, 20, Engine::Auto).engine, Engine::Reference);
+    EXPECT_EQ(profileOf(200, 200, 200, Engine::Auto).engine, Engine::Simd);
+    EXPECT_EQ(profileOf(200, 200, 200, Engine::Strassen).engine, Engine::Strassen);
+    setThreadCount(4);
+}
+
+TEST(InstrumentationTest, WritebackOfNarrowedResults) {
+
+    REQUIRE_INSTRUMENTATION();
+    Matrix<int> A(150, 170), B(170, 130), C(150, 130);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    clearCallProfiles();
+    multiply(A.view(), B.view(), C.view(), Accumulation::Saturate);
+
+    const std::vector<CallProfile> profiles = callProfiles();
+    ASSERT_EQ(profiles.size(), 1u);
+    EXPECT_STREQ(profiles[0].type, "int");
+    EXPECT_GT(profiles[0].writebackSeconds, 0);
+    EXPECT_GT(profiles[0].packSeconds, 0);
+}
+
+TEST(InstrumentationTest, AsyncAndFloatingPointCalls) {
+
+    REQUIRE_INSTRUMENTATION();
+    Matrix<float> A(100, 100), B(100, 100), C(100, 100);
+    clearCallProfiles();
+    multiplyAsync(A.view(), B.view(), C.view(), Engine::Simd).get();
+    multiply(A.view(), B.view(), C.view(), Engine::Reference);
+
+    const std::vector<CallProfile> profiles = callProfiles();
+    ASSERT_EQ(profiles.size(), 2u);
+    EXPECT_STREQ(profiles[0].type, "float");
+    EXPECT_EQ(profiles[0].engine, Engine::Simd);
+    EXPECT_EQ(profiles[1].engine, Engine::Reference);
+    EXPECT_LE(profiles[0].start, profiles[1].start);
+}
+
+TEST(InstrumentationTest, KeepsTheMostRecentCalls) {
+
+    REQUIRE_INSTRUMENTATION();
+    Matrix<int> A(5, 5), B(5, 5), C(5, 5);
+    clearCallProfiles();
+    for (int i = 0; i < callProfileCapacity + 10; ++i)
+        multiply(A.view(), B.view(), C.view());
+    EXPECT_EQ(callProfiles().size(), static_cast<std::size_t>(callProfileCapacity));
+    clearCallProfiles();
+    EXPECT_TRUE(callProfiles().empty());
+}
+
+TEST(InstrumentationTest, HardwareCounters) {
+
+    REQUIRE_INSTRUMENTATION();
+    const CallProfile profile = profileOf(128, 128, 128, Engine::Parallel);
+    if (!profile.counters.available)
+        GTEST_SKIP() << "perf_event_open is not available";
+    EXPECT_GT(profile.counters.cycles, 0);
+    EXPECT_GT(profile.counters.instructions, 0);
+    EXPECT_GT(profile.counters.instructionsPerCycle(), 0);
+    EXPECT_LE(profile.counters.cacheMisses, profile.counters.cacheReferences);
+}
+
+TEST(InstrumentationTest, ChromeTrace) {
+
+    REQUIRE_INSTRUMENTATION();
+    setThreadCount(4);
+    profileOf(160, 64, 160, Engine::Parallel);
+
+    TempFile trace("trace.json");
+    writeChromeTrace(trace.path);
+    const std::string text = readFile(trace.path);
+    EXPECT_EQ(text.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(text.find("\"name\":\"multiply 160x64x160\""), std::string::npos);
+    EXPECT_NE(text.find("\"engine\":\"Parallel\""), std::string::npos);
+    EXPECT_NE(text.find("\"cat\":\"task\""), std::string::npos);
+
+    EXPECT_THROW(writeChromeTrace(testing::TempDir() + "missing/trace.json"), std::system_error);
+}
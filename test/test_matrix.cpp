@@ -0,0 +1,109 @@
+#include "matrix_multiplication.h"
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the contiguous Matrix<T> type, its views and the multiply() overloads.
+// Every product is checked against multiplyMatricesWithoutErrors.
+
+TEST(MatrixTest, NestedRoundTrip) {
+
+    std::vector<std::vector<int>> nested = {{1, 2, 3}, {4, 5, 6}};
+    Matrix<int> A(nested);
+
+    ASSERT_EQ(A.rows(), 2);
+    ASSERT_EQ(A.cols(), 3);
+    ASSERT_EQ(A(1, 2), 6);
+    ASSERT_EQ(A.toNested(), nested);
+
+    // Ragged rows are rejected
+    std::vector<std::vector<int>> ragged = {{1, 2}, {3}};
+    ASSERT_THROW(Matrix<int> R(ragged), std::invalid_argument);
+}
+
+TEST(MatrixTest, ContiguousAlignedStorage) {
+
+    Matrix<int> A(7, 5);
+
+    // Rows are laid out back to back in one buffer
+    ASSERT_EQ(A.row(1), A.data() + 5);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(A.data()) % 64, 0u);
+}
+
+TEST(MatrixTest, BlockViewSharesStorage) {
+
+    Matrix<int> A(6, 8);
+    fillMatrixRandomly(A);
+
+    MatrixView<int> block = A.view().block(2, 3, 3, 4);
+    ASSERT_EQ(block.ld(), 8);
+    ASSERT_EQ(&block(0, 0), &A(2, 3));
+
+    block(1, 1) = 42;
+    ASSERT_EQ(A(3, 4), 42);
+}
+
+TEST(MatrixMultiplyTest, RectangularMatrices) {
+
+    Matrix<int> A(13, 7), B(7, 9);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Reference), expectedProduct(A, B));
+}
+
+TEST(MatrixMultiplyTest, PaddedLeadingDimension) {
+
+    // A and C rows are padded, B is a sub-block of a larger matrix
+    Matrix<int> A(5, 6, 16, 0);
+    Matrix<int> big(10, 10);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(big);
+    ConstMatrixView<int> B = big.view().block(1, 2, 6, 4);
+    Matrix<int> C(5, 4, 11, 0);
+
+    multiply(A, B, C);
+
+    ASSERT_EQ(C, expectedProduct(Matrix<int>(A.view()), Matrix<int>(B)));
+}
+
+TEST(MatrixMultiplyTest, NestedVectorAdapter) {
+
+    Matrix<int> A(4, 3), B(3, 5);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    std::vector<std::vector<int>> C;
+    multiply(A.toNested(), B.toNested(), C, 4, 3, 5);
+
+    ASSERT_EQ(Matrix<int>(C), expectedProduct(A, B));
+}
+
+TEST(MatrixMultiplyTest, NestedVectorAdapterEmptyShapes) {
+
+    // No rows in A: C has no rows either.
+    std::vector<std::vector<int>> C(1, std::vector<int>(1, 7));
+    multiply({}, {{1, 2}, {3, 4}, {5, 6}}, C, 0, 3, 2);
+    ASSERT_TRUE(C.empty());
+
+    // An empty inner dimension gives a product of zeros.
+    multiply({{}, {}}, {}, C, 2, 0, 3);
+    ASSERT_EQ(C, std::vector<std::vector<int>>(2, std::vector<int>(3, 0)));
+
+    // No columns in B: the rows of C are empty.
+    multiply({{1, 2}}, {{}, {}}, C, 1, 2, 0);
+    ASSERT_EQ(C, std::vector<std::vector<int>>(1));
+
+    // Rows whose length does not match the arguments are still rejected.
+    ASSERT_THROW(multiply({{1, 2}}, {{1}, {2, 3}}, C, 1, 2, 1), std::invalid_argument);
+}
+
+TEST(MatrixMultiplyTest, DimensionMismatch) {
+
+    Matrix<int> A(3, 4), B(5, 2), C(3, 2);
+
+    ASSERT_THROW(multiply(A, B, C), std::invalid_argument);
+}
@@ -0,0 +1,131 @@
+#include "matrix_multiplication.h"
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include "test_helpers.h"
+
+// Tests for the CSV and Matrix Market readers and writers. Files are created
+// in the gtest temporary directory and removed afterwards.
+
+// Writes `text` to the file at `path`
+void writeText(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+}
+
+TEST(CsvTest, ParsesFieldsAndBlankLines) {
+
+    TempFile temp("parse.csv");
+    writeText(temp.path, "1, 2,3\r\n\n  -4 ,+5,\t6  \n7,8,9");
+
+    Matrix<int> A = readCsv<int>(temp.path);
+    ASSERT_EQ(A, Matrix<int>({{1, 2, 3}, {-4, 5, 6}, {7, 8, 9}}));
+
+    Matrix<double> D = readCsv<double>(temp.path);
+    ASSERT_EQ(D(1, 0), -4.0);
+}
+
+TEST(CsvTest, RoundTripInParallelChunks) {
+
+    // Several megabytes of text, so the reader and the writer split the work
+    setThreadCount(4);
+    TempFile temp("large.csv");
+    Matrix<int> A(1500, 400);
+    fillMatrixRandomly(A);
+    A(0, 0) = INT_MIN;
+    A(1499, 399) = INT_MAX;
+
+    writeCsv(temp.path, A);
+    ASSERT_EQ(readCsv<int>(temp.path), A);
+
+    Matrix<float> F(300, 200);
+    for (int i = 0; i < 300; ++i) {
+        for (int j = 0; j < 200; ++j) {
+            F(i, j) = 1.0f / (i + j + 1);
+        }
+    }
+    writeCsv(temp.path, F);
+    ASSERT_EQ(readCsv<float>(temp.path), F);
+    setThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+TEST(CsvTest, InvalidFiles) {
+
+    TempFile temp("invalid.csv");
+    ASSERT_THROW(readCsv<int>(temp.path + ".missing"), std::system_error);
+
+    writeText(temp.path, "1,2\n3\n");
+    ASSERT_THROW(readCsv<int>(temp.path), std::runtime_error);
+    writeText(temp.path, "1,2\n3,4,5\n");
+    ASSERT_THROW(readCsv<int>(temp.path), std::runtime_error);
+    writeText(temp.path, "1,2\n3,x\n");
+    ASSERT_THROW(readCsv<int>(temp.path), std::runtime_error);
+    writeText(temp.path, "1.5,2\n");
+    ASSERT_THROW(readCsv<int>(temp.path), std::runtime_error);
+
+    writeText(temp.path, "\n\n");
+    ASSERT_EQ(readCsv<int>(temp.path).rows(), 0);
+}
+
+TEST(MatrixMarketTest, ArrayAndCoordinateFiles) {
+
+    TempFile temp("parse.mtx");
+    writeText(temp.path,
+              "%%MatrixMarket matrix array integer general\n"
+              "% column by column\n"
+              "2 3\n1\n4\n2\n5\n3\n6\n");
+    ASSERT_EQ(readMatrixMarket<int>(temp.path), Matrix<int>({{1, 2, 3}, {4, 5, 6}}));
+
+    writeText(temp.path,
+              "%%MatrixMarket matrix coordinate real general\n"
+              "3 3 2\n1 2 1.5\n3 1 -2\n");
+    ASSERT_EQ(readMatrixMarket<double>(temp.path),
+              Matrix<double>({{0, 1.5, 0}, {0, 0, 0}, {-2, 0, 0}}));
+
+    writeText(temp.path,
+              "%%MatrixMarket matrix coordinate pattern symmetric\n"
+              "3 3 2\n2 1\n3 3\n");
+    ASSERT_EQ(readMatrixMarket<int>(temp.path),
+              Matrix<int>({{0, 1, 0}, {1, 0, 0}, {0, 0, 1}}));
+}
+
+TEST(MatrixMarketTest, RoundTrip) {
+
+    setThreadCount(4);
+    TempFile temp("large.mtx");
+    Matrix<int> A(700, 900);
+    fillMatrixRandomly(A);
+
+    writeMatrixMarket(temp.path, A);
+    ASSERT_EQ(readMatrixMarket<int>(temp.path), A);
+
+    Matrix<double> D(30, 20);
+    for (int i = 0; i < 30; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            D(i, j) = 1.0 / (i + 2 * j + 1);
+        }
+    }
+    writeMatrixMarket(temp.path, D);
+    ASSERT_EQ(readMatrixMarket<double>(temp.path), D);
+    setThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+TEST(MatrixMarketTest, InvalidFiles) {
+
+    TempFile temp("invalid.mtx");
+    writeText(temp.path, "1 2\n3\n");
+    ASSERT_THROW(readMatrixMarket<int>(temp.path), std::runtime_error);
+
+    // Unsupported symmetry, missing entries, position out of range
+    writeText(temp.path, "%%MatrixMarket matrix coordinate real hermitian\n2 2 0\n");
+    ASSERT_THROW(readMatrixMarket<double>(temp.path), std::runtime_error);
+    writeText(temp.path, "%%MatrixMarket matrix array real general\n2 2\n1\n2\n3\n");
+    ASSERT_THROW(readMatrixMarket<double>(temp.path), std::runtime_error);
+    writeText(temp.path, "%%MatrixMarket matrix coordinate integer general\n2 2 1\n3 1 5\n");
+    ASSERT_THROW(readMatrixMarket<int>(temp.path), std::runtime_error);
+}
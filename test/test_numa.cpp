@@ -0,0 +1,168 @@
+#include "matrix_multiplication.h"
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the NUMA policies of numa_policy.h, on synthetic topologies that
+// split the CPUs of this machine into nodes.
+
+TEST(NumaTest, DetectedTopology) {
+
+    const NumaTopology topology = NumaTopology::detect();
+    ASSERT_FALSE(topology.nodes.empty());
+    EXPECT_FALSE(topology.synthetic);
+    for (const NumaNode& node : topology.nodes)
+        EXPECT_FALSE(node.cpus.empty());
+    if (!numaAvailable()) {
+        EXPECT_EQ(topology.nodes.size(), 1u);
+    }
+}
+
+TEST(NumaTest, SyntheticTopology) {
+
+    for (int count : {1, 2, 3, 8}) {
+        const NumaTopology topology = NumaTopology::makeSynthetic(count);
+        EXPECT_TRUE(topology.synthetic);
+        ASSERT_EQ(topology.nodes.size(), static_cast<std::size_t>(count));
+        for (int id = 0; id < count; ++id) {
+            EXPECT_EQ(topology.nodes[id].id, id);
+            EXPECT_FALSE(topology.nodes[id].cpus.empty());
+        }
+    }
+    EXPECT_THROW(NumaTopology::makeSynthetic(0), std::invalid_argument);
+    EXPECT_THROW(setNumaTopology(NumaTopology()), std::invalid_argument);
+    NumaTopology empty = NumaTopology::makeSynthetic(2);
+    empty.nodes[1].cpus.clear();
+    EXPECT_THROW(setNumaTopology(empty), std::invalid_argument);
+}
+
+TEST(NumaTest, QueuesSplitIntoNodes) {
+
+    ThreadPool pool(6, false, NumaTopology::makeSynthetic(3));
+    EXPECT_EQ(pool.nodes(), 3);
+    // The calling thread belongs to the last node.
+    EXPECT_EQ(pool.currentNode(), 2);
+    // Two tasks per queue and two queues per node.
+    for (int i = 0; i < 12; ++i)
+        EXPECT_EQ(pool.taskNode(12, i), i / 4);
+    // Uneven chunks: queue q gets tasks [7q / 6, 7(q + 1) / 6).
+    for (int q = 0; q < 6; ++q)
+        for (int i = 7 * q / 6; i < 7 * (q + 1) / 6; ++i)
+            EXPECT_EQ(pool.taskNode(7, i), q / 2) << i;
+
+    EXPECT_EQ(ThreadPool(2, false, NumaTopology::makeSynthetic(4)).nodes(), 2);
+    EXPECT_EQ(ThreadPool(4).nodes(), 1);
+}
+
+TEST(NumaTest, ForEachNodeRunsOnItsNode) {
+
+    ThreadPool pool(8, true, NumaTopology::makeSynthetic(4));
+    for (int round = 0; round < 50; ++round) {
+        std::mutex mutex;
+        std::vector<int> runs(4, 0), nodesSeen(4, -1);
+        pool.forEachNode([&](int node) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++runs[node];
+            nodesSeen[node] = pool.currentNode();
+        });
+        for (int node = 0; node < 4; ++node) {
+            EXPECT_EQ(runs[node], 1);
+            EXPECT_EQ(nodesSeen[node], node);
+        }
+    }
+
+    // Single node: runs inline.
+    ThreadPool single(3);
+    int calls = 0;
+    single.forEachNode([&](int node) {
+        EXPECT_EQ(node, 0);
+        ++calls;
+    });
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(NumaTest, StealingStaysCorrect) {
+
+    ThreadPool pool(6, false, NumaTopology::makeSynthetic(2));
+    std::vector<std::atomic<int>> counts(1000);
+    pool.parallelFor(1000, [&](int i) {
+        counts[i].fetch_add(1);
+        // Uneven work makes the threads steal.
+        if (i % 97 == 0)
+            pool.parallelFor(10, [](int) {});
+    });
+    for (const std::atomic<int>& count : counts)
+        EXPECT_EQ(count.load(), 1);
+}
+
+TEST(NumaTest, BoundTasksDoNotHideOthers) {
+
+    // Each node task queues unbound work behind the bound tasks of the
+    // other nodes, which every thread must still be able to steal.
+    ThreadPool pool(8, false, NumaTopology::makeSynthetic(4));
+    for (int round = 0; round < 20; ++round) {
+        std::vector<std::atomic<int>> counts(4 * 64);
+        pool.forEachNode([&](int node) {
+            pool.parallelFor(64, [&](int i) { counts[node * 64 + i].fetch_add(1); });
+        });
+        for (const std::atomic<int>& count : counts)
+            ASSERT_EQ(count.load(), 1);
+    }
+}
+
+TEST(NumaTest, ProductsUnderEveryPolicy) {
+
+    setThreadCount(4);
+    setNumaTopology(NumaTopology::makeSynthetic(2));
+    const TileSizes saved = tileSizes();
+    setTileSizes({48, 64, 40});
+    Matrix<int> A(300, 170), B(170, 250), Bt(250, 170);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    for (int i = 0; i < 250; ++i)
+        for (int k = 0; k < 170; ++k)
+            Bt(i, k) = B(k, i);
+    const Matrix<int> expected = expectedProduct(A, B);
+
+    for (NumaPolicy policy : {NumaPolicy::FirstTouch, NumaPolicy::Interleave, NumaPolicy::None}) {
+        setNumaPolicy(policy);
+        EXPECT_EQ(numaPolicy(), policy);
+        EXPECT_EQ(threadPool()->nodes(), policy == NumaPolicy::None ? 1 : 2);
+
+        Matrix<int> C(300, 250);
+        multiply(A.view(), B.view(), C.view(), Engine::Parallel);
+        EXPECT_EQ(C, expected);
+        Matrix<int> D(300, 250);
+        multiply(A.view(), Transpose::No, Bt.view(), Transpose::Yes, D.view(), Engine::Parallel);
+        EXPECT_EQ(D, expected);
+        Matrix<int> E(300, 250, 1);
+        evaluate(A * B + E, E.view());
+        Matrix<int> shifted = expected;
+        for (int i = 0; i < 300; ++i)
+            for (int j = 0; j < 250; ++j)
+                ++shifted(i, j);
+        EXPECT_EQ(E, shifted);
+
+        Matrix<float> Af(200, 130), Bf(130, 210), Cf(200, 210);
+        for (int i = 0; i < 200; ++i)
+            for (int k = 0; k < 130; ++k)
+                Af(i, k) = static_cast<float>(A(i, k));
+        for (int k = 0; k < 130; ++k)
+            for (int j = 0; j < 210; ++j)
+                Bf(k, j) = static_cast<float>(B(k, j));
+        multiply(Af.view(), Bf.view(), Cf.view(), Engine::Parallel);
+        for (int i = 0; i < 200; ++i)
+            for (int j = 0; j < 210; ++j) {
+                float sum = 0;
+                for (int k = 0; k < 130; ++k)
+                    sum += Af(i, k) * Bf(k, j);
+                EXPECT_EQ(Cf(i, j), sum);
+            }
+    }
+    setTileSizes(saved);
+    setNumaTopology(NumaTopology::detect());
+}
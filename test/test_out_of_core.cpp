@@ -0,0 +1,174 @@
+#include "matrix_multiplication.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the memory-mapped matrix files and the out-of-core product.
+// Files are created in the gtest temporary directory and removed afterwards.
+
+// Writes the matrix to a new file with the given tiles
+template <typename T>
+MappedMatrix<T> store(const std::string& path, const Matrix<T>& A, int tileRows, int tileCols) {
+    MappedMatrix<T> file = MappedMatrix<T>::create(path, A.rows(), A.cols(), tileRows, tileCols);
+    file.write(0, 0, A.view());
+    return file;
+}
+
+// Reads the whole file back into memory
+template <typename T>
+Matrix<T> load(const MappedMatrix<T>& file) {
+    Matrix<T> A(file.rows(), file.cols());
+    file.read(0, 0, A.view());
+    return A;
+}
+
+TEST(MappedMatrixTest, RoundTripThroughFile) {
+
+    TempFile temp("round_trip.mat");
+    Matrix<int> A(37, 45);
+    fillMatrixRandomly(A);
+
+    {
+        MappedMatrix<int> file = store(temp.path, A, 16, 8);
+        ASSERT_EQ(file.tileRowCount(), 3);
+        ASSERT_EQ(file.tileColCount(), 6);
+        file.flush();
+    }
+
+    MappedMatrix<int> file = MappedMatrix<int>::open(temp.path);
+    ASSERT_EQ(file.rows(), 37);
+    ASSERT_EQ(file.cols(), 45);
+    ASSERT_EQ(file.tileRows(), 16);
+    ASSERT_EQ(file.tileCols(), 8);
+    ASSERT_FALSE(file.writable());
+    ASSERT_EQ(load(file), A);
+
+    // Edge tiles are trimmed to the matrix, blocks may straddle tiles
+    MatrixView<const int> corner = file.tile(2, 5);
+    ASSERT_EQ(corner.rows(), 5);
+    ASSERT_EQ(corner.cols(), 5);
+    ASSERT_EQ(corner(4, 4), A(36, 44));
+    Matrix<int> block(20, 11);
+    file.read(10, 7, block.view());
+    ASSERT_EQ(block, Matrix<int>(A.view().block(10, 7, 20, 11)));
+
+    // Paging hints keep the data
+    file.release(0, 0, 37, 45);
+    file.prefetch(0, 0, 37, 45);
+    ASSERT_EQ(load(file), A);
+}
+
+TEST(MappedMatrixTest, InvalidFiles) {
+
+    TempFile temp("invalid.mat");
+    ASSERT_THROW(MappedMatrix<int>::create(temp.path, 4, 4, 0, 4), std::invalid_argument);
+    ASSERT_THROW(MappedMatrix<int>::open(temp.path + ".missing"), std::system_error);
+
+    {
+        std::ofstream out(temp.path);
+        out << std::string(5000, 'x');
+    }
+    ASSERT_THROW(MappedMatrix<int>::open(temp.path), std::runtime_error);
+
+    MappedMatrix<float>::create(temp.path, 4, 4, 2, 2);
+    ASSERT_THROW(MappedMatrix<int>::open(temp.path), std::runtime_error);
+
+    MappedMatrix<float> file = MappedMatrix<float>::open(temp.path);
+    ASSERT_THROW(file.writableTile(0, 0), std::invalid_argument);
+    ASSERT_THROW(file.tile(2, 0), std::invalid_argument);
+    Matrix<float> block(3, 3);
+    ASSERT_THROW(file.read(2, 2, block.view()), std::invalid_argument);
+}
+
+TEST(MappedMatrixTest, HeaderSizeOverflow) {
+
+    // INT32_MAX x INT32_MAX in 65536 x 65536 tiles of int is 2^64 bytes,
+    // which wraps to zero in a size_t.
+    TempFile temp("overflow.mat");
+    MappedMatrix<int>::create(temp.path, 4, 4, 2, 2);
+    {
+        std::fstream out(temp.path, std::ios::in | std::ios::out | std::ios::binary);
+        const std::uint64_t size = INT32_MAX;
+        const std::uint32_t tileSize = 65536;
+        out.seekp(16);
+        out.write(reinterpret_cast<const char*>(&size), sizeof size);
+        out.write(reinterpret_cast<const char*>(&size), sizeof size);
+        out.write(reinterpret_cast<const char*>(&tileSize), sizeof tileSize);
+        out.write(reinterpret_cast<const char*>(&tileSize), sizeof tileSize);
+    }
+    ASSERT_THROW(MappedMatrix<int>::open(temp.path), std::runtime_error);
+
+    ASSERT_THROW(MappedMatrix<double>::create(temp.path, INT32_MAX, INT32_MAX, INT32_MAX, INT32_MAX),
+                 std::invalid_argument);
+}
+
+TEST(OutOfCoreMultiplicationTest, MatchesInMemoryProduct) {
+
+    TempFile pathA("a.mat"), pathB("b.mat"), pathC("c.mat");
+    Matrix<int> A(150, 130), B(130, 170);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    Matrix<int> expected = expectedProduct(A, B);
+
+    // Tiles that do not line up with each other or with the blocks
+    MappedMatrix<int> fileA = store(pathA.path, A, 24, 40);
+    MappedMatrix<int> fileB = store(pathB.path, B, 40, 24);
+    MappedMatrix<int> fileC = MappedMatrix<int>::create(pathC.path, 150, 170, 32, 32);
+
+    // Blocks of 16, 32 and 64 and a budget holding the whole product
+    for (std::size_t budget : {6 * 4 * 16 * 16, 6 * 4 * 40 * 40, 6 * 4 * 64 * 64, 1 << 24}) {
+        multiplyOutOfCore(fileA, fileB, fileC, budget);
+        ASSERT_EQ(load(fileC), expected) << budget;
+    }
+}
+
+TEST(OutOfCoreMultiplicationTest, FloatingPoint) {
+
+    TempFile pathA("a.mat"), pathB("b.mat"), pathC("c.mat");
+    Matrix<double> A(70, 90), B(90, 50);
+    for (int i = 0; i < 70; ++i) {
+        for (int j = 0; j < 90; ++j) {
+            A(i, j) = (i * 7 + j * 3) % 11 - 5;
+        }
+    }
+    for (int i = 0; i < 90; ++i) {
+        for (int j = 0; j < 50; ++j) {
+            B(i, j) = (i * 5 + j) % 13 - 6;
+        }
+    }
+
+    MappedMatrix<double> fileA = store(pathA.path, A, 32, 32);
+    MappedMatrix<double> fileB = store(pathB.path, B, 32, 32);
+    MappedMatrix<double> fileC = MappedMatrix<double>::create(pathC.path, 70, 50, 32, 32);
+    multiplyOutOfCore(fileA, fileB, fileC, 6 * 8 * 32 * 32);
+
+    // Small integers are exact in double, whatever the summation order
+    ASSERT_EQ(load(fileC), multiply(A, B, Engine::Reference));
+}
+
+TEST(OutOfCoreMultiplicationTest, InvalidArguments) {
+
+    TempFile pathA("a.mat"), pathB("b.mat"), pathC("c.mat"), pathD("d.mat"), pathE("e.mat");
+    MappedMatrix<int> A = MappedMatrix<int>::create(pathA.path, 20, 30, 8, 8);
+    MappedMatrix<int> B = MappedMatrix<int>::create(pathB.path, 30, 10, 8, 8);
+    MappedMatrix<int> C = MappedMatrix<int>::create(pathC.path, 20, 10, 8, 8);
+
+    ASSERT_THROW(multiplyOutOfCore(A, A, C, 1 << 20), std::invalid_argument);
+    ASSERT_THROW(multiplyOutOfCore(A, B, C, 1000), std::invalid_argument);
+
+    MappedMatrix<int> readOnly = MappedMatrix<int>::open(pathC.path);
+    ASSERT_THROW(multiplyOutOfCore(A, B, readOnly, 1 << 20), std::invalid_argument);
+
+    // An empty inner dimension gives a zero product
+    MappedMatrix<int> empty = MappedMatrix<int>::create(pathD.path, 20, 0, 8, 8);
+    MappedMatrix<int> emptyB = MappedMatrix<int>::create(pathE.path, 0, 10, 8, 8);
+    C.write(0, 0, Matrix<int>(20, 10, 7).view());
+    multiplyOutOfCore(empty, emptyB, C, 1 << 20);
+    ASSERT_EQ(load(C), Matrix<int>(20, 10));
+}
@@ -0,0 +1,81 @@
+#include "matrix_multiplication.h"
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <vector>
+#include "test_helpers.h"
+#include "../src/packing.h"
+
+// Tests for the panel-major packing of the operands and the per-thread pack arena.
+
+TEST(PackingTest, PanelsOfA) {
+
+    // 5 x 3 block packed into panels of 4 rows: the second panel is zero padded
+    Matrix<int> A(5, 3);
+    fillMatrixRandomly(A);
+    std::vector<int> packed(8 * 3, -1);
+
+    packA<int>(A, 4, packed.data());
+
+    for (int p = 0; p < 2; ++p) {
+        for (int k = 0; k < 3; ++k) {
+            for (int i = 0; i < 4; ++i) {
+                int row = p * 4 + i;
+                int expected = row < 5 ? A(row, k) : 0;
+                ASSERT_EQ(packed[p * 4 * 3 + k * 4 + i], expected);
+            }
+        }
+    }
+}
+
+TEST(PackingTest, PanelsOfB) {
+
+    // 3 x 7 block of a wider matrix packed into panels of 4 columns
+    Matrix<int> big(3, 10);
+    fillMatrixRandomly(big);
+    ConstMatrixView<int> B = big.view().block(0, 2, 3, 7);
+    std::vector<int> packed(3 * 8, -1);
+
+    packB<int>(B, 4, packed.data());
+
+    for (int q = 0; q < 2; ++q) {
+        for (int k = 0; k < 3; ++k) {
+            for (int j = 0; j < 4; ++j) {
+                int col = q * 4 + j;
+                int expected = col < 7 ? B(k, col) : 0;
+                ASSERT_EQ(packed[q * 4 * 3 + k * 4 + j], expected);
+            }
+        }
+    }
+}
+
+TEST(PackingTest, ArenaIsReusedAcrossCalls) {
+
+    setTileSizes({64, 128, 64});
+
+    Matrix<int> A(150, 90), B(90, 170);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    Matrix<int> expected = expectedProduct(A, B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Simd), expected);
+    long allocations = packArena().allocations();
+
+    // Steady state: same shapes again do not allocate packing buffers
+    for (int repeat = 0; repeat < 5; ++repeat) {
+        ASSERT_EQ(multiply(A, B, Engine::Simd), expected);
+    }
+    ASSERT_EQ(packArena().allocations(), allocations);
+}
+
+TEST(PackingTest, ArenaBuffersAreAligned) {
+
+    PackArena arena;
+
+    int* a = arena.get<int>(PackArena::SlotA, 1001);
+    int* b = arena.get<int>(PackArena::SlotB, 37);
+
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(a) % 64, 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(b) % 64, 0u);
+    ASSERT_GE(arena.capacity(), (1001 + 37) * sizeof(int));
+}
@@ -0,0 +1,72 @@
+#include "matrix_multiplication.h"
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the work-stealing thread pool and the parallel engine.
+// Every product is checked against multiplyMatricesWithoutErrors.
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce) {
+
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> runs(1000);
+
+    pool.parallelFor(1000, [&](int i) { runs[i]++; });
+
+    for (auto& count : runs) {
+        ASSERT_EQ(count.load(), 1);
+    }
+}
+
+TEST(ThreadPoolTest, NestedParallelFor) {
+
+    ThreadPool pool(3);
+    std::atomic<int> total(0);
+
+    pool.parallelFor(8, [&](int) {
+        pool.parallelFor(16, [&](int) { total++; });
+    });
+
+    ASSERT_EQ(total.load(), 8 * 16);
+}
+
+TEST(ThreadPoolTest, PropagatesExceptions) {
+
+    ThreadPool pool(4);
+
+    ASSERT_THROW(pool.parallelFor(64, [](int i) {
+        if (i == 17) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+}
+
+TEST(ParallelMultiplicationTest, BigRectangularMatrices) {
+
+    setThreadCount(4);
+
+    Matrix<int> A(203, 150), B(150, 317);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Parallel), expectedProduct(A, B));
+}
+
+TEST(ParallelMultiplicationTest, PinnedThreads) {
+
+    setThreadCount(3);
+    setThreadPinning(true);
+
+    Matrix<int> A(97, 65), B(65, 131);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Parallel), expectedProduct(A, B));
+    setThreadPinning(false);
+}
+
+TEST(ParallelMultiplicationTest, InvalidThreadCount) {
+
+    ASSERT_THROW(setThreadCount(0), std::invalid_argument);
+}
@@ -0,0 +1,266 @@
+#include "matrix_multiplication.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the fingerprints and the cached products of product_cache.h.
+
+TEST(ProductCacheTest, FingerprintsFollowContents) {
+
+    const Matrix<int> A = randomMatrix(37, 53);
+    Matrix<int> copy = A;
+    EXPECT_EQ(fingerprint(A.view()), fingerprint(copy.view()));
+
+    // Every element counts, wherever it is in its row.
+    for (int j : {0, 15, 16, 52}) {
+        copy(20, j) += 1;
+        EXPECT_NE(fingerprint(A.view()), fingerprint(copy.view())) << j;
+        copy(20, j) -= 1;
+    }
+
+    // Padding between rows does not; the order of rows and the shape do.
+    Matrix<int> padded(37, 53, 64, 7);
+    for (int i = 0; i < 37; ++i)
+        for (int j = 0; j < 53; ++j)
+            padded(i, j) = A(i, j);
+    EXPECT_EQ(fingerprint(A.view()), fingerprint(padded.view()));
+    EXPECT_EQ(fingerprint(A.view().block(3, 5, 10, 20)), fingerprint(padded.view().block(3, 5, 10, 20)));
+
+    std::swap_ranges(copy.view().row(1), copy.view().row(1) + 53, copy.view().row(2));
+    EXPECT_NE(fingerprint(A.view()), fingerprint(copy.view()));
+
+    Matrix<int> zeros(4, 6), reshaped(6, 4);
+    EXPECT_NE(fingerprint(zeros.view()), fingerprint(reshaped.view()));
+
+    Matrix<double> D(30, 30);
+    fillMatrixRandomly(D);
+    Matrix<double> E = D;
+    EXPECT_EQ(fingerprint(D.view()), fingerprint(E.view()));
+    E(29, 29) = std::nextafter(E(29, 29), 2.0);
+    EXPECT_NE(fingerprint(D.view()), fingerprint(E.view()));
+}
+
+TEST(ProductCacheTest, FingerprintsOfEveryIsa) {
+
+    // Rows of whole stripes, with a partial last stripe, and shorter than
+    // one stripe
+    for (int cols : {64, 77, 5}) {
+        const Matrix<int> A = randomMatrix(40, cols);
+        setSimdIsa(SimdIsa::Scalar);
+        const std::uint64_t expected = fingerprint(A.view());
+        for (SimdIsa isa : supportedIsas()) {
+            setSimdIsa(isa);
+            EXPECT_EQ(fingerprint(A.view()), expected) << simdIsaName(isa) << " " << cols;
+        }
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(ProductCacheTest, PackedBReusedAcrossCalls) {
+
+    setThreadCount(4);
+    ProductCache cache;
+    const Matrix<int> B = randomMatrix(180, 150);
+    for (int p = 0; p < 6; ++p) {
+        const Matrix<int> A = randomMatrix(100 + 10 * p, 180);
+        Matrix<int> C(A.rows(), 150);
+        cache.multiply(A.view(), B.view(), C.view(), p % 2 ? Engine::Simd : Engine::Parallel);
+        EXPECT_EQ(C, expectedProduct(A, B)) << p;
+    }
+
+    ProductCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.packMisses, 1);
+    EXPECT_EQ(stats.packHits, 5);
+    EXPECT_GE(stats.packedBytes, 180u * 150 * sizeof(int));
+    EXPECT_EQ(stats.resultHits + stats.resultMisses, 0);
+
+    // A modified B is a new operand.
+    Matrix<int> changed = B;
+    changed(90, 75) += 1;
+    const Matrix<int> A = randomMatrix(120, 180);
+    Matrix<int> C(120, 150);
+    cache.multiply(A.view(), changed.view(), C.view(), Engine::Simd);
+    EXPECT_EQ(C, expectedProduct(A, changed));
+    EXPECT_EQ(cache.stats().packMisses, 2);
+
+    // So are new tile sizes, which change the panels.
+    const TileSizes saved = tileSizes();
+    setTileSizes({32, 48, 24});
+    cache.multiply(A.view(), B.view(), C.view(), Engine::Simd);
+    EXPECT_EQ(C, expectedProduct(A, B));
+    setTileSizes(saved);
+    stats = cache.stats();
+    EXPECT_EQ(stats.packMisses, 3);
+    EXPECT_EQ(stats.packHits, 5);
+
+    cache.clear();
+    stats = cache.stats();
+    EXPECT_EQ(stats.packMisses, 0);
+    EXPECT_EQ(stats.packedBytes, 0u);
+}
+
+TEST(ProductCacheTest, EnginesWithoutPackingSkipTheCache) {
+
+    ProductCache cache;
+    const Matrix<int> A = randomMatrix(20, 30), B = randomMatrix(30, 10);
+    Matrix<int> C(20, 10);
+    cache.multiply(A.view(), B.view(), C.view());
+    EXPECT_EQ(C, expectedProduct(A, B));
+    cache.multiply(A.view(), B.view(), C.view(), Engine::Strassen);
+    EXPECT_EQ(C, expectedProduct(A, B));
+    ProductCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.packHits + stats.packMisses, 0);
+    EXPECT_EQ(stats.packedBytes, 0u);
+
+    // Nor do they count as hits once B is packed.
+    cache.multiply(A.view(), B.view(), C.view(), Engine::Simd);
+    cache.multiply(A.view(), B.view(), C.view(), Engine::Reference);
+    EXPECT_EQ(C, expectedProduct(A, B));
+    stats = cache.stats();
+    EXPECT_EQ(stats.packMisses, 1);
+    EXPECT_EQ(stats.packHits, 0);
+}
+
+TEST(ProductCacheTest, PackedMatrix) {
+
+    setThreadCount(4);
+    const Matrix<int> B = randomMatrix(200, 170);
+    const PackedMatrix<int> packed(B.view());
+    EXPECT_EQ(packed.rows(), 200);
+    EXPECT_EQ(packed.cols(), 170);
+    EXPECT_GE(packed.bytes(), 200u * 170 * sizeof(int));
+
+    for (Engine engine : {Engine::Auto, Engine::Simd, Engine::Parallel, Engine::Reference, Engine::Strassen}) {
+        const Matrix<int> A = randomMatrix(90, 200);
+        Matrix<int> C(90, 170);
+        multiply(A.view(), packed, C.view(), engine);
+        EXPECT_EQ(C, expectedProduct(A, B));
+    }
+
+    // Panels packed for other tile sizes are packed again.
+    const TileSizes saved = tileSizes();
+    setTileSizes({32, 48, 24});
+    const Matrix<int> A = randomMatrix(60, 200);
+    Matrix<int> C(60, 170);
+    multiply(A.view(), packed, C.view(), Engine::Simd);
+    EXPECT_EQ(C, expectedProduct(A, B));
+    setTileSizes(saved);
+
+    Matrix<double> D(30, 40), E(40, 20), F(30, 20);
+    fillMatrixRandomly(D);
+    fillMatrixRandomly(E);
+    multiply(D.view(), PackedMatrix<double>(E.view()), F.view(), Engine::Simd);
+    EXPECT_EQ(F, multiply(D, E, Engine::Simd));
+
+    Matrix<int> wrong(61, 170);
+    EXPECT_THROW(multiply(A.view(), packed, wrong.view()), std::invalid_argument);
+}
+
+TEST(ProductCacheTest, ResultsMemoized) {
+
+    ProductCache cache(1 << 20);
+    const Matrix<float> A = [] { Matrix<float> M(90, 70); fillMatrixRandomly(M); return M; }();
+    const Matrix<float> B = [] { Matrix<float> M(70, 80); fillMatrixRandomly(M); return M; }();
+    const Matrix<float> expected = multiply(A, B, Engine::Simd);
+
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        Matrix<float> C(90, 80);
+        cache.multiply(A.view(), B.view(), C.view(), Engine::Simd);
+        EXPECT_EQ(C, expected);
+    }
+    // A stored result is copied into a view of any layout.
+    Matrix<float> padded(90, 80, 96, 0.0f);
+    cache.multiply(A.view(), B.view(), padded.view(), Engine::Simd);
+    for (int i = 0; i < 90; ++i)
+        for (int j = 0; j < 80; ++j)
+            ASSERT_EQ(padded(i, j), expected(i, j));
+
+    ProductCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.resultMisses, 1);
+    EXPECT_EQ(stats.resultHits, 3);
+    EXPECT_EQ(stats.resultBytes, 90u * 80 * sizeof(float));
+
+    // Results are kept per engine.
+    Matrix<float> C(90, 80);
+    cache.multiply(A.view(), B.view(), C.view(), Engine::Reference);
+    EXPECT_EQ(C, multiply(A, B, Engine::Reference));
+    EXPECT_EQ(cache.stats().resultMisses, 2);
+}
+
+TEST(ProductCacheTest, ResultsEvictedLeastRecentlyUsedFirst) {
+
+    // Room for two 40 x 40 int results.
+    ProductCache cache(2 * 40 * 40 * sizeof(int));
+    const Matrix<int> B = randomMatrix(40, 40);
+    std::vector<Matrix<int>> As;
+    for (int p = 0; p < 3; ++p)
+        As.push_back(randomMatrix(40, 40));
+    Matrix<int> C(40, 40);
+
+    cache.multiply(As[0].view(), B.view(), C.view());
+    cache.multiply(As[1].view(), B.view(), C.view());
+    cache.multiply(As[0].view(), B.view(), C.view()); // hit, A0 most recent
+    cache.multiply(As[2].view(), B.view(), C.view()); // evicts A1
+    ProductCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.resultHits, 1);
+    EXPECT_EQ(stats.resultMisses, 3);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_LE(stats.resultBytes, 2u * 40 * 40 * sizeof(int));
+
+    cache.multiply(As[0].view(), B.view(), C.view());
+    EXPECT_EQ(C, expectedProduct(As[0], B));
+    EXPECT_EQ(cache.stats().resultHits, 2);
+    cache.multiply(As[1].view(), B.view(), C.view());
+    EXPECT_EQ(C, expectedProduct(As[1], B));
+    EXPECT_EQ(cache.stats().resultMisses, 4);
+
+    // A result larger than the budget is computed but not stored.
+    const Matrix<int> A = randomMatrix(100, 40);
+    Matrix<int> large(100, 40);
+    cache.multiply(A.view(), B.view(), large.view());
+    EXPECT_EQ(large, expectedProduct(A, B));
+    EXPECT_LE(cache.stats().resultBytes, 2u * 40 * 40 * sizeof(int));
+}
+
+TEST(ProductCacheTest, SharedBetweenThreads) {
+
+    setThreadCount(4);
+    ProductCache cache(1 << 22);
+    const Matrix<int> B = randomMatrix(150, 140);
+    std::vector<Matrix<int>> As, Cs;
+    for (int t = 0; t < 8; ++t) {
+        As.push_back(randomMatrix(130, 150));
+        Cs.emplace_back(130, 140);
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&, t] {
+            for (int p = t; p < 8; p += 4)
+                for (int repeat = 0; repeat < 2; ++repeat)
+                    cache.multiply(As[p].view(), B.view(), Cs[p].view(), Engine::Simd);
+        });
+    for (std::thread& thread : threads)
+        thread.join();
+    for (int p = 0; p < 8; ++p)
+        EXPECT_EQ(Cs[p], expectedProduct(As[p], B)) << p;
+
+    const ProductCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.resultHits, 8);
+    EXPECT_EQ(stats.resultMisses, 8);
+    EXPECT_EQ(stats.packHits + stats.packMisses, 8);
+    EXPECT_GE(stats.packMisses, 1);
+}
+
+TEST(ProductCacheTest, DimensionMismatchThrows) {
+
+    ProductCache cache;
+    Matrix<int> A(3, 4), B(5, 6), C(3, 6);
+    EXPECT_THROW(cache.multiply(A.view(), B.view(), C.view()), std::invalid_argument);
+    Matrix<double> D(0, 4), E(4, 5), F(0, 5);
+    EXPECT_NO_THROW(cache.multiply(D.view(), E.view(), F.view()));
+}
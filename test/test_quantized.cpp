@@ -0,0 +1,123 @@
+#include "matrix_multiplication.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the quantized int8 and int16 products. Results are compared with
+// a 64-bit triple loop over the zero-point corrected operands, for every
+// instruction set this CPU supports.
+
+// Fills the matrix with random values over the whole range of T
+template <typename T>
+void fillMatrixOverRange(Matrix<T>& A) {
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            A(i, j) = static_cast<T>(std::rand());
+        }
+    }
+}
+
+// Random quantization with `count` entries
+Quantization randomQuantization(int count) {
+    Quantization quant;
+    quant.scale.resize(count);
+    quant.zeroPoint.resize(count);
+    for (int i = 0; i < count; ++i) {
+        quant.scale[i] = 0.01f * (1 + std::rand() % 100);
+        quant.zeroPoint[i] = std::rand() % 41 - 20;
+    }
+    return quant;
+}
+
+// Exact sum_k (A(i, k) - zA[i]) * (B(k, j) - zB[j]) for one element
+template <typename T>
+std::int64_t exactElement(const Matrix<T>& A, const Quantization& quantA, const Matrix<T>& B, const Quantization& quantB, int i, int j) {
+    std::int64_t zA = quantA.zeroPoint.size() == 1 ? quantA.zeroPoint[0] : quantA.zeroPoint[i];
+    std::int64_t zB = quantB.zeroPoint.size() == 1 ? quantB.zeroPoint[0] : quantB.zeroPoint[j];
+    std::int64_t sum = 0;
+    for (int k = 0; k < A.cols(); ++k) {
+        sum += (A(i, k) - zA) * (B(k, j) - zB);
+    }
+    return sum;
+}
+
+// Checks the int32 and float results of one product on every instruction set
+template <typename T>
+void checkProduct(int m, int k, int n, const Quantization& quantA, const Quantization& quantB) {
+    Matrix<T> A(m, k), B(k, n);
+    fillMatrixOverRange(A);
+    fillMatrixOverRange(B);
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        Matrix<std::int32_t> C(m, n);
+        Matrix<float> real(m, n);
+        multiplyQuantized(A, quantA, B, quantB, C);
+        multiplyQuantized(A, quantA, B, quantB, real);
+
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                // Full-range int16 sums can leave the int32 range and wrap
+                std::int32_t expected = static_cast<std::int32_t>(exactElement(A, quantA, B, quantB, i, j));
+                ASSERT_EQ(C(i, j), expected) << simdIsaName(isa) << " at (" << i << ", " << j << ")";
+                float scale = (quantA.scale.size() == 1 ? quantA.scale[0] : quantA.scale[i]) *
+                              (quantB.scale.size() == 1 ? quantB.scale[0] : quantB.scale[j]);
+                ASSERT_NEAR(real(i, j), scale * expected, 1e-5 * std::fabs(scale * expected) + 1e-3) << simdIsaName(isa);
+            }
+        }
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(QuantizedMultiplicationTest, Int8PerRowAndColumn) {
+
+    // Partial micro-tiles, cache tiles and k groups
+    setTileSizes({24, 48, 20});
+    checkProduct<std::int8_t>(37, 45, 53, randomQuantization(37), randomQuantization(53));
+    // Several K blocks, even for the deeper int8 ones
+    checkProduct<std::int8_t>(37, 190, 53, randomQuantization(37), randomQuantization(53));
+    setTileSizes(calibrateTileSizes());
+}
+
+TEST(QuantizedMultiplicationTest, Int16PerRowAndColumn) {
+
+    setTileSizes({24, 48, 20});
+    checkProduct<std::int16_t>(37, 45, 53, randomQuantization(37), randomQuantization(53));
+    setTileSizes(calibrateTileSizes());
+}
+
+TEST(QuantizedMultiplicationTest, SharedQuantization) {
+
+    checkProduct<std::int8_t>(19, 130, 21, randomQuantization(1), Quantization());
+    checkProduct<std::int16_t>(19, 131, 21, Quantization(), randomQuantization(1));
+}
+
+TEST(QuantizedMultiplicationTest, ParallelTiles) {
+
+    setThreadCount(4);
+    checkProduct<std::int8_t>(150, 140, 170, randomQuantization(150), randomQuantization(170));
+}
+
+TEST(QuantizedMultiplicationTest, EmptyInnerDimension) {
+
+    Matrix<std::int8_t> A(5, 0), B(0, 6);
+    Matrix<std::int32_t> C(5, 6, 7);
+
+    multiplyQuantized(A, randomQuantization(5), B, randomQuantization(6), C);
+
+    ASSERT_EQ(C, Matrix<std::int32_t>(5, 6, 0));
+}
+
+TEST(QuantizedMultiplicationTest, InvalidArguments) {
+
+    Matrix<std::int8_t> A(3, 4), B(4, 6);
+    Matrix<std::int32_t> C(3, 6), wrong(3, 5);
+
+    ASSERT_THROW(multiplyQuantized(A, Quantization(), B, Quantization(), wrong), std::invalid_argument);
+    ASSERT_THROW(multiplyQuantized(A, randomQuantization(2), B, Quantization(), C), std::invalid_argument);
+    ASSERT_THROW(multiplyQuantized(A, Quantization(), B, randomQuantization(4), C), std::invalid_argument);
+}
@@ -0,0 +1,178 @@
+#include "matrix_multiplication.h"
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the Philox generator and the random matrix fills.
+
+// Word w of the value stream of `seed`
+std::uint32_t streamWord(std::uint64_t w, std::uint64_t seed) {
+    const std::array<std::uint32_t, 4> block = philox4x32(
+        {static_cast<std::uint32_t>(w / 4), static_cast<std::uint32_t>(w / 4 >> 32), 0, 0},
+        {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)});
+    return block[w % 4];
+}
+
+TEST(RandomMatrixTest, PhiloxKnownAnswers) {
+
+    // Known-answer vectors of the Random123 distribution.
+    using Block = std::array<std::uint32_t, 4>;
+    EXPECT_EQ(philox4x32({0, 0, 0, 0}, {0, 0}), (Block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+              (Block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    EXPECT_EQ(philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+              (Block{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(RandomMatrixTest, EveryIsaGivesTheStreamWords) {
+
+    // Over the full int range, element e is word e of the stream shifted by
+    // 2^31. Rows of 37 start at every offset within a Philox block.
+    const std::uint64_t seed = 0x123456789abcdefull;
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        Matrix<int> M(45, 37);
+        fillUniform(M.view(), INT_MIN, INT_MAX, seed);
+        for (int i = 0; i < M.rows(); ++i)
+            for (int j = 0; j < M.cols(); ++j)
+                ASSERT_EQ(static_cast<std::uint32_t>(M(i, j)),
+                          streamWord(static_cast<std::uint64_t>(i) * 37 + j, seed) + 0x80000000u)
+                    << simdIsaName(isa) << " at (" << i << ", " << j << ")";
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(RandomMatrixTest, UniformValuesStayInRange) {
+
+    Matrix<int> M(300, 301);
+    fillUniform(M.view(), -10, 9, 7);
+    std::vector<long> counts(20, 0);
+    for (int i = 0; i < M.rows(); ++i)
+        for (int j = 0; j < M.cols(); ++j) {
+            ASSERT_GE(M(i, j), -10);
+            ASSERT_LE(M(i, j), 9);
+            ++counts[M(i, j) + 10];
+        }
+    // About 4515 of each value.
+    for (long count : counts) {
+        EXPECT_GT(count, 4000);
+        EXPECT_LT(count, 5000);
+    }
+
+    Matrix<float> F(200, 150);
+    fillUniform(F.view(), -1.0f, 1.0f, 7);
+    Matrix<double> D(200, 150);
+    fillUniform(D.view(), 2.0, 3.0, 7);
+    double sum = 0;
+    for (int i = 0; i < F.rows(); ++i)
+        for (int j = 0; j < F.cols(); ++j) {
+            ASSERT_GE(F(i, j), -1.0f);
+            ASSERT_LE(F(i, j), 1.0f);
+            ASSERT_GE(D(i, j), 2.0);
+            ASSERT_LE(D(i, j), 3.0);
+            sum += D(i, j);
+        }
+    EXPECT_NEAR(sum / (200 * 150), 2.5, 0.01);
+
+    Matrix<int> constant(10, 10);
+    fillUniform(constant.view(), 5, 5, 1);
+    EXPECT_EQ(constant, Matrix<int>(10, 10, 5));
+}
+
+TEST(RandomMatrixTest, SeedsAndViews) {
+
+    Matrix<double> A(64, 64), B(64, 64), C(64, 64);
+    fillUniform(A.view(), -1.0, 1.0, 1);
+    fillUniform(B.view(), -1.0, 1.0, 1);
+    fillUniform(C.view(), -1.0, 1.0, 2);
+    EXPECT_EQ(A, B);
+    EXPECT_NE(A, C);
+
+    // A view with a larger leading dimension gets the values of a
+    // contiguous matrix of its shape, and nothing around it changes.
+    Matrix<float> big(50, 80, 9.0f), small(30, 40);
+    fillUniform(big.view().block(10, 20, 30, 40), 0.0f, 1.0f, 3);
+    fillUniform(small.view(), 0.0f, 1.0f, 3);
+    EXPECT_EQ(Matrix<float>(big.view().block(10, 20, 30, 40)), small);
+    EXPECT_EQ(big(9, 20), 9.0f);
+    EXPECT_EQ(big(10, 19), 9.0f);
+    EXPECT_EQ(big(40, 60), 9.0f);
+}
+
+TEST(RandomMatrixTest, IndependentOfThreadCount) {
+
+    Matrix<int> ints(700, 500);
+    Matrix<double> doubles(500, 700), sparse(600, 600), band(800, 400);
+    setThreadCount(1);
+    fillUniform(ints.view(), -1000, 1000, 11);
+    fillUniform(doubles.view(), -1.0, 1.0, 11);
+    fillSparse(sparse.view(), 0.1, 1.0, 2.0, 11);
+    fillBanded(band.view(), 3, 5, 1.0, 2.0, 11);
+    for (int threads : {2, 4, 7}) {
+        setThreadCount(threads);
+        Matrix<int> I(700, 500);
+        Matrix<double> D(500, 700), S(600, 600), B(800, 400);
+        fillUniform(I.view(), -1000, 1000, 11);
+        fillUniform(D.view(), -1.0, 1.0, 11);
+        fillSparse(S.view(), 0.1, 1.0, 2.0, 11);
+        fillBanded(B.view(), 3, 5, 1.0, 2.0, 11);
+        EXPECT_EQ(I, ints) << threads;
+        EXPECT_EQ(D, doubles) << threads;
+        EXPECT_EQ(S, sparse) << threads;
+        EXPECT_EQ(B, band) << threads;
+    }
+    setThreadCount(4);
+}
+
+TEST(RandomMatrixTest, StructuredPatterns) {
+
+    Matrix<int> I(5, 7, 3);
+    fillIdentity(I.view());
+    for (int i = 0; i < 5; ++i)
+        for (int j = 0; j < 7; ++j)
+            EXPECT_EQ(I(i, j), i == j ? 1 : 0);
+
+    // The band keeps the values of the uniform matrix of the same seed.
+    Matrix<int> uniform(90, 60), band(90, 60);
+    fillUniform(uniform.view(), 1, 100, 5);
+    fillBanded(band.view(), 2, 4, 1, 100, 5);
+    for (int i = 0; i < 90; ++i)
+        for (int j = 0; j < 60; ++j)
+            ASSERT_EQ(band(i, j), j - i >= -2 && j - i <= 4 ? uniform(i, j) : 0) << i << ", " << j;
+
+    // So does every element a sparse fill keeps, about `density` of them.
+    Matrix<int> sparse(400, 500);
+    fillSparse(sparse.view(), 0.05, 1, 100, 5);
+    Matrix<int> dense(400, 500);
+    fillUniform(dense.view(), 1, 100, 5);
+    long kept = 0;
+    for (int i = 0; i < 400; ++i)
+        for (int j = 0; j < 500; ++j)
+            if (sparse(i, j) != 0) {
+                ++kept;
+                ASSERT_EQ(sparse(i, j), dense(i, j));
+            }
+    EXPECT_NEAR(kept / (400.0 * 500), 0.05, 0.003);
+
+    Matrix<float> none(20, 20, 1.0f), all(20, 20);
+    fillSparse(none.view(), 0.0, 1.0f, 2.0f, 5);
+    EXPECT_EQ(none, Matrix<float>(20, 20, 0.0f));
+    fillSparse(all.view(), 1.0, 1.0f, 2.0f, 5);
+    for (int i = 0; i < 20; ++i)
+        for (int j = 0; j < 20; ++j)
+            EXPECT_GE(all(i, j), 1.0f);
+}
+
+TEST(RandomMatrixTest, RejectsInvalidArguments) {
+
+    Matrix<int> M(4, 4);
+    EXPECT_THROW(fillUniform(M.view(), 3, 2, 1), std::invalid_argument);
+    EXPECT_THROW(fillBanded(M.view(), -1, 2, 0, 1, 1), std::invalid_argument);
+    EXPECT_THROW(fillSparse(M.view(), 1.5, 0, 1, 1), std::invalid_argument);
+    Matrix<double> D(4, 4);
+    EXPECT_THROW(fillSparse(D.view(), 0.5, 1.0, 0.0, 1), std::invalid_argument);
+}
@@ -0,0 +1,70 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the SIMD engine: every micro-kernel supported by this CPU is forced
+// in turn and checked against multiplyMatricesWithoutErrors.
+
+TEST(SimdMultiplicationTest, IsaNames) {
+
+    for (SimdIsa isa : supportedIsas()) {
+        ASSERT_GT(std::strlen(simdIsaName(isa)), 0u);
+    }
+}
+
+TEST(SimdMultiplicationTest, EdgeMicroTiles) {
+
+    // Dimensions that leave partial micro-tiles and partial cache tiles
+    setTileSizes({24, 48, 20});
+
+    Matrix<int> A(37, 45), B(45, 53);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    Matrix<int> expected = expectedProduct(A, B);
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        ASSERT_EQ(multiply(A, B, Engine::Simd), expected) << simdIsaName(isa);
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(SimdMultiplicationTest, BigRectangularMatrices) {
+
+    setTileSizes(calibrateTileSizes());
+
+    Matrix<int> A(130, 257), B(257, 99);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    Matrix<int> expected = expectedProduct(A, B);
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        ASSERT_EQ(multiply(A, B, Engine::Simd), expected) << simdIsaName(isa);
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(SimdMultiplicationTest, SubMatrixViews) {
+
+    Matrix<int> bigA(40, 50), bigB(60, 70);
+    fillMatrixRandomly(bigA);
+    fillMatrixRandomly(bigB);
+    ConstMatrixView<int> A = bigA.view().block(3, 5, 33, 41);
+    ConstMatrixView<int> B = bigB.view().block(7, 2, 41, 35);
+    Matrix<int> C(33, 35, 48, 0);
+
+    multiply(A, B, C, Engine::Simd);
+
+    ASSERT_EQ(C, expectedProduct(Matrix<int>(A), Matrix<int>(B)));
+}
+
+TEST(SimdMultiplicationTest, OverflowWrapsLikeReference) {
+
+    Matrix<int> A(20, 30, 2000000000), B(30, 20, 3);
+
+    ASSERT_EQ(multiply(A, B, Engine::Simd), multiply(A, B, Engine::Reference));
+}
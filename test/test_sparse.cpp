@@ -0,0 +1,179 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the sparse formats and products. Results are checked against
+// multiplyMatricesWithoutErrors on the dense copies of the operands.
+
+// Fills about `percent`% of the matrix with random non-zero values of the
+// interval [1, 9], and the rest with zeros
+void fillMatrixSparsely(Matrix<int>& A, int percent) {
+    for (int i = 0; i < A.rows(); ++i) {
+        for (int j = 0; j < A.cols(); ++j) {
+            A(i, j) = std::rand() % 100 < percent ? std::rand() % 9 + 1 : 0;
+        }
+    }
+}
+
+TEST(SparseMatrixTest, ConversionsRoundTrip) {
+
+    Matrix<int> A(23, 31);
+    fillMatrixSparsely(A, 10);
+
+    CsrMatrix<int> csr(A);
+    CscMatrix<int> csc(A);
+
+    ASSERT_EQ(csr.nonZeros(), csc.nonZeros());
+    ASSERT_EQ(csr.toDense(), A);
+    ASSERT_EQ(csc.toDense(), A);
+}
+
+TEST(SparseMatrixTest, InvalidArrays) {
+
+    // Row starts of the wrong length, out-of-range and unsorted columns
+    ASSERT_THROW(CsrMatrix<int>(2, 3, {0, 1}, {0}, {5}), std::invalid_argument);
+    ASSERT_THROW(CsrMatrix<int>(2, 3, {0, 1, 1}, {3}, {5}), std::invalid_argument);
+    ASSERT_THROW(CsrMatrix<int>(1, 3, {0, 2}, {2, 1}, {5, 6}), std::invalid_argument);
+    ASSERT_THROW(CscMatrix<int>(3, 2, {0, 1, 2}, {0}, {5}), std::invalid_argument);
+    ASSERT_NO_THROW(CsrMatrix<int>(2, 3, {0, 2, 2}, {0, 2}, {5, 6}));
+}
+
+TEST(SparseMultiplicationTest, SparseTimesDense) {
+
+    Matrix<int> A(47, 53), B(53, 39), C(47, 39);
+    fillMatrixSparsely(A, 5);
+    fillMatrixRandomly(B);
+
+    multiply(CsrMatrix<int>(A), B, C);
+
+    ASSERT_EQ(C, expectedProduct(A, B));
+}
+
+TEST(SparseMultiplicationTest, DenseTimesSparse) {
+
+    Matrix<int> A(47, 53), B(53, 39), C(47, 39);
+    fillMatrixRandomly(A);
+    fillMatrixSparsely(B, 5);
+
+    multiply(A, CscMatrix<int>(B), C);
+
+    ASSERT_EQ(C, expectedProduct(A, B));
+}
+
+TEST(SparseMultiplicationTest, RowKernelsOfEveryIsa) {
+
+    // Full register blocks, single registers and a scalar tail of columns,
+    // and a partial block of transposed rows
+    Matrix<int> sparse(150, 150), dense(150, 150), C(150, 150);
+    fillMatrixSparsely(sparse, 6);
+    fillMatrixRandomly(dense);
+    Matrix<int> expectedLeft = expectedProduct(sparse, dense);
+    Matrix<int> expectedRight = expectedProduct(dense, sparse);
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        multiply(CsrMatrix<int>(sparse), dense, C);
+        ASSERT_EQ(C, expectedLeft) << simdIsaName(isa);
+        multiply(dense, CscMatrix<int>(sparse), C);
+        ASSERT_EQ(C, expectedRight) << simdIsaName(isa);
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(SparseMultiplicationTest, SparseTimesSparse) {
+
+    Matrix<int> A(61, 70), B(70, 55);
+    fillMatrixSparsely(A, 8);
+    fillMatrixSparsely(B, 8);
+
+    CsrMatrix<int> C = multiply(CsrMatrix<int>(A), CsrMatrix<int>(B));
+
+    ASSERT_EQ(C.rows(), 61);
+    ASSERT_EQ(C.cols(), 55);
+    ASSERT_EQ(C.toDense(), expectedProduct(A, B));
+}
+
+TEST(SparseMultiplicationTest, ParallelRanges) {
+
+    setThreadCount(4);
+
+    Matrix<int> A(400, 300), B(300, 350);
+    fillMatrixSparsely(A, 3);
+    fillMatrixSparsely(B, 3);
+    Matrix<int> expected = expectedProduct(A, B);
+
+    Matrix<int> C(400, 350);
+    multiply(CsrMatrix<int>(A), B, C);
+    ASSERT_EQ(C, expected);
+
+    multiply(A, CscMatrix<int>(B), C);
+    ASSERT_EQ(C, expected);
+
+    ASSERT_EQ(multiply(CsrMatrix<int>(A), CsrMatrix<int>(B)).toDense(), expected);
+}
+
+TEST(SparseMultiplicationTest, DensityEstimate) {
+
+    Matrix<int> identity(1000, 1000);
+    for (int i = 0; i < 1000; ++i) {
+        identity(i, i) = 1;
+    }
+    ASSERT_LT(estimateDensity(identity), 0.01);
+
+    Matrix<int> A(300, 300);
+    fillMatrixSparsely(A, 20);
+    ASSERT_NEAR(estimateDensity(A), 0.2, 0.1);
+
+    // Small matrices are counted exactly
+    Matrix<int> small(4, 5);
+    small(1, 2) = 3;
+    ASSERT_DOUBLE_EQ(estimateDensity(small), 0.05);
+}
+
+TEST(SparseMultiplicationTest, AutoAndSparseEngines) {
+
+    Matrix<int> A(150, 160), B(160, 170), dense(160, 160);
+    fillMatrixSparsely(A, 2);
+    fillMatrixSparsely(B, 2);
+    fillMatrixRandomly(dense);
+
+    ASSERT_EQ(multiply(A, dense, Engine::Auto), expectedProduct(A, dense));
+    ASSERT_EQ(multiply(dense, B, Engine::Auto), expectedProduct(dense, B));
+    ASSERT_EQ(multiply(A, B, Engine::Sparse), expectedProduct(A, B));
+}
+
+TEST(SparseMultiplicationTest, FloatingPoint) {
+
+    Matrix<int> pattern(30, 40);
+    fillMatrixSparsely(pattern, 10);
+    Matrix<double> A(30, 40), B(40, 20);
+    for (int i = 0; i < 30; ++i) {
+        for (int j = 0; j < 40; ++j) {
+            A(i, j) = pattern(i, j) * 0.25;
+        }
+    }
+    for (int i = 0; i < 40; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            B(i, j) = (std::rand() % 200 - 100) * 0.125;
+        }
+    }
+    Matrix<double> C(30, 20);
+
+    // Quarters and eighths of small integers add up exactly
+    multiply(CsrMatrix<double>(A), B, C);
+
+    ASSERT_EQ(C, multiply(A, B, Engine::Reference));
+}
+
+TEST(SparseMultiplicationTest, InvalidArguments) {
+
+    Matrix<int> A(3, 4), B(5, 6), C(3, 6);
+
+    ASSERT_THROW(multiply(CsrMatrix<int>(A), B, C), std::invalid_argument);
+    ASSERT_THROW(multiply(A, CscMatrix<int>(B), C), std::invalid_argument);
+    ASSERT_THROW(multiply(CsrMatrix<int>(A), CsrMatrix<int>(B)), std::invalid_argument);
+    ASSERT_THROW(setSparseDensityThreshold(1.5), std::invalid_argument);
+}
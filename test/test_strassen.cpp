@@ -0,0 +1,69 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the Strassen-Winograd engine. A small crossover forces several
+// levels of recursion and of peeling on matrices the reference can check quickly.
+
+TEST(StrassenMultiplicationTest, SquareMatrices) {
+
+    setStrassenCrossover(8);
+
+    Matrix<int> A(128, 128), B(128, 128);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Strassen), expectedProduct(A, B));
+}
+
+TEST(StrassenMultiplicationTest, OddDimMatrices) {
+
+    // Odd sizes peel a row, a column and a rank-1 term at several levels
+    setStrassenCrossover(8);
+
+    Matrix<int> A(77, 91), B(91, 53);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Strassen), expectedProduct(A, B));
+}
+
+TEST(StrassenMultiplicationTest, SubMatrixViews) {
+
+    setStrassenCrossover(16);
+
+    Matrix<int> bigA(90, 90), bigB(90, 90);
+    fillMatrixRandomly(bigA);
+    fillMatrixRandomly(bigB);
+    ConstMatrixView<int> A = bigA.view().block(1, 2, 65, 70);
+    ConstMatrixView<int> B = bigB.view().block(3, 4, 70, 66);
+    Matrix<int> C(65, 66, 80, 0);
+
+    multiply(A, B, C, Engine::Strassen);
+
+    ASSERT_EQ(C, expectedProduct(Matrix<int>(A), Matrix<int>(B)));
+}
+
+TEST(StrassenMultiplicationTest, OverflowWrapsLikeReference) {
+
+    // Intermediate sums of Winograd's step overflow, the result must still wrap exactly
+    setStrassenCrossover(4);
+
+    Matrix<int> A(40, 40), B(40, 40);
+    for (int i = 0; i < 40; ++i) {
+        for (int j = 0; j < 40; ++j) {
+            A(i, j) = (i * 40 + j) * 104729;
+            B(i, j) = 2147483647 - (i + j) * 7919;
+        }
+    }
+
+    ASSERT_EQ(multiply(A, B, Engine::Strassen), multiply(A, B, Engine::Reference));
+}
+
+TEST(StrassenMultiplicationTest, InvalidCrossover) {
+
+    ASSERT_THROW(setStrassenCrossover(1), std::invalid_argument);
+}
@@ -0,0 +1,213 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the detection of zero, identity, permutation, diagonal and
+// binary operands and for the paths Engine::Auto takes for them.
+
+Matrix<int> binaryMatrix(int rows, int cols) {
+    Matrix<int> M(rows, cols);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < cols; ++j)
+            M(i, j) = std::rand() % 2;
+    return M;
+}
+
+Matrix<int> identityMatrix(int n) {
+    Matrix<int> M(n, n, 0);
+    for (int i = 0; i < n; ++i)
+        M(i, i) = 1;
+    return M;
+}
+
+// Row i has its one in column (i * step + 3) % n, a permutation when step
+// and n are coprime.
+Matrix<int> permutationMatrix(int n, int step) {
+    Matrix<int> M(n, n, 0);
+    for (int i = 0; i < n; ++i)
+        M(i, (i * step + 3) % n) = 1;
+    return M;
+}
+
+Matrix<int> diagonalMatrix(int n) {
+    Matrix<int> M(n, n, 0);
+    for (int i = 0; i < n; ++i)
+        M(i, i) = std::rand() % 2001 - 1000;
+    return M;
+}
+
+TEST(StructureTest, DetectsEachStructure) {
+
+    EXPECT_EQ(detectStructure(Matrix<int>(5, 7, 0).view()), Structure::Zero);
+    EXPECT_EQ(detectStructure(identityMatrix(9).view()), Structure::Identity);
+    EXPECT_EQ(detectStructure(permutationMatrix(10, 3).view()), Structure::Permutation);
+    EXPECT_EQ(detectStructure(diagonalMatrix(12).view()), Structure::Diagonal);
+    EXPECT_EQ(detectStructure(binaryMatrix(20, 30).view()), Structure::Binary);
+    EXPECT_EQ(detectStructure(randomMatrix(20, 30).view()), Structure::General);
+    EXPECT_STREQ(structureName(Structure::Permutation), "permutation");
+
+    // The first structure of the list wins: a 1x1 one is the identity, a
+    // diagonal of zeros and ones is diagonal, not binary.
+    EXPECT_EQ(detectStructure(Matrix<int>(1, 1, 1).view()), Structure::Identity);
+    Matrix<int> D = identityMatrix(6);
+    D(2, 2) = 0;
+    EXPECT_EQ(detectStructure(D.view()), Structure::Diagonal);
+}
+
+TEST(StructureTest, NearMissesAreNotDetected) {
+
+    // Rectangular matrices are never identities, permutations or diagonal.
+    Matrix<int> R(4, 5, 0);
+    for (int i = 0; i < 4; ++i)
+        R(i, i) = 1;
+    EXPECT_EQ(detectStructure(R.view()), Structure::Binary);
+
+    // Two ones in a column, an element of 2, -1 (all bits set) in the last
+    // row and an off-diagonal element in the last row.
+    Matrix<int> P = permutationMatrix(10, 3);
+    P(9, (9 * 3 + 3) % 10) = 0;
+    P(9, (0 * 3 + 3) % 10) = 1;
+    EXPECT_EQ(detectStructure(P.view()), Structure::Binary);
+    Matrix<int> two = identityMatrix(8);
+    two(7, 7) = 2;
+    EXPECT_EQ(detectStructure(two.view()), Structure::Diagonal);
+    two(7, 0) = 2;
+    EXPECT_EQ(detectStructure(two.view()), Structure::General);
+    Matrix<int> minusOne = binaryMatrix(8, 9);
+    minusOne(7, 8) = -1;
+    EXPECT_EQ(detectStructure(minusOne.view()), Structure::General);
+    Matrix<int> offDiagonal = diagonalMatrix(8);
+    offDiagonal(7, 0) = 5;
+    EXPECT_EQ(detectStructure(offDiagonal.view()), Structure::General);
+
+    // Views of larger matrices: only the elements of the view count.
+    Matrix<int> big(20, 20, 7);
+    for (int i = 0; i < 10; ++i)
+        for (int j = 0; j < 10; ++j)
+            big(5 + i, 5 + j) = i == j;
+    EXPECT_EQ(detectStructure(big.view().block(5, 5, 10, 10)), Structure::Identity);
+    EXPECT_EQ(detectStructure(big.view()), Structure::General);
+}
+
+TEST(StructureTest, EveryPathMatchesTheReference) {
+
+    setStructureDetection(true);
+    const int n = 67;
+    const Matrix<int> G = randomMatrix(n, n), W = randomMatrix(45, n), T = randomMatrix(n, 38);
+    const Matrix<int> operands[] = {Matrix<int>(n, n, 0), identityMatrix(n), permutationMatrix(n, 5),
+                                    diagonalMatrix(n), binaryMatrix(n, n)};
+    for (const Matrix<int>& S : operands) {
+        EXPECT_EQ(multiply(S, G), expectedProduct(S.view(), G.view())) << structureName(detectStructure(S.view()));
+        EXPECT_EQ(multiply(S, T), expectedProduct(S.view(), T.view())) << structureName(detectStructure(S.view()));
+        EXPECT_EQ(multiply(G, S), expectedProduct(G.view(), S.view())) << structureName(detectStructure(S.view()));
+        EXPECT_EQ(multiply(W, S), expectedProduct(W.view(), S.view())) << structureName(detectStructure(S.view()));
+    }
+
+    // Two structured operands, and a rectangular zero one.
+    const Matrix<int> P = permutationMatrix(n, 5), D = diagonalMatrix(n);
+    EXPECT_EQ(multiply(P, D), expectedProduct(P.view(), D.view()));
+    EXPECT_EQ(multiply(D, P), expectedProduct(D.view(), P.view()));
+    const Matrix<int> Z(45, n, 0);
+    EXPECT_EQ(multiply(Z, G), Matrix<int>(45, n, 0));
+    setStructureDetection(false);
+}
+
+TEST(StructureTest, ScalingWrapsLikeTheOtherEngines) {
+
+    setStructureDetection(true);
+    Matrix<int> D(50, 50, 0);
+    for (int i = 0; i < 50; ++i)
+        D(i, i) = (1 << 20) + i;
+    const Matrix<int> B(50, 40, 1 << 15), A(30, 50, 1 << 16);
+    EXPECT_EQ(multiply(D, B), multiply(D, B, Engine::Reference));
+    EXPECT_EQ(multiply(A, D), multiply(A, D, Engine::Reference));
+    setStructureDetection(false);
+}
+
+TEST(StructureTest, BinaryProductsOfEveryIsa) {
+
+    // Inner dimensions around multiples of 64 leave partial words.
+    const int shapes[][3] = {{1, 1, 1}, {5, 63, 7}, {9, 64, 13}, {33, 65, 17}, {70, 200, 90}, {128, 1000, 3}};
+    setThreadCount(1);
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        for (const auto& shape : shapes) {
+            const Matrix<int> A = binaryMatrix(shape[0], shape[1]);
+            const Matrix<int> B = binaryMatrix(shape[1], shape[2]);
+            Matrix<int> C(shape[0], shape[2], -1);
+            multiplyBinary(A.view(), B.view(), C.view());
+            ASSERT_EQ(C, expectedProduct(A.view(), B.view()))
+                << simdIsaName(isa) << " " << shape[0] << "x" << shape[1] << "x" << shape[2];
+        }
+    }
+    setSimdIsa(detectSimdIsa());
+    setThreadCount(4);
+}
+
+TEST(StructureTest, ParallelBinaryProductMatchesSerial) {
+
+    const Matrix<int> A = binaryMatrix(300, 700), B = binaryMatrix(700, 500);
+    setThreadCount(1);
+    Matrix<int> serial(300, 500);
+    multiplyBinary(A.view(), B.view(), serial.view());
+    EXPECT_EQ(serial, expectedProduct(A.view(), B.view()));
+    for (int threads : {2, 4, 7}) {
+        setThreadCount(threads);
+        Matrix<int> C(300, 500);
+        multiplyBinary(A.view(), B.view(), C.view());
+        EXPECT_EQ(C, serial) << threads;
+    }
+    setThreadCount(4);
+}
+
+TEST(StructureTest, StridedViews) {
+
+    setStructureDetection(true);
+    Matrix<int> big(80, 80, 3);
+    const Matrix<int> B = binaryMatrix(80, 80);
+    const ConstMatrixView<int> A = B.view().block(4, 6, 40, 50);
+    const ConstMatrixView<int> right = B.view().block(10, 3, 50, 30);
+    multiply(A, right, big.view().block(20, 30, 40, 30));
+    EXPECT_EQ(Matrix<int>(big.view().block(20, 30, 40, 30)), expectedProduct(A, right));
+    EXPECT_EQ(big(19, 30), 3);
+    EXPECT_EQ(big(20, 29), 3);
+    EXPECT_EQ(big(60, 59), 3);
+
+    const Matrix<int> P = permutationMatrix(50, 7);
+    multiply(A, P.view(), big.view().block(0, 0, 40, 50));
+    EXPECT_EQ(Matrix<int>(big.view().block(0, 0, 40, 50)), expectedProduct(A, P.view()));
+    setStructureDetection(false);
+}
+
+TEST(StructureTest, OffByDefaultAndPreparedProducts) {
+
+    EXPECT_FALSE(structureDetection());
+    const Matrix<int> A = binaryMatrix(200, 200), B = binaryMatrix(200, 200);
+    EXPECT_EQ(multiply(A, B), expectedProduct(A.view(), B.view()));
+
+    // A cached product keeps to the structured path as well.
+    setStructureDetection(true);
+    ProductCache cache;
+    Matrix<int> C(200, 200);
+    cache.multiply(A.view(), B.view(), C.view());
+    EXPECT_EQ(C, expectedProduct(A.view(), B.view()));
+    setStructureDetection(false);
+}
+
+TEST(StructureTest, MultiplyBinaryRejectsOtherMatrices) {
+
+    const Matrix<int> A = binaryMatrix(4, 5), B = binaryMatrix(5, 6);
+    Matrix<int> C(4, 6), wrong(4, 7);
+    EXPECT_THROW(multiplyBinary(A.view(), B.view(), wrong.view()), std::invalid_argument);
+    Matrix<int> two = B;
+    two(4, 5) = 2;
+    EXPECT_THROW(multiplyBinary(A.view(), two.view(), C.view()), std::invalid_argument);
+
+    // An empty inner dimension gives zeros.
+    Matrix<int> zeros(4, 6, -1);
+    multiplyBinary(Matrix<int>(4, 0).view(), Matrix<int>(0, 6).view(), zeros.view());
+    EXPECT_EQ(zeros, Matrix<int>(4, 6, 0));
+}
@@ -0,0 +1,46 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the cache-blocked engine and its tile size calibration.
+// Every product is checked against multiplyMatricesWithoutErrors.
+
+TEST(TiledMultiplicationTest, CalibratedTileSizes) {
+
+    TileSizes tiles = calibrateTileSizes();
+
+    ASSERT_GT(tiles.mc, 0);
+    ASSERT_GT(tiles.nc, 0);
+    ASSERT_GT(tiles.kc, 0);
+}
+
+TEST(TiledMultiplicationTest, PartialTiles) {
+
+    // Tile sizes that do not divide any dimension, so every edge is partial
+    setTileSizes({5, 7, 3});
+
+    Matrix<int> A(23, 17), B(17, 31);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Tiled), expectedProduct(A, B));
+}
+
+TEST(TiledMultiplicationTest, BigRectangularMatrices) {
+
+    setTileSizes(calibrateTileSizes());
+
+    Matrix<int> A(150, 230), B(230, 170);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+
+    ASSERT_EQ(multiply(A, B, Engine::Tiled), expectedProduct(A, B));
+}
+
+TEST(TiledMultiplicationTest, InvalidTileSizes) {
+
+    ASSERT_THROW(setTileSizes({0, 16, 16}), std::invalid_argument);
+}
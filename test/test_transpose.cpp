@@ -0,0 +1,167 @@
+#include "matrix_multiplication.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "test_helpers.h"
+#include "../src/packing.h"
+
+// Tests for the transposed products and the transposes of transpose.h.
+// Products are checked against multiplyMatricesWithoutErrors on explicitly
+// transposed copies.
+
+// Transpose by the definition
+Matrix<int> naiveTranspose(const Matrix<int>& A) {
+    Matrix<int> At(A.cols(), A.rows());
+    for (int i = 0; i < A.rows(); ++i)
+        for (int j = 0; j < A.cols(); ++j)
+            At(j, i) = A(i, j);
+    return At;
+}
+
+TEST(TransposeTest, PackedPanelsOfTransposedOperands) {
+
+    // Packing A^T and B^T in place gives the panels of the explicit transposes.
+    const Matrix<int> At = randomMatrix(7, 10), Bt = randomMatrix(9, 6);
+    std::vector<int> expected(12 * 7), packed(12 * 7, -1);
+    packA<int>(naiveTranspose(At), 4, expected.data());
+    packATransposed<int>(At, 4, packed.data());
+    EXPECT_EQ(packed, expected);
+
+    packA<int>(naiveTranspose(At), 4, expected.data(), 3);
+    packATransposed<int>(At, 4, packed.data(), 3);
+    EXPECT_EQ(packed, expected);
+
+    expected.assign(6 * 12, 0);
+    packed.assign(6 * 12, -1);
+    packB<int>(naiveTranspose(Bt), 4, expected.data());
+    packBTransposed<int>(Bt, 4, packed.data());
+    EXPECT_EQ(packed, expected);
+}
+
+TEST(TransposeTest, AllFlagsAndEngines) {
+
+    setThreadCount(4);
+    const TileSizes saved = tileSizes();
+    setTileSizes({48, 64, 40});
+    const int shapes[][3] = {{3, 5, 2}, {1, 1, 1}, {70, 90, 50}, {129, 65, 257}, {200, 150, 210}};
+    const Engine engines[] = {Engine::Auto, Engine::Reference, Engine::Tiled, Engine::Simd,
+                              Engine::Parallel, Engine::Strassen, Engine::Sparse};
+    for (const auto& shape : shapes) {
+        const Matrix<int> A = randomMatrix(shape[0], shape[1]), B = randomMatrix(shape[1], shape[2]);
+        const Matrix<int> At = naiveTranspose(A), Bt = naiveTranspose(B);
+        const Matrix<int> expected = expectedProduct(A, B);
+        for (Engine engine : engines) {
+            Matrix<int> C(shape[0], shape[2], -1);
+            multiply(At.view(), Transpose::Yes, B.view(), Transpose::No, C.view(), engine);
+            EXPECT_EQ(C, expected) << "A^T B, " << shape[0] << "x" << shape[1] << "x" << shape[2];
+            C = Matrix<int>(shape[0], shape[2], -1);
+            multiply(A.view(), Transpose::No, Bt.view(), Transpose::Yes, C.view(), engine);
+            EXPECT_EQ(C, expected) << "A B^T";
+            C = Matrix<int>(shape[0], shape[2], -1);
+            multiply(At.view(), Transpose::Yes, Bt.view(), Transpose::Yes, C.view(), engine);
+            EXPECT_EQ(C, expected) << "A^T B^T";
+            C = Matrix<int>(shape[0], shape[2], -1);
+            multiply(A.view(), Transpose::No, B.view(), Transpose::No, C.view(), engine);
+            EXPECT_EQ(C, expected) << "A B";
+        }
+    }
+    setTileSizes(saved);
+}
+
+TEST(TransposeTest, BlocksOfLargerMatrices) {
+
+    // Operands with padded leading dimensions, transposed into a block of C.
+    Matrix<int> bigA = randomMatrix(200, 180), bigB = randomMatrix(190, 170);
+    Matrix<int> bigC(150, 150);
+    const ConstMatrixView<int> At = bigA.view().block(5, 7, 120, 100);
+    const ConstMatrixView<int> Bt = bigB.view().block(3, 2, 110, 120);
+    multiply(At, Transpose::Yes, Bt, Transpose::Yes, bigC.view().block(10, 20, 100, 110), Engine::Simd);
+    const Matrix<int> expected = expectedProduct(naiveTranspose(Matrix<int>(At)), naiveTranspose(Matrix<int>(Bt)));
+    for (int i = 0; i < 150; ++i)
+        for (int j = 0; j < 150; ++j) {
+            const bool inside = i >= 10 && i < 110 && j >= 20 && j < 130;
+            EXPECT_EQ(bigC(i, j), inside ? expected(i - 10, j - 20) : 0);
+        }
+}
+
+TEST(TransposeTest, FloatingPoint) {
+
+    Matrix<float> Af(150, 120), Bf(140, 120), Cf(150, 140);
+    Matrix<double> Ad(150, 120), Bd(140, 120), Cd(150, 140);
+    for (int i = 0; i < 150; ++i)
+        for (int k = 0; k < 120; ++k)
+            Af(i, k) = static_cast<float>(Ad(i, k) = (std::rand() % 20) - 10);
+    for (int j = 0; j < 140; ++j)
+        for (int k = 0; k < 120; ++k)
+            Bf(j, k) = static_cast<float>(Bd(j, k) = (std::rand() % 20) - 10);
+
+    multiply(Af.view(), Transpose::No, Bf.view(), Transpose::Yes, Cf.view(), Engine::Parallel);
+    multiply(Ad.view(), Transpose::No, Bd.view(), Transpose::Yes, Cd.view());
+    // Sums of small integers are exact in both types.
+    for (int i = 0; i < 150; ++i)
+        for (int j = 0; j < 140; ++j) {
+            double expected = 0;
+            for (int k = 0; k < 120; ++k)
+                expected += Ad(i, k) * Bd(j, k);
+            EXPECT_EQ(Cd(i, j), expected);
+            EXPECT_EQ(Cf(i, j), static_cast<float>(expected));
+        }
+}
+
+TEST(TransposeTest, DimensionMismatch) {
+
+    Matrix<int> A(4, 5), B(3, 5), C(4, 3);
+    EXPECT_NO_THROW(multiply(A.view(), Transpose::No, B.view(), Transpose::Yes, C.view()));
+    EXPECT_THROW(multiply(A.view(), Transpose::No, B.view(), Transpose::No, C.view()), std::invalid_argument);
+    EXPECT_THROW(multiply(A.view(), Transpose::Yes, B.view(), Transpose::Yes, C.view()), std::invalid_argument);
+    Matrix<int> wrong(3, 4);
+    EXPECT_THROW(multiply(A.view(), Transpose::No, B.view(), Transpose::Yes, wrong.view()), std::invalid_argument);
+    EXPECT_THROW(transpose<int>(A.view(), wrong.view()), std::invalid_argument);
+    EXPECT_THROW(transposeInPlace(A.view()), std::invalid_argument);
+}
+
+TEST(TransposeTest, OutOfPlace) {
+
+    const int shapes[][2] = {{1, 1}, {1, 100}, {100, 1}, {33, 65}, {300, 70}, {257, 513}};
+    for (const auto& shape : shapes) {
+        const Matrix<int> A = randomMatrix(shape[0], shape[1]);
+        EXPECT_EQ(transpose(A), naiveTranspose(A)) << shape[0] << "x" << shape[1];
+    }
+
+    // Into a block of a larger matrix, from a block of another.
+    const Matrix<int> big = randomMatrix(100, 100);
+    Matrix<int> target(80, 80);
+    transpose<int>(big.view().block(10, 5, 40, 70), target.view().block(2, 3, 70, 40));
+    for (int i = 0; i < 40; ++i)
+        for (int j = 0; j < 70; ++j)
+            EXPECT_EQ(target(2 + j, 3 + i), big(10 + i, 5 + j));
+}
+
+TEST(TransposeTest, InPlace) {
+
+    const int shapes[][2] = {{1, 1}, {2, 2}, {64, 64}, {97, 97}, {1, 50}, {50, 1}, {3, 7}, {64, 200}, {131, 77}};
+    for (const auto& shape : shapes) {
+        Matrix<int> A = randomMatrix(shape[0], shape[1]);
+        const Matrix<int> expected = naiveTranspose(A);
+        transposeInPlace(A);
+        EXPECT_EQ(A, expected) << shape[0] << "x" << shape[1];
+    }
+
+    // Square blocks of a larger matrix, leaving the rest alone.
+    Matrix<int> big = randomMatrix(150, 160);
+    const Matrix<int> original = big;
+    transposeInPlace(big.view().block(10, 20, 100, 100));
+    for (int i = 0; i < 150; ++i)
+        for (int j = 0; j < 160; ++j) {
+            const bool inside = i >= 10 && i < 110 && j >= 20 && j < 120;
+            EXPECT_EQ(big(i, j), inside ? original(10 + j - 20, 20 + i - 10) : original(i, j));
+        }
+
+    // Padded rows go through a copy.
+    Matrix<int> padded(30, 50, 64, 0);
+    fillMatrixRandomly(padded);
+    const Matrix<int> expected = naiveTranspose(padded);
+    transposeInPlace(padded);
+    EXPECT_EQ(padded, expected);
+}
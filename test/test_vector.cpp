@@ -0,0 +1,138 @@
+#include "matrix_multiplication.h"
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <vector>
+#include "test_helpers.h"
+
+// Tests for the products with a dimension of 1, which Engine::Auto runs
+// with the vector kernels: dot, matrix-vector, vector-matrix and outer
+// products.
+
+// Checks C against the product of A and B computed in long double
+template <typename T>
+void expectNearProduct(ConstMatrixView<T> A, ConstMatrixView<T> B, ConstMatrixView<T> C) {
+    const long double tolerance = (A.cols() + 1) * (sizeof(T) == 4 ? 1e-6L : 1e-14L);
+    for (int i = 0; i < A.rows(); ++i)
+        for (int j = 0; j < B.cols(); ++j) {
+            long double expected = 0;
+            for (int k = 0; k < A.cols(); ++k)
+                expected += static_cast<long double>(A(i, k)) * B(k, j);
+            ASSERT_LE(std::fabs(expected - C(i, j)), tolerance) << "at (" << i << ", " << j << ")";
+        }
+}
+
+// Shapes of every route: dot products, matrix-vector and vector-matrix
+// products with partial blocks of rows and lanes, outer products, and
+// scalar times vector.
+const int shapes[][3] = {{1, 1, 1}, {1, 7, 1}, {1, 1000, 1}, {37, 45, 1}, {130, 3, 1},
+                         {1, 45, 37}, {1, 300, 2500}, {53, 1, 47}, {1, 1, 200}, {200, 1, 1}};
+
+TEST(VectorTest, IntShapesOfEveryIsa) {
+
+    setThreadCount(1);
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        for (const auto& shape : shapes) {
+            const Matrix<int> A = randomMatrix<int>(shape[0], shape[1]);
+            const Matrix<int> B = randomMatrix<int>(shape[1], shape[2]);
+            ASSERT_EQ(multiply(A, B), expectedProduct(A.view(), B.view()))
+                << simdIsaName(isa) << " " << shape[0] << "x" << shape[1] << "x" << shape[2];
+        }
+    }
+    setSimdIsa(detectSimdIsa());
+    setThreadCount(4);
+}
+
+TEST(VectorTest, FloatingPointShapesOfEveryIsa) {
+
+    for (SimdIsa isa : supportedIsas()) {
+        setSimdIsa(isa);
+        for (const auto& shape : shapes) {
+            const Matrix<float> A = randomMatrix<float>(shape[0], shape[1]);
+            const Matrix<float> B = randomMatrix<float>(shape[1], shape[2]);
+            expectNearProduct<float>(A.view(), B.view(), multiply(A, B).view());
+            const Matrix<double> D = randomMatrix<double>(shape[0], shape[1]);
+            const Matrix<double> E = randomMatrix<double>(shape[1], shape[2]);
+            expectNearProduct<double>(D.view(), E.view(), multiply(D, E).view());
+        }
+    }
+    setSimdIsa(detectSimdIsa());
+}
+
+TEST(VectorTest, WrapsLikeTheOtherEngines) {
+
+    const Matrix<int> A(40, 200, 1 << 20), B(200, 1, 1 << 15), x(1, 40, 1 << 16);
+    EXPECT_EQ(multiply(A, B), multiply(A, B, Engine::Reference));
+    EXPECT_EQ(multiply(x, A), multiply(x, A, Engine::Reference));
+    EXPECT_EQ(multiply(B, x), multiply(B, x, Engine::Reference));
+}
+
+TEST(VectorTest, StridedViews) {
+
+    // Columns and rows of larger matrices: x, y and C are not contiguous.
+    const Matrix<int> A = randomMatrix<int>(90, 120);
+    const Matrix<int> B = randomMatrix<int>(120, 80);
+    Matrix<int> C(100, 100, -1);
+
+    const ConstMatrixView<int> column = B.view().block(0, 7, 120, 1);
+    multiply(A.view(), column, C.view().block(3, 5, 90, 1));
+    EXPECT_EQ(Matrix<int>(C.view().block(3, 5, 90, 1)), expectedProduct(A.view(), column));
+    EXPECT_EQ(C(2, 5), -1);
+    EXPECT_EQ(C(93, 5), -1);
+    EXPECT_EQ(C(3, 4), -1);
+
+    const ConstMatrixView<int> row = A.view().block(11, 0, 1, 120);
+    multiply(row, B.view().block(0, 10, 120, 70), C.view().block(50, 20, 1, 70));
+    EXPECT_EQ(Matrix<int>(C.view().block(50, 20, 1, 70)),
+              expectedProduct(row, B.view().block(0, 10, 120, 70)));
+
+    const ConstMatrixView<int> left = A.view().block(0, 9, 90, 1);
+    multiply(left, row.block(0, 0, 1, 30), C.view().block(5, 60, 90, 30));
+    EXPECT_EQ(Matrix<int>(C.view().block(5, 60, 90, 30)), expectedProduct(left, row.block(0, 0, 1, 30)));
+    EXPECT_EQ(C(4, 60), -1);
+    EXPECT_EQ(C(5, 59), -1);
+
+    multiply(row, column, C.view().block(99, 99, 1, 1));
+    EXPECT_EQ(C(99, 99), expectedProduct(row, column)(0, 0));
+}
+
+TEST(VectorTest, ParallelMatchesSerial) {
+
+    // Large enough to be split over the pool; the pieces of a dot product
+    // are added in order, so even float results do not depend on the thread
+    // count.
+    const Matrix<float> A = randomMatrix<float>(2000, 600);
+    const Matrix<float> x = randomMatrix<float>(600, 1);
+    const Matrix<float> row = randomMatrix<float>(1, 2000);
+    const Matrix<float> B = randomMatrix<float>(2000, 700);
+    const Matrix<float> u = randomMatrix<float>(1, 500000), v = randomMatrix<float>(500000, 1);
+    const Matrix<int> a = randomMatrix<int>(900, 1), b = randomMatrix<int>(1, 800);
+
+    setThreadCount(1);
+    const Matrix<float> gemv = multiply(A, x), gevm = multiply(row, B), dot = multiply(u, v);
+    const Matrix<int> outer = multiply(a, b);
+    for (int threads : {2, 4, 7}) {
+        setThreadCount(threads);
+        EXPECT_EQ(multiply(A, x), gemv) << threads;
+        EXPECT_EQ(multiply(row, B), gevm) << threads;
+        EXPECT_EQ(multiply(u, v), dot) << threads;
+        EXPECT_EQ(multiply(a, b), outer) << threads;
+    }
+    expectNearProduct<float>(A.view(), x.view(), gemv.view());
+    expectNearProduct<float>(row.view(), B.view(), gevm.view());
+    EXPECT_EQ(outer, expectedProduct(a.view(), b.view()));
+    setThreadCount(4);
+}
+
+TEST(VectorTest, NestedVectorAdapterAndAsync) {
+
+    const Matrix<int> A = randomMatrix<int>(300, 200), x = randomMatrix<int>(200, 1);
+    std::vector<std::vector<int>> C;
+    multiply(A.toNested(), x.toNested(), C, 300, 200, 1);
+    EXPECT_EQ(Matrix<int>(C), expectedProduct(A.view(), x.view()));
+
+    Matrix<int> y(300, 1);
+    multiplyAsync(A.view(), x.view(), y.view()).get();
+    EXPECT_EQ(y, expectedProduct(A.view(), x.view()));
+}
@@ -0,0 +1,171 @@
+#include "matrix_multiplication.h"
+#include <cmath>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include "../src/checksums.h"
+#include "test_helpers.h"
+
+// Tests for the Freivalds checks and the checksummed products of
+// verification.h.
+
+VerificationOptions seeded(int rounds, std::uint64_t seed = 42) {
+    VerificationOptions options;
+    options.rounds = rounds;
+    options.seed = seed;
+    return options;
+}
+
+TEST(VerificationTest, CorrectIntProductsPass) {
+
+    setThreadCount(4);
+    const int shapes[][3] = {{1, 1, 1}, {5, 7, 3}, {70, 90, 50}, {129, 65, 257}, {256, 256, 256}};
+    for (const auto& shape : shapes) {
+        Matrix<int> A(shape[0], shape[1]), B(shape[1], shape[2]);
+        fillMatrixRandomly(A);
+        fillMatrixRandomly(B);
+        for (Engine engine : {Engine::Auto, Engine::Simd, Engine::Parallel, Engine::Strassen}) {
+            Matrix<int> C(shape[0], shape[2]);
+            multiply(A.view(), B.view(), C.view(), engine);
+            EXPECT_TRUE(verifyProduct(A.view(), B.view(), C.view()));
+            EXPECT_NO_THROW(multiplyVerified(A.view(), B.view(), C.view(), engine));
+        }
+    }
+
+    // Exact in the wrapping arithmetic, whatever the overflow.
+    Matrix<int> A(40, 60, 1 << 20), B(60, 30, 1 << 21), C(40, 30);
+    multiply(A.view(), B.view(), C.view());
+    EXPECT_TRUE(verifyProduct(A.view(), B.view(), C.view(), seeded(8)));
+}
+
+TEST(VerificationTest, WrongIntElementsFail) {
+
+    Matrix<int> A(100, 80), B(80, 120);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    const Matrix<int> product = expectedProduct(A, B);
+
+    for (int seed = 1; seed <= 20; ++seed) {
+        Matrix<int> C = product;
+        C(seed * 4, seed * 5) += 1;
+        EXPECT_FALSE(verifyProduct(A.view(), B.view(), C.view(), seeded(1, seed)));
+    }
+    Matrix<int> C = product;
+
+    // An error of 2^31 passes a round half of the time; 32 rounds miss it with
+    // probability 2^-32.
+    C(10, 10) = static_cast<int>(static_cast<unsigned>(C(10, 10)) + (1u << 31));
+    EXPECT_FALSE(verifyProduct(A.view(), B.view(), C.view(), seeded(32)));
+}
+
+TEST(VerificationTest, FloatingPointBound) {
+
+    Matrix<float> Af(150, 300), Bf(300, 120), Cf(150, 120);
+    Matrix<double> Ad(150, 300), Bd(300, 120), Cd(150, 120);
+    fillMatrixRandomly(Af);
+    fillMatrixRandomly(Bf);
+    fillMatrixRandomly(Ad);
+    fillMatrixRandomly(Bd);
+    for (Engine engine : {Engine::Reference, Engine::Tiled, Engine::Simd, Engine::Parallel}) {
+        multiply(Af.view(), Bf.view(), Cf.view(), engine);
+        multiply(Ad.view(), Bd.view(), Cd.view(), engine);
+        EXPECT_TRUE(verifyProduct(Af.view(), Bf.view(), Cf.view()));
+        EXPECT_TRUE(verifyProduct(Ad.view(), Bd.view(), Cd.view()));
+    }
+
+    // Far beyond the worst-case rounding, which for float at K = 300 is
+    // about 10^-4 of |A| |B| |x|.
+    Cf(3, 4) += 50;
+    Cd(5, 6) += 1e-8;
+    EXPECT_FALSE(verifyProduct(Af.view(), Bf.view(), Cf.view(), seeded(2)));
+    EXPECT_FALSE(verifyProduct(Ad.view(), Bd.view(), Cd.view(), seeded(2)));
+    Cf(3, 4) = std::numeric_limits<float>::quiet_NaN();
+    EXPECT_FALSE(verifyProduct(Af.view(), Bf.view(), Cf.view()));
+}
+
+TEST(VerificationTest, InvalidArguments) {
+
+    Matrix<int> A(4, 5), B(6, 3), C(4, 3);
+    EXPECT_THROW(verifyProduct(A.view(), B.view(), C.view()), std::invalid_argument);
+    EXPECT_THROW(multiplyVerified(A.view(), B.view(), C.view()), std::invalid_argument);
+    EXPECT_THROW(multiplyWithChecksums(A.view(), B.view(), C.view()), std::invalid_argument);
+    Matrix<int> D(5, 3);
+    EXPECT_THROW(verifyProduct(A.view(), D.view(), C.view(), seeded(0)), std::invalid_argument);
+}
+
+TEST(ChecksumTest, ProductsCarryTheirSums) {
+
+    setThreadCount(4);
+    Matrix<int> A(130, 200), B(200, 170);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    const Matrix<int> expected = expectedProduct(A, B);
+    for (Engine engine : {Engine::Auto, Engine::Reference, Engine::Simd, Engine::Parallel, Engine::Strassen}) {
+        Matrix<int> C(130, 170);
+        const ChecksumReport report = multiplyWithChecksums(A.view(), B.view(), C.view(), engine);
+        EXPECT_TRUE(report.valid());
+        EXPECT_TRUE(report.rows.empty());
+        EXPECT_TRUE(report.columns.empty());
+        EXPECT_FALSE(report.corrected);
+        EXPECT_EQ(C, expected);
+    }
+
+    Matrix<double> Ad(100, 150), Bd(150, 90), Cd(100, 90);
+    Matrix<float> Af(100, 150), Bf(150, 90), Cf(100, 90);
+    fillMatrixRandomly(Ad);
+    fillMatrixRandomly(Bd);
+    fillMatrixRandomly(Af);
+    fillMatrixRandomly(Bf);
+    for (Engine engine : {Engine::Reference, Engine::Simd, Engine::Parallel}) {
+        EXPECT_TRUE(multiplyWithChecksums(Ad.view(), Bd.view(), Cd.view(), engine).rows.empty());
+        EXPECT_TRUE(multiplyWithChecksums(Af.view(), Bf.view(), Cf.view(), engine).columns.empty());
+    }
+}
+
+TEST(ChecksumTest, SingleErrorIsCorrected) {
+
+    Matrix<int> A(60, 70), B(70, 50);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    const Matrix<int> Af = appendColumnSums<int>(A.view());
+    const Matrix<int> Bf = appendRowSums<int>(B.view());
+    ASSERT_EQ(Af.rows(), 61);
+    ASSERT_EQ(Bf.cols(), 51);
+    Matrix<int> Cf = multiply(Af, Bf);
+    const Matrix<int> clean = Cf;
+
+    Cf(17, 23) ^= 1 << 12;
+    const ChecksumReport report = checkChecksums<int>(A.view(), B.view(), Cf.view());
+    EXPECT_EQ(report.rows, std::vector<int>{17});
+    EXPECT_EQ(report.columns, std::vector<int>{23});
+    EXPECT_TRUE(report.corrected);
+    EXPECT_TRUE(report.valid());
+    EXPECT_EQ(Cf, clean);
+
+    // Two errors in different rows and columns are detected, not corrected.
+    Cf(1, 2) += 5;
+    Cf(3, 4) -= 7;
+    const ChecksumReport twice = checkChecksums<int>(A.view(), B.view(), Cf.view());
+    EXPECT_EQ(twice.rows, (std::vector<int>{1, 3}));
+    EXPECT_EQ(twice.columns, (std::vector<int>{2, 4}));
+    EXPECT_FALSE(twice.corrected);
+    EXPECT_FALSE(twice.valid());
+}
+
+TEST(ChecksumTest, FloatingPointCorrection) {
+
+    Matrix<double> A(80, 90), B(90, 70);
+    fillMatrixRandomly(A);
+    fillMatrixRandomly(B);
+    const Matrix<double> Af = appendColumnSums<double>(A.view());
+    const Matrix<double> Bf = appendRowSums<double>(B.view());
+    Matrix<double> Cf = multiply(Af, Bf, Engine::Simd);
+    const double clean = Cf(40, 30);
+
+    Cf(40, 30) += 0.5;
+    const ChecksumReport report = checkChecksums<double>(A.view(), B.view(), Cf.view());
+    EXPECT_TRUE(report.corrected);
+    EXPECT_NEAR(Cf(40, 30), clean, 1e-9);
+}